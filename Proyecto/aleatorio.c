@@ -0,0 +1,75 @@
+#include<stdio.h>
+#include<string.h>
+#include<stdlib.h>
+#include<errno.h>
+#include<fcntl.h>
+#include<unistd.h>
+#include<sys/random.h>
+
+#include "aleatorio.h"
+
+#define RESERVA_ALEATORIO 256
+
+static __thread unsigned char reserva[RESERVA_ALEATORIO];
+static __thread int usados = RESERVA_ALEATORIO;
+
+/** Llena destino con bytes del núcleo: getrandom, o /dev/urandom en un núcleo que no lo tiene **/
+static void llenar(unsigned char *destino, int largo)
+{
+    int leidos = 0, fd;
+    while (leidos < largo)
+    {
+        ssize_t n = getrandom(destino + leidos,largo - leidos,0);
+        if (n > 0)
+            leidos += n;
+        else if (n < 0 && errno != EINTR)
+            break;
+    }
+    if (leidos == largo)
+        return;
+    if ((fd = open("/dev/urandom",O_RDONLY)) >= 0)
+    {
+        while (leidos < largo)
+        {
+            ssize_t n = read(fd,destino + leidos,largo - leidos);
+            if (n > 0)
+                leidos += n;
+            else if (n == 0 || errno != EINTR)
+                break;
+        }
+        close(fd);
+    }
+    if (leidos < largo)
+    {
+        perror("getrandom error");
+        abort();
+    }
+}
+
+static void tomar(void *destino, int largo)
+{
+    if (usados + largo > RESERVA_ALEATORIO)
+    {
+        llenar(reserva,RESERVA_ALEATORIO);
+        usados = 0;
+    }
+    memcpy(destino,reserva + usados,largo);
+    usados += largo;
+}
+
+unsigned short aleatorioId()
+{
+    unsigned short id;
+    tomar(&id,sizeof(id));
+    return id;
+}
+
+unsigned int aleatorioMenor(unsigned int limite)
+{
+    /** se descartan los valores del último tramo incompleto, para que no haya sesgo **/
+    unsigned int valor, tope = 0xFFFFFFFFu - 0xFFFFFFFFu % limite;
+    do
+        tomar(&valor,sizeof(valor));
+    while (valor >= tope);
+    return valor % limite;
+}
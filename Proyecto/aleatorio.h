@@ -0,0 +1,20 @@
+#ifndef ALEATORIO_H_INCLUDED
+#define ALEATORIO_H_INCLUDED
+
+/**
+ * Números al azar del generador del núcleo (getrandom), para todo lo que un tercero no debe poder
+ * adivinar: el ID de cada consulta (RFC 5452 9.2), en resolverConsulta, el motor, el priming de la
+ * raíz y las transferencias. No se usa rand(): su estado es uno solo para todo el proceso y con
+ * una semilla de pid y reloj la secuencia se puede reconstruir.
+ *
+ * Cada hilo guarda una reserva de bytes y la repone con una sola llamada al sistema cuando se
+ * acaba, así que el motor no paga un getrandom por consulta. Seguro entre hilos.
+ **/
+
+/** ID de 16 bits para una consulta **/
+unsigned short aleatorioId();
+
+/** Entero entre 0 y limite - 1 (limite > 0) **/
+unsigned int aleatorioMenor(unsigned int limite);
+
+#endif // ALEATORIO_H_INCLUDED
@@ -0,0 +1,292 @@
+#include<stdio.h>
+#include<string.h>
+#include<stdlib.h>
+#include<sys/socket.h>
+#include<arpa/inet.h>
+#include<netinet/in.h>
+
+#include "dns.h"
+#include "tipos_rr.h"
+#include "traza.h"
+#include "motor.h"
+#include "barrido.h"
+#include "escritor.h"
+#include "secciones.h"
+
+#define MAX_RANGOS 64
+
+typedef struct
+{
+    int familia;                    // AF_INET o AF_INET6
+    unsigned char base[16];         // primera dirección del rango (ya enmascarada)
+    unsigned long cantidad;         // direcciones del rango
+} RANGO;
+
+typedef struct
+{
+    RANGO rangos[MAX_RANGOS];
+    int cantidadRangos;
+    int actual;                     // rango que se está recorriendo
+    unsigned long siguiente;        // próxima dirección dentro del rango actual
+
+    ESCRITOR *salida;
+    long conPTR, nxdomain, nodata, timeouts, errores;
+    SECCIONES secciones;            // la respuesta en proceso; la reserva sirve para todas
+} BARRIDO;
+
+/** Lo que el callback necesita de cada consulta: la dirección en texto y el barrido **/
+typedef struct
+{
+    BARRIDO *barrido;
+    char ip[INET6_ADDRSTRLEN];
+} CONSULTA_PTR;
+
+/** Labels decimales precalculados ("\1" "7", "\3" "192"...) para los octetos IPv4 **/
+static unsigned char etiquetasDecimales[256][4];
+static const char digitosHex[] = "0123456789abcdef";
+
+static void iniciarEtiquetas()
+{
+    int i;
+    for (i = 0; i < 256; i++)
+    {
+        char texto[4];
+        int largo = sprintf(texto,"%d",i);
+        etiquetasDecimales[i][0] = largo;
+        memcpy(&etiquetasDecimales[i][1],texto,largo);
+    }
+}
+
+/**
+ * Escribe el nombre inverso de la dirección directamente en formato DNS, sin pasar por
+ * "d.c.b.a.in-addr.arpa" ni por cambiarAlFormatoNombreDNS. Devuelve los bytes escritos.
+ **/
+static int armarNombreInverso(const unsigned char *dir, int familia, unsigned char *destino)
+{
+    unsigned char *p = destino;
+    int i;
+    if (familia == AF_INET)
+    {
+        for (i = 3; i >= 0; i--)
+        {
+            memcpy(p,etiquetasDecimales[dir[i]],etiquetasDecimales[dir[i]][0] + 1);
+            p += etiquetasDecimales[dir[i]][0] + 1;
+        }
+        memcpy(p,"\7in-addr\4arpa",14);     /** incluye el 0 final del nombre **/
+        p += 14;
+    }
+    else
+    {
+        /** un label por nibble, del menos significativo al más significativo (RFC 3596) **/
+        for (i = 15; i >= 0; i--)
+        {
+            *p++ = 1;
+            *p++ = digitosHex[dir[i] & 0x0f];
+            *p++ = 1;
+            *p++ = digitosHex[dir[i] >> 4];
+        }
+        memcpy(p,"\3ip6\4arpa",10);
+        p += 10;
+    }
+    return p - destino;
+}
+
+/** Interpreta "direccion[/prefijo]"; devuelve 0 o -1 si el rango no es válido **/
+static int leerRango(char *texto, RANGO *rango)
+{
+    char *barra = strchr(texto,'/');
+    int prefijo, bits, i;
+    if (barra != NULL)
+        *barra = '\0';
+    if (inet_pton(AF_INET,texto,rango->base) == 1)
+        rango->familia = AF_INET, bits = 32;
+    else if (inet_pton(AF_INET6,texto,rango->base) == 1)
+        rango->familia = AF_INET6, bits = 128;
+    else
+    {
+        printf("ERROR: dirección no válida en el rango %s\n",texto);
+        return -1;
+    }
+    prefijo = (barra != NULL) ? atoi(barra + 1) : bits;
+    if (prefijo < 0 || prefijo > bits || (bits - prefijo > 24))
+    {
+        printf("ERROR: el rango %s/%d es demasiado grande (máximo %d direcciones)\n",texto,prefijo,MAX_DIRECCIONES_RANGO);
+        return -1;
+    }
+    /** pongo en cero los bits que no forman parte del prefijo **/
+    for (i = 0; i < bits / 8; i++)
+    {
+        int resto = prefijo - i * 8;
+        if (resto <= 0)
+            rango->base[i] = 0;
+        else if (resto < 8)
+            rango->base[i] &= (unsigned char)(0xff << (8 - resto));
+    }
+    rango->cantidad = 1UL << (bits - prefijo);
+    return 0;
+}
+
+/** Copia en dir la próxima dirección a consultar; devuelve 0 cuando no quedan más **/
+static int siguienteDireccion(BARRIDO *b, unsigned char *dir, int *familia)
+{
+    while (b->actual < b->cantidadRangos && b->siguiente >= b->rangos[b->actual].cantidad)
+    {
+        b->actual++;
+        b->siguiente = 0;
+    }
+    if (b->actual == b->cantidadRangos)
+        return 0;
+
+    RANGO *r = &b->rangos[b->actual];
+    int largo = (r->familia == AF_INET) ? 4 : 16, i;
+    unsigned long desplazamiento = b->siguiente++;
+    memcpy(dir,r->base,largo);
+    /** como mucho 2^24 direcciones: basta con sumar sobre los últimos bytes **/
+    for (i = largo - 1; i >= 0 && desplazamiento > 0; i--, desplazamiento >>= 8)
+        dir[i] |= desplazamiento & 0xff;
+    *familia = r->familia;
+    return 1;
+}
+
+static void respuestaPTR(void *contexto, unsigned char *respuesta, int largo, int inicioRespuestas,
+                         long long rtt, int estado)
+{
+    CONSULTA_PTR *c = (CONSULTA_PTR*)contexto;
+    BARRIDO *b = c->barrido;
+    SECCIONES *s = &b->secciones;
+    struct RESOURCE_RECORD *ptr = NULL;
+    int i;
+    RESULTADO r = {c->ip, T_PTR, ESTADO_TIMEOUT, rtt, NULL, 0};
+
+    if (estado == MOTOR_TIMEOUT)
+    {
+        r.rtt = -1;
+        b->timeouts++;
+    }
+    else if ((r.estado = cabeceraRcode(respuesta)) == 3)
+        b->nxdomain++;
+    else if (r.estado != 0)
+        b->errores++;
+    else
+    {
+        /** sólo los PTR de la sección answer (puede haber CNAME delante, RFC 2317) **/
+        seccionesLeer(s,respuesta,largo,inicioRespuestas);
+        for (i = s->inicio[SECCION_ANSWER]; i < s->inicio[SECCION_ANSWER+1]; i++)
+            r.cantidad += s->tipo[i] == T_PTR;
+        r.registros = seccionesRegistros(s,SECCION_ANSWER);
+        if (r.cantidad > 0 && r.cantidad < seccionesCantidad(s,SECCION_ANSWER))
+        {
+            /** hay otros tipos entre los PTR: se pasan al escritor sólo los PTR **/
+            ptr = (struct RESOURCE_RECORD*)malloc(r.cantidad * sizeof(struct RESOURCE_RECORD));
+            for (r.cantidad = 0, i = s->inicio[SECCION_ANSWER]; i < s->inicio[SECCION_ANSWER+1]; i++)
+                if (s->tipo[i] == T_PTR)
+                    ptr[r.cantidad++] = s->registros[i];
+            r.registros = ptr;
+        }
+        if (r.cantidad > 0)
+            b->conPTR++;
+        else
+            b->nodata++;
+    }
+    escritorResultado(b->salida,&r);
+    free(ptr);
+    free(c);
+}
+
+int barridoPTR(const char *rangos, const char *servidor, const char *puerto, const char *salida,
+               int formato, double qps, int enVuelo)
+{
+    static BARRIDO b;
+    DIRECCION destino;
+    unsigned char consulta[MAX_CONSULTA_MOTOR], dir[16];
+    char *copia, *parte, *resto;
+    unsigned long total = 0;
+    int familia;
+
+    memset(&b,0,sizeof(b));
+    copia = strdup(rangos);
+    for (parte = strtok_r(copia,",",&resto); parte != NULL; parte = strtok_r(NULL,",",&resto))
+    {
+        if (b.cantidadRangos == MAX_RANGOS)
+        {
+            printf("ERROR: demasiados rangos (máximo %d)\n",MAX_RANGOS);
+            free(copia);
+            return -1;
+        }
+        if (leerRango(parte,&b.rangos[b.cantidadRangos]) < 0)
+        {
+            free(copia);
+            return -1;
+        }
+        total += b.rangos[b.cantidadRangos++].cantidad;
+    }
+    free(copia);
+
+    if (direccionDesdeTexto(&destino,servidor,atoi(puerto)) < 0)
+    {
+        printf("ERROR: el servidor %s no es una dirección IPv4 ni IPv6\n",servidor);
+        return -1;
+    }
+
+    /** los resultados se acumulan en un buffer grande en lugar de escribirse de a uno (escritor.h) **/
+    if ((b.salida = escritorAbrir(salida,formato)) == NULL)
+        return -1;
+
+    MOTOR *m = motorCrear(enVuelo,qps,TIMEOUT_BARRIDO_MS,REINTENTOS_BARRIDO);
+    if (m == NULL)
+    {
+        perror("socket error");
+        return -1;
+    }
+    iniciarEtiquetas();
+
+    /** header fijo: un pedido estándar con recursion desired y una sola pregunta **/
+    CABECERA_DNS cabecera = {0};
+    cabecera.rd = 1;
+    cabecera.qdcount = 1;
+    cabeceraEscribir(&cabecera,consulta);
+
+    long long comienzo = trazaMicrosegundos();
+    int quedan = 1, largo = 0;
+    CONSULTA_PTR *pendiente = NULL;     /** armada pero sin enviar: el motor la rechazó **/
+    while (quedan || pendiente != NULL || motorEnVuelo(m) > 0)
+    {
+        while ((quedan || pendiente != NULL) && motorPuedeEnviarA(m,&destino))
+        {
+            if (pendiente == NULL)
+            {
+                if (!(quedan = siguienteDireccion(&b,dir,&familia)))
+                    break;
+                largo = 12 + armarNombreInverso(dir,familia,consulta + 12);
+                consulta[largo++] = 0;
+                consulta[largo++] = T_PTR;
+                consulta[largo++] = 0;
+                consulta[largo++] = 1;      /** clase IN **/
+
+                pendiente = (CONSULTA_PTR*)malloc(sizeof(CONSULTA_PTR));
+                pendiente->barrido = &b;
+                inet_ntop(familia,dir,pendiente->ip,sizeof(pendiente->ip));
+            }
+            /** si el motor no la toma se reintenta después de procesar, sin perder la dirección **/
+            if (motorEnviar(m,&destino,consulta,largo,respuestaPTR,pendiente) < 0)
+                break;
+            pendiente = NULL;
+        }
+        motorProcesar(m,100);
+    }
+    double segundos = (trazaMicrosegundos() - comienzo) / 1000000.0;
+    ESTADISTICAS_MOTOR e = motorEstadisticas(m);
+    motorDestruir(m);
+
+    /** el resumen va a la salida de error si los resultados salen por la estándar **/
+    FILE *resumen = escritorEnSalidaEstandar(b.salida) ? stderr : stdout;
+    escritorCerrar(b.salida);
+    seccionesLiberar(&b.secciones);
+    fprintf(resumen,";; barrido PTR: %lu direcciones en %.2f s (%.0f consultas/s)\n",total,segundos,
+            segundos > 0 ? total / segundos : 0);
+    fprintf(resumen,";; con PTR: %ld, NXDOMAIN: %ld, NODATA: %ld, otros rcode: %ld, timeouts: %ld\n",
+            b.conPTR,b.nxdomain,b.nodata,b.errores,b.timeouts);
+    fprintf(resumen,";; paquetes enviados: %ld (reintentos: %ld), respuestas descartadas: %ld\n",
+            e.enviadas + e.reintentos,e.reintentos,e.descartadas);
+    return 0;
+}
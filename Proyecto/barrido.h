@@ -0,0 +1,34 @@
+#ifndef BARRIDO_H_INCLUDED
+#define BARRIDO_H_INCLUDED
+
+/**
+ * Barrido masivo de DNS inverso (parámetro -ptr=).
+ * Recorre uno o más rangos CIDR (IPv4 o IPv6), arma para cada dirección la consulta PTR sobre
+ * in-addr.arpa / ip6.arpa directamente en el formato del paquete (sin pasar por el nombre con
+ * puntos) y las envía con el motor no bloqueante, con muchas consultas en vuelo a una tasa
+ * controlada. Los resultados se escriben a medida que llegan con el escritor elegido (escritor.h);
+ * en el formato de texto, una línea por dirección:
+ *      direccion<TAB>PTR<TAB>nombre        (una línea por cada PTR de la respuesta)
+ *      direccion<TAB>NXDOMAIN | NODATA | TIMEOUT | rcode
+ * El orden de los resultados es el de llegada de las respuestas, no el de las direcciones.
+ **/
+
+/** Cantidad máxima de direcciones de un rango (un /8 en IPv4, un /104 en IPv6) **/
+#define MAX_DIRECCIONES_RANGO (1 << 24)
+
+/** Espera por intento y reenvíos de cada consulta del barrido **/
+#define TIMEOUT_BARRIDO_MS 2000
+#define REINTENTOS_BARRIDO 2
+
+/**
+ * rangos: lista separada por comas de rangos CIDR o direcciones sueltas
+ *         ("192.0.2.0/24,2001:db8::/120,198.51.100.7").
+ * servidor/puerto: servidor recursivo al que se envían las consultas (IPv4 o IPv6).
+ * salida: archivo de resultados (NULL o "-" = salida estándar); formato: FORMATO_TEXTO, FORMATO_JSON...
+ * qps: consultas por segundo (0 = sin límite); enVuelo: consultas simultáneas como máximo.
+ * Devuelve 0 si el barrido terminó, -1 si hubo un error en los parámetros.
+ **/
+int barridoPTR(const char *rangos, const char *servidor, const char *puerto, const char *salida,
+               int formato, double qps, int enVuelo);
+
+#endif // BARRIDO_H_INCLUDED
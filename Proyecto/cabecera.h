@@ -0,0 +1,123 @@
+#ifndef CABECERA_H_INCLUDED
+#define CABECERA_H_INCLUDED
+
+#include <stdint.h>
+
+/**
+ * Códec de la cabecera de un mensaje (RFC 1035 4.1.1) y de los campos fijos de un RR (4.1.3).
+ * Todo se lee y se escribe de a byte, con desplazamientos y en el orden de red, sin superponer
+ * estructuras al paquete. No depende del orden en que el compilador acomoda los campos de bits,
+ * del relleno de las estructuras ni de la alineación del mensaje, así que vale en cualquier
+ * arquitectura; al ser static inline, el compilador reduce cada lectura a una carga y un bswap.
+ **/
+
+#define TAM_CABECERA 12
+#define TAM_PREGUNTA 4              /** QTYPE y QCLASS, después del nombre **/
+
+/** Enteros en el orden de red **/
+static inline unsigned int leer16(const unsigned char *p)
+{
+    return (p[0] << 8) | p[1];
+}
+
+static inline uint32_t leer32(const unsigned char *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static inline void escribir16(unsigned char *p, unsigned int valor)
+{
+    p[0] = valor >> 8;
+    p[1] = valor;
+}
+
+static inline void escribir32(unsigned char *p, uint32_t valor)
+{
+    p[0] = valor >> 24;
+    p[1] = valor >> 16;
+    p[2] = valor >> 8;
+    p[3] = valor;
+}
+
+/** La cabecera decodificada: cada indicador en su propio campo, los contadores en el orden de la máquina **/
+typedef struct
+{
+    uint16_t id;
+    uint8_t qr;                     // 0 consulta, 1 respuesta
+    uint8_t opcode;
+    uint8_t aa, tc, rd, ra;
+    uint8_t z;                      // reservado, 0
+    uint8_t ad, cd;                 // DNSSEC (RFC 4035 3.2)
+    uint8_t rcode;
+    uint16_t qdcount, ancount, nscount, arcount;
+} CABECERA_DNS;
+
+static inline void cabeceraLeer(const unsigned char *mensaje, CABECERA_DNS *c)
+{
+    c->id = leer16(mensaje);
+    c->qr = mensaje[2] >> 7;
+    c->opcode = (mensaje[2] >> 3) & 0x0f;
+    c->aa = (mensaje[2] >> 2) & 1;
+    c->tc = (mensaje[2] >> 1) & 1;
+    c->rd = mensaje[2] & 1;
+    c->ra = mensaje[3] >> 7;
+    c->z = (mensaje[3] >> 6) & 1;
+    c->ad = (mensaje[3] >> 5) & 1;
+    c->cd = (mensaje[3] >> 4) & 1;
+    c->rcode = mensaje[3] & 0x0f;
+    c->qdcount = leer16(mensaje + 4);
+    c->ancount = leer16(mensaje + 6);
+    c->nscount = leer16(mensaje + 8);
+    c->arcount = leer16(mensaje + 10);
+}
+
+static inline void cabeceraEscribir(const CABECERA_DNS *c, unsigned char *mensaje)
+{
+    escribir16(mensaje,c->id);
+    mensaje[2] = (c->qr << 7) | ((c->opcode & 0x0f) << 3) | (c->aa << 2) | (c->tc << 1) | c->rd;
+    mensaje[3] = (c->ra << 7) | (c->z << 6) | (c->ad << 5) | (c->cd << 4) | (c->rcode & 0x0f);
+    escribir16(mensaje + 4,c->qdcount);
+    escribir16(mensaje + 6,c->ancount);
+    escribir16(mensaje + 8,c->nscount);
+    escribir16(mensaje + 10,c->arcount);
+}
+
+/** El rcode sin decodificar el resto **/
+static inline int cabeceraRcode(const unsigned char *mensaje)
+{
+    return mensaje[3] & 0x0f;
+}
+
+/**
+ * Campos fijos de un RR ya decodificados, en el orden de la máquina. En el mensaje ocupan
+ * TAM_R_DATA (10) bytes justo después del nombre; sizeof de esta estructura no tiene nada que
+ * ver con eso, porque nunca se superpone al paquete.
+ **/
+struct R_DATA
+{
+    uint16_t type;
+    uint16_t _class;
+    uint32_t ttl;
+    uint16_t rdlength;
+};
+
+#define TAM_R_DATA 10
+
+/** Lee los campos fijos que empiezan en p (el byte siguiente al nombre del RR) **/
+static inline void camposRRLeer(const unsigned char *p, struct R_DATA *campos)
+{
+    campos->type = leer16(p);
+    campos->_class = leer16(p + 2);
+    campos->ttl = leer32(p + 4);
+    campos->rdlength = leer16(p + 8);
+}
+
+static inline void camposRREscribir(const struct R_DATA *campos, unsigned char *p)
+{
+    escribir16(p,campos->type);
+    escribir16(p + 2,campos->_class);
+    escribir32(p + 4,campos->ttl);
+    escribir16(p + 8,campos->rdlength);
+}
+
+#endif // CABECERA_H_INCLUDED
@@ -0,0 +1,375 @@
+#include<stdio.h>
+#include<string.h>
+#include<stdlib.h>
+#include<time.h>
+#include<pthread.h>
+
+#include "dns.h"
+#include "nombres.h"
+#include "cache.h"
+
+/** Colas de S3-FIFO **/
+#define COLA_CHICA 0
+#define COLA_PRINCIPAL 1
+#define COLA_FANTASMA 2
+#define MAX_FRECUENCIA 3
+
+typedef struct ENTRADA_CACHE
+{
+    struct ENTRADA_CACHE *siguienteHash;
+    struct ENTRADA_CACHE *anterior, *siguiente;     // en su cola, del frente al final
+    unsigned int hash;
+    uint16_t tipo;
+    uint8_t cola;
+    uint8_t frecuencia;                             // usos desde que entró a su cola, hasta MAX_FRECUENCIA
+    uint32_t guardada, vence;
+    int largo;                                      // bytes de la respuesta
+    int cantidadTtl;
+    uint16_t *ttls;                                 // posiciones de los TTL; la respuesta va en el mismo bloque
+    unsigned char *respuesta;                       // NULL en los fantasmas
+    size_t bytes;                                   // lo que cuenta contra el presupuesto
+    unsigned char largoNombre;
+    unsigned char nombre[];                         // formato DNS, en minúsculas
+} ENTRADA_CACHE;
+
+typedef struct
+{
+    ENTRADA_CACHE *frente, *final;
+    long cantidad;
+    size_t bytes;
+} COLA_CACHE;
+
+static ENTRADA_CACHE **tabla;
+static unsigned int mascara;
+static COLA_CACHE colas[3];
+static size_t presupuesto;
+static int activa;
+static long aciertos, fallos, expulsiones;
+static pthread_mutex_t candado = PTHREAD_MUTEX_INITIALIZER;
+
+void cacheActivar(size_t bytes)
+{
+    unsigned int cubetas = 1024;
+    /** una cubeta cada 512 bytes de presupuesto: las cadenas quedan cortas con respuestas típicas **/
+    while (cubetas < bytes / 512 && cubetas < (1u << 22))
+        cubetas <<= 1;
+    tabla = (ENTRADA_CACHE**)calloc(cubetas,sizeof(ENTRADA_CACHE*));
+    mascara = cubetas - 1;
+    presupuesto = bytes;
+    activa = 1;
+}
+
+int cacheActiva()
+{
+    return activa;
+}
+
+static unsigned int hashClave(const NOMBRE_DNS *nombre, int tipo)
+{
+    return nombre->hash ^ (tipo * 0x9e3779b1u);
+}
+
+static ENTRADA_CACHE *buscar(const NOMBRE_DNS *nombre, int tipo, unsigned int hash)
+{
+    ENTRADA_CACHE *e;
+    for (e = tabla[hash & mascara]; e != NULL; e = e->siguienteHash)
+        if (e->hash == hash && e->tipo == tipo && e->largoNombre == nombre->largo && memcmp(e->nombre,nombre->wire,nombre->largo) == 0)
+            return e;
+    return NULL;
+}
+
+static void colaAgregar(int cola, ENTRADA_CACHE *e)
+{
+    COLA_CACHE *c = &colas[cola];
+    e->cola = cola;
+    e->anterior = c->final;
+    e->siguiente = NULL;
+    if (c->final != NULL)
+        c->final->siguiente = e;
+    else
+        c->frente = e;
+    c->final = e;
+    c->cantidad++;
+    c->bytes += e->bytes;
+}
+
+static void colaQuitar(ENTRADA_CACHE *e)
+{
+    COLA_CACHE *c = &colas[e->cola];
+    if (e->anterior != NULL)
+        e->anterior->siguiente = e->siguiente;
+    else
+        c->frente = e->siguiente;
+    if (e->siguiente != NULL)
+        e->siguiente->anterior = e->anterior;
+    else
+        c->final = e->anterior;
+    c->cantidad--;
+    c->bytes -= e->bytes;
+}
+
+/** Deja la entrada sin respuesta (fantasma o a punto de recibir una nueva); no debe estar en una cola **/
+static void soltarRespuesta(ENTRADA_CACHE *e)
+{
+    free(e->ttls);
+    e->ttls = NULL;
+    e->respuesta = NULL;
+    e->largo = e->cantidadTtl = 0;
+    e->bytes = sizeof(ENTRADA_CACHE) + e->largoNombre;
+}
+
+/** Saca la entrada de la cache; no debe estar en una cola **/
+static void destruir(ENTRADA_CACHE *e)
+{
+    ENTRADA_CACHE **p = &tabla[e->hash & mascara];
+    while (*p != e)
+        p = &(*p)->siguienteHash;
+    *p = e->siguienteHash;
+    free(e->ttls);
+    free(e);
+}
+
+/** Los fantasmas recuerdan tantos nombres como entradas tiene la cola principal **/
+static void recortarFantasmas()
+{
+    long maximo = colas[COLA_PRINCIPAL].cantidad > MIN_FANTASMAS_CACHE ? colas[COLA_PRINCIPAL].cantidad : MIN_FANTASMAS_CACHE;
+    while (colas[COLA_FANTASMA].cantidad > maximo)
+    {
+        ENTRADA_CACHE *e = colas[COLA_FANTASMA].frente;
+        colaQuitar(e);
+        destruir(e);
+    }
+}
+
+/** El frente de la cola chica: pasa a la principal si se volvió a pedir, si no sale y queda su fantasma **/
+static void expulsarChica(uint32_t ahora)
+{
+    ENTRADA_CACHE *e = colas[COLA_CHICA].frente;
+    colaQuitar(e);
+    if (e->vence <= ahora)
+        destruir(e);
+    else if (e->frecuencia > 0)
+    {
+        e->frecuencia = 0;
+        colaAgregar(COLA_PRINCIPAL,e);
+    }
+    else
+    {
+        soltarRespuesta(e);
+        colaAgregar(COLA_FANTASMA,e);
+        expulsiones++;
+        recortarFantasmas();
+    }
+}
+
+/** El frente de la cola principal: si se usó vuelve al final con un uso menos, si no sale **/
+static void expulsarPrincipal(uint32_t ahora)
+{
+    ENTRADA_CACHE *e = colas[COLA_PRINCIPAL].frente;
+    colaQuitar(e);
+    if (e->vence > ahora && e->frecuencia > 0)
+    {
+        e->frecuencia--;
+        colaAgregar(COLA_PRINCIPAL,e);
+        return;
+    }
+    if (e->vence > ahora)
+        expulsiones++;
+    destruir(e);
+}
+
+static void hacerLugar(uint32_t ahora)
+{
+    while (colas[COLA_CHICA].bytes + colas[COLA_PRINCIPAL].bytes + colas[COLA_FANTASMA].bytes > presupuesto)
+    {
+        if (colas[COLA_CHICA].cantidad > 0 && (colas[COLA_CHICA].bytes > presupuesto / 10 || colas[COLA_PRINCIPAL].cantidad == 0))
+            expulsarChica(ahora);
+        else if (colas[COLA_PRINCIPAL].cantidad > 0)
+            expulsarPrincipal(ahora);
+        else
+        {
+            ENTRADA_CACHE *e = colas[COLA_FANTASMA].frente;
+            colaQuitar(e);
+            destruir(e);
+        }
+    }
+}
+
+/** El TTL con que se guarda la respuesta; 0 si no se guarda (delegación, error, negativa sin SOA) **/
+static uint32_t ttlRespuesta(const SECCIONES *s, int rcode)
+{
+    uint32_t ttl = MAX_TTL_CACHE;
+    int i, respuestas = seccionesCantidad(s,SECCION_ANSWER);
+    for (i = s->inicio[SECCION_ANSWER]; i < s->inicio[SECCION_ANSWER+1]; i++)
+        if (s->ttl[i] < ttl)
+            ttl = s->ttl[i];
+    if (rcode == 0 && respuestas > 0)
+        return ttl;
+    /** NXDOMAIN o NODATA: el menor entre el TTL del SOA y su MINIMUM (RFC 2308 5) **/
+    i = seccionesBuscar(s,SECCION_AUTHORITY,T_SOA);
+    if (i < 0 || s->largoRdata[i] < 22)
+        return 0;
+    uint32_t minimo = leer32(s->mensaje + s->rdata[i] + s->largoRdata[i] - 4);
+    if (s->ttl[i] < ttl)
+        ttl = s->ttl[i];
+    if (minimo < ttl)
+        ttl = minimo;
+    return ttl < MAX_TTL_NEGATIVO_CACHE ? ttl : MAX_TTL_NEGATIVO_CACHE;
+}
+
+void cacheGuardar(const SECCIONES *s)
+{
+    const unsigned char *m = s->mensaje;
+    NOMBRE_DNS nombre;
+    int i, fin, rcode;
+
+    CABECERA_DNS cabecera;
+
+    if (!activa || s->largo < TAM_CABECERA)
+        return;
+    cabeceraLeer(m,&cabecera);
+    if (cabecera.tc || cabecera.qdcount != 1)
+        return;
+    rcode = cabecera.rcode;
+    if ((rcode != 0 && rcode != 3) || (fin = nombreLeerMensaje(m,s->largo,TAM_CABECERA,&nombre,NULL)) < 0 || fin + 4 > s->largo
+            || leer16(m + fin + 2) != 1)
+        return;
+    int tipo = leer16(m + fin);
+    uint32_t ttl = ttlRespuesta(s,rcode);
+    if (ttl == 0)
+        return;
+
+    /** los TTL de todos los registros, menos el del OPT (ahí van los indicadores de EDNS) **/
+    int cantidadTtl = 0;
+    for (i = 0; i < s->cantidad; i++)
+        cantidadTtl += s->tipo[i] != T_OPT;
+    size_t bloque = cantidadTtl * sizeof(uint16_t) + s->largo;
+    /** una sola respuesta no puede ocupar más de un octavo del presupuesto **/
+    if (sizeof(ENTRADA_CACHE) + nombre.largo + bloque > presupuesto / 8)
+        return;
+    uint16_t *ttls = (uint16_t*)malloc(bloque);
+    unsigned char *respuesta = (unsigned char*)(ttls + cantidadTtl);
+    memcpy(respuesta,m,s->largo);
+    for (i = 0, cantidadTtl = 0; i < s->cantidad; i++)
+        if (s->tipo[i] != T_OPT)
+            ttls[cantidadTtl++] = s->rdata[i] - 6;
+
+    uint32_t ahora = (uint32_t)time(NULL);
+    unsigned int hash = hashClave(&nombre,tipo);
+    pthread_mutex_lock(&candado);
+    ENTRADA_CACHE *e = buscar(&nombre,tipo,hash);
+    int cola = COLA_CHICA;
+    if (e != NULL)
+    {
+        /** una respuesta nueva para lo que ya estaba se queda en su cola; un fantasma pasa a la principal **/
+        cola = e->cola == COLA_FANTASMA ? COLA_PRINCIPAL : e->cola;
+        colaQuitar(e);
+        soltarRespuesta(e);
+        if (cola == COLA_PRINCIPAL)
+            e->frecuencia = 0;
+    }
+    else
+    {
+        e = (ENTRADA_CACHE*)calloc(1,sizeof(ENTRADA_CACHE) + nombre.largo);
+        e->hash = hash;
+        e->tipo = tipo;
+        e->largoNombre = nombre.largo;
+        memcpy(e->nombre,nombre.wire,nombre.largo);
+        e->siguienteHash = tabla[hash & mascara];
+        tabla[hash & mascara] = e;
+    }
+    e->ttls = ttls;
+    e->respuesta = respuesta;
+    e->largo = s->largo;
+    e->cantidadTtl = cantidadTtl;
+    e->guardada = ahora;
+    e->vence = ahora + ttl;
+    e->bytes = sizeof(ENTRADA_CACHE) + e->largoNombre + bloque;
+    colaAgregar(cola,e);
+    hacerLugar(ahora);
+    pthread_mutex_unlock(&candado);
+}
+
+int cacheResponder(const unsigned char *consulta, int largo, unsigned char *destino, int max)
+{
+    unsigned char pregunta[12 + 255 + 4];
+    NOMBRE_DNS nombre;
+    int fin, i;
+
+    CABECERA_DNS cabecera;
+
+    if (!activa || largo < 17)
+        return 0;
+    cabeceraLeer(consulta,&cabecera);
+    if (cabecera.qr || cabecera.opcode != 0 || cabecera.qdcount != 1)
+        return 0;
+    if ((fin = nombreLeerMensaje(consulta,largo,TAM_CABECERA,&nombre,NULL)) < 0 || fin + 4 > largo || leer16(consulta + fin + 2) != 1)
+        return 0;
+    int tipo = leer16(consulta + fin);
+    /** el ID, el bit RD y la pregunta (con sus mayúsculas) son los de la consulta, que puede ser el mismo buffer **/
+    memcpy(pregunta,consulta,fin + 4);
+
+    uint32_t ahora = (uint32_t)time(NULL);
+    unsigned int hash = hashClave(&nombre,tipo);
+    pthread_mutex_lock(&candado);
+    ENTRADA_CACHE *e = buscar(&nombre,tipo,hash);
+    if (e == NULL || e->respuesta == NULL || e->vence <= ahora || e->largo > max)
+    {
+        if (e != NULL && e->respuesta != NULL && e->vence <= ahora)
+        {
+            colaQuitar(e);
+            destruir(e);
+        }
+        fallos++;
+        pthread_mutex_unlock(&candado);
+        return 0;
+    }
+    if (e->frecuencia < MAX_FRECUENCIA)
+        e->frecuencia++;
+    aciertos++;
+    memcpy(destino,e->respuesta,e->largo);
+    /** cada TTL baja lo que la respuesta lleva guardada **/
+    uint32_t pasados = ahora - e->guardada;
+    for (i = 0; i < e->cantidadTtl; i++)
+    {
+        unsigned char *p = destino + e->ttls[i];
+        uint32_t ttl = leer32(p);
+        escribir32(p,ttl > pasados ? ttl - pasados : 0);
+    }
+    largo = e->largo;
+    pthread_mutex_unlock(&candado);
+
+    CABECERA_DNS guardada;
+    cabeceraLeer(destino,&guardada);
+    guardada.id = cabecera.id;
+    guardada.rd = cabecera.rd;
+    cabeceraEscribir(&guardada,destino);
+    memcpy(destino + TAM_CABECERA,pregunta + TAM_CABECERA,fin + TAM_PREGUNTA - TAM_CABECERA);
+    return largo;
+}
+
+ESTADISTICAS_CACHE cacheEstadisticas()
+{
+    ESTADISTICAS_CACHE e;
+    pthread_mutex_lock(&candado);
+    e.entradas = colas[COLA_CHICA].cantidad + colas[COLA_PRINCIPAL].cantidad;
+    e.fantasmas = colas[COLA_FANTASMA].cantidad;
+    e.bytes = colas[COLA_CHICA].bytes + colas[COLA_PRINCIPAL].bytes + colas[COLA_FANTASMA].bytes;
+    e.presupuesto = presupuesto;
+    e.aciertos = aciertos;
+    e.fallos = fallos;
+    e.expulsiones = expulsiones;
+    pthread_mutex_unlock(&candado);
+    return e;
+}
+
+void cacheResumen(FILE *salida)
+{
+    if (!activa)
+        return;
+    ESTADISTICAS_CACHE e = cacheEstadisticas();
+    long consultas = e.aciertos + e.fallos;
+    fprintf(salida,";; cache: %ld respuestas, %.1f de %.1f MB, aciertos: %ld de %ld (%.1f%%), expulsiones: %ld\n",
+            e.entradas,e.bytes / 1048576.0,e.presupuesto / 1048576.0,e.aciertos,consultas,
+            consultas > 0 ? 100.0 * e.aciertos / consultas : 0,e.expulsiones);
+}
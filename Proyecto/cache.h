@@ -0,0 +1,62 @@
+#ifndef CACHE_H_INCLUDED
+#define CACHE_H_INCLUDED
+
+#include <stdio.h>
+#include <stddef.h>
+
+#include "secciones.h"
+
+/**
+ * Cache de respuestas del proceso (parámetro -cache=MB). Guarda las respuestas completas, tal
+ * como llegaron, por nombre (en minúsculas) y tipo, hasta que vence el menor de sus TTL (el TTL
+ * negativo de RFC 2308 para NXDOMAIN y NODATA). Al contestar desde la cache se restan a cada TTL
+ * los segundos que pasó guardada. Las delegaciones no se guardan: de eso se encarga la cache de
+ * delegaciones (delegaciones.h).
+ *
+ * Cada entrada cuenta sus bytes reales (la entrada, el nombre, la respuesta y las posiciones de
+ * sus TTL) contra el presupuesto. Para no superarlo se expulsa con S3-FIFO: las respuestas nuevas
+ * entran a una cola chica (un décimo del presupuesto) y sólo pasan a la principal si se vuelven a
+ * pedir antes de llegar a su frente; las que no, salen y dejan un fantasma (el nombre sin la
+ * respuesta) que, si se vuelve a pedir pronto, entra directo a la principal. En la principal cada
+ * entrada tiene un contador de usos (hasta 3) que le da otras tantas vueltas antes de salir.
+ * Así un lote de nombres que se piden una sola vez pasa por la cola chica sin desalojar a los
+ * que se repiten (los NS y MX que la resolución iterativa vuelve a visitar).
+ **/
+
+#define PRESUPUESTO_CACHE_POR_OMISION (64 * 1024 * 1024)
+#define MAX_TTL_CACHE 86400             /** un día, como los resolvers **/
+#define MAX_TTL_NEGATIVO_CACHE 10800    /** RFC 2308 5 **/
+#define MIN_FANTASMAS_CACHE 1024
+
+typedef struct
+{
+    long entradas;              // con respuesta, sin contar los fantasmas
+    long fantasmas;
+    size_t bytes;               // ocupados por las entradas (y los fantasmas)
+    size_t presupuesto;
+    long aciertos;
+    long fallos;
+    long expulsiones;           // salidas por falta de lugar (no por vencimiento)
+} ESTADISTICAS_CACHE;
+
+/** Habilita la cache con ese presupuesto en bytes **/
+void cacheActivar(size_t presupuesto);
+
+/** Indica si la cache está habilitada **/
+int cacheActiva();
+
+/** Guarda una respuesta real leída en s (una respuesta o una negativa; las delegaciones no) **/
+void cacheGuardar(const SECCIONES *s);
+
+/**
+ * Contesta una consulta con una respuesta guardada y vigente, como zonaResponder: el largo de la
+ * respuesta, o 0 si no está (hay que preguntar). respuesta puede ser el mismo buffer que consulta.
+ **/
+int cacheResponder(const unsigned char *consulta, int largo, unsigned char *respuesta, int max);
+
+ESTADISTICAS_CACHE cacheEstadisticas();
+
+/** Escribe en salida la línea de resumen de la cache (tamaño, aciertos y expulsiones), si está habilitada **/
+void cacheResumen(FILE *salida);
+
+#endif // CACHE_H_INCLUDED
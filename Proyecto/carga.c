@@ -0,0 +1,345 @@
+#include<stdio.h>
+#include<string.h>
+#include<stdlib.h>
+#include<math.h>
+#include<sys/socket.h>
+#include<arpa/inet.h>
+#include<netinet/in.h>
+
+#include "dns.h"
+#include "traza.h"
+#include "motor.h"
+#include "escritor.h"
+#include "lote.h"
+#include "carga.h"
+
+/** Contadores de un intervalo (y, sumados, de toda la prueba) **/
+typedef struct
+{
+    long enviadas, respuestas, perdidas, sinLugar;
+    long rcodes[16];
+    long long retrasoMaximo;        // cuánto se atrasó el emisor respecto del programa (us)
+    long long latenciaMaxima;
+    long histograma[CUBETAS_LATENCIA];
+} INTERVALO;
+
+/** Contexto de cada consulta en vuelo; se reutilizan desde una pila, sin malloc por consulta **/
+typedef struct CONSULTA_CARGA
+{
+    long long programada;           // instante en que debía salir (us)
+    struct CARGA *carga;
+} CONSULTA_CARGA;
+
+typedef struct CARGA
+{
+    INTERVALO actual;
+    CONSULTA_CARGA *contextos;
+    CONSULTA_CARGA **libres;
+    int cantidadLibres;
+} CARGA;
+
+/** Las consultas del archivo, ya armadas, una detrás de otra **/
+typedef struct
+{
+    unsigned char *datos;
+    long *inicios;
+    long cantidad;
+} CONSULTAS_CARGA;
+
+/** Cubeta de una latencia: exacta hasta 63 us y luego 32 cubetas por potencia de 2 **/
+static int cubeta(long long microsegundos)
+{
+    unsigned long long v = microsegundos < 0 ? 0 : (unsigned long long)microsegundos;
+    if (v < 64)
+        return (int)v;
+    if (v >= (1ULL << 40))
+        v = (1ULL << 40) - 1;
+    int exponente = 63 - __builtin_clzll(v), corrimiento = exponente - 5;
+    return 64 + (exponente - 6) * 32 + (int)((v >> corrimiento) - 32);
+}
+
+/** Valor representativo (el medio) de una cubeta **/
+static long long valorCubeta(int i)
+{
+    if (i < 64)
+        return i;
+    int j = i - 64, corrimiento = j / 32 + 1;
+    return ((long long)(j % 32 + 32) << corrimiento) + (1LL << corrimiento) / 2;
+}
+
+static long long percentil(const INTERVALO *v, double p)
+{
+    long total = 0, acumulado = 0, objetivo;
+    int i;
+    for (i = 0; i < CUBETAS_LATENCIA; i++)
+        total += v->histograma[i];
+    if (total == 0)
+        return 0;
+    objetivo = (long)(p * total + 0.999999);
+    if (objetivo < 1)
+        objetivo = 1;
+    for (i = 0; i < CUBETAS_LATENCIA; i++)
+        if ((acumulado += v->histograma[i]) >= objetivo)
+            break;
+    long long valor = valorCubeta(i);
+    return valor < v->latenciaMaxima ? valor : v->latenciaMaxima;
+}
+
+static void acumular(INTERVALO *total, const INTERVALO *v)
+{
+    int i;
+    total->enviadas += v->enviadas;
+    total->respuestas += v->respuestas;
+    total->perdidas += v->perdidas;
+    total->sinLugar += v->sinLugar;
+    for (i = 0; i < 16; i++)
+        total->rcodes[i] += v->rcodes[i];
+    for (i = 0; i < CUBETAS_LATENCIA; i++)
+        total->histograma[i] += v->histograma[i];
+    if (v->retrasoMaximo > total->retrasoMaximo)
+        total->retrasoMaximo = v->retrasoMaximo;
+    if (v->latenciaMaxima > total->latenciaMaxima)
+        total->latenciaMaxima = v->latenciaMaxima;
+}
+
+/** Una línea de informe: momento (segundos desde el comienzo) y duración del intervalo **/
+static void informar(FILE *f, int formato, const char *etiqueta, double momento, double segundos, const INTERVALO *v)
+{
+    static const double percentiles[] = {0.5, 0.9, 0.99, 0.999};
+    static const char *nombres[] = {"p50", "p90", "p99", "p999"};
+    long completadas = v->respuestas + v->perdidas;
+    double perdida = completadas > 0 ? 100.0 * v->perdidas / completadas : 0;
+    int i, primero = 1;
+
+    if (formato == FORMATO_JSON)
+    {
+        fprintf(f,"{\"type\":\"%s\",\"t\":%.3f,\"sent\":%ld,\"answered\":%ld,\"qps\":%.1f,\"lost\":%ld,\"loss_pct\":%.3f,"
+                "\"no_slot\":%ld,\"sender_lag_us\":%lld,\"rcodes\":{",etiqueta,momento,v->enviadas,v->respuestas,
+                segundos > 0 ? v->respuestas / segundos : 0,v->perdidas,perdida,v->sinLugar,v->retrasoMaximo);
+        for (i = 0; i < 16; i++)
+            if (v->rcodes[i] > 0)
+            {
+                fprintf(f,"%s\"%s\":%ld",primero ? "" : ",",mapearRcode(i),v->rcodes[i]);
+                primero = 0;
+            }
+        fprintf(f,"},\"latency_us\":{");
+        for (i = 0; i < 4; i++)
+            fprintf(f,"\"%s\":%lld,",nombres[i],percentil(v,percentiles[i]));
+        fprintf(f,"\"max\":%lld}}\n",v->latenciaMaxima);
+        fflush(f);
+        return;
+    }
+    fprintf(f,";; %s %7.2f s: enviadas %ld, respuestas %ld (%.0f qps), perdidas %ld (%.2f%%)",etiqueta,momento,
+            v->enviadas,v->respuestas,segundos > 0 ? v->respuestas / segundos : 0,v->perdidas,perdida);
+    if (v->sinLugar > 0)
+        fprintf(f,", sin lugar en vuelo %ld",v->sinLugar);
+    fprintf(f,"\n;;\t");
+    for (i = 0; i < 16; i++)
+        if (v->rcodes[i] > 0)
+            fprintf(f,"%s %ld  ",mapearRcode(i),v->rcodes[i]);
+    fprintf(f,"latencia ms:");
+    for (i = 0; i < 4; i++)
+        fprintf(f," %s %.3f",nombres[i],percentil(v,percentiles[i]) / 1000.0);
+    fprintf(f," max %.3f",v->latenciaMaxima / 1000.0);
+    if (v->retrasoMaximo > 1000)
+        fprintf(f,"  (emisor atrasado hasta %.1f ms)",v->retrasoMaximo / 1000.0);
+    fprintf(f,"\n");
+    fflush(f);
+}
+
+static void respuestaCarga(void *contexto, unsigned char *respuesta, int largo, int inicioRespuestas,
+                           long long rtt, int estado)
+{
+    CONSULTA_CARGA *c = (CONSULTA_CARGA*)contexto;
+    CARGA *carga = c->carga;
+    INTERVALO *v = &carga->actual;
+    (void)largo;
+    (void)inicioRespuestas;
+    (void)rtt;
+    if (estado == MOTOR_TIMEOUT)
+        v->perdidas++;
+    else
+    {
+        /** latencia desde el instante programado, no desde el envío real **/
+        long long latencia = trazaMicrosegundos() - c->programada;
+        v->respuestas++;
+        v->rcodes[cabeceraRcode(respuesta)]++;
+        v->histograma[cubeta(latencia)]++;
+        if (latencia > v->latenciaMaxima)
+            v->latenciaMaxima = latencia;
+    }
+    carga->libres[carga->cantidadLibres++] = c;
+}
+
+/**
+ * Segundos desde el comienzo en que sale la consulta k: con la tasa fija es k / qps, y con la
+ * rampa lineal es la solución de qpsInicial * t + (qps - qpsInicial) * t^2 / (2 * duracion) = k.
+ **/
+static double instanteProgramado(long k, double qps, double qpsInicial, double duracion)
+{
+    if (qpsInicial < 0 || qpsInicial == qps)
+        return k / qps;
+    double a = (qps - qpsInicial) / (2 * duracion), b = qpsInicial;
+    double discriminante = b * b + 4 * a * k;
+    /** con la rampa descendente la tasa se agota antes del final: la consulta ya no sale **/
+    if (discriminante < 0)
+        return duracion + 1;
+    return (sqrt(discriminante) - b) / (2 * a);
+}
+
+static int cargarConsultas(const char *archivo, CONSULTAS_CARGA *q)
+{
+    FILE *f = strcmp(archivo,"-") == 0 ? stdin : fopen(archivo,"r");
+    char nombre[256];
+    long capacidad = 0, usado = 0, lugar = 0;
+    int tipo;
+    if (f == NULL)
+    {
+        printf("ERROR: no se pudo abrir el archivo de consultas %s\n",archivo);
+        return -1;
+    }
+    memset(q,0,sizeof(*q));
+    while (loteLeerConsulta(f,nombre,&tipo))
+    {
+        if (usado + MAX_CONSULTA_MOTOR > capacidad)
+        {
+            capacidad = capacidad ? capacidad * 2 : 1 << 16;
+            q->datos = (unsigned char*)realloc(q->datos,capacidad);
+        }
+        if (q->cantidad == lugar)
+        {
+            lugar = lugar ? lugar * 2 : 1024;
+            q->inicios = (long*)realloc(q->inicios,(lugar + 1) * sizeof(long));
+        }
+        q->inicios[q->cantidad++] = usado;
+        usado += armarConsulta(q->datos + usado,nombre,tipo,1,0);
+    }
+    if (f != stdin)
+        fclose(f);
+    if (q->cantidad == 0)
+    {
+        printf("ERROR: el archivo de consultas %s no tiene consultas válidas\n",archivo);
+        return -1;
+    }
+    q->inicios[q->cantidad] = usado;
+    return 0;
+}
+
+int cargaEjecutar(const char *archivo, const char *servidor, const char *puerto, double qps, double qpsInicial,
+                  double duracion, double intervalo, int enVuelo, const char *salida, int formato)
+{
+    CONSULTAS_CARGA q;
+    CARGA carga;
+    INTERVALO *total;
+    DIRECCION destino;
+    FILE *f = stdout;
+    int i;
+
+    if (qps <= 0 || duracion <= 0 || intervalo <= 0)
+    {
+        printf("ERROR: la prueba de carga necesita -qps=N, y -duracion= e -intervalo= positivos\n");
+        return -1;
+    }
+    if (formato != FORMATO_TEXTO && formato != FORMATO_JSON)
+    {
+        printf("ERROR: los informes de la prueba de carga son de texto o json\n");
+        return -1;
+    }
+    if (direccionDesdeTexto(&destino,servidor,atoi(puerto)) < 0)
+    {
+        printf("ERROR: el servidor %s no es una dirección IPv4 ni IPv6\n",servidor);
+        return -1;
+    }
+    if (cargarConsultas(archivo,&q) < 0)
+        return -1;
+    if (salida != NULL && strcmp(salida,"-") != 0 && (f = fopen(salida,"w")) == NULL)
+    {
+        printf("ERROR: no se pudo abrir el archivo de salida %s\n",salida);
+        return -1;
+    }
+    MOTOR *m = motorCrear(enVuelo,0,TIMEOUT_CARGA_MS,0);
+    if (m == NULL)
+    {
+        perror("socket error");
+        return -1;
+    }
+    motorUsarRitmo(m,0);        /** la prueba de carga mide al servidor: no se frena ante sus errores **/
+    memset(&carga,0,sizeof(carga));
+    carga.contextos = (CONSULTA_CARGA*)calloc(enVuelo,sizeof(CONSULTA_CARGA));
+    carga.libres = (CONSULTA_CARGA**)malloc(enVuelo * sizeof(CONSULTA_CARGA*));
+    for (i = 0; i < enVuelo; i++)
+    {
+        carga.contextos[i].carga = &carga;
+        carga.libres[carga.cantidadLibres++] = &carga.contextos[i];
+    }
+    total = (INTERVALO*)calloc(1,sizeof(INTERVALO));
+
+    if (formato == FORMATO_TEXTO && qpsInicial >= 0)
+        fprintf(f,";; carga: %ld consultas distintas contra %s:%s, rampa de %.0f a %.0f qps en %.0f s\n",q.cantidad,
+                servidor,puerto,qpsInicial,qps,duracion);
+    else if (formato == FORMATO_TEXTO)
+        fprintf(f,";; carga: %ld consultas distintas contra %s:%s, %.0f qps durante %.0f s\n",q.cantidad,servidor,puerto,
+                qps,duracion);
+
+    long long comienzo = trazaMicrosegundos(), finEnvio = comienzo + (long long)(duracion * 1e6);
+    long long finIntervalo = comienzo + (long long)(intervalo * 1e6), inicioIntervalo = comienzo;
+    long k = 0;
+    long long proxima = comienzo;
+    while (proxima < finEnvio || motorEnVuelo(m) > 0)
+    {
+        long long ahora = trazaMicrosegundos();
+        /** todas las consultas cuyo instante ya pasó, aunque el emisor venga atrasado **/
+        while (proxima <= ahora && proxima < finEnvio)
+        {
+            long n = k % q.cantidad;
+            INTERVALO *v = &carga.actual;
+            if (ahora - proxima > v->retrasoMaximo)
+                v->retrasoMaximo = ahora - proxima;
+            if (carga.cantidadLibres == 0)
+                v->sinLugar++;
+            else
+            {
+                CONSULTA_CARGA *c = carga.libres[--carga.cantidadLibres];
+                c->programada = proxima;
+                if (motorEnviar(m,&destino,q.datos + q.inicios[n],q.inicios[n+1] - q.inicios[n],respuestaCarga,c) < 0)
+                {
+                    carga.libres[carga.cantidadLibres++] = c;
+                    v->sinLugar++;
+                }
+                else
+                    v->enviadas++;
+            }
+            k++;
+            proxima = comienzo + (long long)(instanteProgramado(k,qps,qpsInicial,duracion) * 1e6);
+        }
+        if (ahora >= finIntervalo)
+        {
+            informar(f,formato,"intervalo",(ahora - comienzo) / 1e6,(ahora - inicioIntervalo) / 1e6,&carga.actual);
+            acumular(total,&carga.actual);
+            memset(&carga.actual,0,sizeof(INTERVALO));
+            inicioIntervalo = ahora;
+            while (finIntervalo <= ahora)
+                finIntervalo += (long long)(intervalo * 1e6);
+        }
+        long long espera = finIntervalo - ahora;
+        if (proxima < finEnvio && proxima - ahora < espera)
+            espera = proxima - ahora;
+        motorProcesar(m,espera > 0 ? (int)(espera / 1000) : 0);
+    }
+    long long fin = trazaMicrosegundos();
+    if (carga.actual.enviadas + carga.actual.respuestas + carga.actual.perdidas > 0)
+        informar(f,formato,"intervalo",(fin - comienzo) / 1e6,(fin - inicioIntervalo) / 1e6,&carga.actual);
+    acumular(total,&carga.actual);
+    /** la tasa total se mide sobre el tiempo de envío, no sobre la espera de las últimas respuestas **/
+    informar(f,formato,"total",(fin - comienzo) / 1e6,(finEnvio - comienzo) / 1e6,total);
+
+    if (f != stdout)
+        fclose(f);
+    motorDestruir(m);
+    free(total);
+    free(carga.contextos);
+    free(carga.libres);
+    free(q.datos);
+    free(q.inicios);
+    return 0;
+}
@@ -0,0 +1,35 @@
+#ifndef CARGA_H_INCLUDED
+#define CARGA_H_INCLUDED
+
+/**
+ * Prueba de carga (parámetro -carga=), al estilo de dnsperf: envía las consultas de un archivo
+ * (el mismo formato que -lote=, "nombre [TIPO]", que se recorre en ciclo) a una tasa fija o en
+ * rampa, y cada intervalo informa la tasa lograda, las pérdidas, los rcode y los percentiles de
+ * latencia.
+ *
+ * El envío es a lazo abierto: cada consulta tiene un instante programado (el comienzo más k / qps,
+ * o la integral de la rampa) que no depende de las respuestas, y la latencia se mide desde ese
+ * instante y no desde el envío real. Si el servidor o el propio emisor se atrasan, la espera se
+ * suma a la latencia en lugar de esconderse (la "omisión coordinada" de los lazos cerrados).
+ * Las consultas que no encuentran lugar en vuelo (-envuelo=) no se envían y se informan aparte.
+ *
+ * Las latencias se acumulan en un histograma log-lineal (32 cubetas por potencia de 2, un error
+ * menor al 3%), así los percentiles no necesitan guardar cada muestra.
+ **/
+
+/** Espera de cada consulta antes de darla por perdida; en una prueba de carga no se reintenta **/
+#define TIMEOUT_CARGA_MS 3000
+
+#define CUBETAS_LATENCIA 1200
+
+/**
+ * archivo: consultas; servidor/puerto: servidor bajo prueba (IPv4 o IPv6).
+ * qps: tasa objetivo (final, si hay rampa); qpsInicial: comienzo de la rampa lineal, o -1 para
+ * una tasa fija; duracion e intervalo en segundos; enVuelo: consultas simultáneas como máximo.
+ * salida: archivo de los informes (NULL = salida estándar); formato: FORMATO_TEXTO o FORMATO_JSON.
+ * Devuelve 0, o -1 si hubo un error en los parámetros.
+ **/
+int cargaEjecutar(const char *archivo, const char *servidor, const char *puerto, double qps, double qpsInicial,
+                  double duracion, double intervalo, int enVuelo, const char *salida, int formato);
+
+#endif // CARGA_H_INCLUDED
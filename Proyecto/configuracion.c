@@ -0,0 +1,244 @@
+#include<stdio.h>
+#include<string.h>
+#include<stdlib.h>
+#include<time.h>
+#include<unistd.h>
+#include<libgen.h>
+#include<pthread.h>
+#include<arpa/inet.h>
+#include<sys/inotify.h>
+
+#include "configuracion.h"
+#include "plantillas.h"
+
+static CONFIGURACION vigente;
+static char *rutaArchivo, *nombreArchivo;
+static int vigilancia = -1;
+static unsigned int version;
+static time_t ultimaRevision;
+static unsigned int siguienteServidor;
+static pthread_mutex_t candado = PTHREAD_MUTEX_INITIALIZER;
+
+static int acotar(int valor, int minimo, int maximo)
+{
+    return valor < minimo ? minimo : valor > maximo ? maximo : valor;
+}
+
+/** Reemplaza la lista de búsqueda con los dominios de la cadena (separados por blancos) **/
+static void leerBusqueda(CONFIGURACION *c, char *dominios)
+{
+    char *resto, *dominio;
+    c->cantidadBusqueda = 0;
+    if (dominios == NULL)
+        return;
+    for (dominio = strtok_r(dominios," \t\r\n",&resto); dominio != NULL && c->cantidadBusqueda < MAX_DOMINIOS_BUSQUEDA;
+            dominio = strtok_r(NULL," \t\r\n",&resto))
+    {
+        int largo = strlen(dominio);
+        if (largo > 0 && dominio[largo-1] == '.')
+            dominio[--largo] = '\0';
+        if (largo > 0 && largo < 254)
+            strcpy(c->busqueda[c->cantidadBusqueda++],dominio);
+    }
+}
+
+/** Las opciones de una línea options (o de RES_OPTIONS); las desconocidas se ignoran **/
+static void leerOpciones(CONFIGURACION *c, char *opciones)
+{
+    char *resto, *opcion;
+    if (opciones == NULL)
+        return;
+    for (opcion = strtok_r(opciones," \t\r\n",&resto); opcion != NULL; opcion = strtok_r(NULL," \t\r\n",&resto))
+    {
+        if (strncmp(opcion,"timeout:",8) == 0)
+            c->timeout = acotar(atoi(opcion + 8),1,MAX_TIMEOUT);
+        else if (strncmp(opcion,"attempts:",9) == 0)
+            c->intentos = acotar(atoi(opcion + 9),1,MAX_INTENTOS);
+        else if (strncmp(opcion,"ndots:",6) == 0)
+            c->ndots = acotar(atoi(opcion + 6),0,MAX_NDOTS);
+        else if (strcmp(opcion,"rotate") == 0)
+            c->rotar = 1;
+        else if (strcmp(opcion,"trust-ad") == 0)
+            c->confiarAD = 1;
+    }
+}
+
+/** Sin domain ni search, la lista de búsqueda es el dominio del nombre de la máquina **/
+static void busquedaPorOmision(CONFIGURACION *c)
+{
+    char maquina[256], *punto;
+    if (gethostname(maquina,sizeof(maquina)) == 0 && (punto = strchr(maquina,'.')) != NULL && punto[1] != '\0')
+    {
+        maquina[sizeof(maquina)-1] = '\0';
+        leerBusqueda(c,punto + 1);
+    }
+}
+
+/** Lee el archivo completo en c; 0, o -1 si no se pudo abrir **/
+static int leerArchivo(const char *archivo, CONFIGURACION *c)
+{
+    char linea[1024], *variable;
+    int hayBusqueda = 0, resultado = 0;
+    FILE *f;
+
+    memset(c,0,sizeof(CONFIGURACION));
+    c->timeout = TIMEOUT_POR_OMISION;
+    c->intentos = INTENTOS_POR_OMISION;
+    c->ndots = NDOTS_POR_OMISION;
+    if ((f = fopen(archivo,"r")) == NULL)
+        resultado = -1;
+    while (f != NULL && fgets(linea,sizeof(linea),f) != NULL)
+    {
+        char *resto, *clave = strtok_r(linea," \t\r\n",&resto), *valor;
+        if (clave == NULL || clave[0] == '#' || clave[0] == ';')
+            continue;
+        if (strcmp(clave,"nameserver") == 0)
+        {
+            valor = strtok_r(NULL," \t\r\n",&resto);
+            if (valor != NULL && c->cantidadServidores < MAX_SERVIDORES_CONFIGURACION && strlen(valor) < LARGO_TEXTO_DIRECCION
+                    && direccionTextoPermitido(valor))
+                strcpy(c->servidores[c->cantidadServidores++],valor);
+        }
+        else if (strcmp(clave,"domain") == 0 || strcmp(clave,"search") == 0)
+        {
+            /** la última de las dos que aparece es la que vale **/
+            if (strcmp(clave,"domain") == 0 && (valor = strtok_r(NULL," \t\r\n",&resto)) != NULL)
+                leerBusqueda(c,valor);
+            else
+                leerBusqueda(c,resto);
+            hayBusqueda = 1;
+        }
+        else if (strcmp(clave,"options") == 0)
+            leerOpciones(c,resto);
+    }
+    if (f != NULL)
+        fclose(f);
+
+    if (c->cantidadServidores == 0)
+        strcpy(c->servidores[c->cantidadServidores++],direccionPermitida(AF_INET) ? "127.0.0.1" : "::1");
+    if ((variable = getenv("LOCALDOMAIN")) != NULL)
+    {
+        char copia[1024];
+        snprintf(copia,sizeof(copia),"%s",variable);
+        leerBusqueda(c,copia);
+    }
+    else if (!hayBusqueda)
+        busquedaPorOmision(c);
+    if ((variable = getenv("RES_OPTIONS")) != NULL)
+    {
+        char copia[1024];
+        snprintf(copia,sizeof(copia),"%s",variable);
+        leerOpciones(c,copia);
+    }
+    return resultado;
+}
+
+/**
+ * Vigila el directorio y no el archivo: un rename sobre resolv.conf deja la vigilancia del
+ * archivo viejo colgada de un inodo que ya nadie usa.
+ **/
+static void vigilar(const char *archivo)
+{
+    char *copia = strdup(archivo);
+    vigilancia = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (vigilancia >= 0 && inotify_add_watch(vigilancia,dirname(copia),
+            IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE | IN_MOVED_FROM) < 0)
+    {
+        close(vigilancia);
+        vigilancia = -1;
+    }
+    free(copia);
+}
+
+int configuracionCargar(const char *archivo)
+{
+    char *copia;
+    int resultado;
+    if (archivo == NULL)
+        archivo = RUTA_RESOLV_CONF;
+    resultado = leerArchivo(archivo,&vigente);
+    rutaArchivo = strdup(archivo);
+    copia = strdup(archivo);
+    nombreArchivo = strdup(basename(copia));
+    free(copia);
+    vigilar(archivo);
+    ultimaRevision = time(NULL);
+    return resultado;
+}
+
+void configuracionObtener(CONFIGURACION *copia)
+{
+    pthread_mutex_lock(&candado);
+    *copia = vigente;
+    pthread_mutex_unlock(&candado);
+}
+
+/** Vacía los avisos pendientes; 1 si alguno era del archivo **/
+static int huboCambios()
+{
+    char avisos[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    int cambio = 0;
+    ssize_t leidos;
+    while ((leidos = read(vigilancia,avisos,sizeof(avisos))) > 0)
+    {
+        char *p;
+        for (p = avisos; p < avisos + leidos; p += sizeof(struct inotify_event) + ((struct inotify_event*)p)->len)
+        {
+            const struct inotify_event *aviso = (const struct inotify_event*)p;
+            if (aviso->len > 0 && strcmp(aviso->name,nombreArchivo) == 0)
+                cambio = 1;
+        }
+    }
+    return cambio;
+}
+
+unsigned int configuracionVersion()
+{
+    time_t ahora = time(NULL);
+    pthread_mutex_lock(&candado);
+    if (vigilancia >= 0 && ahora != ultimaRevision)
+    {
+        ultimaRevision = ahora;
+        if (huboCambios())
+        {
+            CONFIGURACION nueva;
+            /** mientras se reemplaza puede no existir: se conserva la anterior hasta el próximo aviso **/
+            if (leerArchivo(rutaArchivo,&nueva) == 0)
+            {
+                vigente = nueva;
+                version++;
+            }
+        }
+    }
+    unsigned int actual = version;
+    pthread_mutex_unlock(&candado);
+    return actual;
+}
+
+int configuracionPrimerServidor(const CONFIGURACION *c)
+{
+    if (!c->rotar || c->cantidadServidores <= 1)
+        return 0;
+    return __atomic_fetch_add(&siguienteServidor,1,__ATOMIC_RELAXED) % c->cantidadServidores;
+}
+
+int configuracionCandidatos(const CONFIGURACION *c, const char *nombre, char candidatos[][256])
+{
+    int largo = strlen(nombre), puntos = 0, cantidad = 0, i;
+    for (i = 0; i < largo; i++)
+        puntos += nombre[i] == '.';
+    if (largo == 0 || nombre[largo-1] == '.' || c->cantidadBusqueda == 0)
+    {
+        snprintf(candidatos[cantidad++],256,"%s",nombre);
+        return cantidad;
+    }
+    if (puntos >= c->ndots)
+        snprintf(candidatos[cantidad++],256,"%s",nombre);
+    /** las expansiones que no forman un nombre válido (más de 255 bytes, labels de más de 63) no se prueban **/
+    for (i = 0; i < c->cantidadBusqueda; i++)
+        if (snprintf(candidatos[cantidad],256,"%s.%s",nombre,c->busqueda[i]) < 256 && plantillaNombreValido(candidatos[cantidad]))
+            cantidad++;
+    if (puntos < c->ndots)
+        snprintf(candidatos[cantidad++],256,"%s",nombre);
+    return cantidad;
+}
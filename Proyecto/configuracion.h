@@ -0,0 +1,72 @@
+#ifndef CONFIGURACION_H_INCLUDED
+#define CONFIGURACION_H_INCLUDED
+
+#include "direcciones.h"
+
+/**
+ * Configuración del resolver del sistema (resolv.conf(5)), leída una sola vez al arrancar:
+ * nameserver, domain, search y las opciones timeout:, attempts:, rotate, ndots: y trust-ad. Como en la
+ * libc, LOCALDOMAIN reemplaza la lista de búsqueda y RES_OPTIONS se aplica sobre las opciones del
+ * archivo.
+ *
+ * Los procesos largos (lote, carga) no vuelven a leer el archivo en cada consulta: un inotify
+ * sobre el directorio avisa cuando se reescribe o se reemplaza (los gestores de red lo cambian
+ * con un rename), y recién entonces se relee. configuracionVersion() mira el aviso como mucho
+ * una vez por segundo y cambia cuando hubo una relectura, así que preguntar por ella en cada
+ * vuelta del lazo es gratis.
+ *
+ * Se usan los servidores IPv4 e IPv6 (con -4 o -6, sólo los de esa familia); como en la libc, a lo
+ * sumo MAX_SERVIDORES_CONFIGURACION.
+ **/
+
+#ifndef RUTA_RESOLV_CONF
+#define RUTA_RESOLV_CONF "/etc/resolv.conf"
+#endif
+
+#define MAX_SERVIDORES_CONFIGURACION 3      /** MAXNS de la libc **/
+#define MAX_DOMINIOS_BUSQUEDA 6             /** MAXDNSRCH **/
+
+/** Valores por omisión y topes de las opciones, los de resolv.conf(5) **/
+#define TIMEOUT_POR_OMISION 5
+#define MAX_TIMEOUT 30
+#define INTENTOS_POR_OMISION 2
+#define MAX_INTENTOS 5
+#define NDOTS_POR_OMISION 1
+#define MAX_NDOTS 15
+
+typedef struct
+{
+    char servidores[MAX_SERVIDORES_CONFIGURACION][LARGO_TEXTO_DIRECCION];
+    int cantidadServidores;         // sin ningún nameserver queda 127.0.0.1, como en la libc
+    char busqueda[MAX_DOMINIOS_BUSQUEDA][256];
+    int cantidadBusqueda;
+    int timeout;                    // segundos de espera de cada envío
+    int intentos;                   // vueltas completas sobre los servidores
+    int rotar;                      // cada consulta empieza por el servidor siguiente
+    int ndots;                      // con menos puntos, primero se prueba la lista de búsqueda
+    int confiarAD;                  // trust-ad: los servidores validan DNSSEC y su bit AD es confiable
+} CONFIGURACION;
+
+/** Lee el archivo (RUTA_RESOLV_CONF si es NULL) y empieza a vigilarlo; 0, o -1 si no existe (quedan los valores por omisión) **/
+int configuracionCargar(const char *archivo);
+
+/** Copia la configuración vigente **/
+void configuracionObtener(CONFIGURACION *copia);
+
+/** Cambia cada vez que el archivo se relee; si cambió, hay que volver a obtener la configuración **/
+unsigned int configuracionVersion();
+
+/**
+ * Servidor por el que empieza una consulta nueva: el primero, o con rotate uno distinto cada
+ * vez (round robin compartido por todo el proceso). Devuelve el índice en servidores.
+ **/
+int configuracionPrimerServidor(const CONFIGURACION *c);
+
+/**
+ * Los nombres a probar para nombre, en orden (res_search): con ndots o más puntos primero el
+ * nombre tal cual y después con cada dominio de búsqueda; con menos, al revés. Un nombre con
+ * punto final se prueba sólo tal cual. Devuelve la cantidad (hasta MAX_DOMINIOS_BUSQUEDA + 1).
+ **/
+int configuracionCandidatos(const CONFIGURACION *c, const char *nombre, char candidatos[][256]);
+
+#endif // CONFIGURACION_H_INCLUDED
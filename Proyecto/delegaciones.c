@@ -0,0 +1,225 @@
+#include<stdio.h>
+#include<string.h>
+#include<strings.h>
+#include<stdlib.h>
+#include<pthread.h>
+
+#include "delegaciones.h"
+
+#define CUBETAS_DELEGACIONES 1024
+
+typedef struct DELEGACION
+{
+    const NOMBRE_DNS *zona;         // internada
+    int cantidad;
+    SERVIDOR_DELEGACION servidores[MAX_SERVIDORES_DELEGACION];
+    time_t vence;
+    struct DELEGACION *siguiente;
+} DELEGACION;
+
+static DELEGACION *cubetas[CUBETAS_DELEGACIONES];
+static int cantidadZonas;
+static pthread_mutex_t candado = PTHREAD_MUTEX_INITIALIZER;
+
+/** Busca la zona exacta por su formato DNS; requiere tener el candado **/
+static DELEGACION *buscarExacta(const unsigned char *wire, int largo, unsigned int hash)
+{
+    DELEGACION *d;
+    for (d = cubetas[hash % CUBETAS_DELEGACIONES]; d != NULL; d = d->siguiente)
+        if (d->zona->hash == hash && d->zona->largo == largo && memcmp(d->zona->wire,wire,largo) == 0)
+            return d;
+    return NULL;
+}
+
+static DELEGACION *buscarZona(const char *zona)
+{
+    NOMBRE_DNS z;
+    if (nombreDesdeCadena(zona,&z) < 0)
+        return NULL;
+    return buscarExacta(z.wire,z.largo,z.hash);
+}
+
+/**
+ * Con la tabla llena saca las zonas vencidas y, si no había ninguna, la que vence primero (que no
+ * sea la raíz, que se vuelve a cebar sola pero es la que sostiene todo lo demás). Requiere tener el candado.
+ **/
+static void expulsarZonas(time_t ahora)
+{
+    DELEGACION **p, **victima = NULL;
+    int i;
+    for (i = 0; i < CUBETAS_DELEGACIONES; i++)
+        for (p = &cubetas[i]; *p != NULL; )
+        {
+            if ((*p)->vence <= ahora)
+            {
+                DELEGACION *vencida = *p;
+                *p = vencida->siguiente;
+                free(vencida);
+                cantidadZonas--;
+                continue;
+            }
+            if ((*p)->zona->cantidadEtiquetas > 0 && (victima == NULL || (*p)->vence < (*victima)->vence))
+                victima = p;
+            p = &(*p)->siguiente;
+        }
+    if (cantidadZonas >= MAX_ZONAS_DELEGACIONES && victima != NULL)
+    {
+        DELEGACION *d = *victima;
+        *victima = d->siguiente;
+        free(d);
+        cantidadZonas--;
+    }
+}
+
+/** Busca la zona o la crea vacía; requiere tener el candado **/
+static DELEGACION *obtenerZona(const char *zona)
+{
+    NOMBRE_DNS buscada;
+    const NOMBRE_DNS *z;
+    DELEGACION *d;
+    if (nombreDesdeCadena(zona,&buscada) < 0)
+        return NULL;
+    if ((d = buscarExacta(buscada.wire,buscada.largo,buscada.hash)) == NULL)
+    {
+        if (cantidadZonas >= MAX_ZONAS_DELEGACIONES)
+            expulsarZonas(time(NULL));
+        if (cantidadZonas >= MAX_ZONAS_DELEGACIONES || (z = nombreInternar(&buscada)) == NULL)
+            return NULL;
+        cantidadZonas++;
+        d = (DELEGACION*)calloc(1,sizeof(DELEGACION));
+        d->zona = z;
+        d->siguiente = cubetas[z->hash % CUBETAS_DELEGACIONES];
+        cubetas[z->hash % CUBETAS_DELEGACIONES] = d;
+    }
+    return d;
+}
+
+void delegacionAgregar(const char *zona, const char *nombreNS, const char *ip, unsigned int ttl)
+{
+    int i;
+    time_t ahora = time(NULL);
+    const NOMBRE_DNS *ns = nombreInternarCadena(nombreNS);
+
+    pthread_mutex_lock(&candado);
+    DELEGACION *d = obtenerZona(zona);
+    if (d == NULL || ns == NULL)
+    {
+        pthread_mutex_unlock(&candado);
+        return;
+    }
+    if (d->cantidad == 0 || d->vence <= ahora)
+    {
+        d->cantidad = 0;
+        d->vence = ahora + ttl;
+    }
+    else if (ahora + ttl < d->vence)   /** el conjunto vence con el menor TTL **/
+        d->vence = ahora + ttl;
+
+    for (i = 0; i < d->cantidad; i++)
+        if (strcmp(d->servidores[i].ip,ip) == 0)
+            break;
+    if (i == d->cantidad && d->cantidad < MAX_SERVIDORES_DELEGACION)
+    {
+        d->servidores[i].nombre = ns;
+        snprintf(d->servidores[i].ip,sizeof(d->servidores[i].ip),"%s",ip);
+        d->cantidad++;
+    }
+    pthread_mutex_unlock(&candado);
+}
+
+void delegacionReemplazar(const char *zona, const SERVIDOR_DELEGACION *servidores, int cantidad, unsigned int ttl)
+{
+    if (cantidad > MAX_SERVIDORES_DELEGACION)
+        cantidad = MAX_SERVIDORES_DELEGACION;
+
+    pthread_mutex_lock(&candado);
+    DELEGACION *d = obtenerZona(zona);
+    if (d == NULL)
+    {
+        pthread_mutex_unlock(&candado);
+        return;
+    }
+    memcpy(d->servidores,servidores,cantidad * sizeof(SERVIDOR_DELEGACION));
+    d->cantidad = cantidad;
+    d->vence = time(NULL) + ttl;
+    pthread_mutex_unlock(&candado);
+}
+
+int delegacionBuscar(const char *qname, char *zona, SERVIDOR_DELEGACION *servidor)
+{
+    NOMBRE_DNS nombre;
+    int i;
+    time_t ahora = time(NULL);
+    if (nombreDesdeCadena(qname,&nombre) < 0)
+        return 0;
+
+    /** pruebo con el nombre completo y luego quitando un label por vez, hasta la raíz **/
+    pthread_mutex_lock(&candado);
+    for (i = 0; i <= nombre.cantidadEtiquetas; i++)
+    {
+        int inicio = (i < nombre.cantidadEtiquetas) ? nombre.etiquetas[i] : nombre.largo - 1;
+        DELEGACION *d = buscarExacta(nombre.wire + inicio,nombre.largo - inicio,nombreHashSufijo(&nombre,i));
+        if (d != NULL && d->cantidad > 0 && d->vence > ahora)
+        {
+            nombreATexto(d->zona,zona);
+            *servidor = d->servidores[0];
+            pthread_mutex_unlock(&candado);
+            return 1;
+        }
+    }
+    pthread_mutex_unlock(&candado);
+    return 0;
+}
+
+int delegacionListar(const char *zona, SERVIDOR_DELEGACION *salida, int max)
+{
+    int i = 0;
+    pthread_mutex_lock(&candado);
+    DELEGACION *d = buscarZona(zona);
+    if (d != NULL)
+        for (i = 0; i < d->cantidad && i < max; i++)
+            salida[i] = d->servidores[i];
+    pthread_mutex_unlock(&candado);
+    return i;
+}
+
+unsigned int delegacionRestante(const char *zona)
+{
+    unsigned int restante = 0;
+    time_t ahora = time(NULL);
+    pthread_mutex_lock(&candado);
+    DELEGACION *d = buscarZona(zona);
+    if (d != NULL && d->cantidad > 0 && d->vence > ahora)
+        restante = d->vence - ahora;
+    pthread_mutex_unlock(&candado);
+    return restante;
+}
+
+void delegacionAprender(const SECCIONES *s, const char *referencia, const char *consultada)
+{
+    char zona[256], ns[256], glue[256], ip[INET6_ADDRSTRLEN];
+    NOMBRE_DNS delegada, actual, dueno, servidor;
+    int i, j;
+    /** la zona delegada tiene que estar debajo de la que se consultó: nadie delega hacia arriba ni al costado **/
+    if (nombreDesdeCadena(referencia,&delegada) < 0 || nombreDesdeCadena(consultada,&actual) < 0
+            || delegada.cantidadEtiquetas <= actual.cantidadEtiquetas || !nombreEsSubdominio(&delegada,&actual))
+        return;
+    for (i = s->inicio[SECCION_AUTHORITY]; i < s->inicio[SECCION_AUTHORITY+1]; i++)
+    {
+        /** sólo los NS de la zona delegada, y con glue sólo los que caen dentro de la zona consultada
+            (in-bailiwick): de las direcciones de otros nombres, el que respondió no tiene autoridad **/
+        if (s->tipo[i] != T_NS || seccionesNombre(s,i,zona) < 0 || seccionesNombreRdata(s,i,ns) < 0
+                || nombreDesdeCadena(zona,&dueno) < 0 || !nombreIgual(&dueno,&delegada)
+                || nombreDesdeCadena(ns,&servidor) < 0 || !nombreEsSubdominio(&servidor,&actual))
+            continue;
+        for (j = s->inicio[SECCION_ADDITIONAL]; j < s->inicio[SECCION_ADDITIONAL+1]; j++)
+        {
+            int familia = s->tipo[j] == T_A && s->largoRdata[j] == 4 ? AF_INET
+                          : s->tipo[j] == T_AAAA && s->largoRdata[j] == 16 ? AF_INET6 : AF_UNSPEC;
+            if (familia == AF_UNSPEC || seccionesNombre(s,j,glue) < 0 || strcasecmp(glue,ns) != 0)
+                continue;
+            inet_ntop(familia,s->mensaje + s->rdata[j],ip,sizeof(ip));
+            delegacionAgregar(zona,ns,ip,s->ttl[i]);
+        }
+    }
+}
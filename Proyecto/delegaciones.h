@@ -0,0 +1,57 @@
+#ifndef DELEGACIONES_H_INCLUDED
+#define DELEGACIONES_H_INCLUDED
+
+#include <time.h>
+#include <arpa/inet.h>
+
+#include "nombres.h"
+#include "secciones.h"
+
+/**
+ * Cache de delegaciones: para cada zona (sin el punto final, la raíz es ".") guarda los
+ * servidores de nombres con autoridad sobre ella y sus direcciones (glue), hasta que vence
+ * el menor de sus TTL. La resolución iterativa comienza desde la delegación más cercana al
+ * nombre consultado en lugar de comenzar siempre por la raíz.
+ * Es segura para usar desde varios hilos (el priming de la raíz corre en segundo plano).
+ * Internamente las zonas y los servidores son nombres internados (nombres.h): buscar la zona
+ * de un nombre es calcular el hash de cada sufijo y comparar con memcmp.
+ **/
+
+#define MAX_SERVIDORES_DELEGACION 32   // una entrada por dirección: un NS con A y AAAA ocupa dos
+#define MAX_ZONAS_DELEGACIONES 16384    // llena, se expulsan las vencidas o la que vence primero
+
+typedef struct
+{
+    const NOMBRE_DNS *nombre;       // nombre del servidor de nombres (NS), internado
+    char ip[INET6_ADDRSTRLEN];      // dirección (glue), IPv4 o IPv6
+} SERVIDOR_DELEGACION;
+
+/** Agrega (o refresca) un servidor de la zona. ttl en segundos. **/
+void delegacionAgregar(const char *zona, const char *nombreNS, const char *ip, unsigned int ttl);
+
+/** Reemplaza de una sola vez todos los servidores de una zona (por ejemplo, al cebar la raíz) **/
+void delegacionReemplazar(const char *zona, const SERVIDOR_DELEGACION *servidores, int cantidad, unsigned int ttl);
+
+/**
+ * Busca la zona vigente más cercana que contiene a qname.
+ * Si la encuentra copia la zona y uno de sus servidores, y devuelve 1; si no, devuelve 0.
+ **/
+int delegacionBuscar(const char *qname, char *zona, SERVIDOR_DELEGACION *servidor);
+
+/** Copia hasta max servidores de la zona indicada; devuelve cuántos copió. **/
+int delegacionListar(const char *zona, SERVIDOR_DELEGACION *salida, int max);
+
+/**
+ * Aprende los NS de una referencia que vinieron con su glue (A o AAAA en additional). referencia
+ * es la zona delegada y consultada la zona del servidor que respondió: sólo se aprende si la
+ * delegada está debajo de la consultada, sólo los NS cuyo dueño es la delegada y sólo el glue
+ * de los NS que caen dentro de la consultada (in-bailiwick). Los nombres se leen del mensaje con
+ * sus límites: authority puede traer SOA, NSEC, RRSIG o DS, y un RDATA que no es un nombre se
+ * ignora en lugar de tomarse como tal.
+ **/
+void delegacionAprender(const SECCIONES *s, const char *referencia, const char *consultada);
+
+/** Segundos que le quedan a la zona antes de vencer (0 si no está o ya venció) **/
+unsigned int delegacionRestante(const char *zona);
+
+#endif // DELEGACIONES_H_INCLUDED
@@ -0,0 +1,158 @@
+#include<stdio.h>
+#include<string.h>
+#include<stdlib.h>
+#include<stdint.h>
+#include<netdb.h>
+#include<pthread.h>
+
+#include "direcciones.h"
+
+/** Familia preferida de un servidor; tabla abierta por el puntero del nombre internado **/
+typedef struct
+{
+    const void *servidor;
+    int familia;
+} PREFERENCIA;
+
+static int familiaLimitada = AF_UNSPEC;
+static PREFERENCIA *preferencias;
+static unsigned int capacidadPreferencias, cantidadPreferencias;
+static pthread_mutex_t candadoPreferencias = PTHREAD_MUTEX_INITIALIZER;
+
+int direccionDesdeTexto(DIRECCION *d, const char *ip, int puerto)
+{
+    struct addrinfo pistas, *resultado;
+    memset(d,0,sizeof(DIRECCION));
+    if (inet_pton(AF_INET,ip,&d->v4.sin_addr) == 1)
+    {
+        d->v4.sin_family = AF_INET;
+        d->v4.sin_port = htons(puerto);
+        return 0;
+    }
+    /** getaddrinfo numérico, para que "fe80::1%eth0" quede con su zona **/
+    memset(&pistas,0,sizeof(pistas));
+    pistas.ai_family = AF_INET6;
+    pistas.ai_flags = AI_NUMERICHOST;
+    if (getaddrinfo(ip,NULL,&pistas,&resultado) != 0)
+        return -1;
+    memcpy(&d->v6,resultado->ai_addr,sizeof(d->v6));
+    d->v6.sin6_port = htons(puerto);
+    freeaddrinfo(resultado);
+    return 0;
+}
+
+char *direccionATexto(const DIRECCION *d, char *destino)
+{
+    if (getnameinfo(&d->sa,direccionLargo(d),destino,LARGO_TEXTO_DIRECCION,NULL,0,NI_NUMERICHOST) != 0)
+        strcpy(destino,"?");
+    return destino;
+}
+
+int direccionPuerto(const DIRECCION *d)
+{
+    return ntohs(d->sa.sa_family == AF_INET6 ? d->v6.sin6_port : d->v4.sin_port);
+}
+
+socklen_t direccionLargo(const DIRECCION *d)
+{
+    return d->sa.sa_family == AF_INET6 ? sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in);
+}
+
+int direccionIgual(const DIRECCION *a, const DIRECCION *b)
+{
+    if (a->sa.sa_family != b->sa.sa_family)
+        return 0;
+    if (a->sa.sa_family == AF_INET)
+        return a->v4.sin_addr.s_addr == b->v4.sin_addr.s_addr && a->v4.sin_port == b->v4.sin_port;
+    return memcmp(&a->v6.sin6_addr,&b->v6.sin6_addr,sizeof(a->v6.sin6_addr)) == 0 && a->v6.sin6_port == b->v6.sin6_port;
+}
+
+unsigned int direccionHash(const DIRECCION *d)
+{
+    unsigned int h;
+    if (d->sa.sa_family == AF_INET)
+        h = d->v4.sin_addr.s_addr ^ ((unsigned int)d->v4.sin_port << 16) ^ d->v4.sin_port;
+    else
+    {
+        const uint32_t *p = (const uint32_t*)&d->v6.sin6_addr;
+        h = p[0] ^ p[1] ^ p[2] ^ p[3] ^ ((unsigned int)d->v6.sin6_port << 16) ^ d->v6.sin6_port;
+    }
+    h ^= h >> 16;
+    h *= 0x45d9f3b;
+    h ^= h >> 16;
+    return h;
+}
+
+void direccionLimitarFamilia(int familia)
+{
+    familiaLimitada = familia;
+}
+
+int direccionPermitida(int familia)
+{
+    return familiaLimitada == AF_UNSPEC || familia == familiaLimitada;
+}
+
+int direccionTextoPermitido(const char *ip)
+{
+    DIRECCION d;
+    return direccionDesdeTexto(&d,ip,0) == 0 && direccionPermitida(d.sa.sa_family);
+}
+
+static unsigned int hashServidor(const void *servidor)
+{
+    uint64_t x = (uintptr_t)servidor;
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return (unsigned int)x;
+}
+
+/** La entrada del servidor, o la vacía donde iría; requiere tener el candado y capacidad > 0 **/
+static PREFERENCIA *buscarPreferencia(const void *servidor)
+{
+    unsigned int i = hashServidor(servidor) & (capacidadPreferencias - 1);
+    while (preferencias[i].servidor != NULL && preferencias[i].servidor != servidor)
+        i = (i + 1) & (capacidadPreferencias - 1);
+    return &preferencias[i];
+}
+
+int direccionFamiliaPreferida(const void *servidor)
+{
+    int familia = AF_INET6;
+    pthread_mutex_lock(&candadoPreferencias);
+    if (capacidadPreferencias > 0)
+    {
+        PREFERENCIA *p = buscarPreferencia(servidor);
+        if (p->servidor != NULL)
+            familia = p->familia;
+    }
+    pthread_mutex_unlock(&candadoPreferencias);
+    return familia;
+}
+
+void direccionRegistrarFamilia(const void *servidor, int familia)
+{
+    unsigned int i;
+    if (servidor == NULL)
+        return;
+    pthread_mutex_lock(&candadoPreferencias);
+    /** se agranda al llegar a la mitad, para que las búsquedas sigan cortas **/
+    if (2 * (cantidadPreferencias + 1) > capacidadPreferencias)
+    {
+        PREFERENCIA *anteriores = preferencias;
+        unsigned int capacidadAnterior = capacidadPreferencias;
+        capacidadPreferencias = capacidadPreferencias ? 2 * capacidadPreferencias : 256;
+        preferencias = (PREFERENCIA*)calloc(capacidadPreferencias,sizeof(PREFERENCIA));
+        for (i = 0; i < capacidadAnterior; i++)
+            if (anteriores[i].servidor != NULL)
+                *buscarPreferencia(anteriores[i].servidor) = anteriores[i];
+        free(anteriores);
+    }
+    PREFERENCIA *p = buscarPreferencia(servidor);
+    if (p->servidor == NULL)
+        cantidadPreferencias++;
+    p->servidor = servidor;
+    p->familia = familia;
+    pthread_mutex_unlock(&candadoPreferencias);
+}
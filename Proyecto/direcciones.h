@@ -0,0 +1,60 @@
+#ifndef DIRECCIONES_H_INCLUDED
+#define DIRECCIONES_H_INCLUDED
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/**
+ * Direcciones de los servidores, IPv4 o IPv6, en una sola estructura: el transporte (motor,
+ * resolverConsulta, ritmo, transferencias) no depende de la familia. El texto se acepta como en
+ * resolv.conf: "192.0.2.1", "2001:db8::53" o "fe80::1%eth0" (con zona, para las de enlace local).
+ *
+ * Para los servidores que tienen direcciones de las dos familias (un NS con glue A y AAAA), el
+ * modo iterativo las corre en paralelo como en Happy Eyeballs (RFC 8305): la consulta sale por la
+ * familia preferida del servidor y, si en ESCALON_FAMILIAS_MS no hubo respuesta, también por la
+ * otra; la que responde primero queda como preferida para ese servidor. Sin antecedentes se
+ * prefiere IPv6.
+ **/
+
+#define LARGO_TEXTO_DIRECCION (INET6_ADDRSTRLEN + 16)   // con la zona (%interfaz) de las de enlace local
+#define ESCALON_FAMILIAS_MS 100
+
+typedef union
+{
+    struct sockaddr sa;
+    struct sockaddr_in v4;
+    struct sockaddr_in6 v6;
+} DIRECCION;
+
+/** ip (IPv4 o IPv6, sin corchetes) y puerto a DIRECCION; 0, o -1 si no es una dirección **/
+int direccionDesdeTexto(DIRECCION *d, const char *ip, int puerto);
+
+/** La dirección sin el puerto, en destino (LARGO_TEXTO_DIRECCION bytes); devuelve destino **/
+char *direccionATexto(const DIRECCION *d, char *destino);
+
+/** Puerto, en el orden del host **/
+int direccionPuerto(const DIRECCION *d);
+
+/** Largo de la estructura de su familia, para sendto y connect **/
+socklen_t direccionLargo(const DIRECCION *d);
+
+/** 1 si son la misma dirección y el mismo puerto **/
+int direccionIgual(const DIRECCION *a, const DIRECCION *b);
+
+unsigned int direccionHash(const DIRECCION *d);
+
+/** Limita las consultas a una familia (AF_INET con -4, AF_INET6 con -6; AF_UNSPEC, las dos) **/
+void direccionLimitarFamilia(int familia);
+
+/** 1 si la familia de la dirección (o del texto) se puede usar **/
+int direccionPermitida(int familia);
+int direccionTextoPermitido(const char *ip);
+
+/** Familia preferida de un servidor (el NOMBRE_DNS internado de un NS), la que respondió primero la última vez **/
+int direccionFamiliaPreferida(const void *servidor);
+
+/** Registra qué familia respondió primero a una consulta al servidor **/
+void direccionRegistrarFamilia(const void *servidor, int familia);
+
+#endif // DIRECCIONES_H_INCLUDED
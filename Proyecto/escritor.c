@@ -0,0 +1,400 @@
+#include<stdio.h>
+#include<string.h>
+#include<stdlib.h>
+#include<errno.h>
+#include<fcntl.h>
+#include<unistd.h>
+#include<arpa/inet.h>
+
+#include "dns.h"
+#include "tipos_rr.h"
+#include "traza.h"
+#include "nombres.h"
+#include "escritor.h"
+
+struct ESCRITOR
+{
+    int fd;
+    int formato;
+    char *buffer;
+    int capacidad;
+    int usado;
+    int inicioResultado;            // dónde empieza el resultado que se está armando
+};
+
+static const char *nombresFormato[] = {"texto", "json", "csv", "binario"};
+
+int formatoDesdeNombre(const char *nombre)
+{
+    int i;
+    for (i = 0; i < (int)(sizeof(nombresFormato) / sizeof(nombresFormato[0])); i++)
+        if (strcmp(nombre,nombresFormato[i]) == 0)
+            return i;
+    if (strcmp(nombre,"jsonl") == 0)
+        return FORMATO_JSON;
+    return -1;
+}
+
+/** Escribe todo, reintentando las escrituras parciales **/
+static void escribirTodo(int fd, const char *datos, int largo)
+{
+    while (largo > 0)
+    {
+        ssize_t n = write(fd,datos,largo);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+        {
+            perror("write error");
+            return;
+        }
+        datos += n;
+        largo -= n;
+    }
+}
+
+/** Vuelca los resultados completos y deja al comienzo del buffer el que se está armando **/
+static void volcarCompletos(ESCRITOR *e)
+{
+    escribirTodo(e->fd,e->buffer,e->inicioResultado);
+    memmove(e->buffer,e->buffer + e->inicioResultado,e->usado - e->inicioResultado);
+    e->usado -= e->inicioResultado;
+    e->inicioResultado = 0;
+}
+
+/** Garantiza lugar para n bytes más sin partir el resultado en curso (el binario lo necesita entero) **/
+static void asegurar(ESCRITOR *e, int n)
+{
+    if (e->usado + n <= e->capacidad)
+        return;
+    volcarCompletos(e);
+    if (e->usado + n > e->capacidad)
+    {
+        while (e->usado + n > e->capacidad)
+            e->capacidad *= 2;
+        e->buffer = (char*)realloc(e->buffer,e->capacidad);
+    }
+}
+
+static void agregarBytes(ESCRITOR *e, const void *datos, int largo)
+{
+    asegurar(e,largo);
+    memcpy(e->buffer + e->usado,datos,largo);
+    e->usado += largo;
+}
+
+static void agregarCadena(ESCRITOR *e, const char *s)
+{
+    agregarBytes(e,s,strlen(s));
+}
+
+static void agregarCaracter(ESCRITOR *e, char c)
+{
+    asegurar(e,1);
+    e->buffer[e->usado++] = c;
+}
+
+/** Entero en decimal, sin pasar por printf **/
+static void agregarEntero(ESCRITOR *e, long long valor)
+{
+    char digitos[24];
+    int n = sizeof(digitos);
+    unsigned long long absoluto = valor < 0 ? -(unsigned long long)valor : (unsigned long long)valor;
+    do
+    {
+        digitos[--n] = '0' + absoluto % 10;
+        absoluto /= 10;
+    }
+    while (absoluto > 0);
+    if (valor < 0)
+        digitos[--n] = '-';
+    agregarBytes(e,digitos + n,sizeof(digitos) - n);
+}
+
+/**
+ * Un nombre en forma presentación: los registros ya vienen así (nombreLeerPresentacion), pero la
+ * consulta es la línea del archivo tal cual; sus bytes no imprimibles quedan como \DDD.
+ * Devuelve nombre si no hace falta cambiar nada, o destino (MAX_TEXTO_NOMBRE bytes).
+ **/
+static const char *presentacion(const char *nombre, char *destino)
+{
+    const unsigned char *p;
+    int n = 0;
+    for (p = (const unsigned char*)nombre; *p; p++)
+        if (*p < 0x21 || *p > 0x7e)
+            break;
+    if (*p == '\0')
+        return nombre;
+    for (p = (const unsigned char*)nombre; *p && n < MAX_TEXTO_NOMBRE - 5; p++)
+    {
+        if (*p < 0x21 || *p > 0x7e)
+            n += sprintf(destino + n,"\\%03u",*p);
+        else
+            destino[n++] = *p;
+    }
+    destino[n] = '\0';
+    return destino;
+}
+
+static void agregarJSON(ESCRITOR *e, const char *s)
+{
+    static const char hex[] = "0123456789abcdef";
+    agregarCaracter(e,'"');
+    for (; *s; s++)
+    {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\')
+        {
+            agregarCaracter(e,'\\');
+            agregarCaracter(e,c);
+        }
+        else if (c < 0x20)
+        {
+            char escape[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0x0f]};
+            agregarBytes(e,escape,6);
+        }
+        else
+            agregarCaracter(e,c);
+    }
+    agregarCaracter(e,'"');
+}
+
+/** Campo CSV: entre comillas sólo si tiene separadores, comillas o saltos de línea (RFC 4180) **/
+static void agregarCSV(ESCRITOR *e, const char *s)
+{
+    if (strpbrk(s,",\"\r\n") == NULL)
+    {
+        agregarCadena(e,s);
+        return;
+    }
+    agregarCaracter(e,'"');
+    for (; *s; s++)
+    {
+        if (*s == '"')
+            agregarCaracter(e,'"');
+        agregarCaracter(e,*s);
+    }
+    agregarCaracter(e,'"');
+}
+
+static void agregar8(ESCRITOR *e, unsigned int v)
+{
+    agregarCaracter(e,(char)v);
+}
+
+static void agregar16(ESCRITOR *e, unsigned int v)
+{
+    unsigned char b[2] = {v >> 8, v};
+    agregarBytes(e,b,2);
+}
+
+static void agregar32(ESCRITOR *e, unsigned int v)
+{
+    unsigned char b[4] = {v >> 24, v >> 16, v >> 8, v};
+    agregarBytes(e,b,4);
+}
+
+/** Cadena con su largo adelante (1 o 2 bytes) **/
+static void agregarCorta(ESCRITOR *e, const char *s, int bytesLargo)
+{
+    int largo = strlen(s), maximo = bytesLargo == 1 ? 255 : 65535;
+    if (largo > maximo)
+        largo = maximo;
+    if (bytesLargo == 1)
+        agregar8(e,largo);
+    else
+        agregar16(e,largo);
+    agregarBytes(e,s,largo);
+}
+
+static const char *textoEstado(const RESULTADO *r)
+{
+    if (r->estado == ESTADO_TIMEOUT)
+        return "TIMEOUT";
+    if (r->estado == ESTADO_ERROR)
+        return "ERROR";
+    if (r->estado == 0 && r->cantidad == 0)
+        return "NODATA";
+    return mapearRcode(r->estado);
+}
+
+ESCRITOR *escritorAbrir(const char *archivo, int formato)
+{
+    ESCRITOR *e;
+    int fd = STDOUT_FILENO;
+    if (archivo != NULL && strcmp(archivo,"-") != 0 && (fd = open(archivo,O_WRONLY | O_CREAT | O_TRUNC,0644)) < 0)
+    {
+        printf("ERROR: no se pudo abrir el archivo de salida %s\n",archivo);
+        return NULL;
+    }
+    e = (ESCRITOR*)calloc(1,sizeof(ESCRITOR));
+    e->fd = fd;
+    e->formato = formato;
+    e->capacidad = BUFFER_ESCRITOR;
+    e->buffer = (char*)malloc(e->capacidad);
+    if (formato == FORMATO_CSV)
+        agregarCadena(e,"qname,qtype,status,rtt_us,name,type,ttl,data\n");
+    else if (formato == FORMATO_BINARIO)
+        agregarBytes(e,"DQR1",4);
+    e->inicioResultado = e->usado;
+    return e;
+}
+
+static void resultadoTexto(ESCRITOR *e, const RESULTADO *r)
+{
+    char textoTipo[LARGO_TEXTO_TIPO];
+    char escapada[MAX_TEXTO_NOMBRE];
+    int i;
+    if (r->cantidad == 0)
+    {
+        agregarCadena(e,presentacion(r->consulta,escapada));
+        agregarCaracter(e,'\t');
+        agregarCadena(e,textoEstado(r));
+        agregarCaracter(e,'\n');
+    }
+    for (i = 0; i < r->cantidad; i++)
+    {
+        agregarCadena(e,presentacion((char*)r->registros[i].name,escapada));
+        agregarCaracter(e,'\t');
+        agregarCadena(e,mapearTipo(r->registros[i].resource.type,textoTipo));
+        agregarCaracter(e,'\t');
+        agregarCadena(e,r->registros[i].texto);
+        agregarCaracter(e,'\n');
+    }
+}
+
+static void resultadoJSON(ESCRITOR *e, const RESULTADO *r)
+{
+    char textoTipo[LARGO_TEXTO_TIPO];
+    char escapada[MAX_TEXTO_NOMBRE];
+    int i;
+    agregarCadena(e,"{\"qname\":");
+    agregarJSON(e,presentacion(r->consulta,escapada));
+    agregarCadena(e,",\"qtype\":");
+    agregarJSON(e,mapearTipo(r->tipo,textoTipo));
+    agregarCadena(e,",\"status\":");
+    agregarJSON(e,textoEstado(r));
+    if (r->rtt >= 0)
+    {
+        agregarCadena(e,",\"rtt_us\":");
+        agregarEntero(e,r->rtt);
+    }
+    agregarCadena(e,",\"answers\":[");
+    for (i = 0; i < r->cantidad; i++)
+    {
+        struct RESOURCE_RECORD *rr = &r->registros[i];
+        agregarCadena(e,i > 0 ? ",{\"name\":" : "{\"name\":");
+        agregarJSON(e,presentacion((char*)rr->name,escapada));
+        agregarCadena(e,",\"type\":");
+        agregarJSON(e,mapearTipo(rr->resource.type,textoTipo));
+        agregarCadena(e,",\"ttl\":");
+        agregarEntero(e,rr->resource.ttl);
+        agregarCadena(e,",\"data\":");
+        agregarJSON(e,rr->texto);
+        agregarCaracter(e,'}');
+    }
+    agregarCadena(e,"]}\n");
+}
+
+static void resultadoCSV(ESCRITOR *e, const RESULTADO *r)
+{
+    char textoTipo[LARGO_TEXTO_TIPO];
+    char escapada[MAX_TEXTO_NOMBRE], nombre[MAX_TEXTO_NOMBRE];
+    const char *consulta = presentacion(r->consulta,escapada);
+    int i = 0;
+    do
+    {
+        agregarCSV(e,consulta);
+        agregarCaracter(e,',');
+        agregarCadena(e,mapearTipo(r->tipo,textoTipo));
+        agregarCaracter(e,',');
+        agregarCadena(e,textoEstado(r));
+        agregarCaracter(e,',');
+        if (r->rtt >= 0)
+            agregarEntero(e,r->rtt);
+        if (i < r->cantidad)
+        {
+            struct RESOURCE_RECORD *rr = &r->registros[i];
+            agregarCaracter(e,',');
+            agregarCSV(e,presentacion((char*)rr->name,nombre));
+            agregarCaracter(e,',');
+            agregarCadena(e,mapearTipo(rr->resource.type,textoTipo));
+            agregarCaracter(e,',');
+            agregarEntero(e,rr->resource.ttl);
+            agregarCaracter(e,',');
+            agregarCSV(e,rr->texto);
+        }
+        else
+            agregarCadena(e,",,,,");
+        agregarCaracter(e,'\n');
+    }
+    while (++i < r->cantidad);
+}
+
+static void resultadoBinario(ESCRITOR *e, const RESULTADO *r)
+{
+    char escapada[MAX_TEXTO_NOMBRE];
+    int i, inicio;
+    agregar32(e,0);                 /** largo: se completa al final **/
+    inicio = e->usado;
+    agregar16(e,r->tipo);
+    agregar8(e,r->estado);
+    agregar32(e,r->rtt >= 0 ? (unsigned int)r->rtt : 0xFFFFFFFF);
+    agregarCorta(e,presentacion(r->consulta,escapada),1);
+    agregar16(e,r->cantidad);
+    for (i = 0; i < r->cantidad; i++)
+    {
+        struct RESOURCE_RECORD *rr = &r->registros[i];
+        agregarCorta(e,presentacion((char*)rr->name,escapada),1);
+        agregar16(e,rr->resource.type);
+        agregar32(e,rr->resource.ttl);
+        agregarCorta(e,rr->texto,2);
+    }
+    /** asegurar() nunca parte el resultado en curso, así que el largo sigue en el buffer **/
+    unsigned int largo = e->usado - inicio;
+    unsigned char *p = (unsigned char*)e->buffer + inicio - 4;
+    p[0] = largo >> 24;
+    p[1] = largo >> 16;
+    p[2] = largo >> 8;
+    p[3] = largo;
+}
+
+void escritorResultado(ESCRITOR *e, const RESULTADO *r)
+{
+    e->inicioResultado = e->usado;
+    switch (e->formato)
+    {
+        case FORMATO_JSON:
+            resultadoJSON(e,r);
+            break;
+        case FORMATO_CSV:
+            resultadoCSV(e,r);
+            break;
+        case FORMATO_BINARIO:
+            resultadoBinario(e,r);
+            break;
+        default:
+            resultadoTexto(e,r);
+    }
+    e->inicioResultado = e->usado;
+}
+
+void escritorVolcar(ESCRITOR *e)
+{
+    e->inicioResultado = e->usado;
+    volcarCompletos(e);
+}
+
+void escritorCerrar(ESCRITOR *e)
+{
+    escritorVolcar(e);
+    if (e->fd != STDOUT_FILENO)
+        close(e->fd);
+    free(e->buffer);
+    free(e);
+}
+
+int escritorEnSalidaEstandar(const ESCRITOR *e)
+{
+    return e->fd == STDOUT_FILENO;
+}
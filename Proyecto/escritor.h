@@ -0,0 +1,73 @@
+#ifndef ESCRITOR_H_INCLUDED
+#define ESCRITOR_H_INCLUDED
+
+#include "dns.h"
+
+/**
+ * Escritores de resultados para los modos masivos (-ptr=, -lote=) y para -formato= en general.
+ * Cada resultado (una consulta con su estado y sus registros) se arma directamente en un buffer
+ * grande y reutilizado, que se vuelca con un único write() cuando se llena y al cerrar: no hay
+ * un printf por campo ni una llamada al sistema por línea.
+ *
+ * Formatos (parámetro -formato=):
+ *  texto:  una línea por registro "dueño<TAB>TIPO<TAB>dato" (el dueño de cada registro: en una cadena
+ *          CNAME no es la consulta), o "consulta<TAB>ESTADO" si no hay registros (NXDOMAIN, NODATA,
+ *          TIMEOUT, SERVFAIL, ERROR...). Es el formato histórico del barrido.
+ *  json:   JSON Lines, un objeto por consulta:
+ *          {"qname":..,"qtype":..,"status":..,"rtt_us":..,"answers":[{"name":..,"type":..,"ttl":..,"data":..}]}
+ *  csv:    RFC 4180, con encabezado; una fila por registro (o una fila con los campos del registro
+ *          vacíos): qname,qtype,status,rtt_us,name,type,ttl,data
+ *  binario: "DQR1" al comienzo del archivo y luego un registro por consulta, todos los enteros en
+ *          orden de red:
+ *              u32 largo del resto del registro
+ *              u16 qtype, u8 estado (rcode, 255 = timeout, 254 = error), u32 rtt_us
+ *              u8 largo + qname, u16 cantidad de registros, y por cada uno:
+ *              u8 largo + nombre, u16 tipo, u32 ttl, u16 largo + dato (forma presentación)
+ *
+ * Los nombres salen en forma presentación: los bytes no imprimibles como \DDD y, dentro de un
+ * label, '.' y '\' precedidos de '\'.
+ **/
+
+#define FORMATO_TEXTO 0
+#define FORMATO_JSON 1
+#define FORMATO_CSV 2
+#define FORMATO_BINARIO 3
+
+/** Estado de un resultado sin respuesta, y de una consulta que no se pudo enviar **/
+#define ESTADO_TIMEOUT 255
+#define ESTADO_ERROR 254
+
+/** Tamaño del buffer de cada escritor: se vuelca cuando queda menos que un resultado máximo **/
+#define BUFFER_ESCRITOR (1 << 20)
+
+typedef struct
+{
+    const char *consulta;           // nombre consultado (o la dirección, en el barrido PTR)
+    int tipo;                       // qtype
+    int estado;                     // rcode de la respuesta, ESTADO_TIMEOUT o ESTADO_ERROR
+    long long rtt;                  // microsegundos, -1 si no se midió
+    struct RESOURCE_RECORD *registros;
+    int cantidad;
+} RESULTADO;
+
+typedef struct ESCRITOR ESCRITOR;
+
+/** "texto", "json", "csv" o "binario"; -1 si no se conoce **/
+int formatoDesdeNombre(const char *nombre);
+
+/** Abre el escritor sobre archivo (NULL o "-" = salida estándar); NULL si no se pudo abrir **/
+ESCRITOR *escritorAbrir(const char *archivo, int formato);
+
+/** Agrega un resultado; sólo escribe cuando el buffer se llena **/
+void escritorResultado(ESCRITOR *e, const RESULTADO *r);
+
+/** Vuelca lo pendiente **/
+void escritorVolcar(ESCRITOR *e);
+
+/** Vuelca, cierra el archivo (salvo la salida estándar) y libera el escritor **/
+void escritorCerrar(ESCRITOR *e);
+
+/** Indica si el escritor usa la salida estándar (los resúmenes van entonces a la de error) **/
+int escritorEnSalidaEstandar(const ESCRITOR *e);
+
+#endif // ESCRITOR_H_INCLUDED
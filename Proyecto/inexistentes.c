@@ -0,0 +1,281 @@
+#include<stdio.h>
+#include<string.h>
+#include<stdlib.h>
+#include<time.h>
+
+#include "cabecera.h"
+#include "nombres.h"
+#include "inexistentes.h"
+
+#define MAGICO_INEXISTENTES "DQNX"
+#define VERSION_INEXISTENTES 1
+
+/** Una ranura: huella 0 = vacía **/
+typedef struct
+{
+    uint32_t huella;
+    uint32_t vence;                 // segundos desde 1970
+} RANURA;
+
+static RANURA *tabla;
+static uint32_t cubetas, cantidad;
+static char *archivoFiltro;
+static int reverificacion;
+static long salteados, agregados, quitados;
+
+/** Mezcla de 32 bits (el final de MurmurHash3): las cubetas salen sólo de la huella, así se puede crecer **/
+static uint32_t mezclar(uint32_t x)
+{
+    x ^= x >> 16;
+    x *= 0x85ebca6b;
+    x ^= x >> 13;
+    x *= 0xc2b2ae35;
+    x ^= x >> 16;
+    return x;
+}
+
+static uint32_t primeraCubeta(uint32_t huella)
+{
+    return mezclar(huella) & (cubetas - 1);
+}
+
+/** La otra cubeta de la huella: aplicada dos veces vuelve a la primera **/
+static uint32_t otraCubeta(uint32_t cubeta, uint32_t huella)
+{
+    return (cubeta ^ mezclar(huella * 0x9e3779b9)) & (cubetas - 1);
+}
+
+static uint32_t huellaNombre(const char *nombre, int *valido)
+{
+    NOMBRE_DNS n;
+    uint32_t huella;
+    *valido = nombreDesdeCadena(nombre,&n) == 0;
+    if (!*valido)
+        return 0;
+    huella = n.hash;
+    return huella != 0 ? huella : 1;
+}
+
+/** La ranura de la huella, o NULL si no está **/
+static RANURA *buscar(uint32_t huella)
+{
+    uint32_t c = primeraCubeta(huella), i, vuelta;
+    for (vuelta = 0; vuelta < 2; vuelta++, c = otraCubeta(c,huella))
+        for (i = 0; i < RANURAS_INEXISTENTES; i++)
+            if (tabla[c * RANURAS_INEXISTENTES + i].huella == huella)
+                return &tabla[c * RANURAS_INEXISTENTES + i];
+    return NULL;
+}
+
+static int ponerEnCubeta(uint32_t c, RANURA r)
+{
+    int i;
+    for (i = 0; i < RANURAS_INEXISTENTES; i++)
+        if (tabla[c * RANURAS_INEXISTENTES + i].huella == 0)
+        {
+            tabla[c * RANURAS_INEXISTENTES + i] = r;
+            return 1;
+        }
+    return 0;
+}
+
+/**
+ * Inserta sin crecer: si las dos cubetas están llenas desaloja una ranura al azar y la lleva a su
+ * otra cubeta, hasta MAX_DESALOJOS_INEXISTENTES veces. Si no alcanza devuelve 0 y deja en *r la
+ * ranura que quedó afuera.
+ **/
+static int insertar(RANURA *r)
+{
+    uint32_t c = primeraCubeta(r->huella);
+    int n;
+    if (ponerEnCubeta(c,*r) || ponerEnCubeta(c = otraCubeta(c,r->huella),*r))
+        return 1;
+    for (n = 0; n < MAX_DESALOJOS_INEXISTENTES; n++)
+    {
+        RANURA *victima = &tabla[c * RANURAS_INEXISTENTES + rand() % RANURAS_INEXISTENTES];
+        RANURA desalojada = *victima;
+        *victima = *r;
+        *r = desalojada;
+        c = otraCubeta(c,r->huella);
+        if (ponerEnCubeta(c,*r))
+            return 1;
+    }
+    return 0;
+}
+
+static void reservar(uint32_t nuevas)
+{
+    tabla = (RANURA*)calloc((size_t)nuevas * RANURAS_INEXISTENTES,sizeof(RANURA));
+    cubetas = nuevas;
+}
+
+/**
+ * Duplica la tabla y vuelve a ubicar todo; pendiente es la ranura que no había entrado. Si en la
+ * tabla nueva tampoco entra todo, se descarta y se prueba con el doble, siempre desde la vieja.
+ **/
+static void crecer(RANURA pendiente)
+{
+    RANURA *vieja = tabla;
+    uint32_t viejas = cubetas, i;
+    int entro;
+    do
+    {
+        RANURA r = pendiente;
+        reservar(cubetas * 2);
+        entro = insertar(&r);
+        for (i = 0; entro && i < viejas * RANURAS_INEXISTENTES; i++)
+            if (vieja[i].huella != 0)
+            {
+                RANURA movida = vieja[i];
+                entro = insertar(&movida);
+            }
+        if (!entro)
+            free(tabla);
+    }
+    while (!entro);
+    free(vieja);
+}
+
+int inexistentesAbrir(const char *archivo, int reverificar)
+{
+    unsigned char encabezado[16], ranura[8];
+    uint32_t i, guardadas;
+    FILE *f;
+
+    archivoFiltro = strdup(archivo);
+    reverificacion = reverificar;
+    if ((f = fopen(archivo,"rb")) == NULL)
+    {
+        reservar(CUBETAS_INEXISTENTES_INICIAL);   /** primera corrida: el archivo se crea al cerrar **/
+        return 0;
+    }
+    if (fread(encabezado,1,16,f) != 16 || memcmp(encabezado,MAGICO_INEXISTENTES,4) != 0
+            || leer32(encabezado + 4) != VERSION_INEXISTENTES)
+    {
+        printf("ERROR: %s no es un filtro de nombres inexistentes\n",archivo);
+        fclose(f);
+        return -1;
+    }
+    guardadas = leer32(encabezado + 8);
+    if (guardadas == 0 || (guardadas & (guardadas - 1)) != 0 || guardadas > (1u << 28))
+    {
+        printf("ERROR: el filtro %s está dañado\n",archivo);
+        fclose(f);
+        return -1;
+    }
+    reservar(guardadas);
+    for (i = 0; i < cubetas * RANURAS_INEXISTENTES; i++)
+    {
+        if (fread(ranura,1,8,f) != 8)
+        {
+            printf("ERROR: el filtro %s está cortado\n",archivo);
+            fclose(f);
+            free(tabla);
+            tabla = NULL;
+            return -1;
+        }
+        tabla[i].huella = leer32(ranura);
+        tabla[i].vence = leer32(ranura + 4);
+        cantidad += tabla[i].huella != 0;
+    }
+    fclose(f);
+    return 0;
+}
+
+int inexistentesActivo()
+{
+    return tabla != NULL;
+}
+
+int inexistentesDecidir(const char *nombre)
+{
+    int valido;
+    uint32_t huella = huellaNombre(nombre,&valido);
+    RANURA *r;
+    if (tabla == NULL || !valido || (r = buscar(huella)) == NULL)
+        return INEXISTENTE_CONSULTAR;
+    if (reverificacion && r->vence <= (uint32_t)time(NULL))
+        return INEXISTENTE_CONSULTAR;
+    salteados++;
+    return INEXISTENTE_SALTEAR;
+}
+
+void inexistentesResultado(const char *nombre, int rcode, uint32_t ttlNegativo)
+{
+    int valido;
+    uint32_t huella = huellaNombre(nombre,&valido);
+    RANURA *r;
+    if (tabla == NULL || !valido)
+        return;
+    r = buscar(huella);
+    if (rcode == 3)
+    {
+        RANURA nueva = {huella, (uint32_t)time(NULL) + ttlNegativo};
+        if (r != NULL)
+        {
+            r->vence = nueva.vence;
+            return;
+        }
+        if (!insertar(&nueva))
+            crecer(nueva);
+        cantidad++;
+        agregados++;
+    }
+    else if (rcode == 0 && r != NULL)
+    {
+        r->huella = 0;
+        cantidad--;
+        quitados++;
+    }
+}
+
+void inexistentesEstadisticas(long *salteadosFiltro, long *agregadosFiltro, long *quitadosFiltro, long *total)
+{
+    *salteadosFiltro = salteados;
+    *agregadosFiltro = agregados;
+    *quitadosFiltro = quitados;
+    *total = cantidad;
+}
+
+int inexistentesCerrar()
+{
+    unsigned char encabezado[16], ranura[8];
+    char temporal[4096];
+    uint32_t i;
+    int resultado = 0;
+    FILE *f;
+
+    if (tabla == NULL)
+        return 0;
+    snprintf(temporal,sizeof(temporal),"%s.tmp",archivoFiltro);
+    if ((f = fopen(temporal,"wb")) == NULL)
+    {
+        printf("ERROR: no se pudo escribir el filtro %s\n",temporal);
+        resultado = -1;
+    }
+    else
+    {
+        memcpy(encabezado,MAGICO_INEXISTENTES,4);
+        escribir32(encabezado + 4,VERSION_INEXISTENTES);
+        escribir32(encabezado + 8,cubetas);
+        escribir32(encabezado + 12,cantidad);
+        fwrite(encabezado,1,16,f);
+        for (i = 0; i < cubetas * RANURAS_INEXISTENTES; i++)
+        {
+            escribir32(ranura,tabla[i].huella);
+            escribir32(ranura + 4,tabla[i].vence);
+            fwrite(ranura,1,8,f);
+        }
+        /** recién con todo escrito reemplaza al anterior: un corte no deja un filtro a medias **/
+        if (fclose(f) != 0 || rename(temporal,archivoFiltro) != 0)
+        {
+            perror("filtro de inexistentes");
+            resultado = -1;
+        }
+    }
+    free(tabla);
+    free(archivoFiltro);
+    tabla = NULL;
+    archivoFiltro = NULL;
+    return resultado;
+}
@@ -0,0 +1,52 @@
+#ifndef INEXISTENTES_H_INCLUDED
+#define INEXISTENTES_H_INCLUDED
+
+#include <stdint.h>
+
+/**
+ * Filtro persistente de nombres que ya dieron NXDOMAIN, para los lotes que se repiten todos los
+ * días sobre casi los mismos nombres (-nxfiltro=archivo). Es un filtro cuckoo: cubetas de
+ * RANURAS_INEXISTENTES ranuras, cada una con una huella de 32 bits del nombre (el CRC32C de su
+ * forma wire en minúsculas) y el instante en que vence su TTL negativo (RFC 2308: el mínimo entre
+ * el TTL del SOA de authority y su campo MINIMUM).
+ *
+ * A diferencia de un Bloom, un nombre se puede sacar (cuando vuelve a existir) y cada entrada
+ * conserva su vencimiento. Como todo filtro por huellas puede dar falsos positivos, pero con 32
+ * bits son del orden de uno cada cientos de millones de consultas.
+ *
+ * Sin reverificación, el lote saltea todos los nombres del filtro, vencidos o no: son los que ya
+ * se sabe que no existen. Con reverificación (-reverificar) sólo saltea los vigentes; los vencidos
+ * se vuelven a consultar y el resultado nuevo renueva o quita la entrada. El archivo se reescribe
+ * completo (en un temporal que después se renombra) al terminar el lote.
+ **/
+
+#define RANURAS_INEXISTENTES 4
+#define CUBETAS_INEXISTENTES_INICIAL 1024
+#define MAX_DESALOJOS_INEXISTENTES 500
+
+/** TTL negativo cuando la respuesta no trae el SOA (o viene de una resolución iterativa) **/
+#define TTL_NEGATIVO_POR_OMISION 3600
+
+/** Decisión para un nombre **/
+#define INEXISTENTE_CONSULTAR 0
+#define INEXISTENTE_SALTEAR 1
+
+/** Carga el filtro del archivo, o empieza uno vacío si todavía no existe; 0, o -1 si no se pudo leer **/
+int inexistentesAbrir(const char *archivo, int reverificar);
+
+/** Indica si hay un filtro abierto **/
+int inexistentesActivo();
+
+/** Si hay que consultar el nombre o saltearlo porque está en el filtro **/
+int inexistentesDecidir(const char *nombre);
+
+/** El resultado de una consulta: un NXDOMAIN agrega (o renueva) el nombre, un NOERROR lo quita **/
+void inexistentesResultado(const char *nombre, int rcode, uint32_t ttlNegativo);
+
+/** Nombres salteados, agregados y quitados en esta ejecución, y los que tiene el filtro **/
+void inexistentesEstadisticas(long *salteados, long *agregados, long *quitados, long *total);
+
+/** Guarda el filtro en su archivo y lo cierra; 0 o -1 **/
+int inexistentesCerrar();
+
+#endif // INEXISTENTES_H_INCLUDED
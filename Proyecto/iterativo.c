@@ -0,0 +1,574 @@
+#include<stdio.h>
+#include<string.h>
+#include<stdlib.h>
+#include<sys/socket.h>
+#include<arpa/inet.h>
+#include<netinet/in.h>
+
+#include "dns.h"
+#include "tipos_rr.h"
+#include "traza.h"
+#include "motor.h"
+#include "nombres.h"
+#include "delegaciones.h"
+#include "raices.h"
+#include "zonas.h"
+#include "escritor.h"
+#include "secciones.h"
+#include "negativas.h"
+#include "cache.h"
+#include "direcciones.h"
+#include "iterativo.h"
+#include "aleatorio.h"
+
+/** Estados de una resolución **/
+#define ENVIAR 0
+#define ESPERAR_RESPUESTA 1
+#define ESPERAR_NS 2
+
+#define RCODE_SERVFAIL 2
+
+typedef struct RESOLUCION
+{
+    struct ITERATIVO *it;
+    int estado;
+    char original[256];             // nombre pedido
+    char actual[256];               // nombre que se busca ahora (el canónico, después de un alias)
+    int tipo;
+    char zona[256];                 // zona de la delegación que se está siguiendo
+
+    /** servidores de la delegación actual: con glue, y los que hay que resolver antes **/
+    SERVIDOR_DELEGACION servidores[MAX_SERVIDORES_DELEGACION];
+    int cantidadServidores, inicioServidores, proximoServidor;
+    unsigned int usados;            // bit por servidor ya probado (MAX_SERVIDORES_DELEGACION <= 32)
+    const NOMBRE_DNS *sinGlue[MAX_SERVIDORES_DELEGACION];
+    int cantidadSinGlue, proximoSinGlue;
+
+    char ip[LARGO_TEXTO_DIRECCION]; // servidor del salto en curso (el que respondió, si hubo respuesta)
+    DIRECCION destino, alterna;     // alterna: la otra familia del mismo NS, o sin familia
+    const NOMBRE_DNS *servidor;     // NS del salto en curso, para recordar qué familia le respondió primero
+    int saltos, alias, profundidad;
+    int error;                      // estado final si se acaban los servidores
+    long long comienzo;
+    TRAZA_CONSULTA *traza;          // la propia, o la de la resolución que buscaba este NS sin glue
+    TRAZA_CONSULTA trazaPropia;
+
+    /** answer de cada paso de la cadena de alias: los registros apuntan dentro de las copias **/
+    unsigned char *mensajes[MAX_CNAME + 1];
+    int cantidadMensajes;
+    struct RESOURCE_RECORD *registros;
+    int cantidadRegistros, capacidadRegistros;
+
+    FIN_ITERATIVO fin;
+    void *contexto;
+    struct RESOLUCION *siguiente;   // cola de envíos pendientes
+} RESOLUCION;
+
+struct ITERATIVO
+{
+    MOTOR *m;
+    char puerto[8];
+    RESOLUCION *listas, *ultimaLista;
+    int pendientes;
+    long saltos, resueltas;
+    OBSERVADOR_ITERATIVO observador;
+    void *contextoObservador;
+    SECCIONES secciones;            // la respuesta en proceso; la reserva sirve para todas
+};
+
+/** respuestas armadas en el proceso (zonas locales, negativas sintetizadas, cache): de éstas no se aprende **/
+static unsigned char respuestaLocal[65536];
+
+static void siguienteServidor(RESOLUCION *r);
+
+ITERATIVO *iterativoCrear(int maxEnVuelo, const char *puerto)
+{
+    ITERATIVO *it = (ITERATIVO*)calloc(1,sizeof(ITERATIVO));
+    if ((it->m = motorCrear(maxEnVuelo,0,TIMEOUT_ITERATIVO_MS,REINTENTOS_ITERATIVO)) == NULL)
+    {
+        free(it);
+        return NULL;
+    }
+    snprintf(it->puerto,sizeof(it->puerto),"%s",puerto);
+    raicesIniciar(puerto);
+    return it;
+}
+
+void iterativoDestruir(ITERATIVO *it)
+{
+    motorDestruir(it->m);
+    seccionesLiberar(&it->secciones);
+    free(it);
+}
+
+void iterativoObservar(ITERATIVO *it, OBSERVADOR_ITERATIVO observador, void *contexto)
+{
+    it->observador = observador;
+    it->contextoObservador = contexto;
+}
+
+int iterativoPendientes(ITERATIVO *it)
+{
+    return it->pendientes;
+}
+
+long iterativoSaltos(ITERATIVO *it)
+{
+    return it->saltos;
+}
+
+long iterativoResueltas(ITERATIVO *it)
+{
+    return it->resueltas;
+}
+
+static void encolar(RESOLUCION *r)
+{
+    ITERATIVO *it = r->it;
+    r->estado = ENVIAR;
+    r->siguiente = NULL;
+    if (it->ultimaLista != NULL)
+        it->ultimaLista->siguiente = r;
+    else
+        it->listas = r;
+    it->ultimaLista = r;
+}
+
+/** Clasificación del final de una resolución para la traza (ver traza.h) **/
+static const char *clasificarFin(const RESULTADO *resultado)
+{
+    if (resultado->estado == ESTADO_TIMEOUT)
+        return "timeout";
+    if (resultado->estado == 3)
+        return "nxdomain";
+    if (resultado->estado != 0)
+        return "error";
+    return resultado->cantidad > 0 ? "answer" : "nodata";
+}
+
+static void terminar(RESOLUCION *r, int estado)
+{
+    int i;
+    RESULTADO resultado = {r->original, r->tipo, estado, trazaMicrosegundos() - r->comienzo, r->registros, r->cantidadRegistros};
+    if (r->traza == &r->trazaPropia)
+        trazaFinConsulta(r->traza,clasificarFin(&resultado));
+    r->it->pendientes--;
+    r->it->resueltas++;
+    r->fin(r->contexto,&resultado);
+    liberarRegistros(r->registros,r->cantidadRegistros);
+    free(r->registros);
+    for (i = 0; i < r->cantidadMensajes; i++)
+        free(r->mensajes[i]);
+    free(r);
+}
+
+/** traza: la de la resolución que la pidió, o NULL para una consulta nueva con su propia traza **/
+static RESOLUCION *nuevaResolucion(ITERATIVO *it, const char *nombre, int tipo, FIN_ITERATIVO fin, void *contexto,
+                                   TRAZA_CONSULTA *traza)
+{
+    char textoTipo[LARGO_TEXTO_TIPO];
+    RESOLUCION *r = (RESOLUCION*)calloc(1,sizeof(RESOLUCION));
+    r->it = it;
+    strcpy(r->original,nombre);
+    strcpy(r->actual,nombre);
+    r->tipo = tipo;
+    r->error = ESTADO_TIMEOUT;
+    r->comienzo = trazaMicrosegundos();
+    r->fin = fin;
+    r->contexto = contexto;
+    if ((r->traza = traza) == NULL)
+    {
+        r->traza = &r->trazaPropia;
+        trazaComenzarConsulta(r->traza,nombre,mapearTipo(tipo,textoTipo));
+    }
+    it->pendientes++;
+    return r;
+}
+
+/** Toma los servidores para el nombre actual de la cache de delegaciones y prueba el primero **/
+static void comenzarDesdeDelegacion(RESOLUCION *r)
+{
+    char textoTipo[LARGO_TEXTO_TIPO];
+    SERVIDOR_DELEGACION inicial;
+    if (!delegacionBuscar(r->actual,r->zona,&inicial))
+    {
+        terminar(r,RCODE_SERVFAIL);
+        return;
+    }
+    if (strcmp(r->zona,".") != 0)
+        trazaCache(r->traza,r->actual,mapearTipo(r->tipo,textoTipo),r->zona,inicial.ip);
+    r->cantidadServidores = delegacionListar(r->zona,r->servidores,MAX_SERVIDORES_DELEGACION);
+    r->inicioServidores = r->cantidadServidores > 0 ? aleatorioMenor(r->cantidadServidores) : 0;
+    r->proximoServidor = 0;
+    r->usados = 0;
+    r->cantidadSinGlue = 0;
+    r->proximoSinGlue = 0;
+    siguienteServidor(r);
+}
+
+/** Fin de la resolución hija que buscaba la dirección de un NS sin glue **/
+static void finNS(void *contexto, const RESULTADO *resultado)
+{
+    RESOLUCION *r = (RESOLUCION*)contexto;
+    int i;
+    for (i = 0; i < resultado->cantidad; i++)
+    {
+        struct RESOURCE_RECORD *rr = &resultado->registros[i];
+        int familia = rr->resource.type == T_A && rr->resource.rdlength == 4 ? AF_INET
+                      : rr->resource.type == T_AAAA && rr->resource.rdlength == 16 ? AF_INET6 : AF_UNSPEC;
+        if (familia != AF_UNSPEC && direccionPermitida(familia))
+        {
+            inet_ntop(familia,rr->rdata,r->ip,sizeof(r->ip));
+            direccionDesdeTexto(&r->destino,r->ip,atoi(r->it->puerto));
+            memset(&r->alterna,0,sizeof(r->alterna));
+            r->servidor = NULL;
+            encolar(r);
+            return;
+        }
+    }
+    siguienteServidor(r);
+}
+
+/**
+ * Pasa al próximo servidor de la delegación (rotando desde uno al azar, para repartir la carga);
+ * si el NS tiene glue de las dos familias, la otra dirección queda como alterna y sale primero la
+ * que el NS prefiere (ver direcciones.h). Si no quedan con glue, resuelve la dirección del próximo
+ * NS sin glue. Si no queda ninguno, la resolución termina con el último error.
+ **/
+static void siguienteServidor(RESOLUCION *r)
+{
+    int puerto = atoi(r->it->puerto);
+    while (r->proximoServidor < r->cantidadServidores)
+    {
+        int i = (r->inicioServidores + r->proximoServidor++) % r->cantidadServidores, j;
+        SERVIDOR_DELEGACION *s = &r->servidores[i];
+        if (r->usados & (1u << i))
+            continue;
+        r->usados |= 1u << i;
+        if (direccionDesdeTexto(&r->destino,s->ip,puerto) < 0 || !direccionPermitida(r->destino.sa.sa_family))
+            continue;
+        /** los nombres están internados: el mismo NS es el mismo puntero **/
+        for (j = 0; j < r->cantidadServidores; j++)
+            if (!(r->usados & (1u << j)) && s->nombre != NULL && r->servidores[j].nombre == s->nombre
+                    && direccionDesdeTexto(&r->alterna,r->servidores[j].ip,puerto) == 0
+                    && r->alterna.sa.sa_family != r->destino.sa.sa_family && direccionPermitida(r->alterna.sa.sa_family))
+            {
+                r->usados |= 1u << j;
+                break;
+            }
+        if (j == r->cantidadServidores)
+            memset(&r->alterna,0,sizeof(r->alterna));
+        if (r->alterna.sa.sa_family != 0 && r->alterna.sa.sa_family == direccionFamiliaPreferida(s->nombre))
+        {
+            DIRECCION aux = r->destino;
+            r->destino = r->alterna;
+            r->alterna = aux;
+        }
+        r->servidor = s->nombre;
+        direccionATexto(&r->destino,r->ip);
+        encolar(r);
+        return;
+    }
+    if (r->proximoSinGlue < r->cantidadSinGlue && r->profundidad < MAX_PROFUNDIDAD_NS)
+    {
+        char nombre[256];
+        nombreATexto(r->sinGlue[r->proximoSinGlue++],nombre);
+        /** la dirección del NS se busca por A; con -6, por AAAA **/
+        RESOLUCION *hija = nuevaResolucion(r->it,nombre,direccionPermitida(AF_INET) ? T_A : T_AAAA,finNS,r,r->traza);
+        hija->profundidad = r->profundidad + 1;
+        r->estado = ESPERAR_NS;
+        comenzarDesdeDelegacion(hija);
+        return;
+    }
+    terminar(r,r->error);
+}
+
+/** Guarda los registros de answer de un paso, decodificados desde una copia del mensaje a la que apuntan **/
+static void acumular(RESOLUCION *r, const unsigned char *mensaje, int largo, const SECCIONES *s)
+{
+    int i, cantidad = seccionesCantidad(s,SECCION_ANSWER);
+    if (cantidad == 0 || r->cantidadMensajes > MAX_CNAME)
+        return;
+    unsigned char *copia = (unsigned char*)malloc(largo);
+    memcpy(copia,mensaje,largo);
+    r->mensajes[r->cantidadMensajes++] = copia;
+    if (r->cantidadRegistros + cantidad > r->capacidadRegistros)
+    {
+        r->capacidadRegistros = 2 * (r->cantidadRegistros + cantidad);
+        r->registros = (struct RESOURCE_RECORD*)realloc(r->registros,r->capacidadRegistros * sizeof(struct RESOURCE_RECORD));
+    }
+    for (i = s->inicio[SECCION_ANSWER]; i < s->inicio[SECCION_ANSWER+1]; i++)
+    {
+        struct RESOURCE_RECORD *rr = &r->registros[r->cantidadRegistros++];
+        char nombre[MAX_TEXTO_NOMBRE];
+        if (nombreLeerPresentacion(s->mensaje,s->largo,s->nombre[i],nombre) < 0)
+            nombre[0] = '\0';
+        rr->name = (unsigned char*)strdup(nombre);
+        camposRRLeer(copia + s->rdata[i] - TAM_R_DATA,&rr->resource);
+        decodificarRDATA(copia,largo,copia + s->rdata[i],s->largoRdata[i],s->tipo[i],rr);
+    }
+}
+
+/**
+ * Toma los servidores de una referencia: cada NS de authority cuyo dueño es la zona delegada, con
+ * su glue A y AAAA de additional si el NS cae dentro de la zona que respondió (in-bailiwick), o
+ * sin glue. Aprende además la delegación para las próximas resoluciones.
+ **/
+static void seguirReferencia(RESOLUCION *r, const char *zona, const SECCIONES *s)
+{
+    char ns[256], glue[256], dueno[256];
+    NOMBRE_DNS delegada, anterior, nombre;
+    int i, j;
+    delegacionAprender(s,zona,r->zona);
+    nombreDesdeCadena(zona,&delegada);
+    nombreDesdeCadena(r->zona,&anterior);
+    strcpy(r->zona,zona);
+    r->cantidadServidores = 0;
+    r->cantidadSinGlue = 0;
+    for (i = s->inicio[SECCION_AUTHORITY]; i < s->inicio[SECCION_AUTHORITY+1]; i++)
+    {
+        int conGlue = 0;
+        if (s->tipo[i] != T_NS || seccionesNombre(s,i,dueno) < 0 || seccionesNombreRdata(s,i,ns) < 0
+                || nombreDesdeCadena(dueno,&nombre) < 0 || !nombreIgual(&nombre,&delegada))
+            continue;
+        /** del glue de otros nombres el que respondió no tiene autoridad: ese NS se resuelve aparte **/
+        int enZona = nombreDesdeCadena(ns,&nombre) == 0 && nombreEsSubdominio(&nombre,&anterior);
+        for (j = s->inicio[SECCION_ADDITIONAL]; enZona && j < s->inicio[SECCION_ADDITIONAL+1]
+                && r->cantidadServidores < MAX_SERVIDORES_DELEGACION; j++)
+        {
+            int familia = s->tipo[j] == T_A && s->largoRdata[j] == 4 ? AF_INET
+                          : s->tipo[j] == T_AAAA && s->largoRdata[j] == 16 ? AF_INET6 : AF_UNSPEC;
+            if (familia == AF_UNSPEC || seccionesNombre(s,j,glue) < 0 || strcasecmp(glue,ns) != 0)
+                continue;
+            SERVIDOR_DELEGACION *servidor = &r->servidores[r->cantidadServidores++];
+            servidor->nombre = nombreInternarCadena(ns);
+            inet_ntop(familia,s->mensaje + s->rdata[j],servidor->ip,sizeof(servidor->ip));
+            conGlue = 1;
+        }
+        if (!conGlue && r->cantidadSinGlue < MAX_SERVIDORES_DELEGACION)
+        {
+            const NOMBRE_DNS *nombreNS = nombreInternarCadena(ns);
+            if (nombreNS != NULL)
+                r->sinGlue[r->cantidadSinGlue++] = nombreNS;
+        }
+    }
+    r->inicioServidores = r->cantidadServidores > 0 ? aleatorioMenor(r->cantidadServidores) : 0;
+    r->proximoServidor = 0;
+    r->usados = 0;
+    r->proximoSinGlue = 0;
+}
+
+/** Una referencia sólo sirve si acerca al nombre: una zona más larga, debajo de la actual, que contiene al nombre **/
+static int referenciaAvanza(const char *zonaActual, const char *zonaNueva, const char *nombre)
+{
+    NOMBRE_DNS actual, nueva, buscado;
+    if (nombreDesdeCadena(zonaActual,&actual) < 0 || nombreDesdeCadena(zonaNueva,&nueva) < 0
+            || nombreDesdeCadena(nombre,&buscado) < 0)
+        return 0;
+    return nueva.cantidadEtiquetas > actual.cantidadEtiquetas && nombreEsSubdominio(&nueva,&actual)
+           && nombreEsSubdominio(&buscado,&nueva);
+}
+
+/** Avanza la resolución con la respuesta de un salto **/
+static void procesarRespuesta(RESOLUCION *r, unsigned char *mensaje, int largo, int inicio, long long rtt)
+{
+    char textoTipo[LARGO_TEXTO_TIPO];
+    ITERATIVO *it = r->it;
+    SECCIONES *s = &it->secciones;
+    int resuelto = 0, anteriores = r->cantidadRegistros;
+    char *zona = NULL, *canonico = NULL, nombreZona[256], siguiente[256];
+    const char *clasificacion;
+    CABECERA_DNS cabecera;
+
+    /** el contenedor es del motor: se usa sólo hasta que esta respuesta queda procesada **/
+    seccionesLeer(s,mensaje,largo,inicio);
+    cabeceraLeer(mensaje,&cabecera);
+    /** las negativas no se aprenden de servidores con autoridad: no hay AD validado (negativas.h) **/
+    if (mensaje != respuestaLocal)
+        cacheGuardar(s);
+    int rcode = cabecera.rcode;
+    int ns = seccionesBuscar(s,SECCION_AUTHORITY,T_NS);
+    /** los registros de answer pasan a la resolución (también los CNAME de un NXDOMAIN) **/
+    if (rcode == 0 || rcode == 3)
+        acumular(r,mensaje,largo,s);
+
+    if (rcode == 3)
+        clasificacion = "nxdomain";
+    else if (rcode != 0)
+        clasificacion = "error";
+    else if (seccionesCantidad(s,SECCION_ANSWER) > 0)
+    {
+        clasificacion = "answer";
+        canonico = destinoCNAME(r->actual,r->tipo,r->registros + anteriores,r->cantidadRegistros - anteriores,&resuelto);
+        if (resuelto)
+            canonico = NULL;
+    }
+    else if (ns >= 0 && !cabecera.aa)
+    {
+        /** con AA el servidor tiene autoridad sobre el nombre: sin answer es NODATA, aunque mande sus NS **/
+        clasificacion = "referral";
+        seccionesNombre(s,ns,nombreZona);
+        zona = nombreZona;
+    }
+    else
+        clasificacion = "nodata";
+    /** una respuesta local (zona, negativa o cache) no es un paso por la red: r->ip dice de dónde salió **/
+    if (mensaje == respuestaLocal)
+        trazaCache(r->traza,r->actual,mapearTipo(r->tipo,textoTipo),r->zona,r->ip);
+    else
+        trazaPaso(r->traza,r->ip,it->puerto,r->actual,mapearTipo(r->tipo,textoTipo),rtt,largo,rcode,clasificacion,zona);
+    if (it->observador != NULL)
+    {
+        PASO_ITERATIVO paso = {r->ip, r->actual, r->tipo, rcode, rtt, largo, clasificacion, zona, canonico, r->profundidad,
+                               seccionesRegistros(s,SECCION_ANSWER), seccionesRegistros(s,SECCION_AUTHORITY),
+                               seccionesRegistros(s,SECCION_ADDITIONAL), seccionesCantidad(s,SECCION_ANSWER),
+                               seccionesCantidad(s,SECCION_AUTHORITY), seccionesCantidad(s,SECCION_ADDITIONAL)
+                              };
+        it->observador(it->contextoObservador,&paso);
+    }
+
+    if (rcode != 0 && rcode != 3)
+    {
+        /** SERVFAIL, REFUSED...: otro servidor de la misma delegación **/
+        r->error = RCODE_SERVFAIL;
+        siguienteServidor(r);
+        return;
+    }
+    if (zona != NULL && !referenciaAvanza(r->zona,zona,r->actual))
+    {
+        /** servidor cojo: delega hacia arriba, hacia un costado o a la misma zona **/
+        r->error = RCODE_SERVFAIL;
+        siguienteServidor(r);
+        return;
+    }
+    if (zona != NULL)
+        seguirReferencia(r,zona,s);
+    if (canonico != NULL)
+        snprintf(siguiente,sizeof(siguiente),"%s",canonico);
+
+    if (zona != NULL)
+        siguienteServidor(r);
+    else if (canonico != NULL && rcode == 0 && r->alias++ < MAX_CNAME)
+    {
+        strcpy(r->actual,siguiente);
+        comenzarDesdeDelegacion(r);
+    }
+    else
+        terminar(r,rcode);
+}
+
+static void respuestaSalto(void *contexto, unsigned char *respuesta, int largo, int inicioRespuestas,
+                           long long rtt, int estado)
+{
+    char textoTipo[LARGO_TEXTO_TIPO];
+    RESOLUCION *r = (RESOLUCION*)contexto;
+    if (estado == MOTOR_TIMEOUT)
+    {
+        trazaPaso(r->traza,r->ip,r->it->puerto,r->actual,mapearTipo(r->tipo,textoTipo),rtt,0,0,"timeout",NULL);
+        siguienteServidor(r);
+    }
+    else
+    {
+        /** con alterna, la que respondió primero queda como preferida para ese NS **/
+        const DIRECCION *origen = motorOrigen(r->it->m);
+        if (r->alterna.sa.sa_family != 0)
+        {
+            direccionRegistrarFamilia(r->servidor,origen->sa.sa_family);
+            direccionATexto(origen,r->ip);
+        }
+        procesarRespuesta(r,respuesta,largo,inicioRespuestas,rtt);
+    }
+}
+
+/** Envía el salto de una resolución de la cola; 0, o -1 si el motor no tenía lugar **/
+static int enviarSalto(RESOLUCION *r)
+{
+    unsigned char consulta[MAX_CONSULTA_MOTOR];
+    ITERATIVO *it = r->it;
+
+    if (r->saltos >= MAX_SALTOS_ITERATIVO)
+    {
+        terminar(r,RCODE_SERVFAIL);
+        return 0;
+    }
+    int largo = armarConsulta(consulta,r->actual,r->tipo,0,0);
+    /** las zonas cargadas con -zona= se contestan acá mismo, como en resolverConsulta **/
+    int recibidos = zonaResponder(consulta,largo,respuestaLocal,sizeof(respuestaLocal));
+    r->estado = ESPERAR_RESPUESTA;
+    r->saltos++;
+    if (recibidos > 0)
+    {
+        strcpy(r->ip,"zona local");
+        procesarRespuesta(r,respuestaLocal,recibidos,largo,0);
+        return 0;
+    }
+    if ((recibidos = negativasResponder(consulta,largo,respuestaLocal,sizeof(respuestaLocal))) > 0)
+    {
+        strcpy(r->ip,"negativa (RFC 8198)");
+        procesarRespuesta(r,respuestaLocal,recibidos,largo,0);
+        return 0;
+    }
+    /** los NS y MX que se vuelven a visitar salen de la cache de respuestas (-cache) **/
+    if ((recibidos = cacheResponder(consulta,largo,respuestaLocal,sizeof(respuestaLocal))) > 0)
+    {
+        strcpy(r->ip,"cache");
+        procesarRespuesta(r,respuestaLocal,recibidos,largo,0);
+        return 0;
+    }
+    if (motorEnviarEscalonado(it->m,&r->destino,r->alterna.sa.sa_family != 0 ? &r->alterna : NULL,consulta,largo,
+                              respuestaSalto,r) < 0)
+    {
+        r->saltos--;
+        return -1;
+    }
+    it->saltos++;
+    return 0;
+}
+
+/**
+ * Envía todo lo que la cola tenga listo. Las resoluciones cuyo destino todavía no admite envíos
+ * quedan en la cola, adelante, sin frenar a las demás. Lo que se encola mientras tanto (pasos
+ * que se contestaron localmente, resoluciones nuevas) sale en la próxima vuelta.
+ **/
+static void enviarListas(ITERATIVO *it)
+{
+    RESOLUCION *r = it->listas, *retenidas = NULL, *ultimaRetenida = NULL;
+    it->listas = it->ultimaLista = NULL;
+    while (r != NULL)
+    {
+        RESOLUCION *siguiente = r->siguiente;
+        if (!motorPuedeEnviarA(it->m,&r->destino) || enviarSalto(r) < 0)
+        {
+            r->siguiente = NULL;
+            if (ultimaRetenida != NULL)
+                ultimaRetenida->siguiente = r;
+            else
+                retenidas = r;
+            ultimaRetenida = r;
+        }
+        r = siguiente;
+    }
+    if (retenidas != NULL)
+    {
+        ultimaRetenida->siguiente = it->listas;
+        if (it->listas == NULL)
+            it->ultimaLista = ultimaRetenida;
+        it->listas = retenidas;
+    }
+}
+
+int iterativoResolver(ITERATIVO *it, const char *nombre, int tipo, FIN_ITERATIVO fin, void *contexto)
+{
+    NOMBRE_DNS validado;
+    if (strlen(nombre) > 255 || nombreDesdeCadena(nombre,&validado) < 0)
+        return -1;
+    comenzarDesdeDelegacion(nuevaResolucion(it,nombre,tipo,fin,contexto,NULL));
+    return 0;
+}
+
+void iterativoProcesar(ITERATIVO *it, int esperaMs)
+{
+    enviarListas(it);
+    motorProcesar(it->m,esperaMs);
+    enviarListas(it);
+}
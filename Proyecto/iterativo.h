@@ -0,0 +1,85 @@
+#ifndef ITERATIVO_H_INCLUDED
+#define ITERATIVO_H_INCLUDED
+
+#include "dns.h"
+#include "escritor.h"
+
+/**
+ * Resolución iterativa como máquina de estados sobre el motor no bloqueante.
+ * Cada resolución guarda en su propia estructura todo lo que antes vivía en variables globales
+ * (servidorDNS, maneraConsulta, los indicadores de fin): el nombre que se está buscando, la zona
+ * y los servidores de la delegación actual, el servidor que se está probando y los registros
+ * acumulados de la cadena de alias. Cada respuesta (o timeout) del motor la hace avanzar un paso:
+ *
+ *      ENVIAR ──> ESPERAR_RESPUESTA ──> respuesta con el tipo pedido ──> terminada (NOERROR)
+ *                      │                 alias (CNAME) ──> ENVIAR, desde la delegación del canónico
+ *                      │                 referencia con glue ──> ENVIAR al nuevo servidor
+ *                      │                 referencia sin glue ──> ESPERAR_NS (resolución hija del NS)
+ *                      │                 NXDOMAIN / NODATA ──> terminada
+ *                      └──> timeout, SERVFAIL, REFUSED o servidor cojo ──> ENVIAR al siguiente servidor
+ *
+ * Así miles de resoluciones avanzan a la vez en un solo hilo, cada una esperando sólo su propio
+ * paquete. Las consultas que el ritmo compartido (ritmo.h) todavía no deja salir esperan en una
+ * cola sin bloquear a las demás. Las consultas por nombres de las zonas cargadas con -zona= se
+ * contestan localmente, como en resolverConsulta.
+ **/
+
+/** Espera por intento y reenvíos de cada salto **/
+#define TIMEOUT_ITERATIVO_MS 1500
+#define REINTENTOS_ITERATIVO 1
+
+/** Saltos como máximo por resolución (contando alias y reintentos con otros servidores) **/
+#define MAX_SALTOS_ITERATIVO 40
+
+/** Anidamiento máximo de resoluciones hijas para obtener la dirección de un NS sin glue **/
+#define MAX_PROFUNDIDAD_NS 4
+
+/** Un salto ya respondido, para quien quiera mostrarlo (el modo -t lo imprime) **/
+typedef struct
+{
+    const char *servidor;           // dirección consultada, o "zona local"
+    const char *nombre;             // nombre consultado en este salto
+    int tipo;
+    int rcode;
+    long long rtt;
+    int bytes;
+    const char *clasificacion;      // answer, referral, nxdomain, nodata, error (como en la traza)
+    const char *zona;               // zona de la referencia, o NULL
+    const char *canonico;           // si la respuesta es un alias que hay que seguir, el nombre canónico
+    int profundidad;                // 0 para la resolución pedida, 1 o más para las de los NS sin glue
+    struct RESOURCE_RECORD *answer, *authority, *additional;
+    int respuestasA, respuestasAU, respuestasADD;
+} PASO_ITERATIVO;
+
+typedef void (*OBSERVADOR_ITERATIVO)(void *contexto, const PASO_ITERATIVO *paso);
+
+/**
+ * Fin de una resolución: consulta y tipo pedidos, estado (rcode final, ESTADO_TIMEOUT si ningún
+ * servidor contestó, SERVFAIL si la delegación no llevó a ningún lado), rtt = duración total,
+ * y los registros de answer de todos los pasos de la cadena de alias. Válido sólo durante la llamada.
+ **/
+typedef void (*FIN_ITERATIVO)(void *contexto, const RESULTADO *resultado);
+
+typedef struct ITERATIVO ITERATIVO;
+
+/** maxEnVuelo: paquetes simultáneos; puerto: puerto de los servidores (53 salvo pruebas) **/
+ITERATIVO *iterativoCrear(int maxEnVuelo, const char *puerto);
+void iterativoDestruir(ITERATIVO *it);
+
+/** Observador de cada salto (NULL = ninguno) **/
+void iterativoObservar(ITERATIVO *it, OBSERVADOR_ITERATIVO observador, void *contexto);
+
+/** Comienza una resolución; fin se llama una sola vez al terminar. 0, o -1 si el nombre no es válido **/
+int iterativoResolver(ITERATIVO *it, const char *nombre, int tipo, FIN_ITERATIVO fin, void *contexto);
+
+/** Una vuelta del lazo: envía lo que el ritmo permita y procesa respuestas y timeouts **/
+void iterativoProcesar(ITERATIVO *it, int esperaMs);
+
+/** Resoluciones sin terminar (incluidas las hijas) **/
+int iterativoPendientes(ITERATIVO *it);
+
+/** Paquetes enviados y resoluciones terminadas desde que se creó **/
+long iterativoSaltos(ITERATIVO *it);
+long iterativoResueltas(ITERATIVO *it);
+
+#endif // ITERATIVO_H_INCLUDED
@@ -0,0 +1,218 @@
+#include<stdio.h>
+#include<string.h>
+#include<stdlib.h>
+#include<ctype.h>
+#include<math.h>
+
+#include "loc.h"
+
+#define REFERENCIA_COORDENADA ((uint32_t)1 << 31)
+#define REFERENCIA_ALTITUD 10000000         // 100.000 m en centímetros
+#define MILESIMAS_POR_GRADO 3600000.0
+/** Lo que entra en los 32 bits de la altitud, en metros **/
+#define ALTITUD_MINIMA -100000.0
+#define ALTITUD_MAXIMA 42849672.95
+
+/**
+ * Tablas del byte mantisa/exponente. RFC 1876 sólo define dígitos de 0 a 9; como precsize_ntoa,
+ * los valores 10 a 15 se toman módulo 10, así que ninguna combinación necesita una rama.
+ **/
+static const unsigned long mantisas[16] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5};
+static const unsigned long potencias[16] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000,
+                                            1, 10, 100, 1000, 10000, 100000
+                                           };
+
+void leerLOC(const unsigned char *rdata, struct R_DATA_LOC *loc)
+{
+    loc->version = rdata[0];
+    loc->size = rdata[1];
+    loc->horiz_pre = rdata[2];
+    loc->vert_pre = rdata[3];
+    loc->latitude = leer32(rdata + 4);
+    loc->longitude = leer32(rdata + 8);
+    loc->altitude = leer32(rdata + 12);
+}
+
+void escribirLOC(const struct R_DATA_LOC *loc, unsigned char *rdata)
+{
+    rdata[0] = loc->version;
+    rdata[1] = loc->size;
+    rdata[2] = loc->horiz_pre;
+    rdata[3] = loc->vert_pre;
+    escribir32(rdata + 4,loc->latitude);
+    escribir32(rdata + 8,loc->longitude);
+    escribir32(rdata + 12,loc->altitude);
+}
+
+unsigned long locCentimetros(uint8_t precision)
+{
+    return mantisas[precision >> 4] * potencias[precision & 0x0f];
+}
+
+uint8_t locPrecision(double metros)
+{
+    unsigned long centimetros, potencia = 1;
+    int exponente = 0, mantisa;
+    if (!(metros > 0))
+        return 0;
+    centimetros = (metros < 9e7) ? (unsigned long)(metros * 100 + 0.5) : 9000000000ul;
+    while (exponente < 9 && centimetros >= potencia * 10)
+    {
+        potencia *= 10;
+        exponente++;
+    }
+    mantisa = centimetros / potencia;
+    if (mantisa > 9)
+        mantisa = 9;
+    return (mantisa << 4) | exponente;
+}
+
+/** Escribe una coordenada como "grados minutos segundos.milésimas hemisferio" **/
+static int coordenadaATexto(char *destino, int max, uint32_t valor, char positivo, char negativo)
+{
+    int64_t milesimas = (int64_t)valor - REFERENCIA_COORDENADA;
+    char hemisferio = milesimas < 0 ? negativo : positivo;
+    uint32_t absoluto = (uint32_t)(milesimas < 0 ? -milesimas : milesimas);
+    return snprintf(destino,max,"%u %.2u %.2u.%.3u %c",absoluto / 3600000,absoluto / 60000 % 60,absoluto / 1000 % 60,
+                    absoluto % 1000,hemisferio);
+}
+
+/** Metros con centímetros sólo si hacen falta ("30m", "0.50m") **/
+static int metrosATexto(char *destino, int max, unsigned long centimetros)
+{
+    if (centimetros % 100 == 0)
+        return snprintf(destino,max," %lum",centimetros / 100);
+    return snprintf(destino,max," %lu.%.2lum",centimetros / 100,centimetros % 100);
+}
+
+int locATexto(const unsigned char *rdata, char *destino)
+{
+    int n;
+    if (rdata[0] != 0)
+        return -1;
+    int64_t altitud = (int64_t)leer32(rdata + 12) - REFERENCIA_ALTITUD;
+    uint32_t absoluta = (uint32_t)(altitud < 0 ? -altitud : altitud);
+
+    n = coordenadaATexto(destino,MAX_TEXTO_LOC,leer32(rdata + 4),'N','S');
+    destino[n++] = ' ';
+    n += coordenadaATexto(destino + n,MAX_TEXTO_LOC - n,leer32(rdata + 8),'E','W');
+    n += snprintf(destino + n,MAX_TEXTO_LOC - n," %s%u.%.2um",altitud < 0 ? "-" : "",absoluta / 100,absoluta % 100);
+    n += metrosATexto(destino + n,MAX_TEXTO_LOC - n,locCentimetros(rdata[1]));
+    n += metrosATexto(destino + n,MAX_TEXTO_LOC - n,locCentimetros(rdata[2]));
+    n += metrosATexto(destino + n,MAX_TEXTO_LOC - n,locCentimetros(rdata[3]));
+    return n;
+}
+
+/** "grados [minutos [segundos]] hemisferio" a milésimas de segundo de arco desde 2^31 **/
+static int leerCoordenada(char *campos[], int cantidad, int *i, char positivo, char negativo, int maximo, uint32_t *valor)
+{
+    double partes[3] = {0, 0, 0}, milesimas;
+    int n = 0;
+    while (*i < cantidad && n < 3 && (isdigit((unsigned char)campos[*i][0]) || campos[*i][0] == '.'))
+        partes[n++] = atof(campos[(*i)++]);
+    if (n == 0 || *i >= cantidad || campos[*i][1] != '\0')
+        return -1;
+    /** grados hasta 90 (latitud) o 180 (longitud), minutos y segundos menores que 60 (RFC 1876 3) **/
+    if (partes[1] >= 60 || partes[2] >= 60)
+        return -1;
+    milesimas = partes[0] * 3600000 + partes[1] * 60000 + partes[2] * 1000 + 0.5;
+    if (milesimas >= (double)maximo * 3600000 + 1)
+        return -1;
+    if (toupper((unsigned char)campos[*i][0]) == positivo)
+        *valor = REFERENCIA_COORDENADA + (uint32_t)milesimas;
+    else if (toupper((unsigned char)campos[*i][0]) == negativo)
+        *valor = REFERENCIA_COORDENADA - (uint32_t)milesimas;
+    else
+        return -1;
+    (*i)++;
+    return 0;
+}
+
+/** "d [m [s]] N|S d [m [s]] E|W alt[m] [tamaño[m] [precH[m] [precV[m]]]]" (RFC 1876 3) **/
+int locDesdeTexto(char *campos[], int cantidad, unsigned char *rdata)
+{
+    struct R_DATA_LOC loc;
+    double metros[3] = {1, 10000, 10};      /** valores por omisión de tamaño y precisiones **/
+    int i = 0, n;
+    if (leerCoordenada(campos,cantidad,&i,'N','S',90,&loc.latitude) < 0
+            || leerCoordenada(campos,cantidad,&i,'E','W',180,&loc.longitude) < 0 || i >= cantidad)
+        return -1;
+    double altura = atof(campos[i++]);      /** metros sobre el esferoide WGS 84 **/
+    /** fuera del rango la conversión a uint32_t no está definida; la comparación descarta también los NAN **/
+    if (!(altura >= ALTITUD_MINIMA && altura <= ALTITUD_MAXIMA))
+        return -1;
+    loc.altitude = (uint32_t)(REFERENCIA_ALTITUD + altura * 100 + 0.5);     /** siempre positivo: redondeo simple **/
+    for (n = 0; n < 3 && i < cantidad; n++)
+        metros[n] = atof(campos[i++]);
+    if (i != cantidad)
+        return -1;
+
+    loc.version = 0;
+    loc.size = locPrecision(metros[0]);
+    loc.horiz_pre = locPrecision(metros[1]);
+    loc.vert_pre = locPrecision(metros[2]);
+    escribirLOC(&loc,rdata);
+    return LARGO_LOC;
+}
+
+int locAUbicacion(const unsigned char *rdata, UBICACION *ubicacion)
+{
+    return locLoteAUbicaciones(rdata,1,ubicacion) == 1 ? 0 : -1;
+}
+
+int locDesdeUbicacion(const UBICACION *ubicacion, unsigned char *rdata)
+{
+    return locLoteDesdeUbicaciones(ubicacion,1,rdata) == 1 ? 0 : -1;
+}
+
+/**
+ * El cuerpo del lote es aritmética sin ramas: la versión inválida se resuelve al final, con un
+ * NAN que absorbe el resultado. Así el compilador puede vectorizar el recorrido.
+ **/
+int locLoteAUbicaciones(const unsigned char *rdatas, int cantidad, UBICACION *salida)
+{
+    int i, convertidos = 0;
+    for (i = 0; i < cantidad; i++)
+    {
+        const unsigned char *r = rdatas + i * LARGO_LOC;
+        double invalido = (r[0] == 0) ? 0.0 : NAN;
+        salida[i].latitud = ((double)leer32(r + 4) - REFERENCIA_COORDENADA) / MILESIMAS_POR_GRADO + invalido;
+        salida[i].longitud = ((double)leer32(r + 8) - REFERENCIA_COORDENADA) / MILESIMAS_POR_GRADO + invalido;
+        salida[i].altitud = ((double)leer32(r + 12) - REFERENCIA_ALTITUD) / 100.0 + invalido;
+        salida[i].tamano = locCentimetros(r[1]) / 100.0 + invalido;
+        salida[i].precisionHorizontal = locCentimetros(r[2]) / 100.0 + invalido;
+        salida[i].precisionVertical = locCentimetros(r[3]) / 100.0 + invalido;
+        convertidos += (r[0] == 0);
+    }
+    return convertidos;
+}
+
+int locLoteDesdeUbicaciones(const UBICACION *ubicaciones, int cantidad, unsigned char *rdatas)
+{
+    int i, convertidos = 0;
+    for (i = 0; i < cantidad; i++)
+    {
+        const UBICACION *u = &ubicaciones[i];
+        unsigned char *r = rdatas + i * LARGO_LOC;
+        /** la comparación descarta también los NAN **/
+        if (!(u->latitud >= -90 && u->latitud <= 90 && u->longitud >= -180 && u->longitud <= 180
+                && u->altitud >= ALTITUD_MINIMA && u->altitud <= ALTITUD_MAXIMA))
+        {
+            memset(r,0,LARGO_LOC);
+            r[0] = VERSION_LOC_INVALIDA;
+            continue;
+        }
+        double latitud = u->latitud * MILESIMAS_POR_GRADO + REFERENCIA_COORDENADA + 0.5;
+        double longitud = u->longitud * MILESIMAS_POR_GRADO + REFERENCIA_COORDENADA + 0.5;
+        double altitud = u->altitud * 100 + REFERENCIA_ALTITUD + 0.5;
+        r[0] = 0;
+        r[1] = locPrecision(u->tamano);
+        r[2] = locPrecision(u->precisionHorizontal);
+        r[3] = locPrecision(u->precisionVertical);
+        escribir32(r + 4,(uint32_t)latitud);
+        escribir32(r + 8,(uint32_t)longitud);
+        escribir32(r + 12,(uint32_t)altitud);
+        convertidos++;
+    }
+    return convertidos;
+}
@@ -0,0 +1,68 @@
+#ifndef LOC_H_INCLUDED
+#define LOC_H_INCLUDED
+
+#include <stdint.h>
+
+#include "dns.h"
+
+/**
+ * Codec del registro LOC (RFC 1876), directo desde y hacia los 16 bytes del RDATA:
+ *  - latitud y longitud: milésimas de segundo de arco desplazadas en 2^31 (2^31 = ecuador / Greenwich)
+ *  - altitud: centímetros desde 100.000 m por debajo del esferoide WGS 84
+ *  - tamaño y precisiones: un byte mantisa/exponente en centímetros (0x13 = 1 * 10^3 cm = 10 m)
+ * Las conversiones son aritmética entera y tablas, sin pasar por texto. Para inventarios grandes
+ * están las versiones por lote, que recorren arreglos contiguos de RDATA.
+ **/
+
+#define LARGO_LOC 16
+#define MAX_TEXTO_LOC 96    // largo máximo de la forma presentación, con el '\0'
+#define VERSION_LOC_INVALIDA 0xFF   // marca de los RDATA que no se pudieron codificar en un lote
+
+/** Un LOC en grados decimales (positivos al norte y al este) y metros **/
+typedef struct
+{
+    double latitud;
+    double longitud;
+    double altitud;                 // sobre el esferoide WGS 84
+    double tamano;                  // diámetro de la esfera que contiene al objeto
+    double precisionHorizontal;
+    double precisionVertical;
+} UBICACION;
+
+/** Carga los campos del RDATA de un LOC (16 bytes) en la estructura, en el orden del host **/
+void leerLOC(const unsigned char *rdata, struct R_DATA_LOC *loc);
+
+/** Escribe la estructura como RDATA de 16 bytes **/
+void escribirLOC(const struct R_DATA_LOC *loc, unsigned char *rdata);
+
+/** Byte mantisa/exponente a centímetros (como precsize_ntoa de RFC 1876) **/
+unsigned long locCentimetros(uint8_t precision);
+
+/** Metros a byte mantisa/exponente, redondeando al valor representable más cercano por debajo (precsize_aton) **/
+uint8_t locPrecision(double metros);
+
+/** Forma presentación "41 24 00.499 N 2 10 52.530 E 47.00m 30m 10m 10m"; devuelve el largo o -1 si no es versión 0 **/
+int locATexto(const unsigned char *rdata, char *destino);
+
+/** Forma presentación (en campos separados) a RDATA; devuelve LARGO_LOC o -1 **/
+int locDesdeTexto(char *campos[], int cantidad, unsigned char *rdata);
+
+/** RDATA a grados y metros; 0, o -1 si no es versión 0 **/
+int locAUbicacion(const unsigned char *rdata, UBICACION *ubicacion);
+
+/** Grados y metros a RDATA (versión 0); -1 si las coordenadas están fuera de rango **/
+int locDesdeUbicacion(const UBICACION *ubicacion, unsigned char *rdata);
+
+/**
+ * Convierte cantidad RDATA consecutivos (cantidad * LARGO_LOC bytes) a grados y metros. Los que
+ * no son versión 0 quedan con todos sus campos en NAN. Devuelve cuántos se convirtieron.
+ **/
+int locLoteAUbicaciones(const unsigned char *rdatas, int cantidad, UBICACION *salida);
+
+/**
+ * Lo inverso: cantidad ubicaciones a RDATA consecutivos. Las que están fuera de rango quedan con
+ * versión VERSION_LOC_INVALIDA, así que al volver a convertirlas dan NAN. Devuelve cuántas se codificaron.
+ **/
+int locLoteDesdeUbicaciones(const UBICACION *ubicaciones, int cantidad, unsigned char *rdatas);
+
+#endif // LOC_H_INCLUDED
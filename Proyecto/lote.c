@@ -0,0 +1,365 @@
+#include<stdio.h>
+#include<string.h>
+#include<stdlib.h>
+#include<sys/socket.h>
+#include<arpa/inet.h>
+#include<netinet/in.h>
+
+#include "dns.h"
+#include "tipos_rr.h"
+#include "traza.h"
+#include "motor.h"
+#include "nombres.h"
+#include "escritor.h"
+#include "secciones.h"
+#include "iterativo.h"
+#include "inexistentes.h"
+#include "negativas.h"
+#include "cache.h"
+#include "paquetes.h"
+#include "configuracion.h"
+#include "lote.h"
+
+typedef struct
+{
+    ESCRITOR *salida;
+    long respuestas, timeouts, errores;
+    SECCIONES secciones;            // la respuesta en proceso; la reserva sirve para todas
+    DIRECCION destinos[MAX_SERVIDORES_CONFIGURACION];
+    int cantidadDestinos, rotar;
+    int confiable;                  // trust-ad de resolv.conf: se aprenden las negativas validadas (negativas.h)
+    unsigned int version;           // de la configuración con la que se cargaron los destinos
+    unsigned long turno;
+} LOTE;
+
+/** Los destinos del lote: el servidor indicado, o los nameserver de resolv.conf; 0, o -1 si el servidor no es una dirección **/
+static int cargarDestinos(LOTE *l, const char *servidor, const char *puerto)
+{
+    CONFIGURACION c;
+    int i;
+    l->version = configuracionVersion();
+    configuracionObtener(&c);
+    l->confiable = c.confiarAD;
+    if (servidor != NULL)
+    {
+        l->cantidadDestinos = 1;
+        l->rotar = 0;
+        return direccionDesdeTexto(&l->destinos[0],servidor,atoi(puerto));
+    }
+    for (i = 0; i < c.cantidadServidores; i++)
+        direccionDesdeTexto(&l->destinos[i],c.servidores[i],atoi(puerto));
+    l->cantidadDestinos = c.cantidadServidores;
+    l->rotar = c.rotar;
+    return 0;
+}
+
+/** Lo que el callback necesita de cada consulta **/
+typedef struct
+{
+    LOTE *lote;
+    int tipo;
+    char nombre[];
+} CONSULTA_LOTE;
+
+int loteLeerConsulta(FILE *archivo, char *nombre, int *tipo)
+{
+    char linea[1024];
+    while (fgets(linea,sizeof(linea),archivo) != NULL)
+    {
+        char *resto, *campo = strtok_r(linea," \t\r\n",&resto), *textoTipo;
+        NOMBRE_DNS validado;
+        if (campo == NULL || campo[0] == '#' || campo[0] == ';')
+            continue;
+        if (strlen(campo) > 255 || nombreDesdeCadena(campo,&validado) < 0)
+        {
+            fprintf(stderr,";; nombre no válido en el archivo de consultas: %.64s\n",campo);
+            continue;
+        }
+        strcpy(nombre,campo);
+        textoTipo = strtok_r(NULL," \t\r\n",&resto);
+        if (textoTipo == NULL)
+            *tipo = T_A;
+        else if ((*tipo = tipoDesdeNombre(textoTipo)) == 0)
+        {
+            fprintf(stderr,";; tipo desconocido en el archivo de consultas: %s\n",textoTipo);
+            continue;
+        }
+        return 1;
+    }
+    return 0;
+}
+
+/** TTL negativo de un NXDOMAIN (RFC 2308 5): el menor entre el TTL del SOA de authority y su MINIMUM **/
+static uint32_t ttlNegativo(const SECCIONES *s)
+{
+    int i = seccionesBuscar(s,SECCION_AUTHORITY,T_SOA);
+    if (i < 0 || s->largoRdata[i] < 22)
+        return TTL_NEGATIVO_POR_OMISION;
+    const unsigned char *minimo = s->mensaje + s->rdata[i] + s->largoRdata[i] - 4;
+    uint32_t ttl = leer32(minimo);
+    return ttl < s->ttl[i] ? ttl : s->ttl[i];
+}
+
+/** Un nombre del filtro de inexistentes (-nxfiltro=) no se consulta: sale como NXDOMAIN, sin rtt **/
+static int saltearInexistente(LOTE *l, const char *nombre, int tipo)
+{
+    if (!inexistentesActivo() || inexistentesDecidir(nombre) != INEXISTENTE_SALTEAR)
+        return 0;
+    RESULTADO r = {nombre, tipo, 3, -1, NULL, 0};
+    escritorResultado(l->salida,&r);
+    return 1;
+}
+
+/** Con -nsec, un nombre que los NSEC/NSEC3 ya guardados prueban inexistente sale sin consultar **/
+static int sintetizarNegativa(LOTE *l, const char *nombre, int tipo)
+{
+    uint32_t ttl;
+    int negativa = negativasConsultar(nombre,tipo,&ttl);
+    if (negativa == NEGATIVA_DESCONOCIDA)
+        return 0;
+    RESULTADO r = {nombre, tipo, negativa == NEGATIVA_NXDOMAIN ? 3 : 0, -1, NULL, 0};
+    if (negativa == NEGATIVA_NXDOMAIN)
+    {
+        inexistentesResultado(nombre,3,ttl);
+        l->errores++;
+    }
+    else
+        l->respuestas++;
+    escritorResultado(l->salida,&r);
+    return 1;
+}
+
+/** Con -cache, una consulta ya respondida (y vigente) sale de la cache, sin rtt **/
+static int responderDeCache(LOTE *l, const char *nombre, int tipo, const unsigned char *consulta, int largo)
+{
+    static unsigned char respuesta[65536];
+    int recibidos;
+    if (!cacheActiva() || (recibidos = cacheResponder(consulta,largo,respuesta,sizeof(respuesta))) <= 0)
+        return 0;
+    RESULTADO r = {nombre, tipo, cabeceraRcode(respuesta), -1, NULL, 0};
+    /** la sección Answer empieza después de la pregunta (el nombre de la consulta no está comprimido) **/
+    seccionesLeer(&l->secciones,respuesta,recibidos,12 + strlen((const char*)consulta + 12) + 1 + TAM_PREGUNTA);
+    r.registros = seccionesRegistros(&l->secciones,SECCION_ANSWER);
+    r.cantidad = seccionesCantidad(&l->secciones,SECCION_ANSWER);
+    if (r.estado == 0)
+        l->respuestas++;
+    else
+        l->errores++;
+    escritorResultado(l->salida,&r);
+    return 1;
+}
+
+/** Una consulta que no se pudo enviar (o un nombre que la resolución iterativa no aceptó) sale como ERROR **/
+static void resultadoError(LOTE *l, const char *nombre, int tipo)
+{
+    RESULTADO r = {nombre, tipo, ESTADO_ERROR, -1, NULL, 0};
+    l->errores++;
+    escritorResultado(l->salida,&r);
+}
+
+/** Resumen del filtro de inexistentes, si se usó **/
+static void resumenInexistentes(FILE *resumen)
+{
+    long salteados, agregados, quitados, total;
+    if (!inexistentesActivo())
+        return;
+    inexistentesEstadisticas(&salteados,&agregados,&quitados,&total);
+    fprintf(resumen,";; filtro de inexistentes: %ld salteadas, %ld agregadas, %ld quitadas, %ld nombres en el filtro\n",
+            salteados,agregados,quitados,total);
+}
+
+/** Resumen de las negativas sintetizadas (-nsec), si se usaron **/
+static void resumenNegativas(FILE *resumen)
+{
+    long sintetizadas, registros;
+    if (!negativasActivas())
+        return;
+    negativasEstadisticas(&sintetizadas,&registros);
+    fprintf(resumen,";; negativas sintetizadas (RFC 8198): %ld, NSEC/NSEC3 guardados: %ld\n",sintetizadas,registros);
+}
+
+static void respuestaLote(void *contexto, unsigned char *respuesta, int largo, int inicioRespuestas,
+                          long long rtt, int estado)
+{
+    CONSULTA_LOTE *c = (CONSULTA_LOTE*)contexto;
+    LOTE *l = c->lote;
+    RESULTADO r = {c->nombre, c->tipo, ESTADO_TIMEOUT, -1, NULL, 0};
+
+    if (estado == MOTOR_TIMEOUT)
+        l->timeouts++;
+    else
+    {
+        r.estado = cabeceraRcode(respuesta);
+        r.rtt = rtt;
+        seccionesLeer(&l->secciones,respuesta,largo,inicioRespuestas);
+        r.registros = seccionesRegistros(&l->secciones,SECCION_ANSWER);
+        r.cantidad = seccionesCantidad(&l->secciones,SECCION_ANSWER);
+        inexistentesResultado(c->nombre,r.estado,ttlNegativo(&l->secciones));
+        negativasAprender(&l->secciones,l->confiable);
+        cacheGuardar(&l->secciones);
+        if (r.estado == 0)
+            l->respuestas++;
+        else
+            l->errores++;
+    }
+    escritorResultado(l->salida,&r);
+    free(c);
+}
+
+/** Fin de una resolución iterativa del lote: el resultado ya viene armado **/
+static void finIterativo(void *contexto, const RESULTADO *resultado)
+{
+    LOTE *l = (LOTE*)contexto;
+    /** la resolución iterativa no entrega el SOA de la negativa: vale el TTL por omisión **/
+    inexistentesResultado(resultado->consulta,resultado->estado,TTL_NEGATIVO_POR_OMISION);
+    if (resultado->estado == ESTADO_TIMEOUT)
+        l->timeouts++;
+    else if (resultado->estado == 0)
+        l->respuestas++;
+    else
+        l->errores++;
+    escritorResultado(l->salida,resultado);
+}
+
+/** El lote con resoluciones iterativas (-t): hasta enVuelo resoluciones avanzando a la vez **/
+static int loteIterativo(FILE *entrada, const char *puerto, ESCRITOR *salida, int enVuelo)
+{
+    LOTE l;
+    char nombre[256];
+    long total = 0;
+    int tipo, quedan = 1;
+    ITERATIVO *it = iterativoCrear(enVuelo,puerto);
+    if (it == NULL)
+    {
+        perror("socket error");
+        return -1;
+    }
+    memset(&l,0,sizeof(l));
+    l.salida = salida;
+
+    long long comienzo = trazaMicrosegundos();
+    while (quedan || iterativoPendientes(it) > 0)
+    {
+        while (quedan && iterativoPendientes(it) < enVuelo)
+        {
+            if (!(quedan = loteLeerConsulta(entrada,nombre,&tipo)))
+                break;
+            if (saltearInexistente(&l,nombre,tipo) || sintetizarNegativa(&l,nombre,tipo))
+                continue;
+            if (iterativoResolver(it,nombre,tipo,finIterativo,&l) < 0)
+                resultadoError(&l,nombre,tipo);
+            total++;
+        }
+        iterativoProcesar(it,100);
+    }
+    double segundos = (trazaMicrosegundos() - comienzo) / 1000000.0;
+
+    FILE *resumen = escritorEnSalidaEstandar(salida) ? stderr : stdout;
+    escritorCerrar(salida);
+    fprintf(resumen,";; lote iterativo: %ld consultas en %.2f s (%.0f consultas/s)\n",total,segundos,
+            segundos > 0 ? total / segundos : 0);
+    fprintf(resumen,";; NOERROR: %ld, otros rcode: %ld, sin respuesta: %ld\n",l.respuestas,l.errores,l.timeouts);
+    fprintf(resumen,";; paquetes enviados: %ld (%.1f por consulta, incluidos los NS sin glue)\n",iterativoSaltos(it),
+            total > 0 ? (double)iterativoSaltos(it) / total : 0);
+    resumenInexistentes(resumen);
+    resumenNegativas(resumen);
+    cacheResumen(resumen);
+    paquetesResumen(resumen);
+    iterativoDestruir(it);
+    return 0;
+}
+
+int loteResolver(const char *archivo, const char *servidor, const char *puerto, const char *salida,
+                 int formato, double qps, int enVuelo, int iterativa)
+{
+    LOTE l;
+    unsigned char consulta[MAX_CONSULTA_MOTOR];
+    char nombre[256];
+    long total = 0;
+    int tipo, quedan = 1;
+    FILE *entrada = stdin;
+
+    memset(&l,0,sizeof(l));
+    if (cargarDestinos(&l,servidor,puerto) < 0)
+    {
+        printf("ERROR: el servidor %s no es una dirección IPv4 ni IPv6\n",servidor);
+        return -1;
+    }
+    if (strcmp(archivo,"-") != 0 && (entrada = fopen(archivo,"r")) == NULL)
+    {
+        printf("ERROR: no se pudo abrir el archivo de consultas %s\n",archivo);
+        return -1;
+    }
+    if ((l.salida = escritorAbrir(salida,formato)) == NULL)
+    {
+        if (entrada != stdin)
+            fclose(entrada);
+        return -1;
+    }
+    if (iterativa)
+    {
+        int resultado = loteIterativo(entrada,puerto,l.salida,enVuelo);
+        if (entrada != stdin)
+            fclose(entrada);
+        return resultado;
+    }
+    MOTOR *m = motorCrear(enVuelo,qps,TIMEOUT_LOTE_MS,REINTENTOS_LOTE);
+    if (m == NULL)
+    {
+        perror("socket error");
+        return -1;
+    }
+
+    long long comienzo = trazaMicrosegundos();
+    while (quedan || motorEnVuelo(m) > 0)
+    {
+        /** un resolv.conf nuevo se toma entre dos vueltas, sin releerlo por consulta **/
+        if (servidor == NULL && configuracionVersion() != l.version)
+            cargarDestinos(&l,NULL,puerto);
+        DIRECCION *destino = &l.destinos[l.rotar ? l.turno % l.cantidadDestinos : 0];
+        while (quedan && motorPuedeEnviarA(m,destino))
+        {
+            if (!(quedan = loteLeerConsulta(entrada,nombre,&tipo)))
+                break;
+            if (saltearInexistente(&l,nombre,tipo) || sintetizarNegativa(&l,nombre,tipo))
+                continue;
+            /** el mismo armado de la consulta que resolverConsulta, con recursion desired **/
+            int largo = armarConsulta(consulta,nombre,tipo,1,0);
+            if (responderDeCache(&l,nombre,tipo,consulta,largo))
+                continue;
+            CONSULTA_LOTE *c = (CONSULTA_LOTE*)malloc(sizeof(CONSULTA_LOTE) + strlen(nombre) + 1);
+            c->lote = &l;
+            c->tipo = tipo;
+            strcpy(c->nombre,nombre);
+            if (motorEnviar(m,destino,consulta,largo,respuestaLote,c) < 0)
+            {
+                resultadoError(&l,nombre,tipo);
+                free(c);
+            }
+            total++;
+            if (l.rotar)
+                destino = &l.destinos[++l.turno % l.cantidadDestinos];
+        }
+        motorProcesar(m,100);
+    }
+    double segundos = (trazaMicrosegundos() - comienzo) / 1000000.0;
+    ESTADISTICAS_MOTOR e = motorEstadisticas(m);
+    motorDestruir(m);
+    seccionesLiberar(&l.secciones);
+    if (entrada != stdin)
+        fclose(entrada);
+
+    /** el resumen va a la salida de error si los resultados salen por la estándar **/
+    FILE *resumen = escritorEnSalidaEstandar(l.salida) ? stderr : stdout;
+    escritorCerrar(l.salida);
+    fprintf(resumen,";; lote: %ld consultas en %.2f s (%.0f consultas/s)\n",total,segundos,
+            segundos > 0 ? total / segundos : 0);
+    fprintf(resumen,";; NOERROR: %ld, otros rcode: %ld, timeouts: %ld\n",l.respuestas,l.errores,l.timeouts);
+    fprintf(resumen,";; paquetes enviados: %ld (reintentos: %ld), respuestas descartadas: %ld\n",
+            e.enviadas + e.reintentos,e.reintentos,e.descartadas);
+    resumenInexistentes(resumen);
+    resumenNegativas(resumen);
+    cacheResumen(resumen);
+    paquetesResumen(resumen);
+    return 0;
+}
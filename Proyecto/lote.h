@@ -0,0 +1,47 @@
+#ifndef LOTE_H_INCLUDED
+#define LOTE_H_INCLUDED
+
+#include <stdio.h>
+
+/**
+ * Modo lote (parámetro -lote=): resuelve todas las consultas de un archivo contra un servidor
+ * recursivo, con el motor no bloqueante (muchas consultas en vuelo, tasa controlada), y escribe
+ * cada resultado con el escritor elegido (escritor.h) a medida que llegan las respuestas.
+ *
+ * El archivo tiene una consulta por línea, "nombre [TIPO]" (TIPO por defecto A), el mismo
+ * formato que usan dnsperf y resperf. Las líneas vacías y las que empiezan con '#' o ';' se
+ * ignoran. El archivo se lee de a una línea, así que puede tener millones de consultas.
+ *
+ * Con -t cada consulta se resuelve iterativamente desde la raíz (iterativo.h), con hasta enVuelo
+ * resoluciones avanzando a la vez; del servidor sólo se usa el puerto.
+ *
+ * Sin servidor (no se indicó @servidor) se usan los nameserver de resolv.conf (configuracion.h):
+ * el primero, o con "options rotate" todos por turno. Si el archivo cambia durante el lote, las
+ * consultas siguientes van a los servidores nuevos.
+ *
+ * Con un filtro de inexistentes abierto (-nxfiltro=, ver inexistentes.h) los nombres que ya dieron
+ * NXDOMAIN en corridas anteriores no se consultan: salen como NXDOMAIN sin rtt. Cada NXDOMAIN del
+ * lote se agrega al filtro y cada NOERROR saca el nombre.
+ **/
+
+/** Espera por intento y reenvíos de cada consulta del lote **/
+#define TIMEOUT_LOTE_MS 2000
+#define REINTENTOS_LOTE 2
+
+/**
+ * Lee la próxima consulta válida del archivo: el nombre (hasta 255 caracteres) y el tipo.
+ * Las líneas mal formadas se informan en stderr y se saltean. Devuelve 1, o 0 al final del archivo.
+ **/
+int loteLeerConsulta(FILE *archivo, char *nombre, int *tipo);
+
+/**
+ * archivo: consultas ("-" = entrada estándar); servidor/puerto: servidor recursivo (IPv4 o IPv6), o
+ * NULL para los de resolv.conf;
+ * salida/formato: destino de los resultados; qps y enVuelo como en el barrido (con iterativa, qps
+ * no se usa: el ritmo por servidor es el de -ritmo=, ver ritmo.h).
+ * Devuelve 0 si el lote terminó, -1 si hubo un error en los parámetros.
+ **/
+int loteResolver(const char *archivo, const char *servidor, const char *puerto, const char *salida,
+                 int formato, double qps, int enVuelo, int iterativa);
+
+#endif // LOTE_H_INCLUDED
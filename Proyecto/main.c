@@ -5,378 +5,79 @@
 #include<arpa/inet.h>
 #include<netinet/in.h>
 #include<unistd.h>
+#include<ctype.h>
+#include<poll.h>
 #include <stdint.h>
 #include <inttypes.h>
-
-/** tipos de consultas manejados */
-#define T_A 1
-#define T_MX 15
-#define T_LOC 29    /** RFC 1876: LOCation information, geographical location, experimental RFC **/
-#define T_SOA 6
-#define T_NS 2
+#include <math.h>
+
+#include "dns.h"
+#include "tipos_rr.h"
+#include "traza.h"
+#include "raices.h"
+#include "delegaciones.h"
+#include "nombres.h"
+#include "vectorial.h"
+#include "loc.h"
+#include "secciones.h"
+#include "escritor.h"
+#include "lote.h"
+#include "repeticion.h"
+#include "carga.h"
+#include "ritmo.h"
+#include "iterativo.h"
+#include "inexistentes.h"
+#include "barrido.h"
+#include "transferencia.h"
+#include "zonas.h"
+#include "negativas.h"
+#include "configuracion.h"
+#include "motor.h"
+#include "plantillas.h"
+#include "cache.h"
+#include "paquetes.h"
+#include "medicion.h"
+#include "direcciones.h"
+#include "aleatorio.h"
 
 /** Variables globales **/
-char dns_servers[10][100]; // Listado de servidores dns dentro del sistema
-char *servidorDNS; // Por defecto: se le asignará dns_servers[0]
+CONFIGURACION configuracion; // resolv.conf: servidores, lista de búsqueda y opciones (ver configuracion.h)
+char *servidorDNS; // Por defecto: se le asignará el primer nameserver de la configuración
+int servidorDeConfiguracion = 1; // 1 mientras no se indique @servidor: se usan todos los de resolv.conf
+long long ultimoRtt = -1; // RTT de la última respuesta de resolverConsulta, -1 si no hubo
 char *puerto = "53"; // Por defecto: 53
 char *tipoConsulta = "-a";
 char *maneraConsulta = "-r";
+int consultaRecursiva = 1; // maneraConsulta ya resuelta: 1 con -r, 0 con -t
+int tipoExtendido = 0; // tipo pedido con -tipo=, 0 si se usa -a, -mx o -loc
+char *ultimoResultado = "nodata"; // clasificación de la última respuesta recibida (ver traza.h)
+static TRAZA_CONSULTA trazaConsulta; // la consulta recursiva de la línea de comandos (-r)
+char *rangosPTR = NULL; // rangos CIDR del barrido inverso (-ptr=), NULL si no se pidió
+char *archivoSalida = NULL; // archivo de resultados de los modos masivos (-salida=)
+double consultasPorSegundo = 0; // tasa de envío de los modos masivos (-qps=), 0 = sin límite
+int consultasEnVuelo = 256; // consultas simultáneas de los modos masivos (-envuelo=)
+int modoAXFR = 0; // transferencia completa de la zona (-axfr)
+char *copiaIXFR = NULL; // copia local que se actualiza por IXFR (-ixfr=), NULL si no se pidió
+char *direccionServidor = NULL; // [ip:]puerto del modo servidor (-servir), NULL si no se pidió
+int formatoSalida = FORMATO_TEXTO; // formato de los resultados (-formato=), ver escritor.h
+char *archivoLote = NULL; // archivo de consultas del modo lote (-lote=), NULL si no se pidió
+ESCRITOR *escritorConsultas = NULL; // escritor de la consulta simple cuando -formato= no es texto
+char *capturaRepetir = NULL; // captura que se repite por el parser (-repetir=), NULL si no se pidió
+int vueltasRepeticion = 1; // vueltas sobre la captura (-vueltas=)
+int modoMedicion = 0; // microbenchmarks de las funciones calientes (-medir)
+char *capturaMedicion = NULL; // captura sobre la que se mide (-medir=), NULL para las respuestas sintéticas
+int contadoresHardware = 0; // ciclos y fallos de cache en la medición (-contadores)
+int cantidadPaquetes = PAQUETES_POR_OMISION; // buffers por clase chica del pool de paquetes (-paquetes=)
+int paginasGrandes = 0; // pool de paquetes en páginas enormes (-paginasgrandes)
+int familiaServidores = AF_UNSPEC; // familia de los servidores consultados (-4, -6), AF_UNSPEC = las dos
+char *archivoCarga = NULL; // consultas de la prueba de carga (-carga=), NULL si no se pidió
+double duracionCarga = 10; // segundos de envío de la prueba de carga (-duracion=)
+double qpsInicialCarga = -1; // comienzo de la rampa de la prueba de carga (-rampa=), -1 = tasa fija
+double intervaloCarga = 1; // segundos entre informes de la prueba de carga (-intervalo=)
+double qpsPorServidor = 0; // tasa máxima hacia cada servidor, compartida por todos los modos (-ritmo=), 0 = sin límite
+char *filtroInexistentes = NULL; // filtro persistente de nombres con NXDOMAIN del lote (-nxfiltro=), NULL si no se pidió
+int reverificarInexistentes = 0; // volver a consultar los nombres del filtro con el TTL negativo vencido (-reverificar)
 
-/** tipos de datos definidos */
-/** Formato de mensaje DNS **/
-/**
-El formato de mensaje de nivel superior se divide en 5 secciones:
-    +---------------------+
-    |        Header       |
-    +---------------------+
-    |       Question      | la pregunta para el servidor de nombres
-    +---------------------+
-    |        Answer       | RRs respondiendo la pregunta
-    +---------------------+
-    |      Authority      | RRs pointing toward an authority
-    +---------------------+
-    |      Additional     | RRs holding additional information
-    +---------------------+
-**/
-
-/** Formato de la sección Header **/
-/** El header contiene los siguientes campos:
-                                    1  1  1  1  1  1
-      0  1  2  3  4  5  6  7  8  9  0  1  2  3  4  5
-    +--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+
-    |                      ID                       |
-    +--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+
-    |QR|   Opcode  |AA|TC|RD|RA|   Z    |   RCODE   |
-    +--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+
-    |                    QDCOUNT                    |
-    +--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+
-    |                    ANCOUNT                    |
-    +--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+
-    |                    NSCOUNT                    |
-    +--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+
-    |                    ARCOUNT                    |
-    +--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+
-**/
-typedef struct HEADER
-{
-    /** Un identificador de 16 bits **/
-    unsigned short id;
-    /** Recursion desired **/
-    unsigned char rd :1;
-    /** TrunCation: especifica si el mensaje fue truncado **/
-    unsigned char tc :1;
-    /** Authoritive answer **/
-    unsigned char aa :1;
-    /** Opcode:
-    Un campo de 4 bits que especifica el tipo de consulta en el mensaje . Los valores son:
-        0      standard query (QUERY)
-        1      inverse query (IQUERY)
-        2      server status request (STATUS)
-        3-15   reservado para un uso futuro
-    **/
-    unsigned char opcode :4;
-    /** Un campo de un bir que especifica si es una consulta (0) o una respuesta (1) **/
-    unsigned char qr :1;
-    /** Campo de 4 bits, código de respuesta **/
-    unsigned char rcode :4;
-    /** Z: Reservado para un uso futuro.
-        Debe ser 0 en todas las consultas y respuestas.
-    **/
-    unsigned char z :1;
-    /** Recursion Available **/
-    unsigned char ra :1;
-    /** QDCOUNT:
-    Un entero de 16 bits sin signo que especifica el número de entradas en la sección Question.
-    **/
-    unsigned short qdcount;
-    /**
-    Un entero de 16 bits sin signo que especifica el número de resource records en la sección Answer.
-    **/
-    unsigned short ancount;
-    /**
-    Un entero de 16 bits sin signo que especifica el número de resource records del servidor de
-    nombres en la sección Authority.
-    **/
-    unsigned short nscount;
-    /**
-    Un entero de 16 bits sin signo que especifica el número de resource records del servidor de
-    nombres en la sección Additional.
-    **/
-    unsigned short arcount;
-} seccion_header;
-
-/** Formato de la sección Question **/
-/**
-                                    1  1  1  1  1  1
-      0  1  2  3  4  5  6  7  8  9  0  1  2  3  4  5
-    +--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+
-    |                                               |
-    /                     QNAME                     /
-    /                                               /
-    +--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+
-    |                     QTYPE                     |
-    +--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+
-    |                     QCLASS                    |
-    +--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+
-**/
-typedef struct QUESTION
-{
-    /** QNAME forma parte de esta sección también, un nombre de dominio codificado en labels **/
-    /** Un código de dos octetos que especifica el tipo de la consulta **/
-    unsigned short qtype;
-    /** Un código de dos octetos que especifica la clase de la consulta
-        Por ejemplo, el campo QCLASS es IN para Internet **/
-    unsigned short qclass;
-} seccion_question;
-
-/** 4.1.3. Formato de los Resource record (RR) **/
-/**
-Las secciones Answer, Authority y Additional comparten el mismo
-formato: un número variable de resource records, donde el número de
-registros (records) se especifican en el campo count correspondiente en el Header.
-Cada RR tiene el siguiente formato:
-                                    1  1  1  1  1  1
-      0  1  2  3  4  5  6  7  8  9  0  1  2  3  4  5
-    +--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+
-    |                                               |
-    /                                               /
-    /                      NAME                     /
-    |                                               |
-    +--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+
-    |                      TYPE                     |
-    +--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+
-    |                     CLASS                     |
-    +--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+
-    |                      TTL                      |
-    |                                               |
-    +--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+
-    |                   RDLENGTH                    |
-    +--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+--|
-    /                     RDATA                     /
-    /                                               /
-    +--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+
-**/
-/**
-NAME            a domain name to which this resource record pertains.
-
-TYPE            two octets containing one of the RR type codes.  This
-                field specifies the meaning of the data in the RDATA
-                field.
-
-CLASS           two octets which specify the class of the data in the
-                RDATA field.
-
-TTL             a 32 bit unsigned integer that specifies the time
-                interval (in seconds) that the resource record may be
-                cached before it should be discarded.  Zero values are
-                interpreted to mean that the RR can only be used for the
-                transaction in progress, and should not be cached.
-
-RDLENGTH        an unsigned 16 bit integer that specifies the length in
-                octets of the RDATA field.
-
-RDATA           a variable length string of octets that describes the
-                resource.  The format of this information varies
-                according to the TYPE and CLASS of the resource record.
-                For example, the if the TYPE is A and the CLASS is IN,
-                the RDATA field is a 4 octet ARPA Internet address.
-**/
-
-//Constant sized fields of the resource record structure
-//short es de 16bits, int es de 32 bits
-struct R_DATA
-{
-    unsigned short type;
-    unsigned short _class;
-    unsigned int ttl;
-    unsigned short rdlength;
-};
-
-//Pointers to resource record contents
-struct RESOURCE_RECORD
-{
-    unsigned char *name;
-    struct R_DATA *resource;
-    unsigned char *rdata;
-};
-
-//Structure of a Query
-typedef struct
-{
-    unsigned char *name;
-    seccion_question *ques;
-} QUERY;
-
-/**
-      LOC RDATA Format
-
-       MSB                                           LSB
-       +--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+
-      0|        VERSION        |         SIZE          |
-       +--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+
-      2|       HORIZ PRE       |       VERT PRE        |
-       +--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+
-      4|                   LATITUDE                    |
-       +--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+
-      6|                   LATITUDE                    |
-       +--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+
-      8|                   LONGITUDE                   |
-       +--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+
-     10|                   LONGITUDE                   |
-       +--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+
-     12|                   ALTITUDE                    |
-       +--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+
-     14|                   ALTITUDE                    |
-       +--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+
-   (octet)
-
-where:
-
-VERSION      Version number of the representation.  This must be zero.
-             Implementations are required to check this field and make
-             no assumptions about the format of unrecognized versions.
-
-SIZE         The diameter of a sphere enclosing the described entity, in
-             centimeters, expressed as a pair of four-bit unsigned
-             integers, each ranging from zero to nine, with the most
-             significant four bits representing the base and the second
-             number representing the power of ten by which to multiply
-             the base.  This allows sizes from 0e0 (<1cm) to 9e9
-             (90,000km) to be expressed.  This representation was chosen
-             such that the hexadecimal representation can be read by
-             eye; 0x15 = 1e5.  Four-bit values greater than 9 are
-             undefined, as are values with a base of zero and a non-zero
-             exponent.
-
-             Since 20000000m (represented by the value 0x29) is greater
-             than the equatorial diameter of the WGS 84 ellipsoid
-             (12756274m), it is therefore suitable for use as a
-             "worldwide" size.
-
-HORIZ PRE    The horizontal precision of the data, in centimeters,
-             expressed using the same representation as SIZE.  This is
-             the diameter of the horizontal "circle of error", rather
-             than a "plus or minus" value.  (This was chosen to match
-             the interpretation of SIZE; to get a "plus or minus" value,
-             divide by 2.)
-
-VERT PRE     The vertical precision of the data, in centimeters,
-             expressed using the sane representation as for SIZE.  This
-             is the total potential vertical error, rather than a "plus
-             or minus" value.  (This was chosen to match the
-             interpretation of SIZE; to get a "plus or minus" value,
-             divide by 2.)  Note that if altitude above or below sea
-             level is used as an approximation for altitude relative to
-             the [WGS 84] ellipsoid, the precision value should be
-             adjusted.
-
-LATITUDE     The latitude of the center of the sphere described by the
-             SIZE field, expressed as a 32-bit integer, most significant
-             octet first (network standard byte order), in thousandths
-             of a second of arc.  2^31 represents the equator; numbers
-             above that are north latitude.
-
-LONGITUDE    The longitude of the center of the sphere described by the
-             SIZE field, expressed as a 32-bit integer, most significant
-             octet first (network standard byte order), in thousandths
-             of a second of arc, rounded away from the prime meridian.
-             2^31 represents the prime meridian; numbers above that are
-             east longitude.
-
-ALTITUDE     The altitude of the center of the sphere described by the
-             SIZE field, expressed as a 32-bit integer, most significant
-             octet first (network standard byte order), in centimeters,
-             from a base of 100,000m below the [WGS 84] reference
-             spheroid used by GPS (semimajor axis a=6378137.0,
-             reciprocal flattening rf=298.257223563).  Altitude above
-             (or below) sea level may be used as an approximation of
-             altitude relative to the the [WGS 84] spheroid, though due
-             to the Earth's surface not being a perfect spheroid, there
-             will be differences.  (For example, the geoid (which sea
-             level approximates) for the continental US ranges from 10
-             meters to 50 meters below the [WGS 84] spheroid.
-             Adjustments to ALTITUDE and/or VERT PRE will be necessary
-             in most cases.  The Defense Mapping Agency publishes geoid
-             height values relative to the [WGS 84] ellipsoid.
-*/
-
-struct R_DATA_LOC
-{
-    unsigned char version;
-    unsigned char size;
-    unsigned char horiz_pre;
-    unsigned char vert_pre;
-    uint32_t latitude;
-    uint32_t longitude;
-    uint32_t altitude;
-};
-
-/**
-    SOA RDATA format
-                                   1  1  1  1  1  1
-     0  1  2  3  4  5  6  7  8  9  0  1  2  3  4  5
-    +--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+
-    /                     MNAME                     /
-    /                                               /
-    +--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+
-    /                     RNAME                     /
-    +--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+
-    |                    SERIAL                     |
-    |                                               |
-    +--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+
-    |                    REFRESH                    |
-    |                                               |
-    +--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+
-    |                     RETRY                     |
-    |                                               |
-    +--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+
-    |                    EXPIRE                     |
-    |                                               |
-    +--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+
-    |                    MINIMUM                    |
-    |                                               |
-    +--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+
-
-where:
-
-MNAME           The <domain-name> of the name server that was the
-                original or primary source of data for this zone.
-
-RNAME           A <domain-name> which specifies the mailbox of the
-                person responsible for this zone.
-
-SERIAL          The unsigned 32 bit version number of the original copy
-                of the zone.  Zone transfers preserve this value.  This
-                value wraps and should be compared using sequence space
-                arithmetic.
-
-REFRESH         A 32 bit time interval before the zone should be
-                refreshed.
-
-RETRY           A 32 bit time interval that should elapse before a
-                failed refresh should be retried.
-
-EXPIRE          A 32 bit time value that specifies the upper limit on
-                the time interval that can elapse before the zone is no
-                longer authoritative.
-
-MINIMUM         The unsigned 32 bit minimum TTL field that should be
-                exported with any RR from this zone.
-
-SOA records cause no additional section processing.
-
-    */
-
-struct R_DATA_SOA
-{
-    uint32_t name;
-    uint16_t rname;
-    uint32_t serial;
-    uint32_t refresh;
-    uint32_t retry;
-    uint32_t expire;
-    uint32_t minimum;
-};
 
 /** ¿Cómo se representa un nombre de dominio dentro del paquete DNS? **/
 /** El nombre de dominio se representa en forma de labels separadas por puntos (.):
@@ -393,111 +94,54 @@ struct R_DATA_SOA
 **/
 void cambiarAlFormatoNombreDNS(unsigned char* dns, char* host)
 {
-    //A modo de síntesis, recorro la cadena contando en "lock" cuantos caracteres insumo, una vez llegado el punto
-    //inserto en su lugar i-lock, es decir, el lugar actual menos lo que contiene lock (inicialmente lock es 0 por lo
-    //que se inserta el índice actual), quedando asi la cantidad de caracteres que contiene esa sección del nombre
-    //por otro lado, se escriben en la salida (dns) se guardan los caracteres hasta el proximo punto, incrementando
-    //el valor del lock. El valor de i se incrementa en el for exterior.
-    if (host[0] == '.' && strlen((char*)host) == 1)   /** Raiz **/
+    //Recorro la cadena de a un label: busco el próximo punto (vectorialBuscarByte compara 16 o 32
+    //caracteres por instrucción), escribo el largo del label y copio sus caracteres de una vez.
+    //Un punto final (nombre absoluto) deja un label vacío, que es justamente la raíz.
+    if (host[0] == '.' && host[1] == '\0')   /** Raiz **/
     {
         *dns++='\0';
     }
     else
     {
-        int lock = 0 , i;
-        strcat((char*)host,".");
-        for(i = 0 ; i < strlen((char*)host) ; i++)
+        int restante = strlen(host), largoLabel;
+        const unsigned char *label = (const unsigned char*)host;
+        while (restante > 0)
         {
-            if(host[i]=='.')
-            {
-                *dns++ = i-lock;    //guardo i-lock y luego incremento dicho valor en 1.
-                for(; lock<i; lock++)
-                {
-                    *dns++=host[lock];
-                }
-                lock++;
-            }
+            largoLabel = vectorialBuscarByte(label,restante,'.');
+            if (largoLabel == 0)
+                break;
+            *dns++ = largoLabel;
+            memcpy(dns,label,largoLabel);
+            dns += largoLabel;
+            label += largoLabel + 1;
+            restante -= largoLabel + 1;
         }
         *dns++='\0';
-        host[strlen((char*)host)-1]='\0';//quito el punto que agregue mas arriba.
     }
 }
 
 /** Del formato DNS al formato "humano" con '.'
-    inicialmente lee un nombre en formato dns y luego en una segunda parte lo convierte al formato con puntos
+    lee el nombre en una sola pasada (nombres.h): los punteros de compresión sólo pueden ir hacia
+    atrás, el nombre no puede pasar de 255 bytes y no se lee más allá de los largo bytes del
+    mensaje, así que un mensaje malicioso no lo hace ciclar ni leer o escribir fuera del buffer.
+    Si el nombre está mal formado se devuelve vacío.
 **/
-u_char* leerNombre(unsigned char* reader,unsigned char* buffer,int* count)
+u_char* leerNombre(unsigned char* reader,unsigned char* buffer,int largo,int* count)
 {
-    unsigned char *name;
-    unsigned int p=0,jumped=0,offset;
-    int i , j;
-
-    *count = 1;
-    name = (unsigned char*)malloc(256);
+    unsigned char *name = (unsigned char*)malloc(256);
+    int pos = reader - buffer;
+    int siguiente = nombreLeerMensaje(buffer,largo,pos,NULL,(char*)name);
 
-    name[0]='\0';
-
-    //lee los nombres en format 3www6google3com0
-    while(*reader!=0)
+    if (siguiente < 0)
     {
-        //conversion del caracter.
-        if(*reader>=192)
-        {
-            offset = (*reader)*256 + *(reader+1) - 49152; //*reader = caracter actual apuntado, *(reader+1) = caracter siguiente, 49152 = 11000000 00000000 ;)
-            reader = buffer + offset - 1;
-            jumped = 1;
-        }
-        else
-        {
-            name[p++]=*reader;  //leo un caracter y luego incremento en 1 el puntero p
-        }
-
-        reader = reader+1;
-
-        if(jumped==0)
-        {
-            *count = *count + 1;
-        }
-    }
-
-    name[p]='\0'; //string completo
-    if(jumped==1)
-    {
-        *count = *count + 1;
-    }
-
-    //se convierte 3www6google3com0 a www.google.com
-    for(i=0; i<(int)strlen((const char*)name); i++)
-    {
-        p=name[i];
-        for(j=0; j<(int)p; j++)
-        {
-            name[i]=name[i+1];
-            i=i+1;
-        }
-        name[i]='.';
+        name[0] = '\0';
+        *count = 1;
     }
-    name[i-1]='\0'; // remueve el último punto
+    else
+        *count = siguiente - pos;
     return name;
 }
 
-/** mapearTipo: Simplemente mapea los tipos manejados por el programa a un texto imprimible **/
-char* mapearTipo(int tipo){
-    switch(tipo){
-        case T_A:
-            return "A";
-        case T_MX:
-            return "MX";
-        case T_LOC:
-            return "LOC";
-        case T_SOA:
-            return "SOA";
-        case T_NS:
-            return "NS";
-    }
-    return "error";
-}
-
 /** C substring function: It returns a pointer to the substring */
 char *cortarString(char *string, int position, int length)
 {
@@ -531,7 +175,8 @@ void mostrarAyuda()
            "caracteres denotando el nombre simbólico que se desea mapear a un IP)\n");
     printf("@servidor: el cliente debe resolver la consulta suminstrada contra el servidor\n"\
            "DNS que se especifique con este argumento. Caso contrario, se resolverá la\n"\
-           "consulta suministrada contra el servidor DNS por defecto\n");
+           "consulta suministrada contra el servidor DNS por defecto. Puede ser IPv4 o IPv6;\n"\
+           "una IPv6 con puerto va entre corchetes: @[2001:db8::53]:5300\n");
     printf("[:puerto]: parámetro opcional si se especificó un servidor. Permite indicar\n"\
            "que el servidor contral el cual se resolverá la consulta no está ligado\n"\
            "al puerto DNS estándar. Caso contrario, se asume que las consultas serán\n"\
@@ -550,606 +195,968 @@ void mostrarAyuda()
     printf("\t-r: se está solicitando que la consulta contenga el bit recursion\n"\
            "\tdesired activado\n");
     printf("\t-t: se está solicitando que la consulta se resuelva iterativamente,\n"\
-           "\tmostrando una traza con la evolución de la misma\n");
+           "\tmostrando una traza con la evolución de la misma. Comienza por los\n"\
+           "\tservidores raíz precompilados, sin consultar al servidor por defecto\n");
     printf("\tEn caso de no indicarse la manera de consulta, se asume que la consulta\n"\
            "\tdebe ser resuelta de manera recursiva\n");
     printf("-h: parámetro opcional, modo ayuda\n");
+    printf("\nOPCIONES EXTENDIDAS:\n");
+    printf("-traza[=archivo]: emite una traza de cada paso de la resolución (servidor,\n"\
+           "\tconsulta, RTT, tamaño, rcode y resultado) en formato JSON Lines, por\n"\
+           "\tdefecto a la salida de error estándar\n");
+    printf("-tipo=TIPO: consulta por un tipo distinto de A, MX o LOC (por ejemplo AAAA,\n"\
+           "\tCNAME, PTR, TXT, SRV, SOA o TYPEnnn). Reemplaza a -a, -mx y -loc\n");
+    printf("-raices=archivo: en modo iterativo (-t), usa las pistas de raíz del archivo\n"\
+           "\t(formato named.root) en lugar de las precompiladas\n");
+    printf("-ptr=CIDR[,CIDR...]: barrido de DNS inverso. Consulta el PTR de cada dirección\n"\
+           "\tde los rangos (IPv4 o IPv6, hasta 2^24 direcciones por rango) contra el\n"\
+           "\tservidor indicado, con muchas consultas en vuelo. Uso:\n"\
+           "\tquery -ptr=192.0.2.0/24 [@servidor[:puerto]] [-salida=archivo]\n");
+    printf("-lote=archivo: resuelve todas las consultas del archivo (una por línea, \"nombre [TIPO]\",\n"\
+           "\tpor defecto A) contra el servidor, con muchas consultas en vuelo. Uso:\n"\
+           "\tquery -lote=consultas.txt [@servidor[:puerto]] [-salida=archivo] [-formato=json]\n"\
+           "\tCon -t cada consulta se resuelve iterativamente, muchas a la vez\n");
+    printf("-nxfiltro=archivo: en el lote, no consulta los nombres que dieron NXDOMAIN en corridas\n"\
+           "\tanteriores (salen como NXDOMAIN) y guarda en el archivo los NXDOMAIN nuevos.\n"\
+           "\tCon -reverificar vuelve a consultar los que tienen el TTL negativo vencido\n");
+    printf("-carga=archivo: prueba de carga. Envía las consultas del archivo (mismo formato que\n"\
+           "\t-lote=, en ciclo) a -qps=N por -duracion=S segundos (10 por defecto), a lazo\n"\
+           "\tabierto, e informa cada -intervalo=S (1 por defecto) la tasa lograda, las pérdidas,\n"\
+           "\tlos rcode y los percentiles de latencia. -rampa=N sube (o baja) linealmente de N\n"\
+           "\ta -qps= consultas por segundo. Uso:\n"\
+           "\tquery -carga=consultas.txt @servidor[:puerto] -qps=5000 [-rampa=100] [-formato=json]\n");
+    printf("-salida=archivo: archivo de resultados del barrido o el lote (por defecto la salida estándar)\n");
+    printf("-formato=texto|json|csv|binario: formato de los resultados del barrido, del lote y de\n"\
+           "\tlas consultas recursivas (-r). Los formatos distintos de texto no llevan encabezado\n");
+    printf("-qps=N: consultas por segundo del barrido o el lote (por defecto sin límite)\n");
+    printf("-envuelo=N: consultas simultáneas del barrido o el lote (por defecto 256, como máximo %d)\n",MAX_EN_VUELO_MOTOR);
+    printf("-ritmo=N: como máximo N consultas por segundo a cada servidor, en todos los modos\n"\
+           "\t(también en cada salto de -t). La tasa baja sola si un servidor empieza a\n"\
+           "\tcontestar REFUSED o SERVFAIL o a perder consultas, y vuelve a subir después\n");
+    printf("-axfr: transfiere la zona completa por TCP y la escribe en formato de archivo\n"\
+           "\tde zona (en -salida= o la salida estándar). Uso:\n"\
+           "\tquery zona @servidor[:puerto] -axfr [-salida=archivo]\n");
+    printf("-ixfr=archivo: actualiza la copia local de la zona (generada con -axfr) pidiendo\n"\
+           "\tsólo los cambios desde su serial. Uso: query zona @servidor[:puerto] -ixfr=archivo\n");
+    printf("-repetir=archivo: pasa las respuestas de una captura (pcap o mensajes precedidos por su\n"\
+           "\tlargo, como en TCP) por el parser, sin sockets, e informa mensajes/s y bytes/s.\n"\
+           "\tCon -salida= o -formato= escribe además los resultados. Uso:\n"\
+           "\tquery -repetir=captura.pcap [-vueltas=N] [-salida=archivo] [-formato=json]\n");
+    printf("-medir[=archivo]: mide el tiempo por operación (y las reservas, con el target Perfil) de\n"\
+           "\tlas funciones del parser y del codificador, sobre respuestas sintéticas o las de una\n"\
+           "\tcaptura. -contadores agrega ciclos, instrucciones y fallos de cache (perf_event_open).\n"\
+           "\tAntes comprueba la ida y vuelta del codec de cabecera y campos de RR\n");
+    printf("-zona=archivo: carga un archivo de zona (formato RFC 1035, por ejemplo uno generado\n"\
+           "\tcon -axfr). Las consultas por nombres de las zonas cargadas se contestan\n"\
+           "\tlocalmente, sin consultar a ningún servidor. Se puede repetir\n");
+    printf("-nsec: pide los registros DNSSEC y guarda los NSEC/NSEC3 de las respuestas negativas:\n"\
+           "\tlos nombres que caen en los mismos huecos se contestan NXDOMAIN o NODATA sin\n"\
+           "\tpreguntar, mientras dure el TTL (RFC 8198). Las firmas no se validan acá: sólo se\n"\
+           "\taprende de respuestas con AD de servidores que validan (options trust-ad)\n");
+    printf("-cache[=MB]: guarda las respuestas mientras dure su TTL y contesta desde ahí las que\n"\
+           "\tse repiten, sin superar MB megabytes (64 por defecto). Al terminar informa\n"\
+           "\taciertos y expulsiones\n");
+    printf("-paquetes=N: buffers de 512 y de 1232 bytes que se reservan de entrada para las\n"\
+           "\tconsultas en vuelo (1024 de cada uno por defecto; si faltan se reservan más)\n");
+    printf("-4, -6: consulta sólo a servidores IPv4, o sólo IPv6. Sin ellos se usan los de las dos\n"\
+           "\tfamilias; los NS con glue A y AAAA se prueban en paralelo, con un escalón de %d ms\n",ESCALON_FAMILIAS_MS);
+    printf("-paginasgrandes: reserva los buffers de paquetes en páginas enormes (MAP_HUGETLB, o\n"\
+           "\tlas transparentes si no hay reservadas) e informa cuánta memoria usaron\n");
+    printf("-servir[=[ip:]puerto]: contesta por UDP las consultas de las zonas cargadas con\n"\
+           "\t-zona= (por defecto en 0.0.0.0:53; una IPv6 va entre corchetes: -servir=[::1]:5353).\n"\
+           "\tUso: query -zona=archivo -servir=5353\n");
 }
 
-/** obtengo los servidores dns locales, directo desde el archivo /etc/resolv.conf **/
-void get_dns_servers()
+/** Imprime los RR de una sección con el formato presentación de su tipo (ver tipos_rr.c) **/
+void imprimirSeccion(char *titulo,struct RESOURCE_RECORD registros[],int cantidad)
 {
-    FILE *fp;
-    char line[200] , *p;
-    if((fp = fopen("/etc/resolv.conf" , "r")) == NULL)
+    char textoTipo[LARGO_TEXTO_TIPO];
+    int i;
+    if (cantidad > 0)
     {
-        printf("Falló abriendo el archivo /etc/resolv.conf\n");
+        printf("\n;; %s SECTION:\n",titulo);
+        for(i=0 ; i < cantidad ; i++)
+            printf(";%s.\tIN\t%s\t%s\n",registros[i].name,mapearTipo(registros[i].resource.type,textoTipo),registros[i].texto);
     }
-    int i = 0;
-    while(fgets(line , 200 , fp))
+}
+
+/** Los LOC de la sección también en grados decimales y metros, convertidos en un solo lote (ver loc.h) **/
+void imprimirUbicaciones(struct RESOURCE_RECORD registros[],int cantidad)
+{
+    unsigned char *rdatas;
+    UBICACION *ubicaciones;
+    int *indices, n = 0, i;
+
+    if (cantidad == 0)
+        return;
+    rdatas = (unsigned char*)malloc(cantidad * LARGO_LOC);
+    ubicaciones = (UBICACION*)malloc(cantidad * sizeof(UBICACION));
+    indices = (int*)malloc(cantidad * sizeof(int));
+    for(i=0 ; i < cantidad ; i++)
     {
-        if(line[0] == '#')
+        if(registros[i].resource.type==T_LOC && registros[i].resource.rdlength==LARGO_LOC)
         {
-            continue;
-        }
-        if(strncmp(line , "nameserver" , 10) == 0)
-        {
-            char toks[] = " \n"; // espacios y saltos de línea
-            p = strtok(line, toks);
-            p = strtok(NULL , toks);
-            strcat(dns_servers[i],p);
-            i++;
+            memcpy(rdatas + n * LARGO_LOC,registros[i].rdata,LARGO_LOC);
+            indices[n++] = i;
         }
     }
+    if (n > 0 && locLoteAUbicaciones(rdatas,n,ubicaciones) > 0)
+    {
+        printf("\n;; UBICACION (grados, metros):\n");
+        for(i=0 ; i < n ; i++)
+            if (!isnan(ubicaciones[i].latitud))
+                printf(";%s.\t%.6f\t%.6f\t%.2f\n",registros[indices[i]].name,ubicaciones[i].latitud,ubicaciones[i].longitud,ubicaciones[i].altitud);
+    }
+    free(rdatas);
+    free(ubicaciones);
+    free(indices);
 }
 
-unsigned int littleToBigEndian(unsigned int x)
+/** Imprime resultados de una consulta **/
+void printResults(struct RESOURCE_RECORD answer[],struct RESOURCE_RECORD authority[],struct RESOURCE_RECORD additional[],
+                  int respuestasA,int respuestasAU,int respuestasADD,char* host,int query_type)
 {
-    return (((x>>24) & 0x000000ff) | ((x>>8) & 0x0000ff00) | ((x<<8) & 0x00ff0000) | ((x<<24) & 0xff000000));
+    char textoTipo[LARGO_TEXTO_TIPO];
+    if(consultaRecursiva){
+        printf("\n; QUERY: %d, ANSWER: %d, AUTORITHY: %d, ADDITIONAL: %d\n",1,respuestasA,respuestasAU,respuestasADD);
+
+        printf("\n;; QUESTION SECTION:\n" );
+        printf(";%s\tIN\t%s\n",host,mapearTipo(query_type,textoTipo));
+    }
+
+    /** imprime los RR answer, authority y additional **/
+    imprimirSeccion("ANSWER",answer,respuestasA);
+    imprimirUbicaciones(answer,respuestasA);
+    imprimirSeccion("AUTHORITY",authority,respuestasAU);
+    imprimirSeccion("ADDITIONAL",additional,respuestasADD);
 }
 
-/** modificado del código de RFC 1876 **/
-int precsize_ntoa(uint8_t prec)
+
+/**
+ * Arma en mensaje una consulta estándar por host y query_type, con el bit RD según recursiva.
+ * Devuelve el largo de la consulta. La usan resolverConsulta y los modos masivos (lote.c); la
+ * cabecera y la cola salen de las plantillas ya armadas (plantillas.h).
+ **/
+int armarConsulta(unsigned char *mensaje, char *host, int query_type, int recursiva, unsigned short id)
 {
-    unsigned int poweroften[10] = {1, 10, 100, 1000, 10000, 100000,
-                                   1000000,10000000,100000000,1000000000
-                                  };
-    unsigned long val;
-    int mantissa, exponent;
-
-    mantissa = (int)((prec >> 4) & 0x0f) % 10;
-    exponent = (int)((prec >> 0) & 0x0f) % 10;
-    val = mantissa * poweroften[exponent];
-    val = val / 100;
-
-    return val;
+    /** con -nsec se piden los registros DNSSEC (NSEC, RRSIG): un OPT con el bit DO **/
+    int forma = (recursiva ? PLANTILLA_RECURSIVA : 0) | (negativasActivas() ? PLANTILLA_DNSSEC : 0);
+    return plantillaArmar(mensaje,forma,host,query_type,id);
 }
 
+/** Lee en secciones la respuesta que quedó en mensaje (recibidos < 12: no hubo, y en mensaje está la consulta) **/
+static void leerRespuesta(SECCIONES *secciones, unsigned char *mensaje, int recibidos)
+{
+    /** Me posiciono al final de la sección Question del mensaje DNS para comenzar a leer las respuestas del servidor DNS **/
+    unsigned char *reader = &mensaje[TAM_CABECERA + (strlen((const char*)&mensaje[TAM_CABECERA])+1) + TAM_PREGUNTA];
 
+    /** Las tres secciones comparten el formato de RR: se recorren una sola vez (secciones.c);
+        el RDATA se decodifica según la tabla de tipos (tipos_rr.c) recién cuando hace falta **/
+    int largo = (recibidos < (int)(reader - mensaje)) ? 0 : recibidos;
+    seccionesLeer(secciones,mensaje,largo,reader - mensaje);
+}
 
-/** Imprime resultados de una consulta **/
-void printResults(struct RESOURCE_RECORD answer[],struct RESOURCE_RECORD authority[],struct RESOURCE_RECORD additional[],struct R_DATA_LOC* answerLOC,
-                  int respuestasA,int respuestasAU,int respuestasADD,char* host,int query_type)
+/**
+ * Una respuesta sólo vale si es de la consulta enviada: el mismo ID, QR y la misma pregunta
+ * (RFC 5452 9.1). finPregunta: el byte siguiente al QCLASS de la consulta. El nombre se compara
+ * sin distinguir mayúsculas; el tipo y la clase, byte a byte.
+ **/
+static int respuestaCorresponde(const unsigned char *consulta, int finPregunta, const unsigned char *respuesta, int recibidos)
 {
-    struct sockaddr_in a; // variable utilizada para obtener la direccion IP en un RDATA de tipo A (IPv4)
-    if(strcmp(maneraConsulta,"-r")==0){
-        if (query_type==T_A)
-            printf("\n; QUERY: %d, ANSWER: %d, AUTORITHY: %d, ADDITIONAL: %d\n",1,respuestasA,respuestasAU,respuestasADD);
-        if (query_type==T_MX)
-            printf("\n; QUERY: %d, ANSWER: %d, AUTORITHY: %d, ADDITIONAL: %d\n",1,respuestasA,respuestasAU,respuestasADD);
-        if (query_type==T_LOC)
-            printf("\n; QUERY: %d, ANSWER: %d, AUTORITHY: %d, ADDITIONAL: %d\n",1,respuestasA,respuestasAU,respuestasADD);
-        if (query_type==T_NS)
-            printf("\n; QUERY: %d, ANSWER: %d, AUTORITHY: %d, ADDITIONAL: %d\n",1,respuestasA,respuestasAU,respuestasADD);
+    CABECERA_DNS cabecera;
+    int i;
+    if (recibidos < finPregunta)
+        return 0;
+    cabeceraLeer(respuesta,&cabecera);
+    if (cabecera.id != leer16(consulta) || !cabecera.qr || cabecera.qdcount != 1)
+        return 0;
+    for (i = TAM_CABECERA; i < finPregunta - TAM_PREGUNTA; i++)
+        if (tolower(respuesta[i]) != tolower(consulta[i]))
+            return 0;
+    return memcmp(respuesta + i,consulta + i,TAM_PREGUNTA) == 0;
+}
 
-        printf("\n;; QUESTION SECTION:\n" );
-        if(query_type == T_A)
-            printf(";%s\tIN\tA\n",host);
-        if(query_type == T_MX)
-            printf(";%s\tIN\tMX\n",host);
-        if(query_type == T_LOC)
-            printf(";%s\tIN\tLOC\n",host);
-        if(query_type == T_NS)
-            printf(";%s\tIN\tNS\n",host);
+/**
+ * Clasifica la respuesta leída para la traza (respuesta, delegación, nombre inexistente, etc.),
+ * la guarda en la cache y aprende sus negativas si vino de afuera (remota), y devuelve el estado: el rcode o ESTADO_TIMEOUT.
+ **/
+static int clasificarRespuesta(char *host, int query_type, SECCIONES *secciones, int recibidos, long long rtt,
+                               char *origenRespuesta, int remota)
+{
+    char textoTipo[LARGO_TEXTO_TIPO];
+    int rcode = cabeceraRcode(secciones->mensaje);
+    int respuestasA = seccionesCantidad(secciones,SECCION_ANSWER);
+    if (remota)
+    {
+        negativasAprender(secciones,configuracion.confiarAD);
+        cacheGuardar(secciones);
     }
 
-    int i=0;
+    char *zona = NULL;
+    if (rcode == 3)
+        ultimoResultado = "nxdomain";
+    else if (rcode != 0)
+        ultimoResultado = "error";
+    else if (respuestasA > 0)
+        ultimoResultado = "answer";
+    else if (seccionesCantidad(secciones,SECCION_AUTHORITY) > 0 && secciones->tipo[secciones->inicio[SECCION_AUTHORITY]] == T_NS)
+    {
+        ultimoResultado = "referral";
+        zona = (char*)seccionesRegistros(secciones,SECCION_AUTHORITY)[0].name;
+    }
+    else
+        ultimoResultado = "nodata";
+    /** lo que se contestó localmente no es un paso por la red: origenRespuesta dice de dónde salió **/
+    if (remota)
+        trazaPaso(&trazaConsulta,origenRespuesta,puerto,host,mapearTipo(query_type,textoTipo),rtt,recibidos,rcode,ultimoResultado,zona);
+    else
+        trazaCache(&trazaConsulta,host,mapearTipo(query_type,textoTipo),zona,origenRespuesta);
+
+    ultimoRtt = recibidos < 12 ? -1 : rtt;
+    return recibidos < 12 ? ESTADO_TIMEOUT : rcode;
+}
 
-    /** imprime los RR authorities **/
-    if (respuestasA > 0)
+/** Muestra la respuesta leída en secciones: al escritor con -formato=, o en texto **/
+void imprimirRespuesta(char *host, int query_type, SECCIONES *secciones, int estado)
+{
+    int respuestasA = seccionesCantidad(secciones,SECCION_ANSWER);
+    if(escritorConsultas != NULL)
     {
-        printf("\n;; ANSWER SECTION:\n" );
+        /** -formato=: el resultado va al escritor (JSON Lines, CSV o binario) en lugar del texto **/
+        RESULTADO r = {host, query_type, estado, ultimoRtt, seccionesRegistros(secciones,SECCION_ANSWER), respuestasA};
+        escritorResultado(escritorConsultas,&r);
+    }
+    else printResults(seccionesRegistros(secciones,SECCION_ANSWER),seccionesRegistros(secciones,SECCION_AUTHORITY),
+                          seccionesRegistros(secciones,SECCION_ADDITIONAL),respuestasA,
+                          seccionesCantidad(secciones,SECCION_AUTHORITY),seccionesCantidad(secciones,SECCION_ADDITIONAL),host,query_type);
+}
 
-        for(i=0 ; i < respuestasA ; i++)
+/**
+ * En primera instancia crea una consulta con los datos suministrados.
+ * Luego envía dicho paquete y recibe dentro del mismo "buffer" la respuesta.
+ * Obtiene en secciones cada una de las respuestas (en sus 3 versiones), sin límite de cantidad.
+ * Finalmente imprime el resultado.
+ **/
+int resolverConsulta(char *host , int query_type,SECCIONES *secciones,int print)
+{
+    char textoTipo[LARGO_TEXTO_TIPO];
+    /** static: secciones apunta dentro del mensaje y se usa después de retornar,
+        hasta la próxima llamada **/
+    static unsigned char mensajeDNS[65536];
+    int s4 = -1, s6 = -1;   /** uno por familia, se abren al primer servidor de cada una **/
+
+    DIRECCION dest, consultado, origen;
+
+    int largoConsulta = armarConsulta(mensajeDNS,host,query_type,consultaRecursiva,aleatorioId());
+
+    long long enviado = trazaMicrosegundos(); // para medir el RTT en la traza
+    char *origenRespuesta = servidorDNS;
+    int remota = 0;
+
+    /** si el nombre pertenece a una zona cargada con -zona=, la respuesta se arma localmente **/
+    int recibidos = zonaResponder(mensajeDNS,largoConsulta,mensajeDNS,sizeof(mensajeDNS));
+    if (recibidos > 0)
+        origenRespuesta = "zona local";
+    /** con -nsec, un nombre que cae en un hueco de NSEC/NSEC3 ya conocido se contesta sin preguntar **/
+    else if ((recibidos = negativasResponder(mensajeDNS,largoConsulta,mensajeDNS,sizeof(mensajeDNS))) > 0)
+        origenRespuesta = "negativa (RFC 8198)";
+    /** con -cache, lo que ya se respondió (y sigue vigente) no se vuelve a preguntar **/
+    else if ((recibidos = cacheResponder(mensajeDNS,largoConsulta,mensajeDNS,sizeof(mensajeDNS))) > 0)
+        origenRespuesta = "cache";
+    else
+    {
+        /** attempts: y rotate de resolv.conf: cada intento recorre los servidores (con @servidor, el único)
+            empezando por el que toca; un timeout, SERVFAIL o REFUSED pasa al siguiente, como en la libc **/
+        int cantidad = servidorDeConfiguracion ? configuracion.cantidadServidores : 1;
+        int primero = servidorDeConfiguracion ? configuracionPrimerServidor(&configuracion) : 0, intento;
+        unsigned char consulta[512];   /** copia para los reintentos: la respuesta pisa mensajeDNS **/
+        memcpy(consulta,mensajeDNS,largoConsulta);
+        int finPregunta = TAM_CABECERA + largoNombreDNS(consulta + TAM_CABECERA) + TAM_PREGUNTA;
+        remota = 1;
+        recibidos = -1;
+        for (intento = 0; intento < configuracion.intentos * cantidad; intento++)
         {
-            if(query_type == T_A && ntohs(answer[i].resource->type) == T_A) /** T_A (IPv4) **/
+            if (servidorDeConfiguracion)
+                origenRespuesta = configuracion.servidores[(primero + intento) % cantidad];
+            if (direccionDesdeTexto(&dest,origenRespuesta,atoi(puerto)) < 0)
             {
-                long *p;
-                p=(long*)answer[i].rdata;
-                a.sin_addr.s_addr=(*p);
-                printf(";%s.\tIN\tA\t%s\n",answer[i].name,inet_ntoa(a.sin_addr));
+                printf("ERROR: %s no es una dirección IPv4 ni IPv6\n",origenRespuesta);
+                exit(-1);
             }
-            else if(query_type == T_MX && ntohs(answer[i].resource->type)==T_MX) /** MX **/
+            int *s = dest.sa.sa_family == AF_INET6 ? &s6 : &s4;
+            if (*s < 0)
             {
-                printf(";%s.\tIN\tMX\t%s\n",answer[i].name,answer[i].rdata);
-            }
-            else if(query_type == T_LOC) /** LOC **/
-            {
-                /**
-                LOC ejemplo: systemadmin.es
-                Respuesta del dig:
-                ;; ANSWER SECTION:
-                systemadmin.es.     3248    IN  LOC 41 24 0.499 N 2 10 52.530 E 47.00m 30m 10m 10m
-                Del Wireshark:
-                Version: 0                                  // 00 (hexadecimal)
-                Size: 30 m                                  // 33
-                Horizontal precision: 10 m                  // 13
-                Vertical precision: 10 m                    // 13
-                Latitude: 41 deg 24 min 0.499 sec N         // 88 e2 2d 73
-                Longitude: 2 deg 10 min 52.530 sec E        // 80 77 d1 f2
-                Altitude: 47 m                              // 00 98 a8 dc
-                **/
-
-                uint32_t latLit = ntohl(answerLOC->latitude);
-                int32_t latval = (littleToBigEndian(latLit) - ((uint32_t)1<<31));
-                uint32_t latdeg, latmin, latsec, latsecfrac;
-                char northsouth;
-                if (latval < 0)
-                {
-                    northsouth = 'S';
-                    latval = -latval;
-                }
-                else
-                    northsouth = 'N';
-
-                latsecfrac = latval % 1000;
-                latval = latval / 1000;
-                latsec = latval % 60;
-                latval = latval / 60;
-                latmin = latval % 60;
-                latval = latval / 60;
-                latdeg = latval;
-
-                uint32_t lonLit = ntohl(answerLOC->longitude);
-                int32_t longval = (littleToBigEndian(lonLit) - ((uint32_t)1<<31));
-                uint32_t longdeg, longmin, longsec, longsecfrac;
-                char eastwest;
-                if (longval < 0)
-                {
-                    eastwest = 'W';
-                    longval = -longval;
-                }
-                else
-                    eastwest = 'E';
-
-                longsecfrac = longval % 1000;
-                longval = longval / 1000;
-                longsec = longval % 60;
-                longval = longval / 60;
-                longmin = longval % 60;
-                longval = longval / 60;
-                longdeg = longval;
-
-
-                int altmeters, altfrac, altsign;
-                int32_t altval;
-                int referencealt = 100000 * 100;
-
-                int32_t alt = littleToBigEndian(ntohl(answerLOC->altitude));
-
-                if (alt < referencealt)   /* below WGS 84 spheroid */
+                *s = socket(dest.sa.sa_family , SOCK_DGRAM , IPPROTO_UDP);
+                if (*s < 0)
                 {
-                    altval = referencealt - alt;
-                    altsign = -1;
+                    printf("*** ERROR - socket() falló ***\n");
+                    exit(-1);
                 }
-                else
-                {
-                    altval = alt - referencealt;
-                    altsign = 1;
-                }
-                altfrac = altval % 100;
-                altmeters = (altval / 100) * altsign;
-
-                printf(";%s.\tIN\tLOC\t %d %.2d %.2d.%.3d %c %d %d %.2d.%.3d %c %d.%.2dm %im %im %im\n",answer[i].name,latdeg, latmin, latsec, latsecfrac,northsouth,longdeg, longmin, longsec, longsecfrac,eastwest,altmeters,altfrac,precsize_ntoa(answerLOC->size),precsize_ntoa(answerLOC->horiz_pre),precsize_ntoa(answerLOC->vert_pre));
-
             }
-            else if(query_type == T_NS && ntohs(answer[i].resource->type)==T_NS)
-                printf(";%s.\tIN\tNS\t%s\n",answer[i].name,answer[i].rdata);
-        }
-    }
-    /** imprime los RR authorities **/
-    if (respuestasAU > 0 )
-    {
-        printf("\n;; AUTHORITY SECTION:\n" );
-
-        for( i=0 ; i < respuestasAU ; i++)
-        {
-            printf(";%s.\tIN\t%s\t%s\n",authority[i].name,mapearTipo(ntohs(authority[i].resource->type)),authority[i].rdata);
-        }
-    }
+            /** cada salto respeta el ritmo compartido con el resto del proceso (ver ritmo.h) **/
+            consultado = dest;
+            ritmoEsperarYTomar(&consultado);
+            escribir16(consulta,aleatorioId());
+            enviado = trazaMicrosegundos();
+            if( sendto(*s,(char*)consulta,largoConsulta,0,&dest.sa,direccionLargo(&dest)) < 0)
+            {
+                perror("sendto error");
+            }
 
-    /** imprime los RR additional **/
-    if (respuestasADD > 0 )
-    {
-        printf("\n;; ADDITIONAL SECTION:\n");
-        for(i=0; i < respuestasADD ; i++)
-        {
-            if(ntohs(additional[i].resource->type)==T_A)    /** T_A (IPv4) **/
+            /** hasta el timeout de resolv.conf (options timeout:, 5 s por omisión) se espera la respuesta de
+                esta consulta: lo que llega de otra dirección o no corresponde se descarta sin cortar la espera **/
+            long long limite = enviado + configuracion.timeout * 1000000LL, resta;
+            recibidos = -1;
+            while (recibidos < 0 && (resta = limite - trazaMicrosegundos()) > 0)
             {
-                long *p;
-                p=(long*)additional[i].rdata;
-                a.sin_addr.s_addr=(*p);
-                printf(";%s.\tIN\tA\t%s\n",additional[i].name,inet_ntoa(a.sin_addr));
+                struct pollfd espera = {*s, POLLIN, 0};
+                if (poll(&espera,1,(resta + 999) / 1000) <= 0)
+                    break;
+                socklen_t largoOrigen = sizeof(origen);
+                int largo = recvfrom(*s,(char*)mensajeDNS,65536,0,&origen.sa,&largoOrigen);
+                if (largo >= 0 && direccionIgual(&origen,&dest) && respuestaCorresponde(consulta,finPregunta,mensajeDNS,largo))
+                    recibidos = largo;
             }
-            if(ntohs(additional[i].resource->type)==28)
+            if(recibidos < 0 && intento + 1 == configuracion.intentos * cantidad)
             {
-                printf("ipv6!!!!\n");
+                fprintf(stderr,"recvfrom error: sin respuesta de %s\n",origenRespuesta);
             }
-
+            int resultado = recibidos < 12 ? RITMO_TIMEOUT : ritmoClasificarRcode(cabeceraRcode(mensajeDNS));
+            ritmoResultado(&consultado,resultado);
+            if (resultado == RITMO_RESPUESTA)
+                break;
+            if (intento + 1 < configuracion.intentos * cantidad)
+                trazaPaso(&trazaConsulta,origenRespuesta,puerto,host,mapearTipo(query_type,textoTipo),trazaMicrosegundos() - enviado,
+                          recibidos < 0 ? 0 : recibidos,resultado == RITMO_TIMEOUT ? 0 : cabeceraRcode(mensajeDNS),
+                          resultado == RITMO_TIMEOUT ? "timeout" : "error",NULL);
         }
+        if (recibidos < 12)
+            memcpy(mensajeDNS,consulta,largoConsulta);  /** sin respuesta: la pregunta sigue en su lugar **/
     }
+    long long rtt = trazaMicrosegundos() - enviado;
+    if (s4 >= 0)
+        close(s4);
+    if (s6 >= 0)
+        close(s6);
+
+    leerRespuesta(secciones,mensajeDNS,recibidos);
+    int estado = clasificarRespuesta(host,query_type,secciones,recibidos,rtt,origenRespuesta,remota);
+    if(print)
+        imprimirRespuesta(host,query_type,secciones,estado);
+    return estado;
 }
 
+/** Estado de cada candidato de la lista de búsqueda mientras se resuelven todos juntos **/
+typedef struct
+{
+    char *nombre;
+    int tipo;
+    unsigned char consulta[512];    // copia para reenviarla al servidor siguiente
+    int largoConsulta;
+    int intento;                    // envíos hechos, sobre intentos * servidores
+    int porEnviar;                  // 1 si espera lugar para (re)enviarse
+    DIRECCION destino;
+    int terminado;
+    int estado;                     // rcode, o ESTADO_TIMEOUT
+    int respuestas;                 // registros en answer
+    char *resultado;                // clasificación para la traza (ver traza.h)
+    unsigned char *respuesta;       // copia de la respuesta, del pool de paquetes (el motor la presta sólo durante el callback)
+    int reservada;                  // 1 si el pool no tenía lugar y la copia salió de malloc
+    int largo;
+    long long rtt;
+} CANDIDATO_BUSQUEDA;
+
+/** Servidor del intento actual del candidato: el de @servidor, o el que toca de resolv.conf **/
+static void destinoCandidato(CANDIDATO_BUSQUEDA *c, int primero)
+{
+    direccionDesdeTexto(&c->destino,servidorDeConfiguracion
+                                     ? configuracion.servidores[(primero + c->intento) % configuracion.cantidadServidores]
+                                     : servidorDNS,atoi(puerto));
+}
 
-/**
- * En primera instancia crea una consulta con los datos suministrados.
- * Luego envía dicho paquete y recibe dentro del mismo "buffer" la respuesta.
- * Obtiene en estructuras definidas cada una de las respuestas (en sus 3 versiones).
- * Finalmente imprime el resultado.
- **/
-int resolverConsulta(char *host , int query_type,struct RESOURCE_RECORD answer[],struct RESOURCE_RECORD authority[],struct RESOURCE_RECORD additional[],
-                    struct R_DATA_LOC* answerLOC,int* respuestasA,int* respuestasAU,int* respuestasADD,int print)
+/** Deja el resultado del candidato; mensaje con recibidos < 12 es la consulta sin respuesta **/
+static void terminarCandidato(CANDIDATO_BUSQUEDA *c, unsigned char *mensaje, int recibidos, long long rtt, char *origen, int remota)
 {
-    unsigned char mensajeDNS[65536],*qname,*reader;
-    int i , j , stop , s;
-
-    struct sockaddr_in dest;
-
-    seccion_header *dns = NULL;
-    seccion_question *qinfo = NULL;
-
-    s = socket(AF_INET , SOCK_DGRAM , IPPROTO_UDP);
-
-    if (s < 0)
-          {
-            printf("*** ERROR - socket() falló ***\n");
-            exit(-1);
-          }
-
-    dest.sin_family = AF_INET;
-    dest.sin_port = htons(atoi(puerto));
-    dest.sin_addr.s_addr = inet_addr(servidorDNS);
-
-    /** Me posiciono al comienzo del mensaje DNS y comienzo a "rellenar" la sección Header **/
-    dns = (seccion_header *)&mensajeDNS;
-    dns->id = (unsigned short) htons(getpid());
-    dns->qr = 0;
-    dns->opcode = 0; // query standard
-    dns->aa = 0;
-    dns->tc = 0; // este mensaje no está truncado
-    if (strcmp(maneraConsulta,"-r")==0)
+    static SECCIONES auxiliar;
+    leerRespuesta(&auxiliar,mensaje,recibidos);
+    c->estado = clasificarRespuesta(c->nombre,c->tipo,&auxiliar,recibidos,rtt,origen,remota);
+    c->respuestas = seccionesCantidad(&auxiliar,SECCION_ANSWER);
+    c->resultado = ultimoResultado;
+    c->largo = recibidos < 12 ? c->largoConsulta : recibidos;
+    if ((c->respuesta = paqueteTomar(c->largo)) == NULL)
     {
-        dns->rd = 1; /** Bit Recursion Desired **/
-        dns->ra = 1;
+        c->respuesta = (unsigned char*)malloc(c->largo);
+        c->reservada = 1;
     }
-    else
+    memcpy(c->respuesta,mensaje,c->largo);
+    if (recibidos < 12)
+        c->largo = -1;
+    c->rtt = recibidos < 12 ? -1 : rtt;
+    c->terminado = 1;
+}
+
+static void respuestaCandidato(void *contexto, unsigned char *respuesta, int largo, int inicioRespuestas, long long rtt, int estado)
+{
+    char textoTipo[LARGO_TEXTO_TIPO];
+    CANDIDATO_BUSQUEDA *c = (CANDIDATO_BUSQUEDA*)contexto;
+    char origen[LARGO_TEXTO_DIRECCION];
+    int resultado = estado == MOTOR_TIMEOUT ? RITMO_TIMEOUT : ritmoClasificarRcode(cabeceraRcode(respuesta));
+    int intentos = configuracion.intentos * (servidorDeConfiguracion ? configuracion.cantidadServidores : 1);
+    (void)inicioRespuestas;
+    direccionATexto(&c->destino,origen);
+    /** como en resolverConsulta: un timeout, SERVFAIL o REFUSED pasa al servidor siguiente **/
+    if (resultado != RITMO_RESPUESTA && ++c->intento < intentos)
     {
-        dns->rd = 0;
-        dns->ra = 0;
+        trazaPaso(&trazaConsulta,origen,puerto,c->nombre,mapearTipo(c->tipo,textoTipo),rtt,largo,
+                  resultado == RITMO_TIMEOUT ? 0 : cabeceraRcode(respuesta),resultado == RITMO_TIMEOUT ? "timeout" : "error",NULL);
+        c->porEnviar = 1;
+        return;
     }
-    dns->z = 0;
-    dns->rcode = 0;
-    dns->qdcount = htons(1); // solo 1 consulta
-    dns->ancount = 0;
-    dns->nscount = 0;
-    dns->arcount = 0;
-    /** Terminé de "rellenar" la sección Header **/
-
-    /** Me posiciono al final de la sección Header del mensaje DNS y comienzo a "rellenar" la sección Question **/
-    qname =(unsigned char*)&mensajeDNS[sizeof(seccion_header)];
-
-    /** Inserto en qname, el host que me pasaron (si es solo un . debo preguntar por los servers root */
-    cambiarAlFormatoNombreDNS(qname , host);
-
-    qinfo =(seccion_question*)&mensajeDNS[sizeof(seccion_header) + (strlen((const char*)qname) + 1)];
-    qinfo->qtype = htons(query_type);
-    qinfo->qclass = htons(1);
+    terminarCandidato(c,estado == MOTOR_TIMEOUT ? c->consulta : respuesta,estado == MOTOR_TIMEOUT ? -1 : largo,rtt,origen,1);
+}
 
-    /** Terminé de "rellenar" la sección Question **/
+/** Un candidato con respuestas, o que falla de otra forma que NXDOMAIN, NODATA o SERVFAIL, decide la búsqueda **/
+static int cortaBusqueda(int estado, int respuestas)
+{
+    return (estado == 0 && respuestas > 0) || (estado != 0 && estado != 2 && estado != 3);
+}
 
-    if( sendto(s,(char*)mensajeDNS,sizeof(seccion_header) + (strlen((const char*)qname)+1) + sizeof(seccion_question),0,(struct sockaddr*)&dest,sizeof(dest)) < 0)
+/**
+ * El candidato que decide la búsqueda, en el orden de la lista: el primero con respuestas, o el
+ * primero que falla de una manera que corta la búsqueda (lo que no es NXDOMAIN, NODATA ni
+ * SERVFAIL). -1 si todavía falta que termine alguno anterior.
+ **/
+static int candidatoElegido(CANDIDATO_BUSQUEDA *c, int cantidad)
+{
+    int i;
+    for (i = 0; i < cantidad; i++)
     {
-        perror("sendto error");
+        if (!c[i].terminado)
+            return -1;
+        if (cortaBusqueda(c[i].estado,c[i].respuestas))
+            return i;
     }
+    return cantidad - 1;
+}
 
-    if(recvfrom (s,(char*)mensajeDNS , 65536 , 0 , (struct sockaddr*)&dest , (socklen_t*)&i ) < 0)
+/**
+ * Resuelve host con la lista de búsqueda de resolv.conf (res_search). Los candidatos salen
+ * todos juntos por un motor y gana el primero de la lista que responde, así que un nombre
+ * corto cuesta un RTT y no uno por cada dominio de búsqueda probado antes; en cuanto se decide,
+ * las consultas de los candidatos que siguen se cancelan. Deja en secciones la respuesta del
+ * elegido, la imprime y devuelve su nombre (en elegido).
+ **/
+char *resolverConBusqueda(char *host, int query_type, SECCIONES *secciones, char *elegido)
+{
+    /** static: secciones apunta dentro de la respuesta elegida, como en resolverConsulta **/
+    static unsigned char respuestaElegida[65536];
+    char candidatos[MAX_DOMINIOS_BUSQUEDA + 1][256];
+    int cantidad = configuracionCandidatos(&configuracion,host,candidatos), i, ganador;
+    if (cantidad == 1)
     {
-        perror("recvfrom error");
+        /** nada que paralelizar **/
+        strcpy(elegido,candidatos[0]);
+        resolverConsulta(elegido,query_type,secciones,1);
+        return elegido;
     }
 
-    dns = (seccion_header*) mensajeDNS;
-
-    /** Me posiciono al final de la sección Question del mensaje DNS para comenzar a leer las respuestas del servidor DNS **/
-    reader = &mensajeDNS[sizeof(seccion_header) + (strlen((const char*)qname)+1) + sizeof(seccion_question)];
-
-    /** -------- COMIENZO A LEER LA SECCION ANSWER -------- **/
-
-    /** descomentar para testear, cantidad de respuestas y sus tipos recibidas:
-        printf("\nrespuestasA: %i\n",ntohs(dns->ancount));
-
-        printf("\nrespuestasAU: %i\n",ntohs(dns->nscount));
-
-        printf("\nrespuestasADD: %i\n",ntohs(dns->arcount));
-    */
-    stop=0;
-    //repito tantas veces como "ancount" tenga, es decir la cantidad de respuestas
-    for(i=0; i<ntohs(dns->ancount); i++)
+    MOTOR *motor = motorCrear(cantidad,0,configuracion.timeout * 1000,0);
+    if (motor == NULL)
     {
-        *(respuestasA)+=1;
-        //leo el nombre de la respuesta, en stop tengo el largo de dicho nombre
-        answer[i].name=leerNombre(reader,mensajeDNS,&stop);
-        reader = reader + stop;                             //stop indica el offset que debo sumar al punterlo reader
-
-        /** obtengo el recurso, es decir, los datos de la respuesta **/
-
-        answer[i].resource = (struct R_DATA*)(reader);
-        reader = reader + sizeof(struct R_DATA);
-
-        if(ntohs(answer[i].resource->type) == T_NS) { /** NS **/
-            reader-=2;
-            answer[i].rdata=leerNombre(reader,mensajeDNS,&stop);
-            reader+=stop;
-
+        /** sin motor (sin socket, o sin buffers en el pool de paquetes) los candidatos se prueban de a uno **/
+        int estado = ESTADO_TIMEOUT;
+        for (i = 0; i < cantidad; i++)
+        {
+            strcpy(elegido,candidatos[i]);
+            estado = resolverConsulta(elegido,query_type,secciones,0);
+            if (cortaBusqueda(estado,seccionesCantidad(secciones,SECCION_ANSWER)))
+                break;
         }
-        else if(ntohs(answer[i].resource->type) == T_A) /** T_A (IPv4) **/
-        {   if(ntohs(dns->ancount)==1)reader-=2;         //si leo uno solo no tengo porque restarlo, problemas con leerNombre
-            answer[i].rdata = (unsigned char*)malloc(ntohs(answer[i].resource->rdlength));
+        imprimirRespuesta(elegido,query_type,secciones,estado);
+        return elegido;
+    }
+    CANDIDATO_BUSQUEDA *c = (CANDIDATO_BUSQUEDA*)calloc(cantidad,sizeof(CANDIDATO_BUSQUEDA));
+    int primero = servidorDeConfiguracion ? configuracionPrimerServidor(&configuracion) : 0;
+    unsigned char *local = paqueteTomar(MAX_PAQUETE), *localReservado = NULL;
+    if (local == NULL)
+        local = localReservado = (unsigned char*)malloc(MAX_PAQUETE);
+    for (i = 0; i < cantidad; i++)
+    {
+        int largoLocal;
+        c[i].nombre = candidatos[i];
+        c[i].tipo = query_type;
+        c[i].largoConsulta = armarConsulta(c[i].consulta,candidatos[i],query_type,1,0);
+        /** las zonas de -zona=, las negativas de -nsec y la cache contestan sin salir **/
+        memcpy(local,c[i].consulta,c[i].largoConsulta);
+        if ((largoLocal = zonaResponder(local,c[i].largoConsulta,local,MAX_PAQUETE)) > 0)
+            terminarCandidato(&c[i],local,largoLocal,0,"zona local",0);
+        else if ((largoLocal = negativasResponder(local,c[i].largoConsulta,local,MAX_PAQUETE)) > 0)
+            terminarCandidato(&c[i],local,largoLocal,0,"negativa (RFC 8198)",0);
+        else if ((largoLocal = cacheResponder(local,c[i].largoConsulta,local,MAX_PAQUETE)) > 0)
+            terminarCandidato(&c[i],local,largoLocal,0,"cache",0);
+        else
+            c[i].porEnviar = 1;
+    }
+    if (localReservado != NULL)
+        free(localReservado);
+    else
+        paqueteDevolver(local);
 
-            for(j=0 ; j<ntohs(answer[i].resource->rdlength) ; j++)
+    while ((ganador = candidatoElegido(c,cantidad)) < 0)
+    {
+        for (i = 0; i < cantidad; i++)
+            if (c[i].porEnviar)
             {
-                answer[i].rdata[j]=reader[j];
+                destinoCandidato(&c[i],primero);
+                if (motorPuedeEnviarA(motor,&c[i].destino)
+                        && motorEnviar(motor,&c[i].destino,c[i].consulta,c[i].largoConsulta,respuestaCandidato,&c[i]) == 0)
+                    c[i].porEnviar = 0;
             }
-
-            answer[i].rdata[ntohs(answer[i].resource->rdlength)] = '\0';        // introduzco el caracter terminador
-
-            reader = reader + ntohs(answer[i].resource->rdlength);              // agrego al reader un offset tan largo como el largo de los datos dentro del RR
-        }
+        motorProcesar(motor,10);
+    }
+    /** lo que queda en vuelo ya no cambia el resultado **/
+    int cancelados = 0;
+    for (i = 0; i < cantidad; i++)
+        cancelados += motorCancelar(motor,&c[i]);
+    motorDestruir(motor);
+
+    strcpy(elegido,candidatos[ganador]);
+    if (c[ganador].largo > 0)
+        memcpy(respuestaElegida,c[ganador].respuesta,c[ganador].largo);
+    else
+        memcpy(respuestaElegida,c[ganador].respuesta,c[ganador].largoConsulta);
+    leerRespuesta(secciones,respuestaElegida,c[ganador].largo);
+    ultimoResultado = c[ganador].resultado;
+    ultimoRtt = c[ganador].rtt;
+    if (escritorConsultas == NULL)
+        printf("\n;; lista de búsqueda: %d candidatos en paralelo, %d cancelados, respuesta para %s\n",cantidad,cancelados,elegido);
+    imprimirRespuesta(elegido,query_type,secciones,c[ganador].estado);
+    for (i = 0; i < cantidad; i++)
+        if (c[i].reservada)
+            free(c[i].respuesta);
         else
-            /** MX **/
-            if(ntohs(answer[i].resource->type) == T_MX)
-            {
-                answer[i].rdata = leerNombre(reader,mensajeDNS,&stop);
-                reader = reader + stop;
-            }
-            else
-                /** -LOC **/
-                if(ntohs(answer[i].resource->type) == T_LOC)
-                {
-                    answer[i].rdata = (unsigned char*)malloc(ntohs(answer[i].resource->rdlength));
-                    reader = reader - 2;
-                    int k = 0;
-                    answerLOC->version =reader[k];
-                    reader = reader + sizeof(answerLOC->version);
-                    k = 0;
-                    answerLOC->size =reader[k];
-                    reader = reader + sizeof(answerLOC->size);
-                    k = 0;
-                    answerLOC->horiz_pre=reader[k];
-                    reader = reader + sizeof(answerLOC->horiz_pre);
-                    k = 0;
-                    answerLOC->vert_pre=reader[k];
-                    reader = reader + sizeof(answerLOC->vert_pre);
-                    k = 0;
-                    int oct1 = reader[k];
-                    k++;
-                    int oct2 = reader[k];
-                    k++;
-                    int oct3 = reader[k];
-                    k++;
-                    int oct4 = reader[k];
-                    char lat[4]; /** 4 octetos = 4 bytes **/
-                    /** Hexadecimal en string a partir de los octetos **/
-                    sprintf(lat,"%.2x%.2x%.2x%.2x", oct1,oct2,oct3,oct4);
-                    /** De string en hexa a entero de 32 bits **/
-                    uint32_t latNum = ((uint32_t) strtoimax(lat, NULL, 16));
-                    answerLOC->latitude = latNum;
-
-                    reader = reader + sizeof(answerLOC->latitude);
-                    k = 0;
-                    oct1 = reader[k];
-                    k++;
-                    oct2 = reader[k];
-                    k++;
-                    oct3 = reader[k];
-                    k++;
-                    oct4 = reader[k];
-                    char lon[4];
-                    /** Hexadecimal en string a partir de los octetos **/
-                    sprintf(lon,"%.2x%.2x%.2x%.2x", oct1,oct2,oct3,oct4);
-                    /** De string en hexa a entero de 32 bits **/
-                    int32_t lonNum = (int32_t)strtoimax(lon, NULL, 16);
-                    answerLOC->longitude = lonNum;
-                    reader = reader + sizeof(answerLOC->longitude);
-                    k = 0;
-                    oct1 = reader[k];
-                    k++;
-                    oct2 = reader[k];
-                    k++;
-                    oct3 = reader[k];
-                    k++;
-                    oct4 = reader[k];
-                    char alt[4];
-                    /** Hexadecimal en string a partir de los octetos **/
-                    sprintf(alt,"%.2x%.2x%.2x%.2x", oct1,oct2,oct3,oct4);
-                    /** De string en hexa a entero de 32 bits **/
-                    uint32_t altNum = (uint32_t)strtoimax(alt, NULL, 16);
-                    answerLOC->altitude = altNum;
-                    reader = reader + sizeof(answerLOC->altitude);
-                }
-                else
-                    if (strcmp(maneraConsulta,"-t")==0 && ntohs(answer[i].resource->type) == T_NS)
-                    {
-                        reader=reader - 2;
+            paqueteDevolver(c[i].respuesta);
+    free(c);
+    return elegido;
+}
 
-                        answer[i].rdata = leerNombre(reader,mensajeDNS,&stop);
-                        reader = reader + stop;
+/** Imprime los servidores conocidos de una zona, tal como están en la cache de delegaciones **/
+void imprimirDelegacion(char *zona)
+{
+    SERVIDOR_DELEGACION servidores[MAX_SERVIDORES_DELEGACION];
+    int i, j, cantidad = delegacionListar(zona,servidores,MAX_SERVIDORES_DELEGACION);
+    char ns[256];
 
-                    }
+    printf("\n;; DELEGACION INICIAL (cache, TTL restante %u):\n",delegacionRestante(zona));
+    for (i = 0; i < cantidad; i++)
+    {
+        /** un NS con A y AAAA ocupa dos entradas, pero es un solo NS **/
+        for (j = 0; j < i && servidores[j].nombre != servidores[i].nombre; j++);
+        if (j == i)
+            printf(";%s.\tIN\tNS\t%s\n",strcmp(zona,".") == 0 ? "" : zona,nombreATexto(servidores[i].nombre,ns));
     }
+    printf("\n;; ADDITIONAL SECTION:\n");
+    for (i = 0; i < cantidad; i++)
+        printf(";%s.\tIN\t%s\t%s\n",nombreATexto(servidores[i].nombre,ns),strchr(servidores[i].ip,':') ? "AAAA" : "A",servidores[i].ip);
+}
 
-    /** -------- FIN LECTURA DE LA SECCION ANSWER -------- **/
+/** Compara dos nombres sin distinguir mayúsculas y sin tener en cuenta el punto final **/
+int mismoNombre(const char *a,const char *b)
+{
+    int largoA = strlen(a), largoB = strlen(b);
+    if (largoA > 0 && a[largoA-1] == '.')
+        largoA--;
+    if (largoB > 0 && b[largoB-1] == '.')
+        largoB--;
+    return largoA == largoB && strncasecmp(a,b,largoA) == 0;
+}
 
-    /** -------- COMIENZO A LEER LA SECCION AUTHORITY -------- **/
+/**
+ * Sigue la cadena de alias (CNAME) que comienza en host dentro de la sección answer.
+ * Devuelve el nombre canónico al final de la cadena, o NULL si host no es un alias.
+ * *resuelto queda en 1 si la sección ya trae registros del tipo pedido para ese nombre.
+ **/
+char *destinoCNAME(char *host,int query_type,struct RESOURCE_RECORD answer[],int respuestasA,int *resuelto)
+{
+    char *actual = host, *canonico = NULL;
+    int i, saltos;
 
-    for(i=0; i<ntohs(dns->nscount); i++)
+    *resuelto = 0;
+    for (saltos = 0; saltos <= MAX_CNAME; saltos++)
     {
+        char *siguiente = NULL;
+        for (i = 0; i < respuestasA; i++)
+        {
+            if (!mismoNombre((char*)answer[i].name,actual))
+                continue;
+            if (answer[i].resource.type == query_type)
+            {
+                *resuelto = 1;
+                return canonico;
+            }
+            if (answer[i].resource.type == T_CNAME)
+                siguiente = (char*)answer[i].rdata;
+        }
+        if (siguiente == NULL)
+            break;
+        actual = canonico = siguiente;
+    }
+    return canonico;
+}
 
-        *(respuestasAU)+=1;
-        authority[i].name = leerNombre(reader,mensajeDNS,&stop);
-        reader+=stop;
-
-        authority[i].resource=(struct R_DATA*)(reader);
-        reader+=sizeof(struct R_DATA);
-
-        reader = reader - 2; // el readname nos deja corrido dos bytes
+/** Imprime la delegación más cercana al nombre, desde la que empieza (o sigue) la resolución iterativa **/
+void mostrarDelegacionInicial(const char *host)
+{
+    char zona[256];
+    SERVIDOR_DELEGACION inicial;
+    if (delegacionBuscar(host,zona,&inicial))
+        imprimirDelegacion(zona);
+}
 
-        authority[i].rdata = leerNombre(reader,mensajeDNS,&stop);
-        reader+=stop;
+/** Observador de la resolución iterativa: imprime cada salto como lo hacía resolverConsulta **/
+void mostrarPasoIterativo(void *contexto, const PASO_ITERATIVO *paso)
+{
+    (void)contexto;
+    if (paso->profundidad > 0)
+        printf("\n;; (dirección del servidor de nombres %s, que vino sin glue)\n",paso->nombre);
+    printResults(paso->answer,paso->authority,paso->additional,paso->respuestasA,paso->respuestasAU,
+                 paso->respuestasADD,(char*)paso->nombre,paso->tipo);
+    if (paso->canonico != NULL)
+    {
+        printf("\n;; %s es un alias de %s, se continúa con el nombre canónico\n",paso->nombre,paso->canonico);
+        mostrarDelegacionInicial(paso->canonico);
     }
+    printf("\n-------------------------------------------------------------------------\n");
+}
 
-    /** -------- FIN LECTURA DE LA SECCION AUTHORITY -------- **/
-
-    /** -------- COMIENZO A LEER LA SECCION ADDITIONAL -------- **/
+/** Fin de la resolución iterativa pedida por línea de comandos **/
+void finConsultaIterativa(void *contexto, const RESULTADO *resultado)
+{
+    (void)contexto;
+    printf("\n;; %s: %s, %d registros en %.1f ms\n",resultado->consulta,
+           resultado->estado == ESTADO_TIMEOUT ? "sin respuesta de ningún servidor"
+           : (resultado->estado == 0 && resultado->cantidad == 0) ? "NODATA" : mapearRcode(resultado->estado),
+           resultado->cantidad,resultado->rtt / 1000.0);
+}
 
-    for(i=0; i<ntohs(dns->arcount); i++)
+/**
+ * Consulta iterativa: una sola resolución de la máquina de estados de iterativo.c, que empieza
+ * en la delegación más cercana que se conozca y se muestra salto por salto (la resolución lleva
+ * su propia traza).
+ **/
+void resolverConsultaIterativo (char *host , int query_type)
+{
+    ITERATIVO *it = iterativoCrear(1,puerto);
+    if (it == NULL)
     {
-        *(respuestasADD)+=1;
-        additional[i].name=leerNombre(reader,mensajeDNS,&stop);
-        reader+=stop;
-
+        perror("socket error");
+        return;
+    }
+    iterativoObservar(it,mostrarPasoIterativo,NULL);
+
+    mostrarDelegacionInicial(host);
+    printf("\n-------------------------------------------------------------------------\n");
+    if (iterativoResolver(it,host,query_type,finConsultaIterativa,NULL) < 0)
+        printf("ERROR: nombre no válido %s\n",host);
+    while (iterativoPendientes(it) > 0)
+        iterativoProcesar(it,100);
+    iterativoDestruir(it);
+    printf("\n");
+}
+/** Interpreta el parámetro @servidor[:puerto] y carga servidorDNS y puerto; una IPv6 con
+    puerto va entre corchetes (@[2001:db8::53]:5300), sin puerto puede ir sola (@2001:db8::53) **/
+void leerServidor(char *parametro)
+{
+    int largoParametro = strlen(parametro);
 
-        additional[i].resource=(struct R_DATA*)(reader);    // obtengo el recurso
-        reader+=sizeof(struct R_DATA);
-        reader-= 2;                                          // leer nombre nos deja dos bytes desfasados.
+    char* aux;
+    if (parametro[1] == '[' && (aux=strchr(parametro,']')) != NULL)
+    {
+        servidorDNS = cortarString(parametro,3,largoParametro-strlen(aux)-2);
+        if (aux[1] == ':')
+            puerto = cortarString(parametro,largoParametro-strlen(aux)+3,largoParametro);
+    }
+    else if ((aux=strchr(parametro,':'))!= NULL && strchr(aux+1,':') == NULL)   /** Chequeo si se ingresó puerto del servidor **/
+    {
+        servidorDNS = cortarString(parametro,2,largoParametro-strlen(aux)-1);
+        puerto = cortarString(parametro,largoParametro-strlen(aux)+2,largoParametro);
+    }
+    else
+    {
+        servidorDNS = cortarString(parametro,2,largoParametro);
+    }
+    servidorDeConfiguracion = 0;
+}
 
-        if(ntohs(additional[i].resource->type)==T_A)          /** si es un T_A (IPv4) **/
+/**
+ * Extrae de argv las opciones extendidas (las que no forman parte del enunciado original),
+ * dejando en argv sólo los parámetros clásicos para que el chequeo de main() no cambie.
+ * Opciones:
+ *  -traza[=archivo]: emite la traza de la resolución en JSON Lines (por defecto a stderr)
+ *  -tipo=TIPO: consulta por cualquier tipo conocido por la tabla de tipos (AAAA, TXT, PTR...)
+ *  -raices=archivo: pistas de raíz en formato named.root en lugar de las precompiladas
+ *  -ptr=CIDR[,CIDR...]: barrido masivo de DNS inverso (ver barrido.h)
+ *  -lote=archivo: resuelve todas las consultas del archivo con muchas en vuelo (ver lote.h)
+ *  -nxfiltro=archivo, -reverificar: filtro persistente de nombres inexistentes del lote (ver inexistentes.h)
+ *  -salida=archivo, -qps=N, -envuelo=N: salida, tasa y concurrencia de los modos masivos
+ *  -formato=texto|json|csv|binario: formato de los resultados (ver escritor.h)
+ *  -repetir=archivo, -vueltas=N: repetición de una captura por el parser (ver repeticion.h)
+ *  -medir[=archivo], -contadores: microbenchmarks de las funciones calientes (ver medicion.h)
+ *  -carga=archivo, -duracion=S, -rampa=N, -intervalo=S: prueba de carga (ver carga.h)
+ *  -ritmo=N: tasa máxima hacia cada servidor, compartida por todo el proceso (ver ritmo.h)
+ *  -axfr, -ixfr=archivo: transferencia de zona completa o incremental (ver transferencia.h)
+ *  -zona=archivo, -servir[=[ip:]puerto]: datos autoritativos locales y modo servidor (ver zonas.h)
+ *  -nsec: respuestas negativas sintetizadas a partir de los NSEC/NSEC3 recibidos (ver negativas.h)
+ *  -cache[=MB]: cache de respuestas con presupuesto de memoria (ver cache.h)
+ *  -paquetes=N, -paginasgrandes: pool de buffers de paquetes (ver paquetes.h)
+ *  -4, -6: sólo servidores IPv4 o sólo IPv6 (ver direcciones.h)
+ * Devuelve 0 si todo está bien, -1 si hubo un error.
+ **/
+int extraerOpcionesExtendidas(int *argc, char *argv[])
+{
+    int i, j = 1;
+    for (i = 1; i < *argc; i++)
+    {
+        if (strcmp(argv[i],"-traza")==0)
         {
-            additional[i].rdata = (unsigned char*)malloc(ntohs(additional[i].resource->rdlength));      // reservo espacio del tamaño del que recibo en dicho rdlength (del RR)
-            for(j=0; j<ntohs(additional[i].resource->rdlength); j++)                                    // leo cada dato
-                additional[i].rdata[j]=reader[j];
-
-            additional[i].rdata[ntohs(additional[i].resource->rdlength)]='\0';      // caracter terminador
-            reader+=ntohs(additional[i].resource->rdlength);                        // avanzo el puntero tanto como el tamaño del RR
-
+            if (trazaActivar(NULL) < 0)
+                return -1;
         }
-        else if(ntohs(additional[i].resource->type)==28){       //si es IPv6 lo ignoro, avanzo el largo del RR entero (avanzo el lector tantos bytes como largo del RR IPv6)
-            reader+=ntohs(additional[i].resource->rdlength);
+        else if (strncmp(argv[i],"-traza=",7)==0)
+        {
+            if (trazaActivar(argv[i]+7) < 0)
+                return -1;
         }
-        else
+        else if (strncmp(argv[i],"-tipo=",6)==0)
         {
-            additional[i].rdata=leerNombre(reader,mensajeDNS,&stop);
-            reader+=stop;
+            if ((tipoExtendido = tipoDesdeNombre(argv[i]+6)) == 0)
+            {
+                printf("ERROR: tipo de consulta desconocido %s\n",argv[i]+6);
+                return -1;
+            }
+            tipoConsulta = argv[i]+6;
         }
-    }
-    /** limpio los RR con ipv6! **/
-    int pos=0;
-    for(i=0; i<ntohs(dns->arcount); i++){
-        if(ntohs(additional[i].resource->type)==T_A){   //si es un ipv4 lo guardo al principio de los lugares disponibles y aumento la cuenta de ipv4 (pos)
-            additional[pos]=additional[i];
-            pos++;
+        else if (strncmp(argv[i],"-raices=",8)==0)
+        {
+            if (raicesCargarArchivo(argv[i]+8) <= 0)
+                return -1;
+        }
+        else if (strncmp(argv[i],"-zona=",6)==0)
+        {
+            if (zonaCargarArchivo(argv[i]+6) < 0)
+                return -1;
+        }
+        else if (strcmp(argv[i],"-servir")==0)
+            direccionServidor = "53";
+        else if (strncmp(argv[i],"-servir=",8)==0)
+            direccionServidor = argv[i]+8;
+        else if (strcmp(argv[i],"-nsec")==0)
+            negativasActivar();
+        else if (strcmp(argv[i],"-cache")==0)
+            cacheActivar(PRESUPUESTO_CACHE_POR_OMISION);
+        else if (strncmp(argv[i],"-cache=",7)==0)
+        {
+            if (atoi(argv[i]+7) <= 0)
+            {
+                printf("ERROR: el tamaño de la cache (-cache=MB) debe ser positivo\n");
+                return -1;
+            }
+            cacheActivar((size_t)atoi(argv[i]+7) * 1024 * 1024);
+        }
+        else if (strncmp(argv[i],"-paquetes=",10)==0)
+        {
+            if (atoi(argv[i]+10) <= 0)
+            {
+                printf("ERROR: la cantidad de buffers (-paquetes=N) debe ser positiva\n");
+                return -1;
+            }
+            cantidadPaquetes = atoi(argv[i]+10);
         }
+        else if (strcmp(argv[i],"-paginasgrandes")==0)
+            paginasGrandes = 1;
+        else if (strcmp(argv[i],"-4")==0)
+            familiaServidores = AF_INET;
+        else if (strcmp(argv[i],"-6")==0)
+            familiaServidores = AF_INET6;
+        else if (strcmp(argv[i],"-axfr")==0)
+            modoAXFR = 1;
+        else if (strncmp(argv[i],"-ixfr=",6)==0)
+            copiaIXFR = argv[i]+6;
+        else if (strncmp(argv[i],"-ptr=",5)==0)
+            rangosPTR = argv[i]+5;
+        else if (strncmp(argv[i],"-lote=",6)==0)
+            archivoLote = argv[i]+6;
+        else if (strncmp(argv[i],"-nxfiltro=",10)==0)
+            filtroInexistentes = argv[i]+10;
+        else if (strcmp(argv[i],"-reverificar")==0)
+            reverificarInexistentes = 1;
+        else if (strncmp(argv[i],"-repetir=",9)==0)
+            capturaRepetir = argv[i]+9;
+        else if (strcmp(argv[i],"-medir")==0)
+            modoMedicion = 1;
+        else if (strncmp(argv[i],"-medir=",7)==0)
+        {
+            modoMedicion = 1;
+            capturaMedicion = argv[i]+7;
+        }
+        else if (strcmp(argv[i],"-contadores")==0)
+            contadoresHardware = 1;
+        else if (strncmp(argv[i],"-vueltas=",9)==0)
+        {
+            if ((vueltasRepeticion = atoi(argv[i]+9)) <= 0)
+            {
+                printf("ERROR: cantidad de vueltas no válida %s\n",argv[i]+9);
+                return -1;
+            }
+        }
+        else if (strncmp(argv[i],"-carga=",7)==0)
+            archivoCarga = argv[i]+7;
+        else if (strncmp(argv[i],"-duracion=",10)==0)
+            duracionCarga = atof(argv[i]+10);
+        else if (strncmp(argv[i],"-rampa=",7)==0)
+            qpsInicialCarga = atof(argv[i]+7);
+        else if (strncmp(argv[i],"-intervalo=",11)==0)
+            intervaloCarga = atof(argv[i]+11);
+        else if (strncmp(argv[i],"-ritmo=",7)==0)
+            qpsPorServidor = atof(argv[i]+7);
+        else if (strncmp(argv[i],"-salida=",8)==0)
+            archivoSalida = argv[i]+8;
+        else if (strncmp(argv[i],"-formato=",9)==0)
+        {
+            if ((formatoSalida = formatoDesdeNombre(argv[i]+9)) < 0)
+            {
+                printf("ERROR: formato de salida desconocido %s (texto, json, csv o binario)\n",argv[i]+9);
+                return -1;
+            }
+        }
+        else if (strncmp(argv[i],"-qps=",5)==0)
+            consultasPorSegundo = atof(argv[i]+5);
+        else if (strncmp(argv[i],"-envuelo=",9)==0)
+        {
+            if ((consultasEnVuelo = atoi(argv[i]+9)) <= 0 || consultasEnVuelo > MAX_EN_VUELO_MOTOR)
+            {
+                printf("ERROR: cantidad de consultas en vuelo no válida %s (entre 1 y %d)\n",argv[i]+9,MAX_EN_VUELO_MOTOR);
+                return -1;
+            }
+        }
+        else
+            argv[j++] = argv[i];
     }
-    *respuestasADD = pos;
-
-    /** -------- FIN LECTURA DE LA SECCION ADDITIONAL -------- **/
-
-
-    if(print)printResults(answer,authority,additional,answerLOC,*respuestasA,*respuestasAU,*respuestasADD,host,query_type);
+    *argc = j;
+    argv[j] = NULL;
     return 0;
 }
 
+/** FUNCION PRINCIPAL */
+int main(int argc, char *argv[])
+{
+    if (extraerOpcionesExtendidas(&argc,argv) < 0)
+        return 1;
+    /** obtengo los dns locales y las opciones del resolver, una sola vez (ver configuracion.h);
+        después de las opciones, porque -4 y -6 filtran los nameserver **/
+    direccionLimitarFamilia(familiaServidores);
+    if (configuracionCargar(RUTA_RESOLV_CONF) < 0)
+        printf("Falló abriendo el archivo %s, se usa %s\n",RUTA_RESOLV_CONF,direccionPermitida(AF_INET) ? "127.0.0.1" : "::1");
+    configuracionObtener(&configuracion);
+    servidorDNS = configuracion.servidores[0]; /** seteo el primero predefinido. **/
+    ritmoConfigurar(qpsPorServidor,consultasEnVuelo);
+    paquetesConfigurar(cantidadPaquetes,paginasGrandes);
+    if ((filtroInexistentes != NULL || reverificarInexistentes) && archivoLote == NULL)
+    {
+        printf("ERROR: -nxfiltro= y -reverificar sólo se aplican al modo -lote=\n");
+        return 1;
+    }
 
+    if (direccionServidor != NULL)   /** modo servidor: no admite parámetros clásicos **/
+    {
+        if (argc > 1 || zonasCargadas() == 0)
+        {
+            printf("ERROR: uso: query -zona=archivo [-zona=archivo...] -servir[=[ip:]puerto]\n");
+            return 1;
+        }
+        return zonaServir(direccionServidor) < 0;
+    }
 
+    if (capturaRepetir != NULL)   /** repetición de una captura: no hay servidor ni consulta **/
+    {
+        if (argc > 1)
+        {
+            printf("ERROR: uso: query -repetir=captura [-vueltas=N] [-salida=archivo] [-formato=json]\n");
+            return 1;
+        }
+        return repeticionCaptura(capturaRepetir,vueltasRepeticion,archivoSalida,formatoSalida) < 0;
+    }
 
+    if (modoMedicion)   /** microbenchmarks: tampoco hay servidor ni consulta **/
+    {
+        if (argc > 1)
+        {
+            printf("ERROR: uso: query -medir[=captura] [-contadores]\n");
+            return 1;
+        }
+        return medicionEjecutar(capturaMedicion,contadoresHardware) < 0;
+    }
 
-
-/**
- * Consulta iterativa
-*/
-void resolverConsultaIterativo (char *host , int query_type, struct R_DATA_LOC* answerLOC)
-{
-    //loc -t systemadmin.es no anda, le falta un paso. anda mal el ultimo paso aparentemente
-    char* nombre;
-    nombre = (char*) malloc(sizeof(char));
-    strcpy(nombre,".");
-
-    int largo = strlen(host);
-
-    int terminar=0;
-    int primero=1;
-    int respuestasA = 0;
-    int respuestasAU = 0;
-    int respuestasADD = 0;
-    while((respuestasA == 0)) {
-        //printf("A CONSULTAR: %s SERVER DNS: %s\n",nombre,servidorDNS);
-        struct RESOURCE_RECORD answer[20],authority[20],additional[20]; // Las respuestas del servidor DNS
-        respuestasA = 0;
-        respuestasAU = 0;
-        respuestasADD = 0;
-        if(primero){    //se debe ejecutar por primera vez siempre.
-            resolverConsulta(".", T_NS, answer, authority, additional, answerLOC, &respuestasA, &respuestasAU, &respuestasADD,1);
-            if(strcmp(host,".")!=0){
-                respuestasA=0; //lo seteo en 0 asi vuelve a ciclar el while
-            }
+    if (rangosPTR != NULL)   /** modo barrido: sólo admite el servidor como parámetro clásico **/
+    {
+        if (argc > 2 || (argc == 2 && argv[1][0] != '@'))
+        {
+            printf("ERROR: el barrido -ptr= sólo admite @servidor[:puerto] como parámetro\n");
+            return 1;
         }
-        else //resuelvo la consulta normal
-            resolverConsulta(host, query_type, answer, authority, additional, answerLOC, &respuestasA, &respuestasAU, &respuestasADD,1);
-
-        //ya pase la primer consulta por rootservers! seteo el flag en 0.
-            primero =0;
-
-        if(respuestasA!=0){    //si encontre lo que buscaba tengo que dejar de buscar!
-            if(ntohs(additional[0].resource->type)==query_type)
-                terminar=1;
-        }else{
-            if((respuestasADD==0)&(respuestasA==0)){//si no tengo additional de donde tomar un ip, se lo pido al dns local desde el primer authority NS
-                printf("\ndebo preguntar al server local\n");
-                respuestasA = 0;
-                respuestasAU = 0;
-                respuestasADD = 0;
-                maneraConsulta = "-r";
-                servidorDNS = dns_servers[0];
-                resolverConsulta((char*)authority[0].rdata, T_A, answer, authority, additional, answerLOC, &respuestasA, &respuestasAU, &respuestasADD,1);
-                maneraConsulta = "-t";
-                struct sockaddr_in a;
-                long *p;
-                p = (long*)answer[0].rdata;   //obtengo la primer respuesta y la uso de proximo server!
-                a.sin_addr.s_addr = (*p);
-                servidorDNS = inet_ntoa(a.sin_addr);
-                respuestasA = 0;              //permite seguir a la recursion.
-            }else{
-                /** en servidorDNS esta el servidor donde se hace las consultas
-                    si me dieron additional, obtengo el ip del primer server en additional[0],
-                    para esto debo convertir a human readable el ip guardado ahi **/
-                struct sockaddr_in a;
-                long *p;
-                p = (long*)additional[0].rdata;
-                a.sin_addr.s_addr = (*p);
-                servidorDNS = inet_ntoa(a.sin_addr);
-            }
+        if (argc == 2)
+            leerServidor(argv[1]);
+        return barridoPTR(rangosPTR,servidorDNS,puerto,archivoSalida,formatoSalida,consultasPorSegundo,consultasEnVuelo) < 0;
+    }
 
-            if(largo ==0 ){
-                terminar = 1;
-                strcpy(nombre,host);
+    if (archivoLote != NULL)   /** modo lote: igual que el barrido, sólo admite el servidor (y -t) **/
+    {
+        int iterativa = 0, ind;
+        for (ind = 1; ind < argc; ind++)
+        {
+            if (strcmp(argv[ind],"-t") == 0)
+                iterativa = 1;
+            else if (argv[ind][0] == '@')
+                leerServidor(argv[ind]);
+            else
+            {
+                printf("ERROR: el modo -lote= sólo admite @servidor[:puerto] y -t como parámetros\n");
+                return 1;
             }
-            else{
-                while((host[largo]!='.')&&(largo!=0))
-                largo--;
-
-                if(largo!=0)
-                    largo++;
-
-                strcpy(nombre,(host+largo));
-
-                if(largo>1)
-                    largo--;
-                if(largo>0)
-                    largo--;
+        }
+        if (filtroInexistentes != NULL && inexistentesAbrir(filtroInexistentes,reverificarInexistentes) < 0)
+            return 1;
+        int resultado = loteResolver(archivoLote,servidorDeConfiguracion ? NULL : servidorDNS,puerto,archivoSalida,formatoSalida,consultasPorSegundo,
+                                     consultasEnVuelo,iterativa);
+        return (inexistentesCerrar() < 0 || resultado < 0);
+    }
 
-                printf("\n");
-            }
+    if (archivoCarga != NULL)   /** prueba de carga: como el lote, sólo admite el servidor **/
+    {
+        if (argc > 2 || (argc == 2 && argv[1][0] != '@'))
+        {
+            printf("ERROR: la prueba -carga= sólo admite @servidor[:puerto] como parámetro\n");
+            return 1;
         }
-        printf("\n");
-    printf("-------------------------------------------------------------------------\n");
+        if (argc == 2)
+            leerServidor(argv[1]);
+        return cargaEjecutar(archivoCarga,servidorDNS,puerto,consultasPorSegundo,qpsInicialCarga,duracionCarga,
+                             intervaloCarga,consultasEnVuelo,archivoSalida,formatoSalida) < 0;
     }
-    printf("\n");
 
-}
-/** FUNCION PRINCIPAL */
-int main(int argc, char *argv[])
-{
-    get_dns_servers();          /** obtengo dns locales **/
-    servidorDNS = dns_servers[0]; /** seteo el primero predefinido. **/
+    if (modoAXFR || copiaIXFR != NULL)   /** transferencia de zona: zona [@servidor[:puerto]] **/
+    {
+        if (argc < 2 || argc > 3 || (argc == 3 && argv[2][0] != '@') || (modoAXFR && copiaIXFR != NULL))
+        {
+            printf("ERROR: uso: query zona @servidor[:puerto] -axfr | -ixfr=archivo\n");
+            return 1;
+        }
+        if (argc == 3)
+            leerServidor(argv[2]);
+        if (modoAXFR)
+            return transferenciaAXFR(argv[1],servidorDNS,puerto,archivoSalida) < 0;
+        return transferenciaIXFR(argv[1],servidorDNS,puerto,copiaIXFR) < 0;
+    }
 
     if (argc > 1 && argc < 7 )
     {
@@ -1164,24 +1171,16 @@ int main(int argc, char *argv[])
         if (!modoAyuda)
         {
             hostname = argv[1];
+            /** escribirNombre (plantillas.c) no valida: un label vacío o de más de 63 bytes armaría otra consulta **/
+            if (!plantillaNombreValido(hostname))
+                errorParametrosValidos = 1;
         }
         if (argc > 2)
         {
             int ind = 2;
             if (argv[ind][0]=='@')   /** Se ingresó un servidor **/
             {
-                int largoParametro = strlen(argv[ind]);
-
-                char* aux;
-                if ((aux=strchr(argv[ind],':'))!= NULL)   /** Chequeo si se ingresó puerto del servidor **/
-                {
-                    servidorDNS = cortarString(argv[ind],2,largoParametro-strlen(aux)-1);
-                    puerto = cortarString(argv[ind],largoParametro-strlen(aux)+2,largoParametro);
-                }
-                else
-                {
-                    servidorDNS = cortarString(argv[ind],2,largoParametro);
-                }
+                leerServidor(argv[ind]);
                 ind++; /** aumentó el índice para próxima iteración para chequear argumentos **/
             }
 
@@ -1233,6 +1232,7 @@ int main(int argc, char *argv[])
                 if (ind < argc && strcmp(argv[ind],"-r")==0)
                 {
                     maneraConsulta = "-r";
+                    consultaRecursiva = 1;
                     int indice = ind++;
                     while(!errorParametrosExcluyentesManeraConsulta && indice < argc)
                     {
@@ -1244,6 +1244,7 @@ int main(int argc, char *argv[])
                 else if (ind < argc && strcmp(argv[ind],"-t")==0)
                 {
                     maneraConsulta = "-t";
+                    consultaRecursiva = 0;
                     int indice = ind++;
                     while(!errorParametrosExcluyentesManeraConsulta && indice < argc)
                     {
@@ -1256,25 +1257,34 @@ int main(int argc, char *argv[])
                     modoAyuda = 1;
             }
         }
+        if (!errorParametrosValidos && !modoAyuda && !errorParametrosExcluyentesTipoConsulta && !errorParametrosExcluyentesManeraConsulta
+                && formatoSalida != FORMATO_TEXTO && strcmp(maneraConsulta,"-t")==0)
+        {
+            printf("ERROR: -formato= sólo se aplica a consultas recursivas (-r) y a los modos masivos\n");
+            return 1;
+        }
         if (!errorParametrosValidos && !modoAyuda && !errorParametrosExcluyentesTipoConsulta && !errorParametrosExcluyentesManeraConsulta)
         {
-            printf("Parámetro consulta = %s\n",hostname);
-            printf("Parámetro Servidor = %s\n",servidorDNS);
-            printf("Parámetro Puerto = %s\n",puerto);
-            printf("Parámetro Tipo de Consulta = %s\n",tipoConsulta);
-            printf("Parámetro Manera de Consulta = %s\n",maneraConsulta);
+            /** con un formato para máquinas la salida es sólo el resultado: sin encabezado **/
+            if (formatoSalida == FORMATO_TEXTO)
+            {
+                printf("Parámetro consulta = %s\n",hostname);
+                printf("Parámetro Servidor = %s\n",servidorDNS);
+                printf("Parámetro Puerto = %s\n",puerto);
+                printf("Parámetro Tipo de Consulta = %s\n",tipoConsulta);
+                printf("Parámetro Manera de Consulta = %s\n",maneraConsulta);
+            }
+            else if ((escritorConsultas = escritorAbrir(archivoSalida,formatoSalida)) == NULL)
+                return 1;
 
             // seteo las variables donde pongo las respuestas!
-            struct RESOURCE_RECORD answer[20],authority[20],additional[20]; // Las respuestas del servidor DNS
-            struct R_DATA_LOC* answerLOC = (struct R_DATA_LOC*) malloc(sizeof(struct R_DATA_LOC));
-
-            // llevo cuenta de la cantidad de elementos dentro de cada arreglo:
-            int respuestasA = 0;
-            int respuestasAU = 0;
-            int respuestasADD = 0;
+            SECCIONES secciones; // Las respuestas del servidor DNS, con la cantidad de cada sección
+            seccionesIniciar(&secciones);
 
             int query_type;
-            if (strcmp(tipoConsulta,"-a")==0)
+            if (tipoExtendido != 0)
+                query_type = tipoExtendido;
+            else if (strcmp(tipoConsulta,"-a")==0)
                 query_type = T_A;
             else if (strcmp(tipoConsulta,"-mx")==0)
                 query_type = T_MX;
@@ -1282,9 +1292,40 @@ int main(int argc, char *argv[])
                 query_type = T_LOC;
 
             if (strcmp(maneraConsulta,"-r")==0)
-                resolverConsulta(hostname , query_type, answer, authority, additional, answerLOC,&respuestasA,&respuestasAU,&respuestasADD,1);
+            {
+                /** si el servidor responde con un alias (CNAME) pero no sigue la cadena hasta
+                    el tipo pedido, se vuelve a consultar por el nombre canónico **/
+                char *consulta = hostname, canonico[256], elegido[256], textoTipo[LARGO_TEXTO_TIPO];
+                int alias = 0, resuelto = 1;
+                trazaComenzarConsulta(&trazaConsulta,hostname,mapearTipo(query_type,textoTipo));
+                do
+                {
+                    /** la lista de búsqueda sólo se aplica al nombre pedido, no a los canónicos **/
+                    if (alias == 0)
+                        consulta = resolverConBusqueda(consulta, query_type, &secciones, elegido);
+                    else
+                        resolverConsulta(consulta , query_type, &secciones,1);
+                    consulta = destinoCNAME(consulta,query_type,seccionesRegistros(&secciones,SECCION_ANSWER),
+                                            seccionesCantidad(&secciones,SECCION_ANSWER),&resuelto);
+                    if (consulta != NULL)
+                    {
+                        /** el nombre canónico apunta a los registros, que la próxima lectura libera **/
+                        snprintf(canonico,sizeof(canonico),"%s",consulta);
+                        consulta = canonico;
+                    }
+                    if (consulta != NULL && !resuelto && escritorConsultas == NULL)
+                        printf("\n;; la respuesta es un alias, se consulta el nombre canónico %s\n",consulta);
+                }
+                while (consulta != NULL && !resuelto && ++alias <= MAX_CNAME);
+                seccionesLiberar(&secciones);
+                trazaFinConsulta(&trazaConsulta,ultimoResultado);
+                if (escritorConsultas != NULL)
+                    escritorCerrar(escritorConsultas);
+            }
             else if (strcmp(maneraConsulta,"-t")==0)
-            resolverConsultaIterativo(hostname , query_type, answerLOC);
+            resolverConsultaIterativo(hostname , query_type);
+            if (escritorConsultas == NULL)
+                cacheResumen(stdout);
         }
         else
         {
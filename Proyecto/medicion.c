@@ -0,0 +1,627 @@
+#define _GNU_SOURCE
+#include<stdio.h>
+#include<string.h>
+#include<stdlib.h>
+#include<errno.h>
+#include<fcntl.h>
+#include<time.h>
+#include<unistd.h>
+#include<sys/ioctl.h>
+#include<sys/syscall.h>
+#include<linux/perf_event.h>
+
+#include "dns.h"
+#include "nombres.h"
+#include "secciones.h"
+#include "plantillas.h"
+#include "loc.h"
+#include "repeticion.h"
+#include "medicion.h"
+
+/** Una función medida: funcion(i) hace la operación número i (cada una elige su dato con i) **/
+typedef struct
+{
+    const char *nombre;
+    void (*funcion)(long i);
+} MEDICION;
+
+/** Dónde empieza el nombre de un registro **/
+typedef struct
+{
+    int mensaje;
+    int pos;
+} DUENO;
+
+static unsigned char **mensajes;
+static int *largos;
+static long cantidadMensajes;
+static char (*nombres)[256];            // nombre de la pregunta de cada mensaje, en texto
+static int *tipos;
+static int *finPregunta;                // donde empieza la sección answer
+static DUENO *duenos;
+static long cantidadDuenos;
+static const unsigned char **campos;    // TYPE, CLASS, TTL y RDLENGTH de cada registro
+static long cantidadCampos;
+static unsigned char (*rdatasLOC)[LARGO_LOC];
+static long cantidadLOC;
+static SECCIONES secciones;
+static SECCIONES *impresion;
+static int cantidadImpresion;
+static volatile unsigned long sumidero; // para que el compilador no descarte los resultados
+
+#ifdef CONTAR_ASIGNACIONES
+/** Con -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc (target Perfil) las llamadas del programa pasan por acá **/
+static long asignaciones;
+static unsigned long long bytesAsignados;
+
+void *__real_malloc(size_t tamanio);
+void *__real_calloc(size_t cantidad, size_t tamanio);
+void *__real_realloc(void *p, size_t tamanio);
+
+void *__wrap_malloc(size_t tamanio)
+{
+    asignaciones++;
+    bytesAsignados += tamanio;
+    return __real_malloc(tamanio);
+}
+
+void *__wrap_calloc(size_t cantidad, size_t tamanio)
+{
+    asignaciones++;
+    bytesAsignados += cantidad * tamanio;
+    return __real_calloc(cantidad,tamanio);
+}
+
+void *__wrap_realloc(void *p, size_t tamanio)
+{
+    asignaciones++;
+    bytesAsignados += tamanio;
+    return __real_realloc(p,tamanio);
+}
+#endif
+
+static long long nanosegundos()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC,&t);
+    return (long long)t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+/** ------------------------------------------------------------------ respuestas sintéticas **/
+
+/** Agrega un registro con el dueño comprimido (puntero a dueno) y devuelve la nueva posición **/
+static int agregarRR(unsigned char *m, int pos, int dueno, int tipo, const unsigned char *rdata, int largo)
+{
+    struct R_DATA campos = {.type = tipo, ._class = 1, .ttl = 3600, .rdlength = largo};
+    escribir16(m + pos,0xC000 | dueno);
+    camposRREscribir(&campos,m + pos + 2);
+    memcpy(m + pos + 2 + TAM_R_DATA,rdata,largo);
+    return pos + 2 + TAM_R_DATA + largo;
+}
+
+/** Cabecera de respuesta sobre la consulta armada por la plantilla **/
+static int armarRespuesta(unsigned char *m, const char *nombre, int tipo)
+{
+    int largo = plantillaArmar(m,PLANTILLA_RECURSIVA,nombre,tipo,0x2b1c);
+    CABECERA_DNS cabecera;
+    cabeceraLeer(m,&cabecera);
+    cabecera.qr = 1;
+    cabecera.ra = 1;
+    cabecera.z = cabecera.ad = cabecera.cd = cabecera.rcode = 0;
+    cabeceraEscribir(&cabecera,m);
+    return largo;
+}
+
+static void contarRegistros(unsigned char *m, int respuestas, int autoridad, int adicionales)
+{
+    escribir16(m + 6,respuestas);
+    escribir16(m + 8,autoridad);
+    escribir16(m + 10,adicionales);
+}
+
+/** Cuatro respuestas típicas: A, MX con NS y glue, LOC y una cadena CNAME **/
+static void armarSinteticas()
+{
+    static unsigned char buffers[4][512];
+    unsigned char rdata[64];
+    int pos, i, ns[2];
+
+    mensajes = (unsigned char**)malloc(4 * sizeof(unsigned char*));
+    largos = (int*)malloc(4 * sizeof(int));
+    for (i = 0; i < 4; i++)
+        mensajes[i] = buffers[i];
+
+    /** www.ejemplo.com A: cuatro direcciones **/
+    pos = armarRespuesta(mensajes[0],"www.ejemplo.com",T_A);
+    for (i = 0; i < 4; i++)
+    {
+        unsigned char a[4] = {192, 0, 2, 10 + i};
+        pos = agregarRR(mensajes[0],pos,12,T_A,a,4);
+    }
+    contarRegistros(mensajes[0],4,0,0);
+    largos[0] = pos;
+
+    /** ejemplo.com MX: dos MX, dos NS en authority y sus direcciones en additional **/
+    pos = armarRespuesta(mensajes[1],"ejemplo.com",T_MX);
+    for (i = 0; i < 2; i++)
+    {
+        unsigned char mx[] = {0, 10 * (i + 1), 3, 'm', 'x', '1' + i, 0xC0, 12};
+        pos = agregarRR(mensajes[1],pos,12,T_MX,mx,sizeof(mx));
+    }
+    for (i = 0; i < 2; i++)
+    {
+        unsigned char nombreNS[] = {3, 'n', 's', '1' + i, 0xC0, 12};
+        ns[i] = pos + 2 + TAM_R_DATA;
+        pos = agregarRR(mensajes[1],pos,12,T_NS,nombreNS,sizeof(nombreNS));
+    }
+    for (i = 0; i < 2; i++)
+    {
+        unsigned char a[4] = {198, 51, 100, 53 + i};
+        pos = agregarRR(mensajes[1],pos,ns[i],T_A,a,4);
+    }
+    contarRegistros(mensajes[1],2,2,2);
+    largos[1] = pos;
+
+    /** sitio.ejemplo.com LOC: dos ubicaciones **/
+    pos = armarRespuesta(mensajes[2],"sitio.ejemplo.com",T_LOC);
+    UBICACION u[2] = {{-34.6037, -58.3816, 25, 1, 10000, 10}, {42.3650, -71.1050, -24, 30, 10, 2}};
+    for (i = 0; i < 2; i++)
+    {
+        locDesdeUbicacion(&u[i],rdata);
+        pos = agregarRR(mensajes[2],pos,12,T_LOC,rdata,LARGO_LOC);
+    }
+    contarRegistros(mensajes[2],2,0,0);
+    largos[2] = pos;
+
+    /** alias.ejemplo.com A: CNAME a www.ejemplo.com y su dirección **/
+    pos = armarRespuesta(mensajes[3],"alias.ejemplo.com",T_A);
+    unsigned char cname[] = {3, 'w', 'w', 'w', 0xC0, 18};
+    int destino = pos + 2 + TAM_R_DATA;
+    pos = agregarRR(mensajes[3],pos,12,T_CNAME,cname,sizeof(cname));
+    unsigned char a[4] = {192, 0, 2, 80};
+    pos = agregarRR(mensajes[3],pos,destino,T_A,a,4);
+    contarRegistros(mensajes[3],2,0,0);
+    largos[3] = pos;
+
+    cantidadMensajes = 4;
+}
+
+/** ------------------------------------------------------------------ preparación **/
+
+/** Lee de cada mensaje la pregunta, los dueños de sus registros y sus LOC; descarta los que no tienen pregunta **/
+static void prepararMensajes()
+{
+    long i, j, utiles = 0;
+    nombres = malloc(cantidadMensajes * sizeof(*nombres));
+    tipos = (int*)malloc(cantidadMensajes * sizeof(int));
+    finPregunta = (int*)malloc(cantidadMensajes * sizeof(int));
+    seccionesIniciar(&secciones);
+
+    for (i = 0; i < cantidadMensajes; i++)
+    {
+        unsigned char *m = mensajes[i];
+        int pos;
+        if (leer16(m + 4) != 1 || (pos = nombreLeerMensaje(m,largos[i],12,NULL,nombres[utiles])) < 0 || pos + 4 > largos[i])
+            continue;
+        mensajes[utiles] = m;
+        largos[utiles] = largos[i];
+        tipos[utiles] = leer16(m + pos);
+        finPregunta[utiles] = pos + 4;
+
+        int registros = seccionesLeer(&secciones,m,largos[i],pos + 4);
+        duenos = realloc(duenos,(cantidadDuenos + registros + 1) * sizeof(DUENO));
+        campos = realloc(campos,(cantidadCampos + registros + 1) * sizeof(const unsigned char*));
+        duenos[cantidadDuenos].mensaje = utiles;
+        duenos[cantidadDuenos++].pos = 12;
+        for (j = 0; j < registros; j++)
+        {
+            duenos[cantidadDuenos].mensaje = utiles;
+            duenos[cantidadDuenos++].pos = secciones.nombre[j];
+            campos[cantidadCampos++] = m + secciones.rdata[j] - TAM_R_DATA;
+            if (secciones.tipo[j] == T_LOC && secciones.largoRdata[j] == LARGO_LOC)
+            {
+                rdatasLOC = realloc(rdatasLOC,(cantidadLOC + 1) * LARGO_LOC);
+                memcpy(rdatasLOC[cantidadLOC++],m + secciones.rdata[j],LARGO_LOC);
+            }
+        }
+        utiles++;
+    }
+    cantidadMensajes = utiles;
+
+    /** printResults recibe los registros ya decodificados: se arman antes, fuera de la medición **/
+    cantidadImpresion = cantidadMensajes < MAX_PRUEBAS_IMPRESION ? cantidadMensajes : MAX_PRUEBAS_IMPRESION;
+    impresion = (SECCIONES*)malloc(cantidadImpresion * sizeof(SECCIONES));
+    for (i = 0; i < cantidadImpresion; i++)
+    {
+        seccionesIniciar(&impresion[i]);
+        seccionesLeer(&impresion[i],mensajes[i],largos[i],finPregunta[i]);
+        for (j = SECCION_ANSWER; j <= SECCION_ADDITIONAL; j++)
+            seccionesRegistros(&impresion[i],j);
+    }
+}
+
+/** ------------------------------------------------------------------ funciones medidas **/
+
+static void medirCodificarNombre(long i)
+{
+    unsigned char wire[256];
+    cambiarAlFormatoNombreDNS(wire,nombres[i % cantidadMensajes]);
+    sumidero += wire[0];
+}
+
+static void medirArmarConsulta(long i)
+{
+    unsigned char consulta[512];
+    long k = i % cantidadMensajes;
+    sumidero += plantillaArmar(consulta,PLANTILLA_RECURSIVA,nombres[k],tipos[k],i);
+}
+
+static void medirLeerNombre(long i)
+{
+    DUENO *d = &duenos[i % cantidadDuenos];
+    int leidos;
+    unsigned char *nombre = leerNombre(mensajes[d->mensaje] + d->pos,mensajes[d->mensaje],largos[d->mensaje],&leidos);
+    sumidero += leidos + nombre[0];
+    free(nombre);
+}
+
+static void medirCabecera(long i)
+{
+    CABECERA_DNS cabecera;
+    unsigned char copia[TAM_CABECERA];
+    cabeceraLeer(mensajes[i % cantidadMensajes],&cabecera);
+    cabecera.id ^= i;
+    cabeceraEscribir(&cabecera,copia);
+    sumidero += cabecera.rcode + cabecera.ancount + copia[0];
+}
+
+static void medirCamposRR(long i)
+{
+    struct R_DATA rr;
+    camposRRLeer(campos[i % cantidadCampos],&rr);
+    sumidero += rr.type + rr.ttl + rr.rdlength;
+}
+
+static void medirLeerSecciones(long i)
+{
+    long k = i % cantidadMensajes;
+    sumidero += seccionesLeer(&secciones,mensajes[k],largos[k],finPregunta[k]);
+}
+
+static void medirDecodificarSecciones(long i)
+{
+    long k = i % cantidadMensajes;
+    int s;
+    seccionesLeer(&secciones,mensajes[k],largos[k],finPregunta[k]);
+    for (s = SECCION_ANSWER; s <= SECCION_ADDITIONAL; s++)
+        sumidero += (unsigned long)seccionesRegistros(&secciones,s);
+}
+
+static void medirPrintResults(long i)
+{
+    SECCIONES *s = &impresion[i % cantidadImpresion];
+    long k = i % cantidadImpresion;
+    printResults(seccionesRegistros(s,SECCION_ANSWER),seccionesRegistros(s,SECCION_AUTHORITY),
+                 seccionesRegistros(s,SECCION_ADDITIONAL),seccionesCantidad(s,SECCION_ANSWER),
+                 seccionesCantidad(s,SECCION_AUTHORITY),seccionesCantidad(s,SECCION_ADDITIONAL),nombres[k],tipos[k]);
+}
+
+static void medirLeerLOC(long i)
+{
+    struct R_DATA_LOC loc;
+    leerLOC(rdatasLOC[i % cantidadLOC],&loc);
+    sumidero += loc.latitude ^ loc.altitude;
+}
+
+static void medirLOCATexto(long i)
+{
+    char texto[MAX_TEXTO_LOC];
+    sumidero += locATexto(rdatasLOC[i % cantidadLOC],texto);
+}
+
+static void medirCentimetros(long i)
+{
+    /** los 100 bytes válidos: mantisa y exponente de 0 a 9 **/
+    sumidero += locCentimetros((uint8_t)(((i % 10) << 4) | ((i / 10) % 10)));
+}
+
+static const MEDICION mediciones[] =
+{
+    {"cambiarAlFormatoNombreDNS", medirCodificarNombre},
+    {"plantillaArmar", medirArmarConsulta},
+    {"leerNombre", medirLeerNombre},
+    {"cabeceraLeer+Escribir", medirCabecera},
+    {"camposRRLeer", medirCamposRR},
+    {"seccionesLeer", medirLeerSecciones},
+    {"seccionesLeer+Registros", medirDecodificarSecciones},
+    {"printResults", medirPrintResults},
+    {"leerLOC", medirLeerLOC},
+    {"locATexto", medirLOCATexto},
+    {"locCentimetros", medirCentimetros},
+};
+
+/** ------------------------------------------------------------------ contadores de hardware **/
+
+#define CANTIDAD_CONTADORES 3
+
+static int contadores[CANTIDAD_CONTADORES] = {-1, -1, -1};
+
+/** Abre ciclos, instrucciones y fallos de cache del proceso, en un grupo; 0, o -1 si el núcleo no los da **/
+static int abrirContadores()
+{
+    static const unsigned long long eventos[CANTIDAD_CONTADORES] =
+        {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES};
+    struct perf_event_attr atributos;
+    int i;
+    for (i = 0; i < CANTIDAD_CONTADORES; i++)
+    {
+        memset(&atributos,0,sizeof(atributos));
+        atributos.type = PERF_TYPE_HARDWARE;
+        atributos.size = sizeof(atributos);
+        atributos.config = eventos[i];
+        atributos.disabled = i == 0;
+        atributos.exclude_kernel = 1;
+        atributos.exclude_hv = 1;
+        atributos.read_format = PERF_FORMAT_GROUP;
+        contadores[i] = syscall(SYS_perf_event_open,&atributos,0,-1,i == 0 ? -1 : contadores[0],0);
+        if (contadores[i] < 0)
+        {
+            printf(";; contadores de hardware no disponibles (perf_event_open: %s)\n",strerror(errno));
+            while (--i >= 0)
+                close(contadores[i]);
+            contadores[0] = -1;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void iniciarContadores()
+{
+    if (contadores[0] < 0)
+        return;
+    ioctl(contadores[0],PERF_EVENT_IOC_RESET,PERF_IOC_FLAG_GROUP);
+    ioctl(contadores[0],PERF_EVENT_IOC_ENABLE,PERF_IOC_FLAG_GROUP);
+}
+
+/** Detiene el grupo y deja los valores en valores; 0, o -1 si no hay contadores **/
+static int leerContadores(unsigned long long valores[CANTIDAD_CONTADORES])
+{
+    unsigned long long grupo[1 + CANTIDAD_CONTADORES];
+    if (contadores[0] < 0)
+        return -1;
+    ioctl(contadores[0],PERF_EVENT_IOC_DISABLE,PERF_IOC_FLAG_GROUP);
+    if (read(contadores[0],grupo,sizeof(grupo)) != sizeof(grupo))
+        return -1;
+    memcpy(valores,grupo + 1,sizeof(grupo) - sizeof(grupo[0]));
+    return 0;
+}
+
+/** ------------------------------------------------------------------ comprobación del codec **/
+
+#define FALLAS_INFORMADAS 8             // las demás sólo se cuentan
+
+static int comprobaciones, fallas;
+
+static void comprobar(int condicion, const char *caso, unsigned long valor)
+{
+    comprobaciones++;
+    if (condicion)
+        return;
+    if (fallas < FALLAS_INFORMADAS)
+        printf("ERROR: codec: %s (0x%lx)\n",caso,valor);
+    fallas++;
+}
+
+/** Los indicadores de una cabecera decodificada, armados de nuevo en los 16 bits de red sin pasar por cabeceraEscribir **/
+static unsigned int indicadores(const CABECERA_DNS *c)
+{
+    return (c->qr << 15) | (c->opcode << 11) | (c->aa << 10) | (c->tc << 9) | (c->rd << 8)
+           | (c->ra << 7) | (c->z << 6) | (c->ad << 5) | (c->cd << 4) | c->rcode;
+}
+
+/**
+ * Ida y vuelta del codec de cabecera.h: cada combinación de los 16 bits de indicadores, los cuatro
+ * contadores y el ID en sus bordes, y TTL y RDLENGTH en los suyos. Lo leído tiene que volver a
+ * escribirse igual byte a byte, y cada campo tiene que caer en su lugar. Devuelve las fallas.
+ **/
+static int comprobarCodec()
+{
+    static const uint32_t bordes32[] = {0, 1, 0x7f, 0x80, 0xff, 0x100, 0xffff, 0x10000, 0x7fffffff, 0x80000000u, 0xfffffffeu, 0xffffffffu};
+    static const unsigned int bordes16[] = {0, 1, 0x7f, 0x80, 0xff, 0x100, 0x7fff, 0x8000, 0xfffe, 0xffff};
+    unsigned char mensaje[TAM_CABECERA], copia[TAM_CABECERA], rr[TAM_R_DATA];
+    CABECERA_DNS cabecera;
+    struct R_DATA campos, leidos;
+    unsigned int v, b;
+    int k, j;
+
+    comprobaciones = fallas = 0;
+    /** indicadores: los 65536 valores de los bytes 2 y 3 **/
+    memset(mensaje,0,sizeof(mensaje));
+    for (v = 0; v <= 0xffff; v++)
+    {
+        escribir16(mensaje + 2,v);
+        cabeceraLeer(mensaje,&cabecera);
+        cabeceraEscribir(&cabecera,copia);
+        comprobar(memcmp(mensaje,copia,TAM_CABECERA) == 0,"indicadores: la cabecera no vuelve igual",v);
+        comprobar(indicadores(&cabecera) == v && (unsigned int)cabeceraRcode(mensaje) == (v & 0x0f),"indicadores: campo fuera de lugar",v);
+    }
+    /** cada bit, en su campo y sólo en él **/
+    for (b = 0; b < 16; b++)
+    {
+        escribir16(mensaje + 2,1u << b);
+        cabeceraLeer(mensaje,&cabecera);
+        comprobar(cabecera.qr + cabecera.aa + cabecera.tc + cabecera.rd + cabecera.ra + cabecera.z + cabecera.ad + cabecera.cd
+                  + (cabecera.opcode != 0) + (cabecera.rcode != 0) == 1,"indicadores: un bit en más de un campo",1u << b);
+    }
+    /** el ID y los cuatro contadores, de a uno, en sus bordes **/
+    for (k = 0; k < 5; k++)
+        for (j = 0; j < (int)(sizeof(bordes16) / sizeof(bordes16[0])); j++)
+        {
+            uint16_t *campo[5] = {&cabecera.id, &cabecera.qdcount, &cabecera.ancount, &cabecera.nscount, &cabecera.arcount};
+            memset(&cabecera,0,sizeof(cabecera));
+            *campo[k] = bordes16[j];
+            cabeceraEscribir(&cabecera,mensaje);
+            comprobar(leer16(mensaje + (k == 0 ? 0 : 2 + 2 * k)) == bordes16[j],"contadores: fuera de lugar en el mensaje",bordes16[j]);
+            memset(&cabecera,0xff,sizeof(cabecera));
+            cabeceraLeer(mensaje,&cabecera);
+            comprobar(*campo[k] == bordes16[j] && (unsigned int)(cabecera.id + cabecera.qdcount + cabecera.ancount
+                      + cabecera.nscount + cabecera.arcount) == bordes16[j] && indicadores(&cabecera) == 0,"contadores: no vuelven iguales",bordes16[j]);
+        }
+    /** campos fijos de un RR: TTL en sus bordes, y TYPE, CLASS y RDLENGTH en los de 16 bits **/
+    for (j = 0; j < (int)(sizeof(bordes32) / sizeof(bordes32[0])); j++)
+    {
+        campos.type = T_A;
+        campos._class = 1;
+        campos.ttl = bordes32[j];
+        campos.rdlength = 4;
+        camposRREscribir(&campos,rr);
+        camposRRLeer(rr,&leidos);
+        comprobar(leer32(rr + 4) == bordes32[j] && leidos.ttl == bordes32[j] && leidos.type == T_A && leidos._class == 1
+                  && leidos.rdlength == 4,"TTL: no vuelve igual",bordes32[j]);
+    }
+    for (j = 0; j < (int)(sizeof(bordes16) / sizeof(bordes16[0])); j++)
+    {
+        campos.type = bordes16[j];
+        campos._class = bordes16[j] ^ 0xffff;
+        campos.ttl = 0;
+        campos.rdlength = bordes16[j];
+        camposRREscribir(&campos,rr);
+        camposRRLeer(rr,&leidos);
+        comprobar(leer16(rr + 8) == bordes16[j] && leidos.rdlength == bordes16[j] && leidos.type == bordes16[j]
+                  && leidos._class == (bordes16[j] ^ 0xffff) && leidos.ttl == 0,"RDLENGTH: no vuelve igual",bordes16[j]);
+    }
+    printf(";; codec de cabecera.h: %d comprobaciones, %d fallas\n",comprobaciones,fallas);
+    return fallas;
+}
+
+/** ------------------------------------------------------------------ medición **/
+
+/** Repite la función, duplicando las vueltas, hasta que tarde al menos TIEMPO_MEDICION_MS e imprime la última **/
+static void medir(const MEDICION *m)
+{
+    unsigned long long valores[CANTIDAD_CONTADORES];
+    long long tiempo;
+    long vueltas = 1, i;
+    char reservas[32] = "-", bytes[32] = "-", hardware[96] = "";
+    int silenciar = m->funcion == medirPrintResults, copia = -1, nulo;
+
+    /** printResults escribe en la salida estándar: durante la medición va a /dev/null **/
+    if (silenciar && (nulo = open("/dev/null",O_WRONLY)) >= 0)
+    {
+        fflush(stdout);
+        copia = dup(STDOUT_FILENO);
+        dup2(nulo,STDOUT_FILENO);
+        close(nulo);
+    }
+    for (;;)
+    {
+#ifdef CONTAR_ASIGNACIONES
+        asignaciones = 0;
+        bytesAsignados = 0;
+#endif
+        iniciarContadores();
+        tiempo = nanosegundos();
+        for (i = 0; i < vueltas; i++)
+            m->funcion(i);
+        if (silenciar)
+            fflush(stdout);
+        tiempo = nanosegundos() - tiempo;
+        if (tiempo >= TIEMPO_MEDICION_MS * 1000000LL || vueltas >= (1L << 40))
+            break;
+        vueltas *= 2;
+    }
+    if (copia >= 0)
+    {
+        dup2(copia,STDOUT_FILENO);
+        close(copia);
+    }
+
+#ifdef CONTAR_ASIGNACIONES
+    sprintf(reservas,"%.2f",(double)asignaciones / vueltas);
+    sprintf(bytes,"%.1f",(double)bytesAsignados / vueltas);
+#endif
+    if (leerContadores(valores) == 0)
+        sprintf(hardware," %10.1f %10.1f %10.3f",(double)valores[0] / vueltas,(double)valores[1] / vueltas,(double)valores[2] / vueltas);
+    printf("%-26s %12ld %10.1f %10s %8s%s\n",m->nombre,vueltas,(double)tiempo / vueltas,bytes,reservas,hardware);
+}
+
+static void liberarMedicion(unsigned char *datos)
+{
+    int i;
+    for (i = 0; i < cantidadImpresion; i++)
+        seccionesLiberar(&impresion[i]);
+    seccionesLiberar(&secciones);
+    free(impresion);
+    free(nombres);
+    free(tipos);
+    free(finPregunta);
+    free(duenos);
+    free(campos);
+    free(rdatasLOC);
+    free(mensajes);
+    free(largos);
+    free(datos);
+}
+
+int medicionEjecutar(const char *captura, int usarContadores)
+{
+    unsigned char *datos = NULL;
+    unsigned char rdataLOC[LARGO_LOC];
+    UBICACION ubicacion = {0, 0, 0, 1, 10000, 10};
+    long bytes = 0, i;
+
+    /** antes de medir el codec, que sea correcto **/
+    if (comprobarCodec() > 0)
+        return -1;
+    if (captura != NULL)
+    {
+        if ((cantidadMensajes = repeticionRespuestas(captura,&datos,&mensajes,&largos)) < 0)
+            return -1;
+    }
+    else
+        armarSinteticas();
+    for (i = 0; i < cantidadMensajes; i++)
+        bytes += largos[i];
+    prepararMensajes();
+    if (cantidadMensajes == 0)
+    {
+        printf("ERROR: la captura %s no tiene respuestas con pregunta\n",captura);
+        liberarMedicion(datos);
+        return -1;
+    }
+    /** una captura sin LOC: el codec se mide con uno fijo **/
+    if (cantidadLOC == 0)
+    {
+        locDesdeUbicacion(&ubicacion,rdataLOC);
+        rdatasLOC = malloc(LARGO_LOC);
+        memcpy(rdatasLOC[0],rdataLOC,LARGO_LOC);
+        cantidadLOC = 1;
+    }
+    /** ni un registro en la captura: los campos fijos se miden sobre un A cualquiera **/
+    if (cantidadCampos == 0)
+    {
+        static const unsigned char campoA[TAM_R_DATA] = {0, 1, 0, 1, 0, 0, 0x0e, 0x10, 0, 4};
+        campos = malloc(sizeof(const unsigned char*));
+        campos[0] = campoA;
+        cantidadCampos = 1;
+    }
+
+    printf(";; medición sobre %ld respuestas %s (%ld bytes), %ld nombres de registros, %ld LOC\n",cantidadMensajes,
+           captura != NULL ? captura : "sintéticas",bytes,cantidadDuenos,cantidadLOC);
+#ifndef CONTAR_ASIGNACIONES
+    printf(";; sin conteo de reservas: compilar con el target Perfil (-DCONTAR_ASIGNACIONES y --wrap)\n");
+#endif
+    if (usarContadores)
+        abrirContadores();
+    printf("%-27s %12s %10s %10s %8s%s\n","función","vueltas","ns/op","bytes/op","res/op",
+           contadores[0] >= 0 ? "   ciclos/op   instr/op  fallos/op" : "");
+    for (i = 0; i < (long)(sizeof(mediciones) / sizeof(mediciones[0])); i++)
+        medir(&mediciones[i]);
+
+    for (i = 0; i < CANTIDAD_CONTADORES; i++)
+        if (contadores[i] >= 0)
+            close(contadores[i]);
+    liberarMedicion(datos);
+    return 0;
+}
@@ -0,0 +1,29 @@
+#ifndef MEDICION_H_INCLUDED
+#define MEDICION_H_INCLUDED
+
+/**
+ * Microbenchmarks de las funciones calientes del parser y del codificador (parámetro -medir):
+ * cambiarAlFormatoNombreDNS, el armado de consultas, leerNombre, la lectura y decodificación de
+ * las secciones, printResults (con la salida a /dev/null), el codec LOC y locCentimetros (el
+ * precsize_ntoa de RFC 1876). Corren sobre un juego de respuestas sintéticas (A, MX con NS y glue,
+ * LOC y una cadena CNAME) o sobre las respuestas de una captura (-medir=captura, los formatos de
+ * repeticion.h). Cada función se repite hasta juntar al menos TIEMPO_MEDICION_MS, rotando por
+ * los mensajes, y se informa el tiempo por operación.
+ *
+ * Con el target Perfil de Code::Blocks (-O2 -g -fno-omit-frame-pointer, listo para perf record
+ * -g) el binario se enlaza con --wrap para malloc, calloc y realloc y se informan además las
+ * reservas y los bytes reservados por operación; en los demás targets esas columnas quedan en
+ * "-". Con -contadores se leen los contadores de hardware del proceso (perf_event_open: ciclos,
+ * instrucciones y fallos de cache por operación), si el núcleo los permite.
+ *
+ * Antes de medir se comprueba la ida y vuelta del codec de cabecera.h (todos los indicadores, los
+ * contadores y los bordes de TTL y RDLENGTH); si algo no vuelve igual no se mide nada.
+ **/
+
+#define TIEMPO_MEDICION_MS 200
+#define MAX_PRUEBAS_IMPRESION 256   // respuestas decodificadas de antemano para printResults
+
+/** captura: NULL para las respuestas sintéticas. Devuelve 0, o -1 si no se pudo leer la captura **/
+int medicionEjecutar(const char *captura, int contadores);
+
+#endif // MEDICION_H_INCLUDED
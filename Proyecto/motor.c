@@ -0,0 +1,582 @@
+#define _GNU_SOURCE
+#include<stdio.h>
+#include<string.h>
+#include<stdlib.h>
+#include<errno.h>
+#include<fcntl.h>
+#include<poll.h>
+#include<sys/socket.h>
+#include<arpa/inet.h>
+#include<netinet/in.h>
+#include<unistd.h>
+
+#include "motor.h"
+#include "cabecera.h"
+#include "traza.h"
+#include "vectorial.h"
+#include "ritmo.h"
+#include "paquetes.h"
+#include "aleatorio.h"
+
+/** Respuestas que se leen por cada recvmmsg **/
+#define LOTE_RECEPCION 64
+#define MAX_RESPUESTA_MOTOR 4096
+
+typedef struct
+{
+    int activa;
+    unsigned short id;
+    long long enviado;              // instante del último envío (us)
+    int reintentos;
+    DIRECCION destino;
+    DIRECCION alterna;              // la otra familia del mismo servidor (motorEnviarEscalonado)
+    int estadoAlterna;              // SIN_ALTERNA, ALTERNA_PENDIENTE o ALTERNA_ENVIADA
+    long long primerEnvio;          // para el escalón de la alterna (us)
+    int fallida;                    // el envío falló (red inalcanzable): vence sin esperar el timeout
+    unsigned char *consulta;        // MAX_CONSULTA_MOTOR bytes del pool de paquetes, de la ranura para siempre
+    int largo;
+    int largoPregunta;              // header + question, lo que la respuesta debe repetir
+    RESPUESTA_MOTOR callback;
+    void *contexto;
+} CONSULTA_MOTOR;
+
+/** Estado de la dirección alterna de una consulta **/
+#define SIN_ALTERNA 0
+#define ALTERNA_PENDIENTE 1
+#define ALTERNA_ENVIADA 2
+
+/** Entrada de la cola de vencimientos: como el timeout es fijo, las más viejas están adelante **/
+typedef struct
+{
+    int ranura;
+    long long enviado;
+} VENCIMIENTO;
+
+struct MOTOR
+{
+    int s;
+    int s6;                         // socket IPv6, se abre con el primer destino IPv6 (-1 hasta entonces)
+    int maxEnVuelo;
+    int enVuelo;
+    double qps;
+    double fichas;                  // fichas disponibles del balde (token bucket) de envío
+    long long ultimaRecarga;
+    long long timeout;              // us
+    int reintentos;
+    int usarRitmo;                  // si los envíos pasan por el ritmo compartido (ritmo.h)
+    long long proximoRitmo;         // instante en que el ritmo vuelve a permitir el último destino negado
+    long long escalon;              // us hasta enviar también a la alterna
+    int pendientesEscalon;          // consultas con la alterna sin enviar
+    int fallidas;                   // consultas con el envío fallido, por vencer
+    DIRECCION origen;               // quién respondió la consulta cuyo callback está en curso
+
+    CONSULTA_MOTOR *ranuras;
+    int *libres;                    // pila de ranuras libres
+    int cantidadLibres;
+    int indicePorId[65536];         // ranura de cada ID en vuelo, -1 si está libre
+
+    VENCIMIENTO *cola;              // cola circular de vencimientos
+    int capacidadCola, frente, cantidadCola;
+
+    unsigned char *recepcion[LOTE_RECEPCION];     // buffers de recvmmsg, del pool de paquetes
+
+    ESTADISTICAS_MOTOR estadisticas;
+};
+
+/** Socket UDP no bloqueante de la familia; -1 si no se pudo abrir **/
+static int abrirSocket(int familia)
+{
+    int s = socket(familia,SOCK_DGRAM,IPPROTO_UDP);
+    if (s < 0)
+        return -1;
+    fcntl(s,F_SETFL,fcntl(s,F_GETFL) | O_NONBLOCK);
+    /** un buffer de recepción grande evita perder respuestas en ráfagas **/
+    int tam = 4 * 1024 * 1024;
+    setsockopt(s,SOL_SOCKET,SO_RCVBUF,&tam,sizeof(tam));
+    return s;
+}
+
+MOTOR *motorCrear(int maxEnVuelo, double qps, int timeoutMs, int reintentos)
+{
+    int i;
+    MOTOR *m = (MOTOR*)calloc(1,sizeof(MOTOR));
+    if (m == NULL)
+        return NULL;
+
+    if ((m->s = abrirSocket(AF_INET)) < 0)
+    {
+        free(m);
+        return NULL;
+    }
+    m->s6 = -1;
+    m->escalon = (long long)ESCALON_FAMILIAS_MS * 1000;
+
+    m->maxEnVuelo = maxEnVuelo <= 0 ? 1 : maxEnVuelo > MAX_EN_VUELO_MOTOR ? MAX_EN_VUELO_MOTOR : maxEnVuelo;
+    m->qps = qps;
+    m->fichas = 1;
+    m->ultimaRecarga = trazaMicrosegundos();
+    m->timeout = (long long)timeoutMs * 1000;
+    m->reintentos = reintentos;
+    m->usarRitmo = 1;
+
+    m->ranuras = (CONSULTA_MOTOR*)calloc(m->maxEnVuelo,sizeof(CONSULTA_MOTOR));
+    m->libres = (int*)malloc(m->maxEnVuelo * sizeof(int));
+    for (i = 0; i < m->maxEnVuelo; i++)
+        m->libres[m->cantidadLibres++] = m->maxEnVuelo - 1 - i;
+    for (i = 0; i < 65536; i++)
+        m->indicePorId[i] = -1;
+
+    /** cada intento (primer envío o reintento) deja una entrada en la cola **/
+    m->capacidadCola = m->maxEnVuelo * (reintentos + 1);
+    m->cola = (VENCIMIENTO*)malloc(m->capacidadCola * sizeof(VENCIMIENTO));
+
+    /** los buffers se toman una vez y se reusan en cada consulta y cada recvmmsg; sin lugar en el
+        pool no hay motor (errno queda en ENOMEM para el perror de quien llama) **/
+    for (i = 0; i < m->maxEnVuelo; i++)
+        if ((m->ranuras[i].consulta = paqueteTomar(MAX_CONSULTA_MOTOR)) == NULL)
+        {
+            motorDestruir(m);
+            errno = ENOMEM;
+            return NULL;
+        }
+    for (i = 0; i < LOTE_RECEPCION; i++)
+        if ((m->recepcion[i] = paqueteTomar(MAX_RESPUESTA_MOTOR)) == NULL)
+        {
+            motorDestruir(m);
+            errno = ENOMEM;
+            return NULL;
+        }
+    return m;
+}
+
+void motorDestruir(MOTOR *m)
+{
+    int i;
+    if (m == NULL)
+        return;
+    close(m->s);
+    if (m->s6 >= 0)
+        close(m->s6);
+    for (i = 0; i < m->maxEnVuelo; i++)
+        paqueteDevolver(m->ranuras[i].consulta);
+    for (i = 0; i < LOTE_RECEPCION; i++)
+        paqueteDevolver(m->recepcion[i]);
+    free(m->ranuras);
+    free(m->libres);
+    free(m->cola);
+    free(m);
+}
+
+void motorUsarRitmo(MOTOR *m, int usar)
+{
+    m->usarRitmo = usar;
+}
+
+int motorEnVuelo(MOTOR *m)
+{
+    return m->enVuelo;
+}
+
+ESTADISTICAS_MOTOR motorEstadisticas(MOTOR *m)
+{
+    return m->estadisticas;
+}
+
+/** Recarga el balde según el tiempo transcurrido; la ráfaga máxima es de 10 ms de envíos **/
+static void recargarFichas(MOTOR *m)
+{
+    long long ahora = trazaMicrosegundos();
+    double maximo;
+    if (m->qps <= 0)
+        return;
+    maximo = m->qps / 100 > 1 ? m->qps / 100 : 1;
+    m->fichas += (ahora - m->ultimaRecarga) * m->qps / 1000000.0;
+    if (m->fichas > maximo)
+        m->fichas = maximo;
+    m->ultimaRecarga = ahora;
+}
+
+int motorPuedeEnviar(MOTOR *m)
+{
+    if (m->cantidadLibres == 0)
+        return 0;
+    if (m->qps <= 0)
+        return 1;
+    recargarFichas(m);
+    return m->fichas >= 1;
+}
+
+int motorPuedeEnviarA(MOTOR *m, const DIRECCION *destino)
+{
+    long long espera;
+    if (!motorPuedeEnviar(m))
+        return 0;
+    if (!m->usarRitmo || (espera = ritmoEspera(destino)) == 0)
+        return 1;
+    m->proximoRitmo = trazaMicrosegundos() + espera;
+    return 0;
+}
+
+static void encolarVencimiento(MOTOR *m, int ranura, long long enviado)
+{
+    /** las entradas de consultas ya respondidas quedan hasta su vencimiento, así que con
+        respuestas rápidas la cola puede tener más entradas que consultas en vuelo **/
+    if (m->cantidadCola == m->capacidadCola)
+    {
+        VENCIMIENTO *nueva = (VENCIMIENTO*)malloc(2 * m->capacidadCola * sizeof(VENCIMIENTO));
+        int i;
+        for (i = 0; i < m->cantidadCola; i++)
+            nueva[i] = m->cola[(m->frente + i) % m->capacidadCola];
+        free(m->cola);
+        m->cola = nueva;
+        m->frente = 0;
+        m->capacidadCola *= 2;
+    }
+    int fin = (m->frente + m->cantidadCola) % m->capacidadCola;
+    m->cola[fin].ranura = ranura;
+    m->cola[fin].enviado = enviado;
+    m->cantidadCola++;
+}
+
+/** Envía la consulta de la ranura a una dirección; -1 si la red la rechaza (sin ruta, sin IPv6...) **/
+static int enviarA(MOTOR *m, CONSULTA_MOTOR *c, const DIRECCION *destino)
+{
+    int s = m->s;
+    if (destino->sa.sa_family == AF_INET6)
+    {
+        if (m->s6 < 0)
+            m->s6 = abrirSocket(AF_INET6);
+        if ((s = m->s6) < 0)
+            return -1;
+    }
+    if (sendto(s,c->consulta,c->largo,0,&destino->sa,direccionLargo(destino)) < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+        return -1;
+    return 0;
+}
+
+static void enviarRanura(MOTOR *m, int ranura)
+{
+    CONSULTA_MOTOR *c = &m->ranuras[ranura];
+    c->enviado = trazaMicrosegundos();
+    int error = enviarA(m,c,&c->destino);
+    /** si la familia del destino no tiene salida, la alterna sale ya, sin esperar el escalón **/
+    if (error < 0 && c->estadoAlterna == ALTERNA_PENDIENTE)
+    {
+        c->destino = c->alterna;
+        c->estadoAlterna = SIN_ALTERNA;
+        m->pendientesEscalon--;
+        error = enviarA(m,c,&c->destino);
+    }
+    else if (c->estadoAlterna == ALTERNA_ENVIADA && enviarA(m,c,&c->alterna) == 0)
+        error = 0;
+    if (error < 0 && !c->fallida)
+    {
+        c->fallida = 1;
+        m->fallidas++;
+    }
+    if (m->qps > 0)
+        m->fichas -= 1;
+    encolarVencimiento(m,ranura,c->enviado);
+}
+
+/** Envía a la alterna las consultas que pasaron el escalón sin respuesta; devuelve los us hasta el próximo escalón, o -1 **/
+static long long enviarAlternas(MOTOR *m)
+{
+    long long ahora = trazaMicrosegundos(), proximo = -1;
+    int ranura;
+    for (ranura = 0; ranura < m->maxEnVuelo && m->pendientesEscalon > 0; ranura++)
+    {
+        CONSULTA_MOTOR *c = &m->ranuras[ranura];
+        if (!c->activa || c->estadoAlterna != ALTERNA_PENDIENTE)
+            continue;
+        long long falta = c->primerEnvio + m->escalon - ahora;
+        if (falta > 0)
+        {
+            if (proximo < 0 || falta < proximo)
+                proximo = falta;
+            continue;
+        }
+        m->pendientesEscalon--;
+        c->estadoAlterna = enviarA(m,c,&c->alterna) == 0 ? ALTERNA_ENVIADA : SIN_ALTERNA;
+    }
+    return proximo;
+}
+
+/** Largo del header más la sección Question de una consulta (un solo nombre sin comprimir) **/
+static int largoPregunta(const unsigned char *consulta, int largo)
+{
+    int pos = 12;
+    while (pos < largo && consulta[pos] != 0)
+    {
+        if (consulta[pos] >= 64)
+            return -1;
+        pos += consulta[pos] + 1;
+    }
+    pos += 1 + 4;
+    return pos <= largo ? pos : -1;
+}
+
+int motorEnviar(MOTOR *m, const DIRECCION *destino, const unsigned char *consulta, int largo,
+                RESPUESTA_MOTOR callback, void *contexto)
+{
+    return motorEnviarEscalonado(m,destino,NULL,consulta,largo,callback,contexto);
+}
+
+int motorEnviarEscalonado(MOTOR *m, const DIRECCION *destino, const DIRECCION *alterna, const unsigned char *consulta,
+                          int largo, RESPUESTA_MOTOR callback, void *contexto)
+{
+    int ranura, pregunta;
+    unsigned short id;
+    if (m->cantidadLibres == 0 || largo > MAX_CONSULTA_MOTOR || (pregunta = largoPregunta(consulta,largo)) < 0)
+        return -1;
+    if (m->usarRitmo && ritmoTomar(destino) < 0)
+        return -1;
+
+    /** ID aleatorio (aleatorio.h) que no esté en uso: con a lo sumo MAX_EN_VUELO_MOTOR ocupados siempre hay libres **/
+    do
+        id = aleatorioId();
+    while (m->indicePorId[id] != -1);
+
+    ranura = m->libres[--m->cantidadLibres];
+    CONSULTA_MOTOR *c = &m->ranuras[ranura];
+    c->activa = 1;
+    c->id = id;
+    c->reintentos = 0;
+    c->destino = *destino;
+    c->estadoAlterna = SIN_ALTERNA;
+    if (alterna != NULL)
+    {
+        c->alterna = *alterna;
+        c->estadoAlterna = ALTERNA_PENDIENTE;
+        m->pendientesEscalon++;
+    }
+    c->fallida = 0;
+    c->primerEnvio = trazaMicrosegundos();
+    memcpy(c->consulta,consulta,largo);
+    escribir16(c->consulta,id);
+    c->largo = largo;
+    c->largoPregunta = pregunta;
+    c->callback = callback;
+    c->contexto = contexto;
+    m->indicePorId[id] = ranura;
+    m->enVuelo++;
+    m->estadisticas.enviadas++;
+
+    enviarRanura(m,ranura);
+    return 0;
+}
+
+static void liberarRanura(MOTOR *m, int ranura)
+{
+    CONSULTA_MOTOR *c = &m->ranuras[ranura];
+    c->activa = 0;
+    if (c->estadoAlterna == ALTERNA_PENDIENTE)
+        m->pendientesEscalon--;
+    c->estadoAlterna = SIN_ALTERNA;
+    if (c->fallida)
+        m->fallidas--;
+    c->fallida = 0;
+    m->indicePorId[c->id] = -1;
+    m->libres[m->cantidadLibres++] = ranura;
+    m->enVuelo--;
+}
+
+int motorCancelar(MOTOR *m, void *contexto)
+{
+    int ranura, canceladas = 0;
+    for (ranura = 0; ranura < m->maxEnVuelo; ranura++)
+        if (m->ranuras[ranura].activa && m->ranuras[ranura].contexto == contexto)
+        {
+            /** la entrada de la cola de vencimientos queda vieja y se saltea sola **/
+            if (m->usarRitmo)
+                ritmoSoltar();
+            liberarRanura(m,ranura);
+            canceladas++;
+        }
+    return canceladas;
+}
+
+/** Compara la sección Question sin distinguir mayúsculas (algunos servidores la normalizan) **/
+static int mismaPregunta(const unsigned char *a, const unsigned char *b, int largo)
+{
+    return vectorialIgualesSinMayusculas(a + 12,b + 12,largo - 12);
+}
+
+static void procesarRespuesta(MOTOR *m, unsigned char *respuesta, int largo, DIRECCION *origen)
+{
+    int ranura;
+    CONSULTA_MOTOR *c;
+    CABECERA_DNS cabecera;
+    if (largo < TAM_CABECERA || (ranura = m->indicePorId[leer16(respuesta)]) < 0)
+    {
+        m->estadisticas.descartadas++;
+        return;
+    }
+    c = &m->ranuras[ranura];
+    cabeceraLeer(respuesta,&cabecera);
+    /** la respuesta debe venir del servidor consultado (por cualquiera de sus direcciones) y repetir la pregunta **/
+    if (!cabecera.qr
+            || !(direccionIgual(origen,&c->destino) || (c->estadoAlterna == ALTERNA_ENVIADA && direccionIgual(origen,&c->alterna)))
+            || largo < c->largoPregunta || !mismaPregunta(respuesta,c->consulta,c->largoPregunta))
+    {
+        m->estadisticas.descartadas++;
+        return;
+    }
+    m->estadisticas.respuestas++;
+    RESPUESTA_MOTOR callback = c->callback;
+    void *contexto = c->contexto;
+    long long rtt = trazaMicrosegundos() - c->enviado;
+    int inicio = c->largoPregunta;
+    if (m->usarRitmo)
+        ritmoResultado(&c->destino,ritmoClasificarRcode(cabecera.rcode));
+    /** libero antes del callback, así el callback puede enviar una nueva consulta **/
+    liberarRanura(m,ranura);
+    m->origen = *origen;
+    callback(contexto,respuesta,largo,inicio,rtt,MOTOR_RESPUESTA);
+}
+
+/** Termina la consulta con MOTOR_TIMEOUT **/
+static void vencer(MOTOR *m, int ranura, long long rtt)
+{
+    CONSULTA_MOTOR *c = &m->ranuras[ranura];
+    RESPUESTA_MOTOR callback = c->callback;
+    void *contexto = c->contexto;
+    m->estadisticas.timeouts++;
+    if (m->usarRitmo)
+        ritmoResultado(&c->destino,RITMO_TIMEOUT);
+    m->origen = c->destino;
+    liberarRanura(m,ranura);
+    callback(contexto,NULL,0,0,rtt,MOTOR_TIMEOUT);
+}
+
+static void vencerTimeouts(MOTOR *m)
+{
+    long long ahora = trazaMicrosegundos();
+    int ranura;
+    /** las que no pudieron salir no tienen nada que esperar ni sentido reintentar **/
+    for (ranura = 0; ranura < m->maxEnVuelo && m->fallidas > 0; ranura++)
+        if (m->ranuras[ranura].activa && m->ranuras[ranura].fallida)
+            vencer(m,ranura,0);
+    while (m->cantidadCola > 0)
+    {
+        VENCIMIENTO *v = &m->cola[m->frente];
+        if (v->enviado + m->timeout > ahora)
+            break;
+        ranura = v->ranura;
+        long long enviado = v->enviado;
+        m->frente = (m->frente + 1) % m->capacidadCola;
+        m->cantidadCola--;
+
+        CONSULTA_MOTOR *c = &m->ranuras[ranura];
+        /** la entrada es vieja si la consulta ya se respondió o se volvió a enviar **/
+        if (!c->activa || c->enviado != enviado)
+            continue;
+        if (c->reintentos < m->reintentos)
+        {
+            c->reintentos++;
+            m->estadisticas.reintentos++;
+            if (m->usarRitmo)
+                ritmoReintento(&c->destino);
+            enviarRanura(m,ranura);
+        }
+        else
+            vencer(m,ranura,ahora - enviado);
+    }
+}
+
+/** Lee todo lo que haya en el socket, en lotes de recvmmsg; devuelve las respuestas procesadas **/
+static int recibir(MOTOR *m, int s)
+{
+    struct mmsghdr mensajes[LOTE_RECEPCION];
+    struct iovec vectores[LOTE_RECEPCION];
+    DIRECCION origenes[LOTE_RECEPCION];
+    int procesadas = 0, i, n;
+    do
+    {
+        for (i = 0; i < LOTE_RECEPCION; i++)
+        {
+            vectores[i].iov_base = m->recepcion[i];
+            vectores[i].iov_len = MAX_RESPUESTA_MOTOR;
+            memset(&mensajes[i].msg_hdr,0,sizeof(mensajes[i].msg_hdr));
+            mensajes[i].msg_hdr.msg_iov = &vectores[i];
+            mensajes[i].msg_hdr.msg_iovlen = 1;
+            mensajes[i].msg_hdr.msg_name = &origenes[i];
+            mensajes[i].msg_hdr.msg_namelen = sizeof(origenes[i]);
+        }
+        n = recvmmsg(s,mensajes,LOTE_RECEPCION,MSG_DONTWAIT,NULL);
+        for (i = 0; i < n; i++)
+            procesarRespuesta(m,m->recepcion[i],mensajes[i].msg_len,&origenes[i]);
+        if (n > 0)
+            procesadas += n;
+    }
+    while (n == LOTE_RECEPCION);
+    return procesadas;
+}
+
+int motorProcesar(MOTOR *m, int esperaMs)
+{
+    struct pollfd pfd[2];
+    int procesadas = 0, sockets = 1;
+
+    /** no espero más allá del próximo vencimiento **/
+    if (m->cantidadCola > 0)
+    {
+        long long falta = (m->cola[m->frente].enviado + m->timeout - trazaMicrosegundos()) / 1000;
+        if (falta < esperaMs)
+            esperaMs = falta < 0 ? 0 : (int)falta;
+    }
+    /** ni más allá del próximo escalón hacia una alterna, y nada si hay envíos fallidos por vencer **/
+    if (m->pendientesEscalon > 0)
+    {
+        long long falta = enviarAlternas(m);
+        if (falta >= 0 && (falta + 999) / 1000 < esperaMs)
+            esperaMs = (int)((falta + 999) / 1000);
+    }
+    if (m->fallidas > 0)
+        esperaMs = 0;
+    /** ni más allá de la próxima ficha, si hay lugar para enviar y sólo falta la ficha **/
+    if (m->qps > 0 && m->cantidadLibres > 0)
+    {
+        recargarFichas(m);
+        if (m->fichas < 1)
+        {
+            int falta = (int)((1 - m->fichas) * 1000 / m->qps) + 1;
+            if (falta < esperaMs)
+                esperaMs = falta;
+        }
+    }
+    /** ni más allá del momento en que el ritmo vuelva a permitir el destino negado **/
+    if (m->proximoRitmo > 0 && m->cantidadLibres > 0)
+    {
+        long long falta = (m->proximoRitmo - trazaMicrosegundos() + 999) / 1000;
+        if (falta < esperaMs)
+            esperaMs = falta < 0 ? 0 : (int)falta;
+        m->proximoRitmo = 0;
+    }
+    pfd[0].fd = m->s;
+    pfd[0].events = POLLIN;
+    pfd[0].revents = 0;
+    if (m->s6 >= 0)
+    {
+        pfd[1].fd = m->s6;
+        pfd[1].events = POLLIN;
+        pfd[1].revents = 0;
+        sockets = 2;
+    }
+    if (poll(pfd,sockets,esperaMs) > 0)
+    {
+        if (pfd[0].revents & POLLIN)
+            procesadas += recibir(m,m->s);
+        if (sockets == 2 && (pfd[1].revents & POLLIN))
+            procesadas += recibir(m,m->s6);
+    }
+    if (m->pendientesEscalon > 0)
+        enviarAlternas(m);
+    vencerTimeouts(m);
+    return procesadas;
+}
+
+const DIRECCION *motorOrigen(MOTOR *m)
+{
+    return &m->origen;
+}
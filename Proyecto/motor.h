@@ -0,0 +1,102 @@
+#ifndef MOTOR_H_INCLUDED
+#define MOTOR_H_INCLUDED
+
+#include "direcciones.h"
+
+/**
+ * Motor de consultas UDP no bloqueante, sobre IPv4 e IPv6 (un socket por familia).
+ * A diferencia de resolverConsulta (un sendto y un recvfrom bloqueante por consulta), el motor
+ * mantiene muchas consultas en vuelo sobre un mismo socket, las empareja con sus respuestas por
+ * ID, dirección de origen y sección Question, y se encarga de los timeouts, los reintentos y de
+ * no superar una tasa de envío (QPS) y una cantidad máxima de consultas en vuelo.
+ *
+ * Uso típico:
+ *      while (quedanConsultas || motorEnVuelo(m) > 0) {
+ *          while (quedanConsultas && motorPuedeEnviarA(m, destino))
+ *              motorEnviar(m, ...);
+ *          motorProcesar(m, 100);
+ *      }
+ *
+ * Además de su propio tope, cada envío pasa por el ritmo compartido del proceso (ritmo.h): la tasa
+ * de cada destino y el tope global de consultas en vuelo, que se adaptan a los errores y timeouts.
+ **/
+
+/** Tamaño máximo de una consulta que el motor guarda para reintentar **/
+#define MAX_CONSULTA_MOTOR 512
+#define MAX_EN_VUELO_MOTOR 32768    // la mitad de los IDs: sortear uno libre lleva pocos intentos
+
+/** Resultado que recibe el callback **/
+#define MOTOR_RESPUESTA 0
+#define MOTOR_TIMEOUT -1
+
+/**
+ * Callback de una consulta: respuesta/largo es el mensaje recibido (válido sólo durante la
+ * llamada), inicioRespuestas el desplazamiento de la sección Answer, rtt el tiempo desde el
+ * último envío en microsegundos, y estado MOTOR_RESPUESTA o MOTOR_TIMEOUT.
+ **/
+typedef void (*RESPUESTA_MOTOR)(void *contexto, unsigned char *respuesta, int largo, int inicioRespuestas,
+                                long long rtt, int estado);
+
+typedef struct MOTOR MOTOR;
+
+/**
+ * maxEnVuelo: consultas simultáneas como máximo (se recorta a MAX_EN_VUELO_MOTOR); qps: envíos por segundo (0 = sin límite);
+ * timeoutMs: espera por cada intento; reintentos: reenvíos antes de informar MOTOR_TIMEOUT.
+ **/
+MOTOR *motorCrear(int maxEnVuelo, double qps, int timeoutMs, int reintentos);
+void motorDestruir(MOTOR *m);
+
+/** 1 si hay lugar en vuelo y la tasa de envío permite mandar otra consulta ahora **/
+int motorPuedeEnviar(MOTOR *m);
+
+/** Como motorPuedeEnviar, y además el ritmo compartido permite enviar a destino **/
+int motorPuedeEnviarA(MOTOR *m, const DIRECCION *destino);
+
+/** Activa (por defecto) o desactiva el ritmo compartido; la prueba de carga lo desactiva **/
+void motorUsarRitmo(MOTOR *m, int usar);
+
+/**
+ * Envía una consulta ya armada (el motor le asigna el ID). Devuelve 0, o -1 si no hay lugar,
+ * el ritmo no lo permite o la consulta es demasiado grande.
+ **/
+int motorEnviar(MOTOR *m, const DIRECCION *destino, const unsigned char *consulta, int largo,
+                RESPUESTA_MOTOR callback, void *contexto);
+
+/**
+ * Como motorEnviar, para un servidor con direcciones de las dos familias: si destino no responde
+ * en ESCALON_FAMILIAS_MS (o su familia no tiene salida) la misma consulta sale también hacia
+ * alterna, y vale la primera respuesta de cualquiera de las dos (ver direcciones.h).
+ **/
+int motorEnviarEscalonado(MOTOR *m, const DIRECCION *destino, const DIRECCION *alterna, const unsigned char *consulta,
+                          int largo, RESPUESTA_MOTOR callback, void *contexto);
+
+/**
+ * Abandona las consultas en vuelo con ese contexto: no se vuelven a enviar, su respuesta (si
+ * llega) se descarta y el callback no se llama. Devuelve cuántas se cancelaron.
+ **/
+int motorCancelar(MOTOR *m, void *contexto);
+
+/**
+ * Una vuelta del lazo de eventos: recibe respuestas (en lotes), vence timeouts y reintenta.
+ * Espera como máximo esperaMs si no hay nada para hacer. Devuelve las respuestas procesadas.
+ **/
+int motorProcesar(MOTOR *m, int esperaMs);
+
+int motorEnVuelo(MOTOR *m);
+
+/** Durante un callback: la dirección que respondió (con MOTOR_TIMEOUT, la última consultada) **/
+const DIRECCION *motorOrigen(MOTOR *m);
+
+/** Estadísticas acumuladas **/
+typedef struct
+{
+    long enviadas;
+    long reintentos;
+    long respuestas;
+    long timeouts;
+    long descartadas;   /** respuestas que no corresponden a ninguna consulta en vuelo **/
+} ESTADISTICAS_MOTOR;
+
+ESTADISTICAS_MOTOR motorEstadisticas(MOTOR *m);
+
+#endif // MOTOR_H_INCLUDED
@@ -0,0 +1,821 @@
+#include<stdio.h>
+#include<string.h>
+#include<stdlib.h>
+#include<time.h>
+#include<pthread.h>
+
+#include "dns.h"
+#include "nombres.h"
+#include "negativas.h"
+
+#define LARGO_SHA1 20
+#define MAX_PRUEBAS 3
+
+/** Un NSEC guardado: el RDATA queda sin comprimir (el siguiente nombre y el mapa de tipos) **/
+typedef struct
+{
+    NOMBRE_DNS dueno;
+    unsigned char *rdata;
+    uint16_t largoRdata;
+    uint16_t mapa;                  // dónde empieza el mapa de tipos en rdata
+    uint32_t vence;
+} NSEC_GUARDADO;
+
+/** Un NSEC3 guardado: el hash del dueño (el primer label, decodificado) y el RDATA tal como vino **/
+typedef struct
+{
+    unsigned char hash[LARGO_SHA1];
+    unsigned char *rdata;
+    uint16_t largoRdata;
+    uint16_t siguiente;             // dónde empieza el siguiente hash en rdata
+    uint16_t mapa;
+    uint32_t vence;
+} NSEC3_GUARDADO;
+
+typedef struct
+{
+    NOMBRE_DNS apex;
+    unsigned char soa[2 * 255 + 20];        // RDATA del SOA sin comprimir
+    int largoSoa;
+    uint32_t venceSoa;
+    NSEC_GUARDADO *nsec;
+    int cantidadNsec, capacidadNsec;
+    NSEC3_GUARDADO *nsec3;
+    int cantidadNsec3, capacidadNsec3;
+    int iteraciones, largoSal;      // parámetros de NSEC3 de la zona
+    unsigned char sal[255];
+} ZONA_NEGATIVA;
+
+/** La prueba encontrada para una consulta: los registros que van en authority **/
+typedef struct
+{
+    ZONA_NEGATIVA *zona;
+    int rcode;
+    int esNsec3;
+    int cantidad;
+    int indices[MAX_PRUEBAS];
+    uint32_t ttl;
+} PRUEBA;
+
+static ZONA_NEGATIVA *zonas[MAX_ZONAS_NEGATIVAS];
+static int cantidadZonas, activas;
+static long sintetizadas, guardados;
+static pthread_mutex_t candado = PTHREAD_MUTEX_INITIALIZER;
+
+static uint32_t rotar(uint32_t x, int n)
+{
+    return (x << n) | (x >> (32 - n));
+}
+
+/** SHA-1 (RFC 3174), el único hash de NSEC3; las entradas son cortas (nombre y sal) **/
+static void sha1(const unsigned char *datos, int largo, unsigned char *salida)
+{
+    unsigned char bloques[640];
+    uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0}, w[80];
+    uint64_t bits = (uint64_t)largo * 8;
+    int total = ((largo + 8) / 64 + 1) * 64, i, j;
+
+    memcpy(bloques,datos,largo);
+    bloques[largo] = 0x80;
+    memset(bloques + largo + 1,0,total - largo - 1);
+    for (i = 0; i < 8; i++)
+        bloques[total - 1 - i] = bits >> (8 * i);
+    for (j = 0; j < total; j += 64)
+    {
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (i = 0; i < 16; i++)
+            w[i] = leer32(bloques + j + 4 * i);
+        for (; i < 80; i++)
+            w[i] = rotar(w[i-3] ^ w[i-8] ^ w[i-14] ^ w[i-16],1);
+        for (i = 0; i < 80; i++)
+        {
+            uint32_t f, k;
+            if (i < 20)
+            {
+                f = (b & c) | (~b & d);
+                k = 0x5A827999;
+            }
+            else if (i < 40)
+            {
+                f = b ^ c ^ d;
+                k = 0x6ED9EBA1;
+            }
+            else if (i < 60)
+            {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8F1BBCDC;
+            }
+            else
+            {
+                f = b ^ c ^ d;
+                k = 0xCA62C1D6;
+            }
+            uint32_t t = rotar(a,5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = rotar(b,30);
+            b = a;
+            a = t;
+        }
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+    }
+    for (i = 0; i < 5; i++)
+        escribir32(salida + 4 * i,h[i]);
+}
+
+/** Hash NSEC3 de un nombre (RFC 5155 5): SHA-1 del nombre y la sal, repetido con cada resultado **/
+static void hashNsec3(const ZONA_NEGATIVA *z, const NOMBRE_DNS *nombre, unsigned char *salida)
+{
+    unsigned char entrada[255 + 255];
+    int i;
+    memcpy(entrada,nombre->wire,nombre->largo);
+    memcpy(entrada + nombre->largo,z->sal,z->largoSal);
+    sha1(entrada,nombre->largo + z->largoSal,salida);
+    for (i = 0; i < z->iteraciones; i++)
+    {
+        memcpy(entrada,salida,LARGO_SHA1);
+        memcpy(entrada + LARGO_SHA1,z->sal,z->largoSal);
+        sha1(entrada,LARGO_SHA1 + z->largoSal,salida);
+    }
+}
+
+/** Decodifica base32hex (el primer label del dueño de un NSEC3); la cantidad de bytes o -1 **/
+static int desdeBase32Hex(const unsigned char *texto, int largo, unsigned char *salida, int max)
+{
+    uint32_t acumulado = 0;
+    int bits = 0, n = 0, i;
+    for (i = 0; i < largo; i++)
+    {
+        int c = texto[i], valor;
+        if (c >= '0' && c <= '9')
+            valor = c - '0';
+        else if (c >= 'a' && c <= 'v')
+            valor = c - 'a' + 10;
+        else
+            return -1;
+        acumulado = (acumulado << 5) | valor;
+        bits += 5;
+        if (bits >= 8)
+        {
+            if (n == max)
+                return -1;
+            salida[n++] = acumulado >> (bits - 8);
+            bits -= 8;
+        }
+    }
+    return n;
+}
+
+static void aBase32Hex(const unsigned char *datos, int largo, unsigned char *salida)
+{
+    static const char alfabeto[] = "0123456789abcdefghijklmnopqrstuv";
+    uint32_t acumulado = 0;
+    int bits = 0, i;
+    for (i = 0; i < largo; i++)
+    {
+        acumulado = (acumulado << 8) | datos[i];
+        bits += 8;
+        while (bits >= 5)
+        {
+            *salida++ = alfabeto[(acumulado >> (bits - 5)) & 31];
+            bits -= 5;
+        }
+    }
+    if (bits > 0)
+        *salida = alfabeto[(acumulado << (5 - bits)) & 31];
+}
+
+/** Verifica el formato de un mapa de tipos: ventanas crecientes de 1 a 32 bytes **/
+static int mapaValido(const unsigned char *mapa, int largo)
+{
+    int pos = 0, anterior = -1;
+    while (pos < largo)
+    {
+        if (pos + 2 > largo || mapa[pos] <= anterior || mapa[pos+1] < 1 || mapa[pos+1] > 32 || pos + 2 + mapa[pos+1] > largo)
+            return 0;
+        anterior = mapa[pos];
+        pos += 2 + mapa[pos+1];
+    }
+    return 1;
+}
+
+static int tipoEnMapa(const unsigned char *mapa, int largo, int tipo)
+{
+    int pos = 0;
+    while (pos + 2 <= largo)
+    {
+        int bytes = mapa[pos+1];
+        if (mapa[pos] == tipo >> 8)
+            return (tipo & 0xff) / 8 < bytes && (mapa[pos + 2 + (tipo & 0xff) / 8] & (0x80 >> (tipo & 7)));
+        pos += 2 + bytes;
+    }
+    return 0;
+}
+
+/**
+ * Un dueño con este mapa no sirve como prueba para nombres debajo (o para otro tipo que DS):
+ * un NS sin SOA es un corte de delegación, y un DNAME redirige todo lo que cuelga de él.
+ **/
+static int esCorte(const unsigned char *mapa, int largo)
+{
+    return (tipoEnMapa(mapa,largo,T_NS) && !tipoEnMapa(mapa,largo,T_SOA)) || tipoEnMapa(mapa,largo,T_DNAME);
+}
+
+/** Cuántos labels tienen en común a y b desde la derecha **/
+static int etiquetasComunes(const NOMBRE_DNS *a, const NOMBRE_DNS *b)
+{
+    int n = 0;
+    while (n < a->cantidadEtiquetas && n < b->cantidadEtiquetas)
+    {
+        const unsigned char *x = a->wire + a->etiquetas[a->cantidadEtiquetas - 1 - n];
+        const unsigned char *y = b->wire + b->etiquetas[b->cantidadEtiquetas - 1 - n];
+        if (x[0] != y[0] || memcmp(x + 1,y + 1,x[0]) != 0)
+            break;
+        n++;
+    }
+    return n;
+}
+
+/** El ancestro de nombre que tiene sus últimos etiquetas labels **/
+static void ancestro(const NOMBRE_DNS *nombre, int etiquetas, NOMBRE_DNS *destino)
+{
+    int inicio = etiquetas == 0 ? nombre->largo - 1 : nombre->etiquetas[nombre->cantidadEtiquetas - etiquetas];
+    nombreDesdeWire(nombre->wire + inicio,nombre->largo - inicio,destino);
+}
+
+/** El comodín *.nombre; -1 si no entra en 255 bytes **/
+static int comodin(const NOMBRE_DNS *nombre, NOMBRE_DNS *destino)
+{
+    unsigned char wire[257] = {1, '*'};
+    if (nombre->largo + 2 > 255)
+        return -1;
+    memcpy(wire + 2,nombre->wire,nombre->largo);
+    return nombreDesdeWire(wire,nombre->largo + 2,destino);
+}
+
+/** La zona guardada más profunda que contiene al nombre, o NULL **/
+static ZONA_NEGATIVA *zonaDe(const NOMBRE_DNS *nombre)
+{
+    ZONA_NEGATIVA *mejor = NULL;
+    int i;
+    for (i = 0; i < cantidadZonas; i++)
+        if (nombreEsSubdominio(nombre,&zonas[i]->apex)
+                && (mejor == NULL || zonas[i]->apex.cantidadEtiquetas > mejor->apex.cantidadEtiquetas))
+            mejor = zonas[i];
+    return mejor;
+}
+
+static ZONA_NEGATIVA *zonaCrear(const NOMBRE_DNS *apex)
+{
+    int i;
+    for (i = 0; i < cantidadZonas; i++)
+        if (nombreIgual(&zonas[i]->apex,apex))
+            return zonas[i];
+    if (cantidadZonas == MAX_ZONAS_NEGATIVAS)
+        return NULL;
+    ZONA_NEGATIVA *z = (ZONA_NEGATIVA*)calloc(1,sizeof(ZONA_NEGATIVA));
+    z->apex = *apex;
+    z->iteraciones = -1;
+    zonas[cantidadZonas++] = z;
+    return z;
+}
+
+/** Índice del último NSEC con dueño menor o igual al nombre (en orden canónico), o -1 **/
+static int nsecAnterior(const ZONA_NEGATIVA *z, const NOMBRE_DNS *nombre)
+{
+    int bajo = 0, alto = z->cantidadNsec - 1, encontrado = -1;
+    while (bajo <= alto)
+    {
+        int medio = (bajo + alto) / 2;
+        if (nombreCompararCanonico(&z->nsec[medio].dueno,nombre) <= 0)
+        {
+            encontrado = medio;
+            bajo = medio + 1;
+        }
+        else
+            alto = medio - 1;
+    }
+    return encontrado;
+}
+
+static int nsec3Anterior(const ZONA_NEGATIVA *z, const unsigned char *hash)
+{
+    int bajo = 0, alto = z->cantidadNsec3 - 1, encontrado = -1;
+    while (bajo <= alto)
+    {
+        int medio = (bajo + alto) / 2;
+        if (memcmp(z->nsec3[medio].hash,hash,LARGO_SHA1) <= 0)
+        {
+            encontrado = medio;
+            bajo = medio + 1;
+        }
+        else
+            alto = medio - 1;
+    }
+    return encontrado;
+}
+
+/** El NSEC vigente cuyo dueño es el nombre, o -1 **/
+static int nsecIgual(const ZONA_NEGATIVA *z, const NOMBRE_DNS *nombre, uint32_t ahora)
+{
+    int i = nsecAnterior(z,nombre);
+    if (i < 0 || z->nsec[i].vence <= ahora || !nombreIgual(&z->nsec[i].dueno,nombre))
+        return -1;
+    return i;
+}
+
+/**
+ * El NSEC vigente que cubre el nombre (dueño < nombre < siguiente), o -1. El último de la
+ * cadena apunta de vuelta al apex y cubre todo lo que va después de su dueño.
+ **/
+static int nsecCubre(const ZONA_NEGATIVA *z, const NOMBRE_DNS *nombre, uint32_t ahora)
+{
+    NOMBRE_DNS siguiente;
+    int i = nsecAnterior(z,nombre);
+    if (i < 0)
+        i = z->cantidadNsec - 1;
+    if (i < 0 || z->nsec[i].vence <= ahora)
+        return -1;
+    const NSEC_GUARDADO *n = &z->nsec[i];
+    if (nombreDesdeWire(n->rdata,n->mapa,&siguiente) < 0)
+        return -1;
+    int despues = nombreCompararCanonico(nombre,&n->dueno) > 0;
+    int antes = nombreCompararCanonico(nombre,&siguiente) < 0;
+    if (nombreCompararCanonico(&siguiente,&n->dueno) > 0)
+        return despues && antes ? i : -1;
+    return despues || antes ? i : -1;
+}
+
+static int nsec3Igual(const ZONA_NEGATIVA *z, const unsigned char *hash, uint32_t ahora)
+{
+    int i = nsec3Anterior(z,hash);
+    if (i < 0 || z->nsec3[i].vence <= ahora || memcmp(z->nsec3[i].hash,hash,LARGO_SHA1) != 0)
+        return -1;
+    return i;
+}
+
+static int nsec3Cubre(const ZONA_NEGATIVA *z, const unsigned char *hash, uint32_t ahora)
+{
+    int i = nsec3Anterior(z,hash);
+    if (i < 0)
+        i = z->cantidadNsec3 - 1;
+    if (i < 0 || z->nsec3[i].vence <= ahora)
+        return -1;
+    const NSEC3_GUARDADO *n = &z->nsec3[i];
+    const unsigned char *siguiente = n->rdata + n->siguiente;
+    int despues = memcmp(hash,n->hash,LARGO_SHA1) > 0;
+    int antes = memcmp(hash,siguiente,LARGO_SHA1) < 0;
+    if (memcmp(siguiente,n->hash,LARGO_SHA1) > 0)
+        return despues && antes ? i : -1;
+    return despues || antes ? i : -1;
+}
+
+static void agregarPrueba(PRUEBA *p, int indice, uint32_t vence, uint32_t ahora)
+{
+    int i;
+    for (i = 0; i < p->cantidad; i++)
+        if (p->indices[i] == indice)
+            return;
+    p->indices[p->cantidad++] = indice;
+    if (vence - ahora < p->ttl)
+        p->ttl = vence - ahora;
+}
+
+/** NODATA o NXDOMAIN con NSEC (RFC 4035 5.4) **/
+static int probarNsec(ZONA_NEGATIVA *z, const NOMBRE_DNS *nombre, int tipo, uint32_t ahora, PRUEBA *p)
+{
+    NOMBRE_DNS siguiente, encerrador, asterisco;
+    int i = nsecIgual(z,nombre,ahora), j;
+    if (i >= 0)
+    {
+        const NSEC_GUARDADO *n = &z->nsec[i];
+        const unsigned char *mapa = n->rdata + n->mapa;
+        int largo = n->largoRdata - n->mapa;
+        /** el tipo o un CNAME existen; un corte sólo prueba algo para DS, y el apex de una hija nada para DS **/
+        if (tipoEnMapa(mapa,largo,tipo) || tipoEnMapa(mapa,largo,T_CNAME)
+                || (tipo != T_DS && esCorte(mapa,largo)) || (tipo == T_DS && tipoEnMapa(mapa,largo,T_SOA)))
+            return 0;
+        agregarPrueba(p,i,n->vence,ahora);
+        p->rcode = 0;
+        return NEGATIVA_NODATA;
+    }
+    if ((i = nsecCubre(z,nombre,ahora)) < 0)
+        return 0;
+    const NSEC_GUARDADO *n = &z->nsec[i];
+    /** si el dueño es un ancestro y es un corte, el nombre está en otra zona (o redirigido) **/
+    if (nombreEsSubdominio(nombre,&n->dueno) && esCorte(n->rdata + n->mapa,n->largoRdata - n->mapa))
+        return 0;
+    if (nombreDesdeWire(n->rdata,n->mapa,&siguiente) < 0)
+        return 0;
+    /** el encerrador más cercano es el ancestro más largo que comparte con el dueño o el siguiente **/
+    int comunes = etiquetasComunes(nombre,&n->dueno), conSiguiente = etiquetasComunes(nombre,&siguiente);
+    if (conSiguiente > comunes)
+        comunes = conSiguiente;
+    if (comunes < z->apex.cantidadEtiquetas || comunes >= nombre->cantidadEtiquetas)
+        return 0;
+    ancestro(nombre,comunes,&encerrador);
+    if (comodin(&encerrador,&asterisco) < 0 || (j = nsecCubre(z,&asterisco,ahora)) < 0)
+        return 0;
+    agregarPrueba(p,i,n->vence,ahora);
+    agregarPrueba(p,j,z->nsec[j].vence,ahora);
+    p->rcode = 3;
+    return NEGATIVA_NXDOMAIN;
+}
+
+/** NODATA o NXDOMAIN con NSEC3 (RFC 5155 8.4 a 8.6), sin opt-out **/
+static int probarNsec3(ZONA_NEGATIVA *z, const NOMBRE_DNS *nombre, int tipo, uint32_t ahora, PRUEBA *p)
+{
+    unsigned char hash[LARGO_SHA1];
+    NOMBRE_DNS encerrador, siguienteCercano, asterisco;
+    int i, etiquetas, cubre, deComodin;
+
+    hashNsec3(z,nombre,hash);
+    if ((i = nsec3Igual(z,hash,ahora)) >= 0)
+    {
+        const NSEC3_GUARDADO *n = &z->nsec3[i];
+        const unsigned char *mapa = n->rdata + n->mapa;
+        int largo = n->largoRdata - n->mapa;
+        if (tipoEnMapa(mapa,largo,tipo) || tipoEnMapa(mapa,largo,T_CNAME)
+                || (tipo != T_DS && esCorte(mapa,largo)) || (tipo == T_DS && tipoEnMapa(mapa,largo,T_SOA)))
+            return 0;
+        agregarPrueba(p,i,n->vence,ahora);
+        p->rcode = 0;
+        return NEGATIVA_NODATA;
+    }
+    /** el encerrador más cercano: el ancestro más largo cuyo hash tiene un NSEC3 **/
+    for (etiquetas = nombre->cantidadEtiquetas - 1; etiquetas >= z->apex.cantidadEtiquetas; etiquetas--)
+    {
+        ancestro(nombre,etiquetas,&encerrador);
+        hashNsec3(z,&encerrador,hash);
+        if ((i = nsec3Igual(z,hash,ahora)) >= 0)
+            break;
+    }
+    if (etiquetas < z->apex.cantidadEtiquetas)
+        return 0;
+    if (esCorte(z->nsec3[i].rdata + z->nsec3[i].mapa,z->nsec3[i].largoRdata - z->nsec3[i].mapa))
+        return 0;
+    /** el nombre siguiente más cercano tiene que estar cubierto, y sin opt-out **/
+    ancestro(nombre,etiquetas + 1,&siguienteCercano);
+    hashNsec3(z,&siguienteCercano,hash);
+    if ((cubre = nsec3Cubre(z,hash,ahora)) < 0 || (z->nsec3[cubre].rdata[1] & 0x01))
+        return 0;
+    if (comodin(&encerrador,&asterisco) < 0)
+        return 0;
+    hashNsec3(z,&asterisco,hash);
+    if ((deComodin = nsec3Cubre(z,hash,ahora)) < 0)
+        return 0;
+    agregarPrueba(p,i,z->nsec3[i].vence,ahora);
+    agregarPrueba(p,cubre,z->nsec3[cubre].vence,ahora);
+    agregarPrueba(p,deComodin,z->nsec3[deComodin].vence,ahora);
+    p->rcode = 3;
+    return NEGATIVA_NXDOMAIN;
+}
+
+/** Busca una prueba vigente para el nombre y el tipo; se llama con el candado tomado **/
+static int probar(const NOMBRE_DNS *nombre, int tipo, PRUEBA *p)
+{
+    uint32_t ahora = (uint32_t)time(NULL);
+    ZONA_NEGATIVA *z = zonaDe(nombre);
+    int resultado = NEGATIVA_DESCONOCIDA;
+    memset(p,0,sizeof(PRUEBA));
+    if (z == NULL || z->venceSoa <= ahora)
+        return NEGATIVA_DESCONOCIDA;
+    p->zona = z;
+    p->ttl = z->venceSoa - ahora;
+    if (z->cantidadNsec > 0)
+        resultado = probarNsec(z,nombre,tipo,ahora,p);
+    if (resultado == NEGATIVA_DESCONOCIDA && z->cantidadNsec3 > 0)
+    {
+        p->cantidad = 0;
+        p->ttl = z->venceSoa - ahora;
+        p->esNsec3 = 1;
+        resultado = probarNsec3(z,nombre,tipo,ahora,p);
+    }
+    return resultado;
+}
+
+/** Indica si authority trae un RRSIG del mismo dueño que cubre el tipo del registro i **/
+static int firmado(const SECCIONES *s, int i, const NOMBRE_DNS *dueno)
+{
+    NOMBRE_DNS otro;
+    int j;
+    for (j = s->inicio[SECCION_AUTHORITY]; j < s->inicio[SECCION_AUTHORITY+1]; j++)
+        if (s->tipo[j] == T_RRSIG && s->largoRdata[j] >= 18 && leer16(s->mensaje + s->rdata[j]) == s->tipo[i]
+                && nombreLeerMensaje(s->mensaje,s->largo,s->nombre[j],&otro,NULL) >= 0 && nombreIgual(&otro,dueno))
+            return 1;
+    return 0;
+}
+
+/** Saca los vencidos de un arreglo lleno **/
+static void purgarNsec(ZONA_NEGATIVA *z, uint32_t ahora)
+{
+    int i, j = 0;
+    for (i = 0; i < z->cantidadNsec; i++)
+        if (z->nsec[i].vence > ahora)
+            z->nsec[j++] = z->nsec[i];
+        else
+        {
+            free(z->nsec[i].rdata);
+            guardados--;
+        }
+    z->cantidadNsec = j;
+}
+
+static void purgarNsec3(ZONA_NEGATIVA *z, uint32_t ahora, int todos)
+{
+    int i, j = 0;
+    for (i = 0; i < z->cantidadNsec3; i++)
+        if (!todos && z->nsec3[i].vence > ahora)
+            z->nsec3[j++] = z->nsec3[i];
+        else
+        {
+            free(z->nsec3[i].rdata);
+            guardados--;
+        }
+    z->cantidadNsec3 = j;
+}
+
+static void guardarNsec(ZONA_NEGATIVA *z, const NSEC_GUARDADO *nuevo, uint32_t ahora)
+{
+    int i = nsecAnterior(z,&nuevo->dueno);
+    if (i >= 0 && nombreIgual(&z->nsec[i].dueno,&nuevo->dueno))
+    {
+        free(z->nsec[i].rdata);
+        z->nsec[i] = *nuevo;
+        return;
+    }
+    if (z->cantidadNsec == MAX_NEGACIONES_ZONA)
+    {
+        purgarNsec(z,ahora);
+        if (z->cantidadNsec == MAX_NEGACIONES_ZONA)
+        {
+            free(nuevo->rdata);
+            return;
+        }
+        i = nsecAnterior(z,&nuevo->dueno);
+    }
+    if (z->cantidadNsec == z->capacidadNsec)
+    {
+        z->capacidadNsec = z->capacidadNsec ? z->capacidadNsec * 2 : 16;
+        z->nsec = (NSEC_GUARDADO*)realloc(z->nsec,z->capacidadNsec * sizeof(NSEC_GUARDADO));
+    }
+    memmove(z->nsec + i + 2,z->nsec + i + 1,(z->cantidadNsec - i - 1) * sizeof(NSEC_GUARDADO));
+    z->nsec[i+1] = *nuevo;
+    z->cantidadNsec++;
+    guardados++;
+}
+
+static void guardarNsec3(ZONA_NEGATIVA *z, const NSEC3_GUARDADO *nuevo, uint32_t ahora)
+{
+    int i = nsec3Anterior(z,nuevo->hash);
+    if (i >= 0 && memcmp(z->nsec3[i].hash,nuevo->hash,LARGO_SHA1) == 0)
+    {
+        free(z->nsec3[i].rdata);
+        z->nsec3[i] = *nuevo;
+        return;
+    }
+    if (z->cantidadNsec3 == MAX_NEGACIONES_ZONA)
+    {
+        purgarNsec3(z,ahora,0);
+        if (z->cantidadNsec3 == MAX_NEGACIONES_ZONA)
+        {
+            free(nuevo->rdata);
+            return;
+        }
+        i = nsec3Anterior(z,nuevo->hash);
+    }
+    if (z->cantidadNsec3 == z->capacidadNsec3)
+    {
+        z->capacidadNsec3 = z->capacidadNsec3 ? z->capacidadNsec3 * 2 : 16;
+        z->nsec3 = (NSEC3_GUARDADO*)realloc(z->nsec3,z->capacidadNsec3 * sizeof(NSEC3_GUARDADO));
+    }
+    memmove(z->nsec3 + i + 2,z->nsec3 + i + 1,(z->cantidadNsec3 - i - 1) * sizeof(NSEC3_GUARDADO));
+    z->nsec3[i+1] = *nuevo;
+    z->cantidadNsec3++;
+    guardados++;
+}
+
+/** Un NSEC de authority: el siguiente nombre se guarda sin comprimir, aunque no debería venir comprimido **/
+static void aprenderNsec(ZONA_NEGATIVA *z, const SECCIONES *s, int i, const NOMBRE_DNS *dueno, uint32_t vence, uint32_t ahora)
+{
+    NOMBRE_DNS siguiente;
+    NSEC_GUARDADO nuevo;
+    int fin = nombreLeerMensaje(s->mensaje,s->largo,s->rdata[i],&siguiente,NULL);
+    int finRdata = s->rdata[i] + s->largoRdata[i];
+    if (fin < 0 || fin > finRdata || !mapaValido(s->mensaje + fin,finRdata - fin) || !nombreEsSubdominio(&siguiente,&z->apex))
+        return;
+    nuevo.dueno = *dueno;
+    nuevo.mapa = siguiente.largo;
+    nuevo.largoRdata = siguiente.largo + finRdata - fin;
+    nuevo.rdata = (unsigned char*)malloc(nuevo.largoRdata);
+    memcpy(nuevo.rdata,siguiente.wire,siguiente.largo);
+    memcpy(nuevo.rdata + siguiente.largo,s->mensaje + fin,finRdata - fin);
+    nuevo.vence = vence;
+    guardarNsec(z,&nuevo,ahora);
+}
+
+/** Un NSEC3 de authority: el dueño es el hash en base32hex y un label debajo del apex **/
+static void aprenderNsec3(ZONA_NEGATIVA *z, const SECCIONES *s, int i, const NOMBRE_DNS *dueno, uint32_t vence, uint32_t ahora)
+{
+    const unsigned char *rdata = s->mensaje + s->rdata[i];
+    int largo = s->largoRdata[i], largoSal, pos;
+    NSEC3_GUARDADO nuevo;
+
+    if (largo < 5 || rdata[0] != 1 || dueno->cantidadEtiquetas != z->apex.cantidadEtiquetas + 1)
+        return;
+    largoSal = rdata[4];
+    pos = 5 + largoSal;
+    if (pos + 1 + LARGO_SHA1 > largo || rdata[pos] != LARGO_SHA1 || !mapaValido(rdata + pos + 1 + LARGO_SHA1,largo - pos - 1 - LARGO_SHA1))
+        return;
+    if (leer16(rdata + 2) > MAX_ITERACIONES_NSEC3)
+        return;
+    if (desdeBase32Hex(dueno->wire + 1,dueno->wire[0],nuevo.hash,LARGO_SHA1) != LARGO_SHA1)
+        return;
+    /** una zona que cambió la sal o las iteraciones invalida todos sus NSEC3 **/
+    if (z->iteraciones != (int)leer16(rdata + 2) || z->largoSal != largoSal || memcmp(z->sal,rdata + 5,largoSal) != 0)
+    {
+        purgarNsec3(z,ahora,1);
+        z->iteraciones = leer16(rdata + 2);
+        z->largoSal = largoSal;
+        memcpy(z->sal,rdata + 5,largoSal);
+    }
+    nuevo.rdata = (unsigned char*)malloc(largo);
+    memcpy(nuevo.rdata,rdata,largo);
+    nuevo.largoRdata = largo;
+    nuevo.siguiente = pos + 1;
+    nuevo.mapa = pos + 1 + LARGO_SHA1;
+    nuevo.vence = vence;
+    guardarNsec3(z,&nuevo,ahora);
+}
+
+void negativasActivar()
+{
+    activas = 1;
+}
+
+int negativasActivas()
+{
+    return activas;
+}
+
+void negativasAprender(const SECCIONES *s, int confiable)
+{
+    NOMBRE_DNS apex, mname, rname, dueno, pregunta;
+    CABECERA_DNS cabecera;
+    uint32_t ahora = (uint32_t)time(NULL), ttlNegativo;
+    int soa, fin, i;
+
+    if (!activas || !confiable || s->largo < TAM_CABECERA)
+        return;
+    /** sólo lo que el servidor validó (AD, RFC 8198 4), de la pregunta que se hizo **/
+    cabeceraLeer(s->mensaje,&cabecera);
+    if (!cabecera.ad || (cabecera.rcode != 0 && cabecera.rcode != 3) || cabecera.qdcount != 1
+            || nombreLeerMensaje(s->mensaje,s->largo,TAM_CABECERA,&pregunta,NULL) < 0)
+        return;
+    /** el SOA de authority da el apex y el TTL negativo (RFC 2308 5); tiene que contener al nombre preguntado **/
+    if ((soa = seccionesBuscar(s,SECCION_AUTHORITY,T_SOA)) < 0
+            || nombreLeerMensaje(s->mensaje,s->largo,s->nombre[soa],&apex,NULL) < 0
+            || !nombreEsSubdominio(&pregunta,&apex)
+            || (fin = nombreLeerMensaje(s->mensaje,s->largo,s->rdata[soa],&mname,NULL)) < 0
+            || (fin = nombreLeerMensaje(s->mensaje,s->largo,fin,&rname,NULL)) < 0
+            || fin + 20 != s->rdata[soa] + s->largoRdata[soa])
+        return;
+    ttlNegativo = leer32(s->mensaje + fin + 16);
+    if (s->ttl[soa] < ttlNegativo)
+        ttlNegativo = s->ttl[soa];
+
+    pthread_mutex_lock(&candado);
+    ZONA_NEGATIVA *z = zonaCrear(&apex);
+    if (z == NULL)
+    {
+        pthread_mutex_unlock(&candado);
+        return;
+    }
+    memcpy(z->soa,mname.wire,mname.largo);
+    memcpy(z->soa + mname.largo,rname.wire,rname.largo);
+    memcpy(z->soa + mname.largo + rname.largo,s->mensaje + fin,20);
+    z->largoSoa = mname.largo + rname.largo + 20;
+    z->venceSoa = ahora + ttlNegativo;
+    for (i = s->inicio[SECCION_AUTHORITY]; i < s->inicio[SECCION_AUTHORITY+1]; i++)
+    {
+        if ((s->tipo[i] != T_NSEC && s->tipo[i] != T_NSEC3) || s->clase[i] != 1)
+            continue;
+        if (nombreLeerMensaje(s->mensaje,s->largo,s->nombre[i],&dueno,NULL) < 0
+                || !nombreEsSubdominio(&dueno,&apex) || !firmado(s,i,&dueno))
+            continue;
+        uint32_t vence = ahora + (s->ttl[i] < ttlNegativo ? s->ttl[i] : ttlNegativo);
+        if (s->tipo[i] == T_NSEC)
+            aprenderNsec(z,s,i,&dueno,vence,ahora);
+        else
+            aprenderNsec3(z,s,i,&dueno,vence,ahora);
+    }
+    pthread_mutex_unlock(&candado);
+}
+
+int negativasConsultar(const char *nombre, int tipo, uint32_t *ttl)
+{
+    NOMBRE_DNS n;
+    PRUEBA p;
+    int resultado;
+    if (!activas || nombreDesdeCadena(nombre,&n) < 0)
+        return NEGATIVA_DESCONOCIDA;
+    pthread_mutex_lock(&candado);
+    resultado = probar(&n,tipo,&p);
+    if (resultado != NEGATIVA_DESCONOCIDA)
+        sintetizadas++;
+    pthread_mutex_unlock(&candado);
+    *ttl = p.ttl;
+    return resultado;
+}
+
+/** Agrega un RR sin comprimir; la posición siguiente o -1 si no entra **/
+static int agregarRR(unsigned char *respuesta, int pos, int max, const unsigned char *dueno, int largoDueno, int tipo,
+                     uint32_t ttl, const unsigned char *rdata, int largoRdata)
+{
+    struct R_DATA campos = {tipo, 1, ttl, largoRdata};
+    if (pos + largoDueno + TAM_R_DATA + largoRdata > max)
+        return -1;
+    memcpy(respuesta + pos,dueno,largoDueno);
+    pos += largoDueno;
+    camposRREscribir(&campos,respuesta + pos);
+    memcpy(respuesta + pos + TAM_R_DATA,rdata,largoRdata);
+    return pos + TAM_R_DATA + largoRdata;
+}
+
+int negativasResponder(const unsigned char *consulta, int largo, unsigned char *destino, int max)
+{
+    static unsigned char armada[4096];
+    unsigned char *respuesta;
+    NOMBRE_DNS nombre;
+    PRUEBA p;
+    CABECERA_DNS cabecera;
+    int fin, i, pos;
+
+    if (!activas || largo < 17)
+        return 0;
+    cabeceraLeer(consulta,&cabecera);
+    if (cabecera.qr || cabecera.opcode != 0 || cabecera.qdcount != 1)
+        return 0;
+    if ((fin = nombreLeerMensaje(consulta,largo,TAM_CABECERA,&nombre,NULL)) < 0 || fin + TAM_PREGUNTA > largo
+            || leer16(consulta + fin + 2) != 1)
+        return 0;
+    int tipo = leer16(consulta + fin);
+
+    pthread_mutex_lock(&candado);
+    if (probar(&nombre,tipo,&p) == NEGATIVA_DESCONOCIDA || fin + 4 > max)
+    {
+        pthread_mutex_unlock(&candado);
+        return 0;
+    }
+    ZONA_NEGATIVA *z = p.zona;
+    /** se arma aparte: si no entra, la consulta (que puede ser el mismo buffer) queda intacta **/
+    if (max > (int)sizeof(armada))
+        max = sizeof(armada);
+    respuesta = armada;
+    /** el header y la pregunta de la consulta; sin additional (la consulta puede traer un OPT) **/
+    memcpy(respuesta,consulta,fin + 4);
+    cabecera.qr = 1;
+    cabecera.aa = cabecera.tc = cabecera.z = cabecera.ad = cabecera.cd = 0;
+    cabecera.ra = 1;
+    cabecera.rcode = p.rcode;
+    cabecera.ancount = cabecera.arcount = 0;
+    cabecera.nscount = 1 + p.cantidad;
+    cabeceraEscribir(&cabecera,respuesta);
+    pos = agregarRR(respuesta,fin + 4,max,z->apex.wire,z->apex.largo,T_SOA,p.ttl,z->soa,z->largoSoa);
+    for (i = 0; i < p.cantidad && pos >= 0; i++)
+    {
+        if (!p.esNsec3)
+        {
+            const NSEC_GUARDADO *n = &z->nsec[p.indices[i]];
+            pos = agregarRR(respuesta,pos,max,n->dueno.wire,n->dueno.largo,T_NSEC,p.ttl,n->rdata,n->largoRdata);
+        }
+        else
+        {
+            const NSEC3_GUARDADO *n = &z->nsec3[p.indices[i]];
+            unsigned char dueno[1 + 32 + 255];
+            dueno[0] = 32;
+            aBase32Hex(n->hash,LARGO_SHA1,dueno + 1);
+            memcpy(dueno + 33,z->apex.wire,z->apex.largo);
+            pos = agregarRR(respuesta,pos,max,dueno,33 + z->apex.largo,T_NSEC3,p.ttl,n->rdata,n->largoRdata);
+        }
+    }
+    if (pos >= 0)
+    {
+        memcpy(destino,armada,pos);
+        sintetizadas++;
+    }
+    pthread_mutex_unlock(&candado);
+    return pos > 0 ? pos : 0;
+}
+
+void negativasEstadisticas(long *sintetizadasNegativas, long *registros)
+{
+    pthread_mutex_lock(&candado);
+    *sintetizadasNegativas = sintetizadas;
+    *registros = guardados;
+    pthread_mutex_unlock(&candado);
+}
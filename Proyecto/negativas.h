@@ -0,0 +1,64 @@
+#ifndef NEGATIVAS_H_INCLUDED
+#define NEGATIVAS_H_INCLUDED
+
+#include <stdint.h>
+
+#include "secciones.h"
+
+/**
+ * Uso agresivo de las negativas firmadas (RFC 8198, parámetro -nsec). Un NXDOMAIN o un NODATA de
+ * una zona firmada trae en authority los NSEC o NSEC3 que prueban la inexistencia: un NSEC dice
+ * "entre este nombre y el siguiente no hay nada" (en el orden canónico de RFC 4034 6.1) y un
+ * NSEC3 lo mismo entre dos hashes. Guardados por zona y ordenados, alcanzan para contestar sin
+ * preguntar cualquier otro nombre que caiga en los mismos huecos, hasta que venzan (el menor entre
+ * el TTL del registro y el TTL negativo del SOA, RFC 8198 5.4). Un lote de nombres aleatorios
+ * bajo la misma zona pasa así de una consulta por nombre a unas pocas por zona.
+ *
+ * La respuesta sintetizada se arma como la de un servidor: el rcode, y en authority el SOA de la
+ * zona y los NSEC/NSEC3 de la prueba (sin las firmas). Este cliente no valida DNSSEC, y RFC 8198
+ * pide registros validados: sólo se aprende de respuestas con el bit AD de un servidor que valida
+ * y en el que se confía ("options trust-ad" en resolv.conf, como en la libc), cuyo SOA es de una
+ * zona que contiene al nombre preguntado. Por eso el modo iterativo, que habla con servidores con
+ * autoridad, no aprende negativas. Los NSEC3 con opt-out no prueban que un nombre no exista, y
+ * las zonas con más de MAX_ITERACIONES_NSEC3 iteraciones se ignoran (RFC 9276 3.2).
+ **/
+
+#define MAX_ZONAS_NEGATIVAS 256
+#define MAX_NEGACIONES_ZONA 16384
+#define MAX_ITERACIONES_NSEC3 100
+
+/** Resultado de una consulta a las negativas guardadas **/
+#define NEGATIVA_DESCONOCIDA 0
+#define NEGATIVA_NXDOMAIN 1
+#define NEGATIVA_NODATA 2
+
+/** Habilita el modo: las consultas piden DNSSEC (bit DO) y se guardan los NSEC/NSEC3 **/
+void negativasActivar();
+
+/** Indica si el modo está habilitado **/
+int negativasActivas();
+
+/**
+ * Guarda los NSEC/NSEC3 firmados de authority de una respuesta real (no de una sintetizada).
+ * confiable: 1 si el servidor que respondió valida y su bit AD se puede creer (trust-ad); si no,
+ * o si la respuesta no trae AD, no se aprende nada.
+ **/
+void negativasAprender(const SECCIONES *s, int confiable);
+
+/**
+ * Si los NSEC/NSEC3 guardados prueban que el nombre no existe o que no tiene ese tipo.
+ * En *ttl deja cuánto le queda a la prueba. Segura entre hilos.
+ **/
+int negativasConsultar(const char *nombre, int tipo, uint32_t *ttl);
+
+/**
+ * Contesta una consulta con las negativas guardadas, como zonaResponder: el largo de la
+ * respuesta, o 0 si no hay una prueba vigente (hay que preguntar). respuesta puede ser el mismo
+ * buffer que consulta.
+ **/
+int negativasResponder(const unsigned char *consulta, int largo, unsigned char *respuesta, int max);
+
+/** Respuestas sintetizadas en esta ejecución y NSEC/NSEC3 guardados **/
+void negativasEstadisticas(long *sintetizadas, long *registros);
+
+#endif // NEGATIVAS_H_INCLUDED
@@ -0,0 +1,277 @@
+#include<stdio.h>
+#include<string.h>
+#include<stdlib.h>
+#include<ctype.h>
+#include<pthread.h>
+
+#include "nombres.h"
+#include "tipos_rr.h"
+#include "vectorial.h"
+
+/** Tabla de nombres internados: nunca se liberan, así que los punteros valen para siempre **/
+typedef struct INTERNADO
+{
+    NOMBRE_DNS nombre;
+    struct INTERNADO *siguiente;
+} INTERNADO;
+
+static INTERNADO **internados;
+static unsigned int cubetasInternados, cantidadInternados;
+static pthread_mutex_t candadoInternados = PTHREAD_MUTEX_INITIALIZER;
+
+unsigned int hashNombreDNS(const unsigned char *wire, int largo)
+{
+    return vectorialHash(wire,largo);
+}
+
+void nombrePasarAMinusculas(unsigned char *wire, int largo)
+{
+    vectorialMinusculas(wire,largo);
+}
+
+/** Calcula las posiciones de los labels y el hash de un wire ya copiado y en minúsculas **/
+static int completar(NOMBRE_DNS *nombre)
+{
+    int i = 0;
+    nombre->cantidadEtiquetas = 0;
+    while (nombre->wire[i] != 0)
+    {
+        if (nombre->wire[i] > 63 || nombre->cantidadEtiquetas >= MAX_ETIQUETAS_NOMBRE)
+            return -1;
+        nombre->etiquetas[nombre->cantidadEtiquetas++] = i;
+        i += nombre->wire[i] + 1;
+        if (i >= nombre->largo)
+            return -1;
+    }
+    if (i + 1 != nombre->largo)
+        return -1;
+    nombre->hash = hashNombreDNS(nombre->wire,nombre->largo);
+    return 0;
+}
+
+/** Copia un label al texto; en forma presentación escapa '.', '\\' y los bytes no imprimibles (RFC 1035 5.1) **/
+static int copiarEtiqueta(char *salida, const unsigned char *etiqueta, int largo, int presentacion)
+{
+    int i, n = 0;
+    if (!presentacion)
+    {
+        memcpy(salida,etiqueta,largo);
+        return largo;
+    }
+    for (i = 0; i < largo; i++)
+    {
+        unsigned char c = etiqueta[i];
+        if (c == '.' || c == '\\')
+        {
+            salida[n++] = '\\';
+            salida[n++] = c;
+        }
+        else if (c < 0x21 || c > 0x7e)
+            n += sprintf(salida + n,"\\%03u",c);
+        else
+            salida[n++] = c;
+    }
+    return n;
+}
+
+static int leerComprimido(const unsigned char *mensaje, int largoMensaje, int pos, NOMBRE_DNS *nombre, char *salida,
+                          int presentacion)
+{
+    unsigned char wire[255];
+    int largo = 0, fin = -1, limite = pos, texto = 0;
+
+    while (1)
+    {
+        unsigned char c;
+        if (pos >= largoMensaje)
+            return -1;
+        c = mensaje[pos];
+        if ((c & 0xC0) == 0xC0)
+        {
+            int destino;
+            if (pos + 1 >= largoMensaje)
+                return -1;
+            destino = ((c & 0x3F) << 8) | mensaje[pos+1];
+            /** cada salto tiene que ir más atrás que el anterior: así no hay ciclos posibles **/
+            if (destino >= limite)
+                return -1;
+            if (fin < 0)
+                fin = pos + 2;
+            limite = pos = destino;
+            continue;
+        }
+        if (c > 63 || largo + c + 1 > 255 || pos + 1 + c > largoMensaje)
+            return -1;
+        wire[largo++] = c;
+        if (c == 0)
+            break;
+        memcpy(wire + largo,mensaje + pos + 1,c);
+        if (salida != NULL)
+        {
+            if (texto > 0)
+                salida[texto++] = '.';
+            texto += copiarEtiqueta(salida + texto,mensaje + pos + 1,c,presentacion);
+        }
+        largo += c;
+        pos += c + 1;
+    }
+    if (fin < 0)
+        fin = pos + 1;
+    if (salida != NULL)
+        salida[texto] = '\0';
+    if (nombre != NULL && nombreDesdeWire(wire,largo,nombre) < 0)
+        return -1;
+    return fin;
+}
+
+int nombreLeerMensaje(const unsigned char *mensaje, int largoMensaje, int pos, NOMBRE_DNS *nombre, char *salida)
+{
+    return leerComprimido(mensaje,largoMensaje,pos,nombre,salida,0);
+}
+
+int nombreLeerPresentacion(const unsigned char *mensaje, int largoMensaje, int pos, char *salida)
+{
+    return leerComprimido(mensaje,largoMensaje,pos,NULL,salida,1);
+}
+
+int nombreDesdeWire(const unsigned char *wire, int largo, NOMBRE_DNS *nombre)
+{
+    if (largo < 1 || largo > 255)
+        return -1;
+    memcpy(nombre->wire,wire,largo);
+    nombre->largo = largo;
+    nombrePasarAMinusculas(nombre->wire,largo);
+    return completar(nombre);
+}
+
+int nombreDesdeCadena(const char *texto, NOMBRE_DNS *nombre)
+{
+    unsigned char wire[256];
+    int largo;
+    if (texto[0] == '\0')
+        texto = ".";
+    /** sin origen los nombres relativos quedan relativos a la raíz, con o sin punto final **/
+    if ((largo = nombreDesdeTexto(texto,NULL,wire)) < 0)
+        return -1;
+    return nombreDesdeWire(wire,largo,nombre);
+}
+
+char *nombreATexto(const NOMBRE_DNS *nombre, char *destino)
+{
+    int i = 0, n = 0;
+    if (nombre->largo <= 1)
+    {
+        strcpy(destino,".");
+        return destino;
+    }
+    while (nombre->wire[i] != 0)
+    {
+        if (n > 0)
+            destino[n++] = '.';
+        memcpy(destino + n,nombre->wire + i + 1,nombre->wire[i]);
+        n += nombre->wire[i];
+        i += nombre->wire[i] + 1;
+    }
+    destino[n] = '\0';
+    return destino;
+}
+
+int nombreIgual(const NOMBRE_DNS *a, const NOMBRE_DNS *b)
+{
+    return a == b || (a->hash == b->hash && a->largo == b->largo && memcmp(a->wire,b->wire,a->largo) == 0);
+}
+
+int nombreCompararCanonico(const NOMBRE_DNS *a, const NOMBRE_DNS *b)
+{
+    int i = a->cantidadEtiquetas - 1, j = b->cantidadEtiquetas - 1;
+    for (; i >= 0 && j >= 0; i--, j--)
+    {
+        const unsigned char *x = a->wire + a->etiquetas[i], *y = b->wire + b->etiquetas[j];
+        int comun = x[0] < y[0] ? x[0] : y[0];
+        int diferencia = memcmp(x + 1,y + 1,comun);
+        if (diferencia != 0)
+            return diferencia;
+        if (x[0] != y[0])
+            return x[0] - y[0];
+    }
+    return (i >= 0) - (j >= 0);
+}
+
+int nombreEsSubdominio(const NOMBRE_DNS *nombre, const NOMBRE_DNS *zona)
+{
+    int i = nombre->cantidadEtiquetas - zona->cantidadEtiquetas;
+    int inicio;
+    if (i < 0)
+        return 0;
+    inicio = (i < nombre->cantidadEtiquetas) ? nombre->etiquetas[i] : nombre->largo - 1;
+    return nombre->largo - inicio == zona->largo && memcmp(nombre->wire + inicio,zona->wire,zona->largo) == 0;
+}
+
+int nombreEsHostname(const NOMBRE_DNS *nombre)
+{
+    int i;
+    for (i = 0; i < nombre->cantidadEtiquetas; i++)
+    {
+        const unsigned char *etiqueta = nombre->wire + nombre->etiquetas[i] + 1;
+        int largo = etiqueta[-1];
+        if (i == 0 && largo == 1 && etiqueta[0] == '*')     /** comodín **/
+            continue;
+        if (etiqueta[0] == '-' || etiqueta[largo-1] == '-' || vectorialCaracteresHost(etiqueta,largo) != largo)
+            return 0;
+    }
+    return 1;
+}
+
+unsigned int nombreHashSufijo(const NOMBRE_DNS *nombre, int etiqueta)
+{
+    int inicio = (etiqueta < nombre->cantidadEtiquetas) ? nombre->etiquetas[etiqueta] : nombre->largo - 1;
+    return hashNombreDNS(nombre->wire + inicio,nombre->largo - inicio);
+}
+
+/** Duplica las cubetas de la tabla de internados; requiere tener el candado **/
+static void crecerInternados()
+{
+    unsigned int nuevas = cubetasInternados ? cubetasInternados * 2 : 256, i;
+    INTERNADO **nueva = (INTERNADO**)calloc(nuevas,sizeof(INTERNADO*));
+    for (i = 0; i < cubetasInternados; i++)
+        while (internados[i] != NULL)
+        {
+            INTERNADO *n = internados[i];
+            internados[i] = n->siguiente;
+            n->siguiente = nueva[n->nombre.hash % nuevas];
+            nueva[n->nombre.hash % nuevas] = n;
+        }
+    free(internados);
+    internados = nueva;
+    cubetasInternados = nuevas;
+}
+
+const NOMBRE_DNS *nombreInternar(const NOMBRE_DNS *nombre)
+{
+    INTERNADO *n = NULL;
+    pthread_mutex_lock(&candadoInternados);
+    if (cubetasInternados > 0)
+        for (n = internados[nombre->hash % cubetasInternados]; n != NULL; n = n->siguiente)
+            if (nombreIgual(&n->nombre,nombre))
+                break;
+    if (n == NULL && cantidadInternados < MAX_NOMBRES_INTERNADOS)
+    {
+        if (cantidadInternados >= cubetasInternados)
+            crecerInternados();
+        n = (INTERNADO*)malloc(sizeof(INTERNADO));
+        n->nombre = *nombre;
+        n->siguiente = internados[nombre->hash % cubetasInternados];
+        internados[nombre->hash % cubetasInternados] = n;
+        cantidadInternados++;
+    }
+    pthread_mutex_unlock(&candadoInternados);
+    return n != NULL ? &n->nombre : NULL;
+}
+
+const NOMBRE_DNS *nombreInternarCadena(const char *texto)
+{
+    NOMBRE_DNS nombre;
+    if (nombreDesdeCadena(texto,&nombre) < 0)
+        return NULL;
+    return nombreInternar(&nombre);
+}
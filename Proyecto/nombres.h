@@ -0,0 +1,88 @@
+#ifndef NOMBRES_H_INCLUDED
+#define NOMBRES_H_INCLUDED
+
+/**
+ * Representación compacta de nombres de dominio para las comparaciones del camino caliente
+ * (cache de delegaciones, zonas locales, priming). El nombre se guarda en formato DNS sin
+ * comprimir y en minúsculas, junto con la posición de cada label y un hash CRC32C: comparar dos
+ * nombres es comparar el hash, el largo y un memcmp, y los sufijos (la zona padre, el abuelo...)
+ * son desplazamientos dentro del mismo buffer, sin copiar ni volver a convertir a texto.
+ *
+ * Los nombres que se repiten mucho (servidores NS, zonas) se internan: nombreInternar devuelve
+ * siempre el mismo puntero para el mismo nombre, así que se comparan por puntero y se guardan
+ * una sola vez, sin importar en cuántas delegaciones aparezcan.
+ **/
+
+#define MAX_ETIQUETAS_NOMBRE 128
+#define MAX_NOMBRES_INTERNADOS 65536   // los internados no se liberan: el tope acota la memoria
+#define MAX_TEXTO_NOMBRE 1024          // un nombre en forma presentación: hasta 4 caracteres por byte (\DDD)
+
+typedef struct
+{
+    unsigned int hash;                              // hashNombreDNS de wire[0..largo)
+    unsigned char largo;                            // bytes de wire, incluido el label raíz
+    unsigned char cantidadEtiquetas;                // sin contar la raíz
+    unsigned char etiquetas[MAX_ETIQUETAS_NOMBRE];  // posición en wire del byte de largo de cada label
+    unsigned char wire[255];                        // formato DNS, en minúsculas
+} NOMBRE_DNS;
+
+/** CRC32C de un nombre en formato DNS (ya en minúsculas); por hardware si el procesador lo tiene (vectorial.h) **/
+unsigned int hashNombreDNS(const unsigned char *wire, int largo);
+
+/** Pasa a minúsculas un nombre en formato DNS; los bytes de largo (0 a 63) no son letras **/
+void nombrePasarAMinusculas(unsigned char *wire, int largo);
+
+/**
+ * Lee un nombre (con compresión) de un mensaje en una sola pasada, sin salirse de largoMensaje,
+ * sin pasar de 255 bytes y rechazando punteros que no apunten hacia atrás (evita los ciclos).
+ * Si salida no es NULL copia allí el nombre en texto, con su capitalización original y sin el
+ * punto final (la raíz queda como cadena vacía). Si nombre no es NULL lo completa.
+ * Devuelve la posición siguiente al nombre en el mensaje, o -1 si está mal formado.
+ **/
+int nombreLeerMensaje(const unsigned char *mensaje, int largoMensaje, int pos, NOMBRE_DNS *nombre, char *salida);
+
+/**
+ * Como nombreLeerMensaje, pero el texto queda en forma presentación (como en un archivo de zona):
+ * un '.' o '\\' dentro de un label va precedido de '\\' y los bytes no imprimibles quedan como
+ * \\DDD. salida debe tener MAX_TEXTO_NOMBRE bytes.
+ **/
+int nombreLeerPresentacion(const unsigned char *mensaje, int largoMensaje, int pos, char *salida);
+
+/** Completa un NOMBRE_DNS a partir de un nombre en formato DNS sin comprimir. 0 o -1 **/
+int nombreDesdeWire(const unsigned char *wire, int largo, NOMBRE_DNS *nombre);
+
+/** Completa un NOMBRE_DNS a partir de texto ("www.ejemplo.com", con o sin punto final; "" y "." son la raíz). 0 o -1 **/
+int nombreDesdeCadena(const char *texto, NOMBRE_DNS *nombre);
+
+/** Escribe el nombre en texto, sin el punto final; la raíz es ".". destino debe tener 256 bytes **/
+char *nombreATexto(const NOMBRE_DNS *nombre, char *destino);
+
+/** Compara dos nombres (sin distinguir mayúsculas) **/
+int nombreIgual(const NOMBRE_DNS *a, const NOMBRE_DNS *b);
+
+/**
+ * Orden canónico de DNSSEC (RFC 4034 6.1): label por label desde la derecha, byte a byte y sin
+ * distinguir mayúsculas; un nombre va antes que sus subdominios. <0, 0 o >0 como memcmp.
+ **/
+int nombreCompararCanonico(const NOMBRE_DNS *a, const NOMBRE_DNS *b);
+
+/** Indica si nombre es igual a zona o está debajo de ella **/
+int nombreEsSubdominio(const NOMBRE_DNS *nombre, const NOMBRE_DNS *zona);
+
+/** Indica si todos los labels son letras, dígitos y guiones sin guión en los extremos (RFC 1123); admite un "*" inicial **/
+int nombreEsHostname(const NOMBRE_DNS *nombre);
+
+/** Hash del sufijo que empieza en el label indicado (cantidadEtiquetas = la raíz) **/
+unsigned int nombreHashSufijo(const NOMBRE_DNS *nombre, int etiqueta);
+
+/**
+ * Devuelve la copia compartida del nombre; siempre el mismo puntero para el mismo nombre. Segura
+ * entre hilos. NULL si el nombre es nuevo y ya hay MAX_NOMBRES_INTERNADOS: quien llama lo trata
+ * como un nombre que no pudo guardar.
+ **/
+const NOMBRE_DNS *nombreInternar(const NOMBRE_DNS *nombre);
+
+/** nombreInternar a partir de texto; NULL si el nombre no es válido **/
+const NOMBRE_DNS *nombreInternarCadena(const char *texto);
+
+#endif // NOMBRES_H_INCLUDED
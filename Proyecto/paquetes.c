@@ -0,0 +1,154 @@
+#define _GNU_SOURCE
+#include<stdio.h>
+#include<string.h>
+#include<stdlib.h>
+#include<pthread.h>
+#include<sys/mman.h>
+
+#include "paquetes.h"
+
+#define PAGINA_GRANDE (2 * 1024 * 1024)
+
+static const int tamanios[CLASES_PAQUETE] = {512, 1232, 4096, MAX_PAQUETE};
+/** buffers por losa de las clases que se reservan a pedido **/
+static const int porLosa[CLASES_PAQUETE] = {0, 0, 64, 4};
+
+typedef struct
+{
+    unsigned char *inicio, *fin;
+    int clase;
+} LOSA;
+
+typedef struct
+{
+    unsigned char **libres;         // pila de buffers disponibles
+    int cantidad, capacidad;        // capacidad: todos los de la clase, para que quepan al devolverlos
+} CLASE_PAQUETE;
+
+static LOSA losas[MAX_LOSAS_PAQUETES];
+static int cantidadLosas;
+static CLASE_PAQUETE clases[CLASES_PAQUETE];
+static int cantidadPorClase = PAQUETES_POR_OMISION, paginasGrandes, iniciado;
+static ESTADISTICAS_PAQUETES estadisticas;
+static pthread_mutex_t candado = PTHREAD_MUTEX_INITIALIZER;
+
+void paquetesConfigurar(int cantidad, int grandes)
+{
+    pthread_mutex_lock(&candado);
+    if (cantidad > 0)
+        cantidadPorClase = cantidad;
+    paginasGrandes = grandes;
+    pthread_mutex_unlock(&candado);
+}
+
+/** Memoria para una losa, ya tocada; con páginas enormes si se pidieron y se consiguen **/
+static unsigned char *reservar(size_t *bytes)
+{
+    void *p = MAP_FAILED;
+    if (paginasGrandes)
+    {
+        *bytes = (*bytes + PAGINA_GRANDE - 1) / PAGINA_GRANDE * PAGINA_GRANDE;
+        p = mmap(NULL,*bytes,PROT_READ | PROT_WRITE,MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE,-1,0);
+        if (p != MAP_FAILED)
+            estadisticas.respaldo = RESPALDO_HUGETLB;
+    }
+    if (p == MAP_FAILED)
+    {
+        p = mmap(NULL,*bytes,PROT_READ | PROT_WRITE,MAP_PRIVATE | MAP_ANONYMOUS,-1,0);
+        if (p == MAP_FAILED)
+            return NULL;
+        /** las transparentes hay que pedirlas antes de tocar la región **/
+        estadisticas.respaldo = paginasGrandes && madvise(p,*bytes,MADV_HUGEPAGE) == 0 ? RESPALDO_TRANSPARENTE : RESPALDO_NORMAL;
+        memset(p,0,*bytes);
+    }
+    return (unsigned char*)p;
+}
+
+/** Agrega una losa de cantidad buffers a la clase; -1 si no hubo memoria **/
+static int agregarLosa(int clase, int cantidad)
+{
+    CLASE_PAQUETE *c = &clases[clase];
+    size_t bytes = (size_t)cantidad * tamanios[clase];
+    unsigned char *p;
+    int i;
+
+    if (cantidadLosas == MAX_LOSAS_PAQUETES || (p = reservar(&bytes)) == NULL)
+        return -1;
+    /** lo que sobra del redondeo a página enorme también son buffers **/
+    cantidad = bytes / tamanios[clase];
+    losas[cantidadLosas].inicio = p;
+    losas[cantidadLosas].fin = p + bytes;
+    losas[cantidadLosas].clase = clase;
+    cantidadLosas++;
+    /** la pila tiene que alcanzar para los buffers de todas las losas, también los que están en uso **/
+    c->capacidad += cantidad;
+    c->libres = (unsigned char**)realloc(c->libres,c->capacidad * sizeof(unsigned char*));
+    /** al revés, para que los primeros que se toman sean los del principio de la losa **/
+    for (i = cantidad - 1; i >= 0; i--)
+        c->libres[c->cantidad++] = p + (size_t)i * tamanios[clase];
+    estadisticas.reservados += bytes;
+    estadisticas.losas++;
+    return 0;
+}
+
+unsigned char *paqueteTomar(int largo)
+{
+    unsigned char *paquete = NULL;
+    int clase;
+    for (clase = 0; clase < CLASES_PAQUETE && tamanios[clase] < largo; clase++);
+    if (clase == CLASES_PAQUETE)
+        return NULL;
+
+    pthread_mutex_lock(&candado);
+    if (!iniciado)
+    {
+        agregarLosa(0,cantidadPorClase);
+        agregarLosa(1,cantidadPorClase);
+        iniciado = 1;
+    }
+    CLASE_PAQUETE *c = &clases[clase];
+    if (c->cantidad > 0 || agregarLosa(clase,porLosa[clase] > 0 ? porLosa[clase] : cantidadPorClase) == 0)
+    {
+        paquete = c->libres[--c->cantidad];
+        if (++estadisticas.enUso > estadisticas.maximoEnUso)
+            estadisticas.maximoEnUso = estadisticas.enUso;
+    }
+    pthread_mutex_unlock(&candado);
+    return paquete;
+}
+
+void paqueteDevolver(unsigned char *paquete)
+{
+    int i;
+    if (paquete == NULL)
+        return;
+    pthread_mutex_lock(&candado);
+    for (i = 0; i < cantidadLosas; i++)
+        if (paquete >= losas[i].inicio && paquete < losas[i].fin)
+        {
+            CLASE_PAQUETE *c = &clases[losas[i].clase];
+            c->libres[c->cantidad++] = paquete;
+            estadisticas.enUso--;
+            break;
+        }
+    pthread_mutex_unlock(&candado);
+}
+
+ESTADISTICAS_PAQUETES paquetesEstadisticas()
+{
+    ESTADISTICAS_PAQUETES e;
+    pthread_mutex_lock(&candado);
+    e = estadisticas;
+    pthread_mutex_unlock(&candado);
+    return e;
+}
+
+void paquetesResumen(FILE *salida)
+{
+    static const char *respaldos[] = {"páginas normales", "páginas enormes", "páginas enormes transparentes"};
+    if (!paginasGrandes)
+        return;
+    ESTADISTICAS_PAQUETES e = paquetesEstadisticas();
+    fprintf(salida,";; paquetes: %.1f MB en %ld losas (%s), máximo en uso: %ld\n",e.reservados / 1048576.0,e.losas,
+            respaldos[e.respaldo],e.maximoEnUso);
+}
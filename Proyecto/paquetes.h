@@ -0,0 +1,52 @@
+#ifndef PAQUETES_H_INCLUDED
+#define PAQUETES_H_INCLUDED
+
+#include <stdio.h>
+
+/**
+ * Pool de buffers de paquetes de tamaño fijo, para los modos que mantienen miles de consultas en
+ * vuelo. Hay cuatro clases: 512 bytes (UDP clásico, RFC 1035), 1232 (EDNS sin fragmentar, el
+ * tamaño del DNS Flag Day 2020), 4096 y 65536. Las dos primeras se reservan enteras al primer uso
+ * (cantidadPorClase buffers cada una); las grandes, en losas, recién cuando alguien las pide.
+ *
+ * Las losas salen de mmap y se tocan de entrada (MAP_POPULATE): después no hay malloc ni fallos
+ * de página por consulta, y la memoria queda fija en lo que se reservó. Los buffers devueltos
+ * vuelven a su pila y no se liberan nunca. Con páginas enormes (-paginasgrandes) se pide
+ * MAP_HUGETLB y, si el sistema no tiene páginas reservadas, se marca la región para las
+ * transparentes (MADV_HUGEPAGE): con miles de buffers en uso son muchas menos entradas de TLB.
+ **/
+
+#define CLASES_PAQUETE 4
+#define MAX_PAQUETE 65536
+#define PAQUETES_POR_OMISION 1024
+#define MAX_LOSAS_PAQUETES 256
+
+/** Respaldo de la memoria del pool **/
+#define RESPALDO_NORMAL 0
+#define RESPALDO_HUGETLB 1          /** páginas enormes reservadas (hugetlbfs) **/
+#define RESPALDO_TRANSPARENTE 2     /** páginas enormes transparentes, si el núcleo las consigue **/
+
+typedef struct
+{
+    size_t reservados;              // bytes de todas las losas
+    long enUso;
+    long maximoEnUso;
+    long losas;
+    int respaldo;                   // el de la última losa reservada
+} ESTADISTICAS_PAQUETES;
+
+/** Antes del primer uso: buffers por clase chica y si se piden páginas enormes **/
+void paquetesConfigurar(int cantidadPorClase, int paginasGrandes);
+
+/** Un buffer de al menos largo bytes (hasta MAX_PAQUETE), o NULL si no se pudo reservar. Seguro entre hilos **/
+unsigned char *paqueteTomar(int largo);
+
+/** Devuelve un buffer al pool (NULL no hace nada) **/
+void paqueteDevolver(unsigned char *paquete);
+
+ESTADISTICAS_PAQUETES paquetesEstadisticas();
+
+/** Escribe en salida la línea de resumen del pool, si se pidieron páginas enormes **/
+void paquetesResumen(FILE *salida);
+
+#endif // PAQUETES_H_INCLUDED
@@ -0,0 +1,91 @@
+#include<string.h>
+
+#include "plantillas.h"
+#include "dns.h"
+
+/**
+ * Cabeceras: ID (se parchea), indicadores, QDCOUNT = 1 y ARCOUNT = 1 si lleva el OPT. El segundo
+ * byte de indicadores (RA, Z, AD, CD y rcode) va siempre en 0 en una consulta.
+ **/
+static const unsigned char cabeceras[CANTIDAD_PLANTILLAS][12] =
+{
+    {0, 0, 0x00, 0x00, 0, 1, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0x01, 0x00, 0, 1, 0, 0, 0, 0, 0, 0},    /** RD **/
+    {0, 0, 0x00, 0x00, 0, 1, 0, 0, 0, 0, 0, 1},
+    {0, 0, 0x01, 0x00, 0, 1, 0, 0, 0, 0, 0, 1}
+};
+
+/** Colas: QTYPE (se parchea), QCLASS IN y, con -nsec, el OPT: raíz, 1232 bytes, bit DO **/
+static const unsigned char colas[2][15] =
+{
+    {0, 0, 0, 1},
+    {0, 0, 0, 1, 0, 0, T_OPT, 0x04, 0xd0, 0, 0, 0x80, 0, 0, 0}
+};
+static const int largoCola[2] = {4, 15};
+
+/**
+ * El nombre en formato DNS, como cambiarAlFormatoNombreDNS, en una sola pasada: el byte de largo
+ * de cada label se reserva y se completa al llegar al punto. Para los nombres cortos de las
+ * consultas sale más barato que buscar cada punto por separado. Un label vacío (punto final)
+ * termina el nombre. Devuelve los bytes escritos.
+ **/
+static int escribirNombre(unsigned char *destino, const char *nombre)
+{
+    unsigned char *cuenta = destino, *p = destino + 1;
+    for (;; nombre++)
+    {
+        if (*nombre != '.' && *nombre != '\0')
+        {
+            *p++ = *nombre;
+            continue;
+        }
+        if (p == cuenta + 1)
+        {
+            *cuenta = 0;
+            return cuenta - destino + 1;
+        }
+        *cuenta = p - cuenta - 1;
+        if (*nombre == '\0')
+        {
+            *p = 0;
+            return p - destino + 1;
+        }
+        cuenta = p++;
+    }
+}
+
+int plantillaNombreValido(const char *nombre)
+{
+    int largo = 1, etiqueta = 0;        /** el 0 que termina el nombre **/
+    if (strcmp(nombre,".") == 0)
+        return 1;
+    for (; *nombre != '\0'; nombre++)
+    {
+        if (*nombre != '.')
+        {
+            if (++etiqueta > 63)
+                return 0;
+            continue;
+        }
+        if (etiqueta == 0)              /** "a..b" o ".a" **/
+            return 0;
+        largo += etiqueta + 1;
+        etiqueta = 0;
+    }
+    if (etiqueta > 0)
+        largo += etiqueta + 1;
+    return largo <= 255;
+}
+
+int plantillaArmar(unsigned char *mensaje, int forma, const char *nombre, int tipo, unsigned short id)
+{
+    int dnssec = (forma & PLANTILLA_DNSSEC) != 0;
+    memcpy(mensaje,cabeceras[forma],12);
+    mensaje[0] = id >> 8;
+    mensaje[1] = id & 0xff;
+    int largo = 12 + escribirNombre(mensaje + 12,nombre);
+    memcpy(mensaje + largo,colas[dnssec],largoCola[dnssec]);
+    mensaje[largo] = tipo >> 8;
+    mensaje[largo+1] = tipo & 0xff;
+    return largo + largoCola[dnssec];
+}
@@ -0,0 +1,27 @@
+#ifndef PLANTILLAS_H_INCLUDED
+#define PLANTILLAS_H_INCLUDED
+
+/**
+ * Plantillas de consulta. Los modos masivos (lote, carga, la lista de búsqueda) arman millones de
+ * consultas de la misma forma, en las que sólo cambian el nombre, el ID y a veces el tipo. La
+ * cabecera y la cola (qtype, qclass y el OPT de -nsec) de cada forma son constantes ya en formato
+ * de red: armar una consulta es copiar la cabecera, escribir el nombre, copiar la cola y parchear
+ * el ID y el tipo, sin campos de bits ni decisiones por consulta.
+ **/
+
+/** La forma de una consulta: combinación de estos bits **/
+#define PLANTILLA_RECURSIVA 1       /** bit RD **/
+#define PLANTILLA_DNSSEC 2          /** OPT (RFC 6891) con el bit DO **/
+#define CANTIDAD_PLANTILLAS 4
+
+/** Arma en mensaje la consulta por nombre y tipo con la forma dada; devuelve su largo **/
+int plantillaArmar(unsigned char *mensaje, int forma, const char *nombre, int tipo, unsigned short id);
+
+/**
+ * Si plantillaArmar puede escribir el nombre tal como viene: labels de 1 a 63 bytes y a lo sumo
+ * 255 bytes en formato DNS. Sólo el punto final (o "." solo) puede dejar un label vacío. Los
+ * nombres que llegan de la línea de comandos se validan con esto antes de armar la consulta.
+ **/
+int plantillaNombreValido(const char *nombre);
+
+#endif // PLANTILLAS_H_INCLUDED
@@ -0,0 +1,315 @@
+#include<stdio.h>
+#include<string.h>
+#include<stdlib.h>
+#include<ctype.h>
+#include<pthread.h>
+#include<sys/socket.h>
+#include<poll.h>
+#include<arpa/inet.h>
+#include<netinet/in.h>
+#include<unistd.h>
+
+#include "raices.h"
+#include "dns.h"
+#include "cabecera.h"
+#include "ritmo.h"
+#include "delegaciones.h"
+#include "nombres.h"
+#include "direcciones.h"
+#include "traza.h"
+#include "aleatorio.h"
+
+/**
+ * Tabla generada a partir de https://www.internic.net/domain/named.root
+ * (servidores A a M). Al ser un arreglo constante queda resuelta en tiempo de compilación
+ * y no hace falta ningún paquete para conocer la raíz.
+ **/
+const PISTA_RAIZ pistasRaiz[] =
+{
+    {"a.root-servers.net", "198.41.0.4",     "2001:503:ba3e::2:30"},
+    {"b.root-servers.net", "170.247.170.2",  "2801:1b8:10::b"},
+    {"c.root-servers.net", "192.33.4.12",    "2001:500:2::c"},
+    {"d.root-servers.net", "199.7.91.13",    "2001:500:2d::d"},
+    {"e.root-servers.net", "192.203.230.10", "2001:500:a8::e"},
+    {"f.root-servers.net", "192.5.5.241",    "2001:500:2f::f"},
+    {"g.root-servers.net", "192.112.36.4",   "2001:500:12::d0d"},
+    {"h.root-servers.net", "198.97.190.53",  "2001:500:1::53"},
+    {"i.root-servers.net", "192.36.148.17",  "2001:7fe::53"},
+    {"j.root-servers.net", "192.58.128.30",  "2001:503:c27::2:30"},
+    {"k.root-servers.net", "193.0.14.129",   "2001:7fd::1"},
+    {"l.root-servers.net", "199.7.83.42",    "2001:500:9f::42"},
+    {"m.root-servers.net", "202.12.27.33",   "2001:dc3::35"}
+};
+const int cantidadPistasRaiz = sizeof(pistasRaiz) / sizeof(pistasRaiz[0]);
+
+/** Pistas leídas de un archivo (-raices=archivo), reemplazan a la tabla precompilada **/
+static PISTA_RAIZ *pistasArchivo = NULL;
+static int cantidadPistasArchivo = 0;
+
+static pthread_once_t unaVez = PTHREAD_ONCE_INIT;
+static char puertoPriming[16] = "53";
+
+/** Reintentos del priming cuando ningún servidor raíz responde (segundos) **/
+#define ESPERA_MINIMA_PRIMING 5
+#define ESPERA_MAXIMA_PRIMING 300
+/** Espera de la respuesta de cada servidor raíz (segundos) **/
+#define ESPERA_PRIMING 2
+
+int raicesCargarArchivo(const char *archivo)
+{
+    FILE *fp;
+    char line[512];
+    if ((fp = fopen(archivo,"r")) == NULL)
+    {
+        printf("Falló abriendo el archivo de pistas de raíz %s\n",archivo);
+        return -1;
+    }
+    while (fgets(line,sizeof(line),fp))
+    {
+        char *campos[5];
+        int n = 0;
+        char *p = strtok(line," \t\r\n");
+        if (p == NULL || p[0] == ';')
+            continue;
+        while (p != NULL && n < 5)
+        {
+            campos[n++] = p;
+            p = strtok(NULL," \t\r\n");
+        }
+        if (n < 4)
+            continue;
+        /** NOMBRE TTL [IN] TIPO DATO **/
+        int t = (strcasecmp(campos[2],"IN") == 0) ? 3 : 2;
+        if (t + 1 >= n)
+            continue;
+        char *tipo = campos[t], *dato = campos[t+1];
+        int esA = strcasecmp(tipo,"A") == 0, esAAAA = strcasecmp(tipo,"AAAA") == 0;
+        if (!esA && !esAAAA)
+            continue;
+
+        char nombre[256];
+        snprintf(nombre,sizeof(nombre),"%s",campos[0]);
+        int largo = strlen(nombre), i;
+        if (largo > 1 && nombre[largo-1] == '.')
+            nombre[largo-1] = '\0';
+        for (i = 0; nombre[i]; i++)
+            nombre[i] = tolower((unsigned char)nombre[i]);
+
+        /** un mismo servidor aparece con su A y su AAAA **/
+        for (i = 0; i < cantidadPistasArchivo; i++)
+            if (strcmp(pistasArchivo[i].nombre,nombre) == 0)
+                break;
+        if (i == cantidadPistasArchivo)
+        {
+            pistasArchivo = realloc(pistasArchivo,(cantidadPistasArchivo + 1) * sizeof(PISTA_RAIZ));
+            pistasArchivo[i].nombre = strdup(nombre);
+            pistasArchivo[i].ipv4 = NULL;
+            pistasArchivo[i].ipv6 = NULL;
+            cantidadPistasArchivo++;
+        }
+        if (esA)
+            pistasArchivo[i].ipv4 = strdup(dato);
+        else
+            pistasArchivo[i].ipv6 = strdup(dato);
+    }
+    fclose(fp);
+    return cantidadPistasArchivo;
+}
+
+static const PISTA_RAIZ *pistas(int *cantidad)
+{
+    if (pistasArchivo != NULL)
+    {
+        *cantidad = cantidadPistasArchivo;
+        return pistasArchivo;
+    }
+    *cantidad = cantidadPistasRaiz;
+    return pistasRaiz;
+}
+
+/** Si msg (de al menos el largo de la consulta) es la respuesta a la consulta ". NS IN" enviada: mismo ID, QR y la misma pregunta **/
+static int respuestaPriming(const unsigned char *consulta, const unsigned char *msg)
+{
+    CABECERA_DNS cabecera;
+    cabeceraLeer(msg,&cabecera);
+    return cabecera.qr && cabecera.id == leer16(consulta) && cabecera.qdcount == 1
+           && memcmp(msg + TAM_CABECERA,consulta + TAM_CABECERA,1 + TAM_PREGUNTA) == 0;
+}
+
+/**
+ * Consulta ". NS" a un servidor raíz y, si la respuesta trae direcciones, reemplaza con ellas
+ * la delegación de la raíz. Devuelve el TTL del conjunto, o 0 si falló.
+ **/
+static unsigned int primarRaiz(const char *ip)
+{
+    unsigned char consulta[TAM_CABECERA + 1 + TAM_PREGUNTA], msg[4096];
+    DIRECCION dest, origen;
+    int s, largo = -1, pos, i;
+    CABECERA_DNS cabecera = {0};
+    struct R_DATA campos;
+    TRAZA_CONSULTA traza;           /** el priming corre en su hilo: su traza no comparte estado con las consultas **/
+    long long enviado, limite, resta;
+
+    cabecera.id = aleatorioId();
+    cabecera.qdcount = 1;                   /** RD = 0 **/
+    cabeceraEscribir(&cabecera,consulta);
+    consulta[TAM_CABECERA] = 0;             /** QNAME = raíz **/
+    escribir16(consulta + TAM_CABECERA + 1,T_NS);
+    escribir16(consulta + TAM_CABECERA + 3,1);      /** QCLASS = IN **/
+
+    if (direccionDesdeTexto(&dest,ip,atoi(puertoPriming)) < 0
+            || (s = socket(dest.sa.sa_family,SOCK_DGRAM,IPPROTO_UDP)) < 0)
+        return 0;
+    ritmoEsperarYTomar(&dest);
+    trazaComenzarConsulta(&traza,".","NS");
+    enviado = trazaMicrosegundos();
+    if (sendto(s,consulta,sizeof(consulta),0,&dest.sa,direccionLargo(&dest)) >= 0)
+    {
+        /** hasta ESPERA_PRIMING se espera la respuesta: lo que llega de otra dirección, con otro ID o con
+            otra pregunta se descarta sin cortar la espera, porque de esta respuesta sale toda la raíz **/
+        limite = enviado + ESPERA_PRIMING * 1000000LL;
+        while (largo < 0 && (resta = limite - trazaMicrosegundos()) > 0)
+        {
+            struct pollfd espera = {s, POLLIN, 0};
+            if (poll(&espera,1,(resta + 999) / 1000) <= 0)
+                break;
+            socklen_t largoOrigen = sizeof(origen);
+            int recibidos = recvfrom(s,msg,sizeof(msg),0,&origen.sa,&largoOrigen);
+            if (recibidos >= (int)sizeof(consulta) && direccionIgual(&origen,&dest) && respuestaPriming(consulta,msg))
+                largo = recibidos;
+        }
+    }
+    close(s);
+    if (largo < 0)
+    {
+        ritmoResultado(&dest,RITMO_TIMEOUT);
+        trazaPaso(&traza,ip,puertoPriming,".","NS",trazaMicrosegundos() - enviado,0,0,"timeout",NULL);
+        trazaFinConsulta(&traza,"timeout");
+        return 0;
+    }
+    ritmoResultado(&dest,ritmoClasificarRcode(cabeceraRcode(msg)));
+    cabeceraLeer(msg,&cabecera);
+    trazaPaso(&traza,ip,puertoPriming,".","NS",trazaMicrosegundos() - enviado,largo,cabecera.rcode,
+              cabecera.rcode == 0 ? "answer" : "error",NULL);
+    trazaFinConsulta(&traza,cabecera.rcode == 0 ? "answer" : "error");
+    if (cabecera.rcode != 0)
+        return 0;
+
+    int ancount = cabecera.ancount;
+    int nscount = cabecera.nscount;
+    int arcount = cabecera.arcount;
+    NOMBRE_DNS nombre;
+    const NOMBRE_DNS *nombresNS[MAX_SERVIDORES_DELEGACION];
+    SERVIDOR_DELEGACION glue[MAX_SERVIDORES_DELEGACION];
+    int cantidadNS = 0, cantidadGlue = 0;
+    unsigned int ttlMinimo = 0xFFFFFFFF;
+
+    if ((pos = nombreLeerMensaje(msg,largo,TAM_CABECERA,NULL,NULL)) < 0)
+        return 0;
+    pos += 4;
+
+    /** answer: los NS de la raíz; authority se saltea; additional: sus direcciones (A y AAAA) **/
+    for (i = 0; i < ancount + nscount + arcount; i++)
+    {
+        if ((pos = nombreLeerMensaje(msg,largo,pos,&nombre,NULL)) < 0 || pos + TAM_R_DATA > largo)
+            break;
+        camposRRLeer(msg + pos,&campos);
+        int tipo = campos.type;
+        unsigned int ttl = campos.ttl;
+        int rdlength = campos.rdlength;
+        pos += TAM_R_DATA;
+        if (pos + rdlength > largo)
+            break;
+        if (i < ancount && tipo == T_NS && nombre.largo == 1 && cantidadNS < MAX_SERVIDORES_DELEGACION)
+        {
+            NOMBRE_DNS ns;
+            if (nombreLeerMensaje(msg,largo,pos,&ns,NULL) > 0 && (nombresNS[cantidadNS] = nombreInternar(&ns)) != NULL)
+                cantidadNS++;
+            if (ttl < ttlMinimo)
+                ttlMinimo = ttl;
+        }
+        else if (i >= ancount + nscount && ((tipo == T_A && rdlength == 4) || (tipo == T_AAAA && rdlength == 16))
+                 && cantidadGlue < MAX_SERVIDORES_DELEGACION)
+        {
+            int j;
+            for (j = 0; j < cantidadNS; j++)
+                if (nombreIgual(nombresNS[j],&nombre))
+                    break;
+            if (j < cantidadNS)
+            {
+                glue[cantidadGlue].nombre = nombresNS[j];
+                inet_ntop(tipo == T_A ? AF_INET : AF_INET6,msg + pos,glue[cantidadGlue].ip,sizeof(glue[cantidadGlue].ip));
+                cantidadGlue++;
+            }
+        }
+        pos += rdlength;
+    }
+    if (cantidadGlue == 0)
+        return 0;
+    /** reemplazo las pistas por el conjunto real, de una sola vez **/
+    delegacionReemplazar(".",glue,cantidadGlue,ttlMinimo);
+    return ttlMinimo;
+}
+
+/** Hilo de priming: ceba la raíz y la refresca cada vez que vence su TTL **/
+static void *hiloPriming(void *arg)
+{
+    int cantidad, siguiente = 0;
+    unsigned int espera = ESPERA_MINIMA_PRIMING;
+    const PISTA_RAIZ *p = pistas(&cantidad);
+    (void)arg;
+
+    while (1)
+    {
+        int intentos;
+        unsigned int ttl = 0;
+        /** pruebo los servidores raíz en orden rotativo hasta que uno responda **/
+        for (intentos = 0; intentos < cantidad && ttl == 0; intentos++)
+        {
+            const PISTA_RAIZ *pista = &p[siguiente];
+            siguiente = (siguiente + 1) % cantidad;
+            /** IPv4 si se puede, si no la IPv6 (sin ninguna, o con -6) **/
+            if (pista->ipv4 != NULL && direccionPermitida(AF_INET))
+                ttl = primarRaiz(pista->ipv4);
+            else if (pista->ipv6 != NULL && direccionPermitida(AF_INET6))
+                ttl = primarRaiz(pista->ipv6);
+        }
+        if (ttl > 0)
+        {
+            espera = ESPERA_MINIMA_PRIMING;
+            sleep(ttl);
+        }
+        else
+        {
+            sleep(espera);
+            espera = (espera * 2 > ESPERA_MAXIMA_PRIMING) ? ESPERA_MAXIMA_PRIMING : espera * 2;
+        }
+    }
+    return NULL;
+}
+
+static void iniciarUnaVez()
+{
+    int cantidad, i;
+    const PISTA_RAIZ *p = pistas(&cantidad);
+    pthread_t hilo;
+
+    /** las pistas quedan disponibles de inmediato: nadie espera al priming **/
+    for (i = 0; i < cantidad; i++)
+    {
+        if (p[i].ipv4 != NULL && direccionPermitida(AF_INET))
+            delegacionAgregar(".",p[i].nombre,p[i].ipv4,TTL_PISTAS_RAIZ);
+        if (p[i].ipv6 != NULL && direccionPermitida(AF_INET6))
+            delegacionAgregar(".",p[i].nombre,p[i].ipv6,TTL_PISTAS_RAIZ);
+    }
+
+    if (pthread_create(&hilo,NULL,hiloPriming,NULL) == 0)
+        pthread_detach(hilo);
+}
+
+void raicesIniciar(const char *puerto)
+{
+    if (puerto != NULL)
+        snprintf(puertoPriming,sizeof(puertoPriming),"%s",puerto);
+    pthread_once(&unaVez,iniciarUnaVez);
+}
@@ -0,0 +1,33 @@
+#ifndef RAICES_H_INCLUDED
+#define RAICES_H_INCLUDED
+
+/** Pistas de los servidores raíz (root hints), precompiladas a partir de named.root **/
+typedef struct
+{
+    const char *nombre;
+    const char *ipv4;
+    const char *ipv6;
+} PISTA_RAIZ;
+
+extern const PISTA_RAIZ pistasRaiz[];
+extern const int cantidadPistasRaiz;
+
+/** TTL con el que se publican las pistas en named.root (segundos) **/
+#define TTL_PISTAS_RAIZ 3600000
+
+/**
+ * Carga la cache de delegaciones con las pistas de raíz y lanza, una sola vez por proceso,
+ * un hilo que "ceba" (priming, RFC 8109) la zona raíz en segundo plano preguntando ". NS" a
+ * uno de los servidores raíz y refresca el conjunto cuando vence su TTL.
+ * puerto: puerto al que se envían las consultas (53 salvo pruebas).
+ **/
+void raicesIniciar(const char *puerto);
+
+/**
+ * Reemplaza las pistas precompiladas por las de un archivo en formato named.root
+ * (líneas "NOMBRE TTL [IN] A|AAAA|NS DATO"). Debe llamarse antes de raicesIniciar().
+ * Devuelve la cantidad de direcciones cargadas, o -1 si no se pudo leer.
+ **/
+int raicesCargarArchivo(const char *archivo);
+
+#endif // RAICES_H_INCLUDED
@@ -0,0 +1,409 @@
+#include<stdio.h>
+#include<string.h>
+#include<stdlib.h>
+#include<arpa/inet.h>
+
+#include "dns.h"
+#include "tipos_rr.h"
+#include "traza.h"
+#include "nombres.h"
+#include "escritor.h"
+#include "secciones.h"
+#include "delegaciones.h"
+#include "repeticion.h"
+
+/** Números mágicos del encabezado pcap, leídos en el orden de bytes del archivo **/
+#define PCAP_MICROSEGUNDOS 0xA1B2C3D4
+#define PCAP_NANOSEGUNDOS 0xA1B23C4D
+#define PCAPNG 0x0A0D0D0A
+
+/** Tipos de enlace (LINKTYPE_*) **/
+#define ENLACE_NULL 0
+#define ENLACE_ETHERNET 1
+#define ENLACE_RAW 101
+#define ENLACE_RAW_BSD 12
+#define ENLACE_IPV4 228
+#define ENLACE_IPV6 229
+#define ENLACE_SLL 113
+#define ENLACE_SLL2 276
+
+/** La captura cargada: los mensajes quedan dentro del archivo leído, sin copiarlos **/
+typedef struct
+{
+    unsigned char *datos;
+    long largo;
+    long *inicios;
+    int *largos;
+    long cantidad, capacidad;
+    long ignorados;                 // paquetes que no son UDP sobre IP, fragmentos, TCP, otros puertos...
+} CAPTURA;
+
+/** Contadores de la repetición **/
+typedef struct
+{
+    long respuestas, consultas, malformados, referencias;
+    long rcodes[16];
+    long long registros, bytes;
+    SECCIONES secciones;            // reutilizado de un mensaje al siguiente
+} REPETICION;
+
+/** Entero de 32 bits del archivo pcap, en el orden de bytes de quien lo escribió **/
+static unsigned int leer32Pcap(const unsigned char *p, int invertido)
+{
+    if (invertido)
+        return ((unsigned int)p[3] << 24) | (p[2] << 16) | (p[1] << 8) | p[0];
+    return leer32(p);
+}
+
+static void agregarMensaje(CAPTURA *c, const unsigned char *mensaje, int largo)
+{
+    if (c->cantidad == c->capacidad)
+    {
+        c->capacidad = c->capacidad ? c->capacidad * 2 : 4096;
+        c->inicios = (long*)realloc(c->inicios,c->capacidad * sizeof(long));
+        c->largos = (int*)realloc(c->largos,c->capacidad * sizeof(int));
+    }
+    c->inicios[c->cantidad] = mensaje - c->datos;
+    c->largos[c->cantidad++] = largo;
+}
+
+/** Carga el archivo entero en memoria **/
+static int leerArchivo(const char *archivo, CAPTURA *c)
+{
+    FILE *f = fopen(archivo,"rb");
+    size_t leidos;
+    if (f == NULL)
+    {
+        printf("ERROR: no se pudo abrir la captura %s\n",archivo);
+        return -1;
+    }
+    fseek(f,0,SEEK_END);
+    c->largo = ftell(f);
+    fseek(f,0,SEEK_SET);
+    if (c->largo < 0 || c->largo > MAX_CAPTURA)
+    {
+        printf("ERROR: la captura %s es demasiado grande\n",archivo);
+        fclose(f);
+        return -1;
+    }
+    c->datos = (unsigned char*)malloc(c->largo + 1);
+    leidos = fread(c->datos,1,c->largo,f);
+    fclose(f);
+    if ((long)leidos != c->largo)
+    {
+        printf("ERROR: no se pudo leer la captura %s\n",archivo);
+        return -1;
+    }
+    return 0;
+}
+
+/** Busca el datagrama UDP dentro de un paquete IPv4 o IPv6 y, si es del puerto 53, agrega su contenido **/
+static void agregarDatagrama(CAPTURA *c, const unsigned char *ip, int largo)
+{
+    int protocolo, encabezado, total;
+    if (largo < 1)
+    {
+        c->ignorados++;
+        return;
+    }
+    if ((ip[0] >> 4) == 4 && largo >= 20)
+    {
+        encabezado = (ip[0] & 0x0f) * 4;
+        if ((total = leer16(ip + 2)) < largo)   /** descarta el relleno de Ethernet **/
+            largo = total;
+        /** fragmentos: MF o desplazamiento distinto de cero **/
+        if ((leer16(ip + 6) & 0x3FFF) != 0)
+        {
+            c->ignorados++;
+            return;
+        }
+        protocolo = ip[9];
+    }
+    else if ((ip[0] >> 4) == 6 && largo >= 40)
+    {
+        encabezado = 40;
+        if ((total = leer16(ip + 4) + 40) < largo)
+            largo = total;
+        protocolo = ip[6];
+        /** encabezados de extensión: hop-by-hop, enrutamiento y opciones de destino **/
+        while ((protocolo == 0 || protocolo == 43 || protocolo == 60) && encabezado + 8 <= largo)
+        {
+            protocolo = ip[encabezado];
+            encabezado += (ip[encabezado+1] + 1) * 8;
+        }
+    }
+    else
+    {
+        c->ignorados++;
+        return;
+    }
+    if (protocolo != 17 || encabezado + 8 > largo)
+    {
+        c->ignorados++;
+        return;
+    }
+    const unsigned char *udp = ip + encabezado;
+    /** sólo DNS: el puerto 53 de un lado o del otro (un mDNS o un QUIC no pasan por el parser) **/
+    if (leer16(udp) != 53 && leer16(udp + 2) != 53)
+    {
+        c->ignorados++;
+        return;
+    }
+    int largoUDP = leer16(udp + 4);
+    if (largoUDP < 8 || largoUDP > largo - encabezado)
+        largoUDP = largo - encabezado;
+    agregarMensaje(c,udp + 8,largoUDP - 8);
+}
+
+/** Recorre un pcap clásico y agrega el contenido de cada datagrama UDP **/
+static int cargarPcap(CAPTURA *c, int invertido)
+{
+    unsigned int enlace = leer32Pcap(c->datos + 20,invertido) & 0xFFFF;
+    long pos = 24;
+    while (pos + 16 <= c->largo)
+    {
+        unsigned int capturado = leer32Pcap(c->datos + pos + 8,invertido);
+        const unsigned char *p = c->datos + pos + 16;
+        int largo = capturado, tipo = -1;
+        if (capturado > (unsigned long)(c->largo - pos - 16))
+        {
+            fprintf(stderr,";; la captura termina en un paquete incompleto\n");
+            break;
+        }
+        pos += 16 + capturado;
+
+        /** salteo el encabezado de enlace; tipo queda en el ethertype cuando el enlace lo tiene **/
+        switch (enlace)
+        {
+            case ENLACE_ETHERNET:
+                if (largo < 14)
+                    break;
+                tipo = leer16(p + 12);
+                p += 14;
+                largo -= 14;
+                while ((tipo == 0x8100 || tipo == 0x88A8) && largo >= 4)  /** VLAN **/
+                {
+                    tipo = leer16(p + 2);
+                    p += 4;
+                    largo -= 4;
+                }
+                break;
+            case ENLACE_SLL:
+                if (largo < 16)
+                    break;
+                tipo = leer16(p + 14);
+                p += 16;
+                largo -= 16;
+                break;
+            case ENLACE_SLL2:
+                if (largo < 20)
+                    break;
+                tipo = leer16(p);
+                p += 20;
+                largo -= 20;
+                break;
+            case ENLACE_NULL:       /** familia en el orden del host que capturó: basta la versión IP **/
+                if (largo < 4)
+                    break;
+                p += 4;
+                largo -= 4;
+                tipo = 0;
+                break;
+            case ENLACE_RAW:
+            case ENLACE_RAW_BSD:
+            case ENLACE_IPV4:
+            case ENLACE_IPV6:
+                tipo = 0;
+                break;
+            default:
+                printf("ERROR: tipo de enlace %u no soportado en la captura\n",enlace);
+                return -1;
+        }
+        if (tipo == 0 || tipo == 0x0800 || tipo == 0x86DD)
+            agregarDatagrama(c,p,largo);
+        else
+            c->ignorados++;
+    }
+    return 0;
+}
+
+/** Mensajes precedidos por su largo en 2 bytes, como en DNS sobre TCP **/
+static int cargarConLargo(CAPTURA *c)
+{
+    long pos = 0;
+    while (pos + 2 <= c->largo)
+    {
+        int largo = leer16(c->datos + pos);
+        if (pos + 2 + largo > c->largo)
+        {
+            fprintf(stderr,";; la captura termina en un mensaje incompleto\n");
+            break;
+        }
+        agregarMensaje(c,c->datos + pos + 2,largo);
+        pos += 2 + largo;
+    }
+    return 0;
+}
+
+static int cargarCaptura(const char *archivo, CAPTURA *c)
+{
+    if (leerArchivo(archivo,c) < 0)
+        return -1;
+    if (c->largo >= 24)
+    {
+        unsigned int magico = leer32Pcap(c->datos,0);
+        if (magico == PCAP_MICROSEGUNDOS || magico == PCAP_NANOSEGUNDOS)
+            return cargarPcap(c,0);
+        magico = leer32Pcap(c->datos,1);
+        if (magico == PCAP_MICROSEGUNDOS || magico == PCAP_NANOSEGUNDOS)
+            return cargarPcap(c,1);
+        if (magico == PCAPNG)
+        {
+            printf("ERROR: %s es pcapng; convertirla con \"editcap -F pcap\"\n",archivo);
+            return -1;
+        }
+    }
+    return cargarConLargo(c);
+}
+
+/** Analiza una respuesta igual que resolverConsulta: pregunta, las tres secciones y las referencias **/
+static void analizarMensaje(REPETICION *r, unsigned char *mensaje, int largo, ESCRITOR *salida)
+{
+    SECCIONES *s = &r->secciones;
+    int pos = TAM_CABECERA, tipo = 0, i;
+    char qname[256] = "";
+    CABECERA_DNS cabecera;
+
+    if (largo < TAM_CABECERA)
+    {
+        r->malformados++;
+        return;
+    }
+    cabeceraLeer(mensaje,&cabecera);
+    if (!cabecera.qr)
+    {
+        r->consultas++;
+        return;
+    }
+    for (i = 0; i < cabecera.qdcount; i++)
+    {
+        pos = nombreLeerMensaje(mensaje,largo,pos,NULL,i == 0 ? qname : NULL);
+        if (pos < 0 || pos + 4 > largo)
+        {
+            r->malformados++;
+            return;
+        }
+        if (i == 0)
+            tipo = leer16(mensaje + pos);
+        pos += 4;
+    }
+
+    /** se recorre el mensaje una vez; sólo se decodifica lo que se va a usar **/
+    int rcode = cabecera.rcode;
+    r->registros += seccionesLeer(s,mensaje,largo,pos);
+    r->respuestas++;
+    r->rcodes[rcode]++;
+    /** las referencias alimentan la cache de delegaciones, como en el modo iterativo **/
+    if (rcode == 0 && seccionesCantidad(s,SECCION_ANSWER) == 0 && seccionesCantidad(s,SECCION_AUTHORITY) > 0
+            && s->tipo[s->inicio[SECCION_AUTHORITY]] == T_NS)
+    {
+        /** la captura no dice qué zona servía el que respondió: se toma la padre de la delegada,
+            así sólo se aprende glue dentro de ella, como si la hubiera mandado su servidor **/
+        char zona[256];
+        const char *padre;
+        if (seccionesNombre(s,s->inicio[SECCION_AUTHORITY],zona) == 0)
+        {
+            padre = strchr(zona,'.');
+            delegacionAprender(s,zona,padre != NULL && padre[1] != '\0' ? padre + 1 : ".");
+        }
+        r->referencias++;
+    }
+    if (salida != NULL)
+    {
+        RESULTADO resultado = {qname, tipo, rcode, -1, seccionesRegistros(s,SECCION_ANSWER), seccionesCantidad(s,SECCION_ANSWER)};
+        escritorResultado(salida,&resultado);
+    }
+}
+
+int repeticionCaptura(const char *archivo, int vueltas, const char *salida, int formato)
+{
+    CAPTURA c;
+    REPETICION r;
+    ESCRITOR *escritor = NULL;
+    long i;
+    int vuelta;
+
+    memset(&c,0,sizeof(c));
+    memset(&r,0,sizeof(r));
+    if (cargarCaptura(archivo,&c) < 0)
+    {
+        free(c.datos);
+        return -1;
+    }
+    if ((salida != NULL || formato != FORMATO_TEXTO) && (escritor = escritorAbrir(salida,formato)) == NULL)
+    {
+        free(c.datos);
+        return -1;
+    }
+
+    long long comienzo = trazaMicrosegundos();
+    for (vuelta = 0; vuelta < vueltas; vuelta++)
+        for (i = 0; i < c.cantidad; i++)
+        {
+            analizarMensaje(&r,c.datos + c.inicios[i],c.largos[i],escritor);
+            r.bytes += c.largos[i];
+        }
+    double segundos = (trazaMicrosegundos() - comienzo) / 1000000.0;
+
+    FILE *resumen = stdout;
+    if (escritor != NULL)
+    {
+        if (escritorEnSalidaEstandar(escritor))
+            resumen = stderr;
+        escritorCerrar(escritor);
+    }
+    long mensajes = c.cantidad * vueltas;
+    fprintf(resumen,";; repetición: %ld mensajes (%ld por vuelta, %d vueltas) en %.3f s\n",mensajes,c.cantidad,vueltas,segundos);
+    if (segundos > 0)
+        fprintf(resumen,";; %.0f mensajes/s, %.1f MB/s (%.0f ns por mensaje)\n",mensajes / segundos,
+                r.bytes / segundos / 1e6,mensajes > 0 ? segundos * 1e9 / mensajes : 0);
+    fprintf(resumen,";; respuestas: %ld, registros: %lld, referencias: %ld, consultas salteadas: %ld, malformados: %ld\n",
+            r.respuestas,r.registros,r.referencias,r.consultas,r.malformados);
+    fprintf(resumen,";; NOERROR: %ld, NXDOMAIN: %ld, SERVFAIL: %ld, otros rcode: %ld\n",r.rcodes[0],r.rcodes[3],r.rcodes[2],
+            r.respuestas - r.rcodes[0] - r.rcodes[3] - r.rcodes[2]);
+    if (c.ignorados > 0)
+        fprintf(resumen,";; paquetes de la captura que no son DNS sobre UDP (puerto 53): %ld\n",c.ignorados);
+
+    seccionesLiberar(&r.secciones);
+    free(c.inicios);
+    free(c.largos);
+    free(c.datos);
+    return 0;
+}
+
+long repeticionRespuestas(const char *archivo, unsigned char **datos, unsigned char ***mensajes, int **largos)
+{
+    CAPTURA c;
+    long i, cantidad = 0;
+
+    memset(&c,0,sizeof(c));
+    if (cargarCaptura(archivo,&c) < 0)
+    {
+        free(c.datos);
+        free(c.inicios);
+        free(c.largos);
+        return -1;
+    }
+    *mensajes = (unsigned char**)malloc((c.cantidad > 0 ? c.cantidad : 1) * sizeof(unsigned char*));
+    *largos = (int*)malloc((c.cantidad > 0 ? c.cantidad : 1) * sizeof(int));
+    for (i = 0; i < c.cantidad; i++)
+        if (c.largos[i] >= 12 && (c.datos[c.inicios[i] + 2] & 0x80))
+        {
+            (*mensajes)[cantidad] = c.datos + c.inicios[i];
+            (*largos)[cantidad++] = c.largos[i];
+        }
+    *datos = c.datos;
+    free(c.inicios);
+    free(c.largos);
+    return cantidad;
+}
@@ -0,0 +1,42 @@
+#ifndef REPETICION_H_INCLUDED
+#define REPETICION_H_INCLUDED
+
+/**
+ * Repetición de capturas (parámetro -repetir=): lee respuestas DNS de un archivo y las pasa por
+ * el mismo camino que las respuestas en vivo de resolverConsulta (leerSeccion y la tabla de tipos,
+ * la cache de delegaciones con las referencias y, si se pidió, el escritor de resultados), sin
+ * sockets y a la máxima velocidad. Sirve para medir el parser con tráfico real y repetible.
+ *
+ * Formatos de captura (se reconocen por los primeros bytes):
+ *  pcap:   el formato clásico de tcpdump (microsegundos o nanosegundos, cualquier orden de bytes),
+ *          con enlaces Ethernet (con o sin VLAN), Linux "cooked" (SLL y SLL2), loopback BSD o IP
+ *          crudo. Se toman los datagramas UDP sobre IPv4 o IPv6 con origen o destino en el puerto 53; los
+ *          fragmentos, TCP y los demás puertos se saltean.
+ *          pcapng no se reconoce: convertir antes con "editcap -F pcap".
+ *  largo:  cada mensaje precedido por su largo en 2 bytes en orden de red, como en DNS sobre TCP
+ *          (RFC 1035 4.2.2). Un volcado de una conexión TCP DNS ya tiene este formato.
+ * Sólo se analizan las respuestas (QR = 1); las consultas de la captura se cuentan y se saltean.
+ *
+ * Toda la captura se carga en memoria antes de empezar, así la medición no incluye la lectura
+ * del archivo. Al final informa mensajes por segundo y bytes por segundo.
+ **/
+
+/** Tamaño máximo de la captura que se carga en memoria **/
+#define MAX_CAPTURA (1L << 31)
+
+/**
+ * archivo: captura; vueltas: cuántas veces se recorre la captura (para capturas chicas).
+ * salida/formato: si salida no es NULL o el formato no es texto, cada respuesta se escribe con
+ * el escritor (escritor.h); si no, sólo se analizan y se mide el parser.
+ * Devuelve 0, o -1 si no se pudo leer la captura.
+ **/
+int repeticionCaptura(const char *archivo, int vueltas, const char *salida, int formato);
+
+/**
+ * Carga la captura y deja en mensajes y largos sus respuestas (QR = 1, de al menos 12 bytes), que
+ * apuntan dentro de *datos. Para medir funciones sueltas sobre tráfico real (medicion.h); se
+ * liberan *datos, *mensajes y *largos. Devuelve la cantidad de respuestas, o -1.
+ **/
+long repeticionRespuestas(const char *archivo, unsigned char **datos, unsigned char ***mensajes, int **largos);
+
+#endif // REPETICION_H_INCLUDED
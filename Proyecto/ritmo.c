@@ -0,0 +1,207 @@
+#include<stdio.h>
+#include<string.h>
+#include<stdlib.h>
+#include<unistd.h>
+#include<pthread.h>
+#include<arpa/inet.h>
+
+#include "traza.h"
+#include "ritmo.h"
+
+/** Estado de un destino **/
+typedef struct DESTINO_RITMO
+{
+    DIRECCION direccion;            // dirección y puerto
+    double tasa;                    // qps actual, entre tasaMinima y qpsPorDestino
+    double fichas;
+    long long ultimaRecarga;
+    int resultados, errores;        // de la ventana en curso
+    struct DESTINO_RITMO *siguiente;
+} DESTINO_RITMO;
+
+static double qpsPorDestino = 0;
+static int maxEnVueloGlobal = 0;
+static int enVueloGlobal = 0;
+static DESTINO_RITMO **destinos;
+static unsigned int cubetasDestinos, cantidadDestinos;
+static pthread_mutex_t candadoRitmo = PTHREAD_MUTEX_INITIALIZER;
+
+void ritmoConfigurar(double qps, int maxEnVuelo)
+{
+    pthread_mutex_lock(&candadoRitmo);
+    qpsPorDestino = qps > 0 ? qps : 0;
+    maxEnVueloGlobal = maxEnVuelo > 0 ? maxEnVuelo : 0;
+    pthread_mutex_unlock(&candadoRitmo);
+}
+
+/** Duplica las cubetas; requiere tener el candado **/
+static void crecerDestinos()
+{
+    unsigned int nuevas = cubetasDestinos ? cubetasDestinos * 2 : 64, i;
+    DESTINO_RITMO **nueva = (DESTINO_RITMO**)calloc(nuevas,sizeof(DESTINO_RITMO*));
+    for (i = 0; i < cubetasDestinos; i++)
+        while (destinos[i] != NULL)
+        {
+            DESTINO_RITMO *d = destinos[i];
+            unsigned int h = direccionHash(&d->direccion) % nuevas;
+            destinos[i] = d->siguiente;
+            d->siguiente = nueva[h];
+            nueva[h] = d;
+        }
+    free(destinos);
+    destinos = nueva;
+    cubetasDestinos = nuevas;
+}
+
+/** Busca (o crea) el destino y recarga sus fichas; requiere tener el candado **/
+static DESTINO_RITMO *obtenerDestino(const DIRECCION *destino)
+{
+    DESTINO_RITMO *d = NULL;
+    long long ahora = trazaMicrosegundos();
+
+    if (cubetasDestinos > 0)
+        for (d = destinos[direccionHash(destino) % cubetasDestinos]; d != NULL; d = d->siguiente)
+            if (direccionIgual(&d->direccion,destino))
+                break;
+    if (d == NULL)
+    {
+        if (cantidadDestinos >= cubetasDestinos)
+            crecerDestinos();
+        d = (DESTINO_RITMO*)calloc(1,sizeof(DESTINO_RITMO));
+        d->direccion = *destino;
+        d->tasa = qpsPorDestino;
+        d->fichas = 1;
+        d->ultimaRecarga = ahora;
+        unsigned int h = direccionHash(destino) % cubetasDestinos;
+        d->siguiente = destinos[h];
+        destinos[h] = d;
+        cantidadDestinos++;
+    }
+    if (qpsPorDestino > 0)
+    {
+        /** la ráfaga máxima es de 10 ms de envíos, como en el motor **/
+        double maximo = d->tasa / 100 > 1 ? d->tasa / 100 : 1;
+        d->fichas += (ahora - d->ultimaRecarga) * d->tasa / 1000000.0;
+        if (d->fichas > maximo)
+            d->fichas = maximo;
+    }
+    d->ultimaRecarga = ahora;
+    return d;
+}
+
+/** Lo que falta para la próxima ficha del destino; requiere tener el candado **/
+static long long esperaDestino(DESTINO_RITMO *d)
+{
+    if (qpsPorDestino <= 0 || d->fichas >= 1)
+        return 0;
+    return (long long)((1 - d->fichas) * 1000000 / d->tasa) + 1;
+}
+
+long long ritmoEspera(const DIRECCION *destino)
+{
+    long long espera;
+    pthread_mutex_lock(&candadoRitmo);
+    espera = esperaDestino(obtenerDestino(destino));
+    /** con el tope global lleno no se sabe cuándo se libera un lugar: se vuelve a mirar en 1 ms **/
+    if (espera == 0 && maxEnVueloGlobal > 0 && enVueloGlobal >= maxEnVueloGlobal)
+        espera = 1000;
+    pthread_mutex_unlock(&candadoRitmo);
+    return espera;
+}
+
+int ritmoTomar(const DIRECCION *destino)
+{
+    int resultado = -1;
+    pthread_mutex_lock(&candadoRitmo);
+    DESTINO_RITMO *d = obtenerDestino(destino);
+    if (esperaDestino(d) == 0 && (maxEnVueloGlobal <= 0 || enVueloGlobal < maxEnVueloGlobal))
+    {
+        if (qpsPorDestino > 0)
+            d->fichas -= 1;
+        enVueloGlobal++;
+        resultado = 0;
+    }
+    pthread_mutex_unlock(&candadoRitmo);
+    return resultado;
+}
+
+void ritmoEsperarYTomar(const DIRECCION *destino)
+{
+    while (ritmoTomar(destino) < 0)
+    {
+        long long espera = ritmoEspera(destino);
+        usleep(espera > 0 ? espera : 100);
+    }
+}
+
+/** Cuenta un resultado en la ventana del destino y adapta la tasa; requiere tener el candado **/
+static void adaptar(const DIRECCION *destino, DESTINO_RITMO *d, int resultado)
+{
+    d->resultados++;
+    if (resultado != RITMO_RESPUESTA)
+        d->errores++;
+    if (qpsPorDestino > 0 && d->resultados >= RITMO_VENTANA)
+    {
+        double minima = qpsPorDestino / 16;
+        if (d->errores > d->resultados * RITMO_UMBRAL_ERRORES && d->tasa > minima)
+        {
+            d->tasa /= 2;
+            if (d->tasa < minima)
+                d->tasa = minima;
+            /** las fichas acumuladas a la tasa anterior se descartan **/
+            if (d->fichas > 1)
+                d->fichas = 1;
+            char ip[LARGO_TEXTO_DIRECCION];
+            trazaRitmo(direccionATexto(destino,ip),direccionPuerto(destino),d->tasa,d->errores,d->resultados);
+        }
+        else if (d->tasa < qpsPorDestino)
+        {
+            d->tasa += qpsPorDestino / 10;
+            if (d->tasa > qpsPorDestino)
+                d->tasa = qpsPorDestino;
+        }
+        d->resultados = 0;
+        d->errores = 0;
+    }
+}
+
+void ritmoResultado(const DIRECCION *destino, int resultado)
+{
+    pthread_mutex_lock(&candadoRitmo);
+    if (enVueloGlobal > 0)
+        enVueloGlobal--;
+    adaptar(destino,obtenerDestino(destino),resultado);
+    pthread_mutex_unlock(&candadoRitmo);
+}
+
+void ritmoSoltar()
+{
+    pthread_mutex_lock(&candadoRitmo);
+    if (enVueloGlobal > 0)
+        enVueloGlobal--;
+    pthread_mutex_unlock(&candadoRitmo);
+}
+
+void ritmoReintento(const DIRECCION *destino)
+{
+    pthread_mutex_lock(&candadoRitmo);
+    DESTINO_RITMO *d = obtenerDestino(destino);
+    if (qpsPorDestino > 0)
+        d->fichas -= 1;
+    adaptar(destino,d,RITMO_TIMEOUT);
+    pthread_mutex_unlock(&candadoRitmo);
+}
+
+int ritmoClasificarRcode(int rcode)
+{
+    return (rcode == 2 || rcode == 5) ? RITMO_RECHAZO : RITMO_RESPUESTA;
+}
+
+double ritmoTasa(const DIRECCION *destino)
+{
+    double tasa;
+    pthread_mutex_lock(&candadoRitmo);
+    tasa = qpsPorDestino > 0 ? obtenerDestino(destino)->tasa : 0;
+    pthread_mutex_unlock(&candadoRitmo);
+    return tasa;
+}
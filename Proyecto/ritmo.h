@@ -0,0 +1,64 @@
+#ifndef RITMO_H_INCLUDED
+#define RITMO_H_INCLUDED
+
+#include "direcciones.h"
+
+/**
+ * Ritmo de envío compartido por todo el proceso: un balde de fichas (token bucket) por cada
+ * destino (dirección y puerto) y un tope global de consultas en vuelo. Lo consultan el motor no
+ * bloqueante (barrido, lote) y el camino bloqueante de resolverConsulta, así que cada salto del
+ * modo iterativo respeta el mismo límite que un lote contra los mismos servidores.
+ *
+ * La tasa de cada destino se adapta (aumento aditivo, disminución multiplicativa): cuando en una
+ * ventana de resultados sube la proporción de REFUSED, SERVFAIL o timeouts, la tasa se divide
+ * por dos (sin bajar de 1/16 del máximo); mientras las respuestas son buenas, vuelve a subir de a
+ * un décimo del máximo. Así se encuentra la tasa sostenible sin disparar el response rate
+ * limiting del otro lado, y los reintentos no terminan de saturar a un servidor que ya rechaza.
+ *
+ * Sin ritmoConfigurar (o con qpsPorDestino 0) los destinos no tienen límite de tasa y sólo
+ * cuenta el tope global. La prueba de carga (carga.h) no pasa por acá: mide al servidor sin frenos.
+ **/
+
+/** Resultado de una consulta, para la adaptación de la tasa **/
+#define RITMO_RESPUESTA 0
+#define RITMO_RECHAZO 1        /** REFUSED o SERVFAIL **/
+#define RITMO_TIMEOUT 2
+
+/** Resultados por ventana de adaptación, y proporción de errores que dispara la baja **/
+#define RITMO_VENTANA 20
+#define RITMO_UMBRAL_ERRORES 0.1
+
+/** qpsPorDestino: tasa máxima de cada destino (0 = sin límite); maxEnVuelo: tope global (0 = sin tope) **/
+void ritmoConfigurar(double qpsPorDestino, int maxEnVuelo);
+
+/**
+ * Microsegundos que faltan para poder enviar a destino (0 = ya). No consume nada: para enviar
+ * hay que llamar a ritmoTomar.
+ **/
+long long ritmoEspera(const DIRECCION *destino);
+
+/** Consume una ficha del destino y un lugar del tope global; -1 si ahora no se puede **/
+int ritmoTomar(const DIRECCION *destino);
+
+/** Espera (durmiendo) hasta poder enviar a destino y lo toma; para el camino bloqueante **/
+void ritmoEsperarYTomar(const DIRECCION *destino);
+
+/** Informa cómo terminó una consulta tomada: libera su lugar en vuelo y adapta la tasa **/
+void ritmoResultado(const DIRECCION *destino, int resultado);
+
+/** Libera el lugar en vuelo de una consulta abandonada (cancelada) sin adaptar la tasa: no se sabe cómo terminó **/
+void ritmoSoltar();
+
+/**
+ * Un reenvío de una consulta que sigue en vuelo: cuenta como timeout para la adaptación y consume
+ * una ficha aunque no haya (la deuda demora los envíos siguientes al mismo destino).
+ **/
+void ritmoReintento(const DIRECCION *destino);
+
+/** Clasifica un rcode para ritmoResultado **/
+int ritmoClasificarRcode(int rcode);
+
+/** Tasa actual de un destino (0 si no tiene límite), para los resúmenes **/
+double ritmoTasa(const DIRECCION *destino);
+
+#endif // RITMO_H_INCLUDED
@@ -0,0 +1,184 @@
+#include<stdio.h>
+#include<string.h>
+#include<stdlib.h>
+
+#include "secciones.h"
+#include "nombres.h"
+#include "tipos_rr.h"
+
+/** El registro más chico posible: nombre raíz (1 byte) y los campos fijos **/
+#define MINIMO_RR (1 + TAM_R_DATA)
+
+/** Avanza sobre un nombre sin decodificarlo; la posición siguiente o -1 **/
+static int saltarNombre(const unsigned char *mensaje, int largo, int pos)
+{
+    while (pos < largo)
+    {
+        unsigned char c = mensaje[pos];
+        if ((c & 0xC0) == 0xC0)
+            return pos + 2 <= largo ? pos + 2 : -1;
+        if (c > 63)
+            return -1;
+        if (c == 0)
+            return pos + 1;
+        pos += c + 1;
+    }
+    return -1;
+}
+
+void seccionesIniciar(SECCIONES *s)
+{
+    memset(s,0,sizeof(SECCIONES));
+}
+
+/** Libera lo decodificado del mensaje anterior **/
+static void soltarDecodificadas(SECCIONES *s)
+{
+    int seccion;
+    for (seccion = 0; seccion < 3; seccion++)
+        if (s->decodificada[seccion])
+        {
+            liberarRegistros(s->registros + s->inicio[seccion],s->inicio[seccion+1] - s->inicio[seccion]);
+            s->decodificada[seccion] = 0;
+        }
+}
+
+/** Una sola reserva para todos los arreglos, del más alineado al menos alineado **/
+static void reservar(SECCIONES *s, int capacidad)
+{
+    char *p;
+    free(s->bloque);
+    s->bloque = malloc(capacidad * (sizeof(struct RESOURCE_RECORD) + sizeof(uint32_t) + 5 * sizeof(uint16_t)));
+    s->capacidad = capacidad;
+    p = (char*)s->bloque;
+    s->registros = (struct RESOURCE_RECORD*)p;
+    p += capacidad * sizeof(struct RESOURCE_RECORD);
+    s->ttl = (uint32_t*)p;
+    p += capacidad * sizeof(uint32_t);
+    s->tipo = (uint16_t*)p;
+    s->clase = s->tipo + capacidad;
+    s->nombre = s->clase + capacidad;
+    s->rdata = s->nombre + capacidad;
+    s->largoRdata = s->rdata + capacidad;
+}
+
+int seccionesLeer(SECCIONES *s, unsigned char *mensaje, int largo, int inicio)
+{
+    int contadores[3], total, seccion, pos = inicio;
+
+    soltarDecodificadas(s);
+    s->mensaje = mensaje;
+    s->largo = largo;
+    s->cantidad = 0;
+    memset(s->inicio,0,sizeof(s->inicio));
+    if (largo < 12 || inicio < 12 || inicio > largo)
+        return 0;
+    /** los desplazamientos se guardan en 16 bits: un mensaje DNS nunca pasa de 65535 bytes **/
+    if (largo > 65535)
+        largo = s->largo = 65535;
+
+    contadores[0] = leer16(mensaje + 6);
+    contadores[1] = leer16(mensaje + 8);
+    contadores[2] = leer16(mensaje + 10);
+    /** los contadores vienen del otro lado: no se reserva más de lo que entra en el mensaje **/
+    total = contadores[0] + contadores[1] + contadores[2];
+    if (total > (largo - inicio) / MINIMO_RR)
+        total = (largo - inicio) / MINIMO_RR;
+    if (total > s->capacidad)
+        reservar(s,total);
+
+    for (seccion = 0; seccion < 3; seccion++)
+    {
+        int i;
+        s->inicio[seccion] = s->cantidad;
+        for (i = 0; i < contadores[seccion] && pos >= 0 && s->cantidad < total; i++)
+        {
+            int n = s->cantidad, fin = saltarNombre(mensaje,largo,pos);
+            if (fin < 0 || fin + TAM_R_DATA > largo)
+            {
+                pos = -1;
+                break;
+            }
+            int rdlength = leer16(mensaje + fin + 8);
+            if (fin + TAM_R_DATA + rdlength > largo)   /** mensaje truncado **/
+            {
+                pos = -1;
+                break;
+            }
+            s->nombre[n] = pos;
+            s->tipo[n] = leer16(mensaje + fin);
+            s->clase[n] = leer16(mensaje + fin + 2);
+            s->ttl[n] = leer32(mensaje + fin + 4);
+            s->rdata[n] = fin + TAM_R_DATA;
+            s->largoRdata[n] = rdlength;
+            s->cantidad++;
+            pos = fin + TAM_R_DATA + rdlength;
+        }
+    }
+    s->inicio[3] = s->cantidad;
+    return s->cantidad;
+}
+
+int seccionesCantidad(const SECCIONES *s, int seccion)
+{
+    return s->inicio[seccion+1] - s->inicio[seccion];
+}
+
+int seccionesBuscar(const SECCIONES *s, int seccion, int tipo)
+{
+    int i;
+    for (i = s->inicio[seccion]; i < s->inicio[seccion+1]; i++)
+        if (s->tipo[i] == tipo)
+            return i;
+    return -1;
+}
+
+int seccionesNombre(const SECCIONES *s, int i, char *destino)
+{
+    if (nombreLeerMensaje(s->mensaje,s->largo,s->nombre[i],NULL,destino) < 0)
+    {
+        destino[0] = '\0';
+        return -1;
+    }
+    return 0;
+}
+
+int seccionesNombreRdata(const SECCIONES *s, int i, char *destino)
+{
+    int fin = nombreLeerMensaje(s->mensaje,s->largo,s->rdata[i],NULL,destino);
+    if (fin < 0 || fin > s->rdata[i] + s->largoRdata[i])
+    {
+        destino[0] = '\0';
+        return -1;
+    }
+    return 0;
+}
+
+struct RESOURCE_RECORD *seccionesRegistros(SECCIONES *s, int seccion)
+{
+    int i;
+    if (s->registros == NULL)
+        return NULL;
+    if (!s->decodificada[seccion])
+    {
+        for (i = s->inicio[seccion]; i < s->inicio[seccion+1]; i++)
+        {
+            struct RESOURCE_RECORD *rr = &s->registros[i];
+            char nombre[MAX_TEXTO_NOMBRE];
+            if (nombreLeerPresentacion(s->mensaje,s->largo,s->nombre[i],nombre) < 0)
+                nombre[0] = '\0';
+            rr->name = (unsigned char*)strdup(nombre);
+            camposRRLeer(s->mensaje + s->rdata[i] - TAM_R_DATA,&rr->resource);
+            decodificarRDATA(s->mensaje,s->largo,s->mensaje + s->rdata[i],s->largoRdata[i],s->tipo[i],rr);
+        }
+        s->decodificada[seccion] = 1;
+    }
+    return s->registros + s->inicio[seccion];
+}
+
+void seccionesLiberar(SECCIONES *s)
+{
+    soltarDecodificadas(s);
+    free(s->bloque);
+    seccionesIniciar(s);
+}
@@ -0,0 +1,75 @@
+#ifndef SECCIONES_H_INCLUDED
+#define SECCIONES_H_INCLUDED
+
+#include <stdint.h>
+
+#include "dns.h"
+
+/**
+ * Los registros de las secciones answer, authority y additional de una respuesta, sin un tope
+ * fijo de cantidad. La lectura recorre el mensaje una vez y anota cada registro en arreglos
+ * paralelos: tipo, clase, TTL y dónde empiezan el nombre y el RDATA. Así, buscar un tipo o mirar
+ * los TTL recorre memoria contigua sin tocar los nombres ni decodificar nada.
+ *
+ * Todos los arreglos salen de una sola reserva, dimensionada con los contadores del header
+ * (acotados por la cantidad de registros que de verdad entran en el mensaje) y reutilizada de un
+ * mensaje al siguiente: un pool grande de A o un NS con muchos servidores sólo la agranda una vez.
+ *
+ * Los registros decodificados (struct RESOURCE_RECORD, con el nombre y el texto) se arman recién
+ * cuando se piden, de a una sección, y valen hasta la próxima lectura.
+ **/
+
+#define SECCION_ANSWER 0
+#define SECCION_AUTHORITY 1
+#define SECCION_ADDITIONAL 2
+
+typedef struct
+{
+    unsigned char *mensaje;         // el último mensaje leído: los desplazamientos son relativos a él
+    int largo;
+    int cantidad;                   // registros leídos en total
+    int inicio[4];                  // la sección s ocupa los índices inicio[s] .. inicio[s+1]-1
+    int capacidad;
+    int decodificada[3];            // la sección ya está armada en registros
+    uint32_t *ttl;
+    uint16_t *tipo;
+    uint16_t *clase;
+    uint16_t *nombre;               // desplazamiento del nombre del registro
+    uint16_t *rdata;                // desplazamiento del RDATA
+    uint16_t *largoRdata;
+    struct RESOURCE_RECORD *registros;
+    void *bloque;
+} SECCIONES;
+
+/** Deja el contenedor vacío, sin reservar nada **/
+void seccionesIniciar(SECCIONES *s);
+
+/**
+ * Lee las tres secciones de mensaje a partir de inicio (el final de la sección question). Un
+ * registro cortado termina la lectura; las secciones siguientes quedan vacías. El mensaje tiene
+ * que seguir vivo mientras se use el contenedor. Devuelve la cantidad de registros leídos.
+ **/
+int seccionesLeer(SECCIONES *s, unsigned char *mensaje, int largo, int inicio);
+
+/** Cantidad de registros de la sección **/
+int seccionesCantidad(const SECCIONES *s, int seccion);
+
+/** Índice del primer registro de la sección con ese tipo, o -1 **/
+int seccionesBuscar(const SECCIONES *s, int seccion, int tipo);
+
+/** Nombre del registro i en texto, sin punto final; 0, o -1 si no se pudo leer **/
+int seccionesNombre(const SECCIONES *s, int i, char *destino);
+
+/**
+ * Nombre con el que empieza el RDATA del registro i (el destino de un NS o un CNAME), en texto y
+ * sin punto final. Verifica que el nombre termine dentro del RDATA: 0, o -1 si no es un nombre.
+ **/
+int seccionesNombreRdata(const SECCIONES *s, int i, char *destino);
+
+/** La sección decodificada (se arma la primera vez que se pide); tiene seccionesCantidad registros **/
+struct RESOURCE_RECORD *seccionesRegistros(SECCIONES *s, int seccion);
+
+/** Libera los registros decodificados y la reserva **/
+void seccionesLiberar(SECCIONES *s);
+
+#endif // SECCIONES_H_INCLUDED
@@ -0,0 +1,900 @@
+#include<stdio.h>
+#include<string.h>
+#include<stdlib.h>
+#include<stdarg.h>
+#include<ctype.h>
+#include<arpa/inet.h>
+
+#include "tipos_rr.h"
+#include "nombres.h"
+#include "loc.h"
+
+/** Texto que crece a medida que se le agregan datos, para armar el formato presentación **/
+typedef struct
+{
+    char *s;
+    int largo;
+    int capacidad;
+} TEXTO;
+
+static void agregar(TEXTO *t, const char *formato, ...)
+{
+    va_list args;
+    int n;
+    if (t->s == NULL)
+    {
+        t->capacidad = 128;
+        t->s = malloc(t->capacidad);
+        t->largo = 0;
+        t->s[0] = '\0';
+    }
+    while (1)
+    {
+        va_start(args,formato);
+        n = vsnprintf(t->s + t->largo,t->capacidad - t->largo,formato,args);
+        va_end(args);
+        if (n < t->capacidad - t->largo)
+            break;
+        t->capacidad = (t->capacidad + n) * 2;
+        t->s = realloc(t->s,t->capacidad);
+    }
+    t->largo += n;
+}
+
+/** Copia del RDATA terminada en '\0', para los tipos que no guardan una dirección o un nombre **/
+static unsigned char *copiarRDATA(unsigned char *rdata, int rdlength)
+{
+    unsigned char *copia = (unsigned char*)malloc(rdlength + 1);
+    memcpy(copia,rdata,rdlength);
+    copia[rdlength] = '\0';
+    return copia;
+}
+
+static void agregarHex(TEXTO *t, const unsigned char *datos, int largo)
+{
+    int i;
+    for (i = 0; i < largo; i++)
+        agregar(t,"%02X",datos[i]);
+}
+
+static void agregarBase64(TEXTO *t, const unsigned char *datos, int largo)
+{
+    static const char alfabeto[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    int i;
+    for (i = 0; i < largo; i += 3)
+    {
+        unsigned int v = datos[i] << 16;
+        if (i + 1 < largo)
+            v |= datos[i+1] << 8;
+        if (i + 2 < largo)
+            v |= datos[i+2];
+        agregar(t,"%c%c%c%c",alfabeto[(v >> 18) & 63],alfabeto[(v >> 12) & 63],
+                i + 1 < largo ? alfabeto[(v >> 6) & 63] : '=',i + 2 < largo ? alfabeto[v & 63] : '=');
+    }
+}
+
+/** Base32 con el alfabeto "extended hex" sin relleno, el que usa NSEC3 (RFC 5155) **/
+static void agregarBase32Hex(TEXTO *t, const unsigned char *datos, int largo)
+{
+    static const char alfabeto[] = "0123456789abcdefghijklmnopqrstuv";
+    unsigned int acumulado = 0;
+    int bits = 0, i;
+    for (i = 0; i < largo; i++)
+    {
+        acumulado = (acumulado << 8) | datos[i];
+        bits += 8;
+        while (bits >= 5)
+        {
+            agregar(t,"%c",alfabeto[(acumulado >> (bits - 5)) & 31]);
+            bits -= 5;
+        }
+    }
+    if (bits > 0)
+        agregar(t,"%c",alfabeto[(acumulado << (5 - bits)) & 31]);
+}
+
+/** Una <character-string>: un byte de largo y el texto, entre comillas y escapado **/
+static int agregarCadena(TEXTO *t, const unsigned char *datos, int disponible)
+{
+    int largo = datos[0], i;
+    if (largo + 1 > disponible)
+        return -1;
+    agregar(t,"\"");
+    for (i = 1; i <= largo; i++)
+    {
+        if (datos[i] == '"' || datos[i] == '\\')
+            agregar(t,"\\%c",datos[i]);
+        else if (datos[i] < 0x20 || datos[i] > 0x7e)
+            agregar(t,"\\%03d",datos[i]);
+        else
+            agregar(t,"%c",datos[i]);
+    }
+    agregar(t,"\"");
+    return largo + 1;
+}
+
+/**
+ * Lee un nombre del RDATA (con compresión) en nombre, y devuelve cuántos bytes ocupa en el RDATA:
+ * -1 si está mal formado o si no termina dentro de los disponible bytes que le quedan al RDATA.
+ * Si presentacion no es NULL deja allí también la forma presentación (MAX_TEXTO_NOMBRE bytes).
+ **/
+static int leerNombreRDATA(unsigned char *mensaje, int largoMensaje, unsigned char *reader, int disponible, char *nombre,
+                           char *presentacion)
+{
+    int pos = reader - mensaje;
+    int siguiente = nombreLeerMensaje(mensaje,largoMensaje,pos,NULL,nombre);
+    if (siguiente < 0 || siguiente - pos > disponible)
+        return -1;
+    if (presentacion != NULL)
+        nombreLeerPresentacion(mensaje,largoMensaje,pos,presentacion);
+    if (nombre[0] == '\0')
+    {
+        strcpy(nombre,".");
+        if (presentacion != NULL)
+            strcpy(presentacion,".");
+    }
+    return siguiente - pos;
+}
+
+/** Agrega un nombre del RDATA y devuelve cuántos bytes ocupa, o -1 (sin agregar nada) como leerNombreRDATA **/
+static int agregarNombre(TEXTO *t, unsigned char *mensaje, int largoMensaje, unsigned char *reader, int disponible)
+{
+    char nombre[256], presentacion[MAX_TEXTO_NOMBRE];
+    int largo = leerNombreRDATA(mensaje,largoMensaje,reader,disponible,nombre,presentacion);
+    if (largo >= 0)
+        agregar(t,"%s",presentacion);
+    return largo;
+}
+
+/** Mapa de tipos de NSEC/NSEC3: ventanas de 256 tipos, cada una con su mapa de bits **/
+static int agregarMapaTipos(TEXTO *t, const unsigned char *datos, int largo)
+{
+    char textoTipo[LARGO_TEXTO_TIPO];
+    int pos = 0;
+    while (pos + 2 <= largo)
+    {
+        int ventana = datos[pos], bytes = datos[pos+1], i, b;
+        if (bytes < 1 || bytes > 32 || pos + 2 + bytes > largo)
+            return -1;
+        for (i = 0; i < bytes; i++)
+            for (b = 0; b < 8; b++)
+                if (datos[pos + 2 + i] & (0x80 >> b))
+                    agregar(t," %s",mapearTipo(ventana * 256 + i * 8 + b,textoTipo));
+        pos += 2 + bytes;
+    }
+    return pos == largo ? 0 : -1;
+}
+
+static void decodificarOpaco(unsigned char *mensaje, int largoMensaje, unsigned char *rdata, int rdlength, struct RESOURCE_RECORD *rr)
+{
+    TEXTO t = {NULL, 0, 0};
+    (void)mensaje;
+    (void)largoMensaje;
+    agregar(&t,"\\# %d",rdlength);
+    if (rdlength > 0)
+    {
+        agregar(&t," ");
+        agregarHex(&t,rdata,rdlength);
+    }
+    rr->rdata = copiarRDATA(rdata,rdlength);
+    rr->texto = t.s;
+}
+
+static void decodificarDireccion4(unsigned char *mensaje, int largoMensaje, unsigned char *rdata, int rdlength, struct RESOURCE_RECORD *rr)
+{
+    char ip[INET_ADDRSTRLEN];
+    if (rdlength != 4)
+    {
+        decodificarOpaco(mensaje,largoMensaje,rdata,rdlength,rr);
+        return;
+    }
+    rr->rdata = copiarRDATA(rdata,rdlength);
+    rr->texto = strdup(inet_ntop(AF_INET,rdata,ip,sizeof(ip)));
+}
+
+static void decodificarDireccion6(unsigned char *mensaje, int largoMensaje, unsigned char *rdata, int rdlength, struct RESOURCE_RECORD *rr)
+{
+    char ip[INET6_ADDRSTRLEN];
+    if (rdlength != 16)
+    {
+        decodificarOpaco(mensaje,largoMensaje,rdata,rdlength,rr);
+        return;
+    }
+    rr->rdata = copiarRDATA(rdata,rdlength);
+    rr->texto = strdup(inet_ntop(AF_INET6,rdata,ip,sizeof(ip)));
+}
+
+/** NS, CNAME, PTR, DNAME: el RDATA es sólo un nombre, que queda en rr->rdata en formato texto ("" la raíz) **/
+static void decodificarNombre(unsigned char *mensaje, int largoMensaje, unsigned char *rdata, int rdlength, struct RESOURCE_RECORD *rr)
+{
+    char nombre[256], presentacion[MAX_TEXTO_NOMBRE];
+    if (leerNombreRDATA(mensaje,largoMensaje,rdata,rdlength,nombre,presentacion) < 0)
+    {
+        decodificarOpaco(mensaje,largoMensaje,rdata,rdlength,rr);
+        return;
+    }
+    rr->texto = strdup(presentacion);
+    rr->rdata = (unsigned char*)strdup(strcmp(nombre,".") == 0 ? "" : nombre);
+}
+
+static void decodificarMX(unsigned char *mensaje, int largoMensaje, unsigned char *rdata, int rdlength, struct RESOURCE_RECORD *rr)
+{
+    char nombre[256], presentacion[MAX_TEXTO_NOMBRE];
+    TEXTO t = {NULL, 0, 0};
+    if (rdlength < 3 || leerNombreRDATA(mensaje,largoMensaje,rdata + 2,rdlength - 2,nombre,presentacion) < 0)
+    {
+        decodificarOpaco(mensaje,largoMensaje,rdata,rdlength,rr);
+        return;
+    }
+    agregar(&t,"%d %s",leer16(rdata),presentacion);
+    rr->texto = t.s;
+    rr->rdata = (unsigned char*)strdup(strcmp(nombre,".") == 0 ? "" : nombre);
+}
+
+static void decodificarSOA(unsigned char *mensaje, int largoMensaje, unsigned char *rdata, int rdlength, struct RESOURCE_RECORD *rr)
+{
+    TEXTO t = {NULL, 0, 0};
+    int pos = agregarNombre(&t,mensaje,largoMensaje,rdata,rdlength), n = -1, i;
+    if (pos >= 0)
+    {
+        agregar(&t," ");
+        n = agregarNombre(&t,mensaje,largoMensaje,rdata + pos,rdlength - pos);
+    }
+    if (n < 0 || pos + n + 20 != rdlength)
+    {
+        free(t.s);
+        decodificarOpaco(mensaje,largoMensaje,rdata,rdlength,rr);
+        return;
+    }
+    /** SERIAL REFRESH RETRY EXPIRE MINIMUM **/
+    for (i = 0, pos += n; i < 5; i++, pos += 4)
+        agregar(&t," %u",leer32(rdata + pos));
+    rr->rdata = copiarRDATA(rdata,rdlength);
+    rr->texto = t.s;
+}
+
+/** TXT, SPF, HINFO: una o más <character-string> **/
+static void decodificarCadenas(unsigned char *mensaje, int largoMensaje, unsigned char *rdata, int rdlength, struct RESOURCE_RECORD *rr)
+{
+    TEXTO t = {NULL, 0, 0};
+    int pos = 0, n;
+    while (pos < rdlength)
+    {
+        if (pos > 0)
+            agregar(&t," ");
+        if ((n = agregarCadena(&t,rdata + pos,rdlength - pos)) < 0)
+        {
+            free(t.s);
+            decodificarOpaco(mensaje,largoMensaje,rdata,rdlength,rr);
+            return;
+        }
+        pos += n;
+    }
+    if (t.s == NULL)
+        agregar(&t,"\"\"");
+    rr->rdata = copiarRDATA(rdata,rdlength);
+    rr->texto = t.s;
+}
+
+static void decodificarSRV(unsigned char *mensaje, int largoMensaje, unsigned char *rdata, int rdlength, struct RESOURCE_RECORD *rr)
+{
+    TEXTO t = {NULL, 0, 0};
+    if (rdlength < 7)
+    {
+        decodificarOpaco(mensaje,largoMensaje,rdata,rdlength,rr);
+        return;
+    }
+    /** PRIORITY WEIGHT PORT TARGET **/
+    agregar(&t,"%d %d %d ",leer16(rdata),leer16(rdata + 2),leer16(rdata + 4));
+    if (agregarNombre(&t,mensaje,largoMensaje,rdata + 6,rdlength - 6) < 0)
+    {
+        free(t.s);
+        decodificarOpaco(mensaje,largoMensaje,rdata,rdlength,rr);
+        return;
+    }
+    rr->rdata = copiarRDATA(rdata,rdlength);
+    rr->texto = t.s;
+}
+
+static void decodificarNAPTR(unsigned char *mensaje, int largoMensaje, unsigned char *rdata, int rdlength, struct RESOURCE_RECORD *rr)
+{
+    TEXTO t = {NULL, 0, 0};
+    int pos = 4, i, n;
+    if (rdlength < 8)
+    {
+        decodificarOpaco(mensaje,largoMensaje,rdata,rdlength,rr);
+        return;
+    }
+    /** ORDER PREFERENCE FLAGS SERVICES REGEXP REPLACEMENT **/
+    agregar(&t,"%d %d",leer16(rdata),leer16(rdata + 2));
+    for (i = 0; i < 3; i++, pos += n)
+    {
+        agregar(&t," ");
+        if (pos >= rdlength || (n = agregarCadena(&t,rdata + pos,rdlength - pos)) < 0)
+        {
+            free(t.s);
+            decodificarOpaco(mensaje,largoMensaje,rdata,rdlength,rr);
+            return;
+        }
+    }
+    agregar(&t," ");
+    if (pos >= rdlength || agregarNombre(&t,mensaje,largoMensaje,rdata + pos,rdlength - pos) < 0)
+    {
+        free(t.s);
+        decodificarOpaco(mensaje,largoMensaje,rdata,rdlength,rr);
+        return;
+    }
+    rr->rdata = copiarRDATA(rdata,rdlength);
+    rr->texto = t.s;
+}
+
+/** DS: KEYTAG ALGORITHM DIGESTTYPE DIGEST **/
+static void decodificarDS(unsigned char *mensaje, int largoMensaje, unsigned char *rdata, int rdlength, struct RESOURCE_RECORD *rr)
+{
+    TEXTO t = {NULL, 0, 0};
+    if (rdlength < 5)
+    {
+        decodificarOpaco(mensaje,largoMensaje,rdata,rdlength,rr);
+        return;
+    }
+    agregar(&t,"%d %d %d ",leer16(rdata),rdata[2],rdata[3]);
+    agregarHex(&t,rdata + 4,rdlength - 4);
+    rr->rdata = copiarRDATA(rdata,rdlength);
+    rr->texto = t.s;
+}
+
+/** SSHFP: ALGORITHM FPTYPE FINGERPRINT **/
+static void decodificarSSHFP(unsigned char *mensaje, int largoMensaje, unsigned char *rdata, int rdlength, struct RESOURCE_RECORD *rr)
+{
+    TEXTO t = {NULL, 0, 0};
+    if (rdlength < 3)
+    {
+        decodificarOpaco(mensaje,largoMensaje,rdata,rdlength,rr);
+        return;
+    }
+    agregar(&t,"%d %d ",rdata[0],rdata[1]);
+    agregarHex(&t,rdata + 2,rdlength - 2);
+    rr->rdata = copiarRDATA(rdata,rdlength);
+    rr->texto = t.s;
+}
+
+/** TLSA: USAGE SELECTOR MATCHINGTYPE DATA **/
+static void decodificarTLSA(unsigned char *mensaje, int largoMensaje, unsigned char *rdata, int rdlength, struct RESOURCE_RECORD *rr)
+{
+    TEXTO t = {NULL, 0, 0};
+    if (rdlength < 4)
+    {
+        decodificarOpaco(mensaje,largoMensaje,rdata,rdlength,rr);
+        return;
+    }
+    agregar(&t,"%d %d %d ",rdata[0],rdata[1],rdata[2]);
+    agregarHex(&t,rdata + 3,rdlength - 3);
+    rr->rdata = copiarRDATA(rdata,rdlength);
+    rr->texto = t.s;
+}
+
+/** DNSKEY: FLAGS PROTOCOL ALGORITHM PUBLICKEY **/
+static void decodificarDNSKEY(unsigned char *mensaje, int largoMensaje, unsigned char *rdata, int rdlength, struct RESOURCE_RECORD *rr)
+{
+    TEXTO t = {NULL, 0, 0};
+    if (rdlength < 5)
+    {
+        decodificarOpaco(mensaje,largoMensaje,rdata,rdlength,rr);
+        return;
+    }
+    agregar(&t,"%d %d %d ",leer16(rdata),rdata[2],rdata[3]);
+    agregarBase64(&t,rdata + 4,rdlength - 4);
+    rr->rdata = copiarRDATA(rdata,rdlength);
+    rr->texto = t.s;
+}
+
+/** RRSIG: TYPECOVERED ALGORITHM LABELS ORIGTTL EXPIRATION INCEPTION KEYTAG SIGNER SIGNATURE **/
+static void decodificarRRSIG(unsigned char *mensaje, int largoMensaje, unsigned char *rdata, int rdlength, struct RESOURCE_RECORD *rr)
+{
+    char textoTipo[LARGO_TEXTO_TIPO];
+    TEXTO t = {NULL, 0, 0};
+    int pos;
+    if (rdlength < 19)
+    {
+        decodificarOpaco(mensaje,largoMensaje,rdata,rdlength,rr);
+        return;
+    }
+    agregar(&t,"%s %d %d %u %u %u %d ",mapearTipo(leer16(rdata),textoTipo),rdata[2],rdata[3],
+            leer32(rdata + 4),leer32(rdata + 8),leer32(rdata + 12),leer16(rdata + 16));
+    if ((pos = agregarNombre(&t,mensaje,largoMensaje,rdata + 18,rdlength - 18)) < 0)
+    {
+        free(t.s);
+        decodificarOpaco(mensaje,largoMensaje,rdata,rdlength,rr);
+        return;
+    }
+    pos += 18;
+    agregar(&t," ");
+    agregarBase64(&t,rdata + pos,rdlength - pos);
+    rr->rdata = copiarRDATA(rdata,rdlength);
+    rr->texto = t.s;
+}
+
+/** NSEC: NEXTDOMAIN TYPES... **/
+static void decodificarNSEC(unsigned char *mensaje, int largoMensaje, unsigned char *rdata, int rdlength, struct RESOURCE_RECORD *rr)
+{
+    TEXTO t = {NULL, 0, 0};
+    int pos = agregarNombre(&t,mensaje,largoMensaje,rdata,rdlength);
+    if (pos < 0 || agregarMapaTipos(&t,rdata + pos,rdlength - pos) < 0)
+    {
+        free(t.s);
+        decodificarOpaco(mensaje,largoMensaje,rdata,rdlength,rr);
+        return;
+    }
+    rr->rdata = copiarRDATA(rdata,rdlength);
+    rr->texto = t.s;
+}
+
+/** NSEC3: ALGORITHM FLAGS ITERATIONS SALT NEXTHASHED TYPES... **/
+static void decodificarNSEC3(unsigned char *mensaje, int largoMensaje, unsigned char *rdata, int rdlength, struct RESOURCE_RECORD *rr)
+{
+    TEXTO t = {NULL, 0, 0};
+    int sal, hash;
+    if (rdlength < 6 || 5 + (sal = rdata[4]) >= rdlength || 6 + sal + (hash = rdata[5 + sal]) > rdlength)
+    {
+        decodificarOpaco(mensaje,largoMensaje,rdata,rdlength,rr);
+        return;
+    }
+    agregar(&t,"%d %d %d ",rdata[0],rdata[1],leer16(rdata + 2));
+    if (sal == 0)
+        agregar(&t,"-");
+    else
+        agregarHex(&t,rdata + 5,sal);
+    agregar(&t," ");
+    agregarBase32Hex(&t,rdata + 6 + sal,hash);
+    if (agregarMapaTipos(&t,rdata + 6 + sal + hash,rdlength - 6 - sal - hash) < 0)
+    {
+        free(t.s);
+        decodificarOpaco(mensaje,largoMensaje,rdata,rdlength,rr);
+        return;
+    }
+    rr->rdata = copiarRDATA(rdata,rdlength);
+    rr->texto = t.s;
+}
+
+/** CAA: FLAGS TAG "VALUE" **/
+static void decodificarCAA(unsigned char *mensaje, int largoMensaje, unsigned char *rdata, int rdlength, struct RESOURCE_RECORD *rr)
+{
+    TEXTO t = {NULL, 0, 0};
+    int largoTag, i;
+    if (rdlength < 2 || 2 + (largoTag = rdata[1]) > rdlength)
+    {
+        decodificarOpaco(mensaje,largoMensaje,rdata,rdlength,rr);
+        return;
+    }
+    agregar(&t,"%d %.*s \"",rdata[0],largoTag,rdata + 2);
+    for (i = 2 + largoTag; i < rdlength; i++)
+    {
+        if (rdata[i] == '"' || rdata[i] == '\\')
+            agregar(&t,"\\%c",rdata[i]);
+        else if (rdata[i] < 0x20 || rdata[i] > 0x7e)
+            agregar(&t,"\\%03d",rdata[i]);
+        else
+            agregar(&t,"%c",rdata[i]);
+    }
+    agregar(&t,"\"");
+    rr->rdata = copiarRDATA(rdata,rdlength);
+    rr->texto = t.s;
+}
+
+static void decodificarLOC(unsigned char *mensaje, int largoMensaje, unsigned char *rdata, int rdlength, struct RESOURCE_RECORD *rr)
+{
+    /**
+    LOC ejemplo: systemadmin.es
+    Respuesta del dig:
+    ;; ANSWER SECTION:
+    systemadmin.es.     3248    IN  LOC 41 24 0.499 N 2 10 52.530 E 47.00m 30m 10m 10m
+    Del Wireshark:
+    Version: 0                                  // 00 (hexadecimal)
+    Size: 30 m                                  // 33
+    Horizontal precision: 10 m                  // 13
+    Vertical precision: 10 m                    // 13
+    Latitude: 41 deg 24 min 0.499 sec N         // 88 e2 2d 73
+    Longitude: 2 deg 10 min 52.530 sec E        // 80 77 d1 f2
+    Altitude: 47 m                              // 00 98 a8 dc
+    **/
+    char texto[MAX_TEXTO_LOC];
+
+    /** sólo se conoce la versión 0; el resto se muestra como datos opacos (ver loc.c) **/
+    if (rdlength != LARGO_LOC || locATexto(rdata,texto) < 0)
+    {
+        decodificarOpaco(mensaje,largoMensaje,rdata,rdlength,rr);
+        return;
+    }
+    rr->rdata = copiarRDATA(rdata,rdlength);
+    rr->texto = strdup(texto);
+}
+
+/** ------------------------------------------------------------------------------------
+    Codificadores: del formato presentación (archivo de zona, RFC 1035 5.1) al RDATA
+    ------------------------------------------------------------------------------------ **/
+
+int largoNombreDNS(const unsigned char *nombre)
+{
+    int largo = 0;
+    while (nombre[largo] != 0)
+        largo += nombre[largo] + 1;
+    return largo + 1;
+}
+
+int nombreDesdeTexto(const char *texto, const unsigned char *origen, unsigned char *destino)
+{
+    static const unsigned char raiz[1] = {0};
+    const char *p = texto;
+    int largo = 0, inicio = 0;      /** inicio: posición del byte de largo del label en curso **/
+    if (origen == NULL)
+        origen = raiz;
+    if (strcmp(texto,"@") == 0)
+    {
+        largo = largoNombreDNS(origen);
+        memcpy(destino,origen,largo);
+        return largo;
+    }
+    if (strcmp(texto,".") == 0)
+    {
+        destino[0] = 0;
+        return 1;
+    }
+
+    destino[largo++] = 0;
+    while (*p)
+    {
+        unsigned char c;
+        if (*p == '.')
+        {
+            if (largo - inicio - 1 == 0)    /** label vacío **/
+                return -1;
+            destino[inicio] = largo - inicio - 1;
+            inicio = largo;
+            destino[largo++] = 0;
+            p++;
+            continue;
+        }
+        if (*p == '\\' && isdigit((unsigned char)p[1]) && isdigit((unsigned char)p[2]) && isdigit((unsigned char)p[3]))
+        {
+            c = (p[1] - '0') * 100 + (p[2] - '0') * 10 + (p[3] - '0');
+            p += 4;
+        }
+        else if (*p == '\\' && p[1] != '\0')
+        {
+            c = p[1];
+            p += 2;
+        }
+        else
+            c = *p++;
+        if (largo - inicio - 1 >= 63 || largo >= 255)
+            return -1;
+        destino[largo++] = c;
+    }
+    if (largo - inicio - 1 == 0)    /** terminó en punto: el último byte es el label raíz **/
+        return largo;
+
+    /** nombre relativo: se completa con el origen **/
+    int largoOrigen = largoNombreDNS(origen);
+    destino[inicio] = largo - inicio - 1;
+    if (largo + largoOrigen > 255)
+        return -1;
+    memcpy(destino + largo,origen,largoOrigen);
+    return largo + largoOrigen;
+}
+
+int leerTiempo(const char *texto, unsigned int *valor)
+{
+    unsigned long total = 0, numero;
+    char *fin;
+    if (!isdigit((unsigned char)*texto))
+        return -1;
+    while (*texto)
+    {
+        numero = strtoul(texto,&fin,10);
+        if (fin == texto)
+            return -1;
+        switch (tolower((unsigned char)*fin))
+        {
+        case '\0':
+            break;
+        case 's':
+            fin++;
+            break;
+        case 'm':
+            numero *= 60, fin++;
+            break;
+        case 'h':
+            numero *= 3600, fin++;
+            break;
+        case 'd':
+            numero *= 86400, fin++;
+            break;
+        case 'w':
+            numero *= 604800, fin++;
+            break;
+        default:
+            return -1;
+        }
+        total += numero;
+        texto = fin;
+    }
+    if (total > 0xffffffffUL)
+        return -1;
+    *valor = total;
+    return 0;
+}
+
+static int leerEntero16(const char *texto, unsigned char *destino)
+{
+    char *fin;
+    unsigned long valor = strtoul(texto,&fin,10);
+    if (*texto == '\0' || *fin != '\0' || valor > 65535)
+        return -1;
+    destino[0] = valor >> 8;
+    destino[1] = valor & 0xff;
+    return 2;
+}
+
+static int codificarDireccion4(char *campos[], int cantidad, const unsigned char *origen, unsigned char *rdata, int max)
+{
+    (void)origen;
+    if (cantidad != 1 || max < 4 || inet_pton(AF_INET,campos[0],rdata) != 1)
+        return -1;
+    return 4;
+}
+
+static int codificarDireccion6(char *campos[], int cantidad, const unsigned char *origen, unsigned char *rdata, int max)
+{
+    (void)origen;
+    if (cantidad != 1 || max < 16 || inet_pton(AF_INET6,campos[0],rdata) != 1)
+        return -1;
+    return 16;
+}
+
+/** NS, CNAME, PTR, DNAME **/
+static int codificarNombre(char *campos[], int cantidad, const unsigned char *origen, unsigned char *rdata, int max)
+{
+    if (cantidad != 1 || max < 255)
+        return -1;
+    return nombreDesdeTexto(campos[0],origen,rdata);
+}
+
+static int codificarMX(char *campos[], int cantidad, const unsigned char *origen, unsigned char *rdata, int max)
+{
+    int largo;
+    if (cantidad != 2 || max < 2 + 255 || leerEntero16(campos[0],rdata) < 0
+            || (largo = nombreDesdeTexto(campos[1],origen,rdata + 2)) < 0)
+        return -1;
+    return 2 + largo;
+}
+
+static int codificarSOA(char *campos[], int cantidad, const unsigned char *origen, unsigned char *rdata, int max)
+{
+    int largo, n, i;
+    unsigned int valor;
+    if (cantidad != 7 || max < 2 * 255 + 20 || (largo = nombreDesdeTexto(campos[0],origen,rdata)) < 0
+            || (n = nombreDesdeTexto(campos[1],origen,rdata + largo)) < 0)
+        return -1;
+    largo += n;
+    /** SERIAL REFRESH RETRY EXPIRE MINIMUM **/
+    for (i = 2; i < 7; i++)
+    {
+        if (leerTiempo(campos[i],&valor) < 0)
+            return -1;
+        rdata[largo++] = valor >> 24;
+        rdata[largo++] = valor >> 16;
+        rdata[largo++] = valor >> 8;
+        rdata[largo++] = valor;
+    }
+    return largo;
+}
+
+/** TXT, SPF, HINFO: cada campo es una <character-string>; las comillas ya se quitaron, los escapes no **/
+static int codificarCadenas(char *campos[], int cantidad, const unsigned char *origen, unsigned char *rdata, int max)
+{
+    int largo = 0, i;
+    (void)origen;
+    if (cantidad < 1)
+        return -1;
+    for (i = 0; i < cantidad; i++)
+    {
+        const char *p = campos[i];
+        int inicio = largo++;
+        while (*p)
+        {
+            unsigned char c;
+            if (*p == '\\' && isdigit((unsigned char)p[1]) && isdigit((unsigned char)p[2]) && isdigit((unsigned char)p[3]))
+            {
+                c = (p[1] - '0') * 100 + (p[2] - '0') * 10 + (p[3] - '0');
+                p += 4;
+            }
+            else if (*p == '\\' && p[1] != '\0')
+            {
+                c = p[1];
+                p += 2;
+            }
+            else
+                c = *p++;
+            if (largo - inicio - 1 >= 255 || largo >= max)
+                return -1;
+            rdata[largo++] = c;
+        }
+        rdata[inicio] = largo - inicio - 1;
+    }
+    return largo;
+}
+
+static int codificarSRV(char *campos[], int cantidad, const unsigned char *origen, unsigned char *rdata, int max)
+{
+    int largo;
+    if (cantidad != 4 || max < 6 + 255 || leerEntero16(campos[0],rdata) < 0 || leerEntero16(campos[1],rdata + 2) < 0
+            || leerEntero16(campos[2],rdata + 4) < 0 || (largo = nombreDesdeTexto(campos[3],origen,rdata + 6)) < 0)
+        return -1;
+    return 6 + largo;
+}
+
+/** "d [m [s]] N|S d [m [s]] E|W alt[m] [tamaño[m] [precH[m] [precV[m]]]]" (RFC 1876 3) **/
+static int codificarLOC(char *campos[], int cantidad, const unsigned char *origen, unsigned char *rdata, int max)
+{
+    (void)origen;
+    if (max < LARGO_LOC)
+        return -1;
+    return locDesdeTexto(campos,cantidad,rdata);
+}
+
+/** Forma genérica de RFC 3597: "\# largo" seguido del RDATA en hexadecimal, en uno o más campos **/
+static int codificarGenerico(char *campos[], int cantidad, unsigned char *rdata, int max)
+{
+    int largo, n = 0, i;
+    char *fin;
+    if (cantidad < 2 || (largo = strtol(campos[1],&fin,10)) < 0 || *fin != '\0' || largo > max)
+        return -1;
+    for (i = 2; i < cantidad; i++)
+    {
+        const char *p = campos[i];
+        for (; p[0] && p[1]; p += 2)
+        {
+            unsigned int byte;
+            if (n == largo || !isxdigit((unsigned char)p[0]) || !isxdigit((unsigned char)p[1])
+                    || sscanf(p,"%2x",&byte) != 1)
+                return -1;
+            rdata[n++] = byte;
+        }
+        if (*p)
+            return -1;
+    }
+    return n == largo ? largo : -1;
+}
+
+/**
+ * Tabla de tipos: cada X(tipo, nombre, decodificador, codificador) genera una entrada del
+ * arreglo, indexado por el número de tipo, de modo que despachar es un acceso directo.
+ **/
+#define TABLA_TIPOS_RR(X) \
+    X(T_A,      "A",      decodificarDireccion4, codificarDireccion4) \
+    X(T_NS,     "NS",     decodificarNombre,     codificarNombre) \
+    X(T_CNAME,  "CNAME",  decodificarNombre,     codificarNombre) \
+    X(T_SOA,    "SOA",    decodificarSOA,        codificarSOA) \
+    X(T_PTR,    "PTR",    decodificarNombre,     codificarNombre) \
+    X(T_HINFO,  "HINFO",  decodificarCadenas,    codificarCadenas) \
+    X(T_MX,     "MX",     decodificarMX,         codificarMX) \
+    X(T_TXT,    "TXT",    decodificarCadenas,    codificarCadenas) \
+    X(T_AAAA,   "AAAA",   decodificarDireccion6, codificarDireccion6) \
+    X(T_LOC,    "LOC",    decodificarLOC,        codificarLOC) \
+    X(T_SRV,    "SRV",    decodificarSRV,        codificarSRV) \
+    X(T_NAPTR,  "NAPTR",  decodificarNAPTR,      NULL) \
+    X(T_DNAME,  "DNAME",  decodificarNombre,     codificarNombre) \
+    X(T_OPT,    "OPT",    decodificarOpaco,      NULL) \
+    X(T_DS,     "DS",     decodificarDS,         NULL) \
+    X(T_SSHFP,  "SSHFP",  decodificarSSHFP,      NULL) \
+    X(T_RRSIG,  "RRSIG",  decodificarRRSIG,      NULL) \
+    X(T_NSEC,   "NSEC",   decodificarNSEC,       NULL) \
+    X(T_DNSKEY, "DNSKEY", decodificarDNSKEY,     NULL) \
+    X(T_NSEC3,  "NSEC3",  decodificarNSEC3,      NULL) \
+    X(T_TLSA,   "TLSA",   decodificarTLSA,       NULL) \
+    X(T_SPF,    "SPF",    decodificarCadenas,    codificarCadenas) \
+    X(T_CAA,    "CAA",    decodificarCAA,        NULL)
+
+#define ENTRADA_TIPO_RR(tipo, nombre, decodificador, codificador) [tipo] = {tipo, nombre, decodificador, codificador},
+
+static const TIPO_RR tablaTiposRR[T_CAA + 1] =
+{
+    TABLA_TIPOS_RR(ENTRADA_TIPO_RR)
+};
+
+const TIPO_RR *buscarTipoRR(int tipo)
+{
+    if (tipo < 0 || tipo > T_CAA || tablaTiposRR[tipo].nombre == NULL)
+        return NULL;
+    return &tablaTiposRR[tipo];
+}
+
+const char *mapearTipo(int tipo, char *desconocido)
+{
+    const TIPO_RR *entrada = buscarTipoRR(tipo);
+    if (entrada != NULL)
+        return entrada->nombre;
+    snprintf(desconocido,LARGO_TEXTO_TIPO,"TYPE%d",tipo);
+    return desconocido;
+}
+
+int tipoDesdeNombre(const char *nombre)
+{
+    int tipo;
+    for (tipo = 0; tipo <= T_CAA; tipo++)
+        if (tablaTiposRR[tipo].nombre != NULL && strcasecmp(tablaTiposRR[tipo].nombre,nombre) == 0)
+            return tipo;
+    if (strncasecmp(nombre,"TYPE",4) == 0 && isdigit((unsigned char)nombre[4]))
+    {
+        tipo = atoi(nombre + 4);
+        return (tipo > 0 && tipo <= 65535) ? tipo : 0;
+    }
+    return 0;
+}
+
+void decodificarRDATA(unsigned char *mensaje, int largoMensaje, unsigned char *rdata, int rdlength, int tipo, struct RESOURCE_RECORD *rr)
+{
+    const TIPO_RR *entrada = buscarTipoRR(tipo);
+    if (entrada != NULL)
+        entrada->decodificar(mensaje,largoMensaje,rdata,rdlength,rr);
+    else
+        decodificarOpaco(mensaje,largoMensaje,rdata,rdlength,rr);
+}
+
+int codificarRDATA(int tipo, char *campos[], int cantidad, const unsigned char *origen, unsigned char *rdata, int max)
+{
+    const TIPO_RR *entrada = buscarTipoRR(tipo);
+    if (cantidad > 0 && strcmp(campos[0],"\\#") == 0)
+        return codificarGenerico(campos,cantidad,rdata,max);
+    if (entrada == NULL || entrada->codificar == NULL)
+        return -1;
+    return entrada->codificar(campos,cantidad,origen,rdata,max);
+}
+
+unsigned char *leerSeccion(unsigned char *reader, unsigned char *mensaje, int largo, int cantidad,
+                           struct RESOURCE_RECORD registros[], int max, int *guardados)
+{
+    unsigned char *fin = mensaje + largo;
+    int i;
+
+    for (i = 0; i < cantidad && reader < fin; i++)
+    {
+        struct RESOURCE_RECORD rr;
+        char nombre[MAX_TEXTO_NOMBRE];
+        int siguiente = nombreLeerPresentacion(mensaje,largo,reader - mensaje,nombre);
+        if (siguiente < 0 || mensaje + siguiente + TAM_R_DATA > fin)
+            break;
+        reader = mensaje + siguiente;
+        rr.name = (unsigned char*)strdup(nombre);
+        /** obtengo el recurso, es decir, los campos fijos del RR **/
+        camposRRLeer(reader,&rr.resource);
+        reader += TAM_R_DATA;
+
+        int rdlength = rr.resource.rdlength;
+        if (reader + rdlength > fin)   /** mensaje truncado **/
+        {
+            free(rr.name);
+            break;
+        }
+        if (*guardados < max)
+        {
+            decodificarRDATA(mensaje,largo,reader,rdlength,rr.resource.type,&rr);
+            registros[(*guardados)++] = rr;
+        }
+        else
+            free(rr.name);
+        reader += rdlength;
+    }
+    return reader;
+}
+
+void liberarRegistros(struct RESOURCE_RECORD registros[], int cantidad)
+{
+    int i;
+    for (i = 0; i < cantidad; i++)
+    {
+        free(registros[i].name);
+        free(registros[i].rdata);
+        free(registros[i].texto);
+    }
+}
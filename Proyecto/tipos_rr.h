@@ -0,0 +1,81 @@
+#ifndef TIPOS_RR_H_INCLUDED
+#define TIPOS_RR_H_INCLUDED
+
+#include "dns.h"
+
+/**
+ * Decodificador del RDATA de un tipo de RR. Recibe el mensaje completo con su largo (para resolver
+ * nombres comprimidos sin salirse de él), el comienzo del RDATA y su largo, y completa rr->rdata
+ * y rr->texto.
+ **/
+typedef void (*DECODIFICADOR_RDATA)(unsigned char *mensaje, int largoMensaje, unsigned char *rdata, int rdlength, struct RESOURCE_RECORD *rr);
+
+/**
+ * Codificador del RDATA desde el formato presentación (archivo de zona). Recibe los campos ya
+ * separados, el origen para completar los nombres relativos (en formato DNS) y escribe el RDATA
+ * en rdata. Devuelve el largo del RDATA, o -1 si los campos no son válidos.
+ **/
+typedef int (*CODIFICADOR_RDATA)(char *campos[], int cantidad, const unsigned char *origen, unsigned char *rdata, int max);
+
+/** Entrada de la tabla de tipos, indexada directamente por el número de tipo **/
+typedef struct
+{
+    unsigned short tipo;
+    const char *nombre;
+    DECODIFICADOR_RDATA decodificar;
+    CODIFICADOR_RDATA codificar;        /** NULL si sólo se acepta la forma genérica "\# largo hex" **/
+} TIPO_RR;
+
+/** Devuelve la entrada del tipo, o NULL si el tipo no está en la tabla **/
+const TIPO_RR *buscarTipoRR(int tipo);
+
+/** Lugar para el "TYPEnnn" de un tipo desconocido, con el 0 final **/
+#define LARGO_TEXTO_TIPO 16
+
+/**
+ * mapearTipo: mapea un tipo a un texto imprimible. Los conocidos devuelven el nombre de la tabla;
+ * para los desconocidos escribe "TYPEnnn" (RFC 3597) en desconocido, de LARGO_TEXTO_TIPO bytes,
+ * que pone quien llama: nada queda compartido entre llamadas ni entre hilos.
+ **/
+const char *mapearTipo(int tipo, char *desconocido);
+
+/** Busca el tipo por su nombre ("AAAA", "mx", "TYPE65"...); devuelve 0 si no lo conoce **/
+int tipoDesdeNombre(const char *nombre);
+
+/**
+ * Decodifica el RDATA según la tabla. Los tipos desconocidos, y los conocidos cuyo RDATA no
+ * tiene el formato esperado, se guardan como datos opacos ("\# largo hex", RFC 3597).
+ **/
+void decodificarRDATA(unsigned char *mensaje, int largoMensaje, unsigned char *rdata, int rdlength, int tipo, struct RESOURCE_RECORD *rr);
+
+/**
+ * Lee "cantidad" RRs de una sección a partir de reader. Guarda hasta max registros a partir de
+ * registros[*guardados] e incrementa *guardados. Siempre avanza RDLENGTH bytes por registro, por
+ * lo que un tipo desconocido no desincroniza la lectura. Devuelve el puntero al siguiente RR.
+ **/
+unsigned char *leerSeccion(unsigned char *reader, unsigned char *mensaje, int largo, int cantidad,
+                           struct RESOURCE_RECORD registros[], int max, int *guardados);
+
+/**
+ * Codifica el RDATA de un registro de archivo de zona según la tabla. Acepta para cualquier tipo
+ * la forma genérica "\# largo hex" (RFC 3597). Devuelve el largo del RDATA o -1.
+ **/
+int codificarRDATA(int tipo, char *campos[], int cantidad, const unsigned char *origen, unsigned char *rdata, int max);
+
+/**
+ * Convierte un nombre del archivo de zona al formato DNS: "@" es el origen, los nombres sin punto
+ * final son relativos al origen (NULL = la raíz) y se aceptan los escapes \X y \DDD. Devuelve el
+ * largo del nombre codificado, o -1 si no es válido.
+ **/
+int nombreDesdeTexto(const char *texto, const unsigned char *origen, unsigned char *destino);
+
+/** Largo de un nombre en formato DNS sin comprimir, incluido el label raíz **/
+int largoNombreDNS(const unsigned char *nombre);
+
+/** Lee un TTL o un intervalo del SOA, con unidades opcionales ("3600", "1h30m", "2d"); 0 o -1 **/
+int leerTiempo(const char *texto, unsigned int *valor);
+
+/** Libera los nombres, rdata y textos de registros leídos con leerSeccion **/
+void liberarRegistros(struct RESOURCE_RECORD registros[], int cantidad);
+
+#endif // TIPOS_RR_H_INCLUDED
@@ -0,0 +1,601 @@
+#include<stdio.h>
+#include<string.h>
+#include<stdlib.h>
+#include<ctype.h>
+#include<sys/socket.h>
+#include<sys/time.h>
+#include<arpa/inet.h>
+#include<netinet/in.h>
+#include<unistd.h>
+
+#include "dns.h"
+#include "tipos_rr.h"
+#include "traza.h"
+#include "direcciones.h"
+#include "transferencia.h"
+#include "aleatorio.h"
+
+#define T_IXFR 251
+#define T_AXFR 252
+
+#define CUBETAS_DELTA 4096
+
+/** Estados del procesamiento de la respuesta (RFC 1995 4) **/
+#define ESPERANDO_SOA 0         // todavía no llegó el primer SOA
+#define ESPERANDO_SEGUNDO 1     // llegó el SOA nuevo; el segundo RR decide el formato
+#define FORMATO_AXFR 2          // zona completa: cada RR se escribe tal cual
+#define IXFR_BORRANDO 3         // secuencia de registros eliminados
+#define IXFR_AGREGANDO 4        // secuencia de registros agregados
+#define TERMINADA 5
+
+/** Un cambio de la IXFR: clave sin TTL para comparar contra la copia local, y la línea a escribir **/
+typedef struct ENTRADA_DELTA
+{
+    char *clave;
+    char *linea;                    // NULL en las eliminaciones
+    int vigente;                    // 0 si un cambio posterior lo anuló
+    struct ENTRADA_DELTA *siguiente;    // siguiente en la cubeta
+    struct ENTRADA_DELTA *orden;        // siguiente agregado, en el orden de llegada
+} ENTRADA_DELTA;
+
+typedef struct
+{
+    int qtype;                      // T_AXFR o T_IXFR
+    int estado;
+    unsigned int serialNuevo;
+    unsigned int serialLocal;
+    char *soaNuevo;                 // línea del primer SOA, hasta saber el formato de la respuesta
+    int incremental;                // 1 si la respuesta vino en formato IXFR
+    int alDia;                      // 1 si el servidor contestó sólo con el SOA de nuestro serial
+    int sinDeltas;                  // 1 si contestó sólo con un SOA más nuevo: no tiene los cambios
+    FILE *salida;                   // zona completa o copia local actualizada
+
+    ENTRADA_DELTA *borrados[CUBETAS_DELTA];
+    ENTRADA_DELTA *agregados[CUBETAS_DELTA];
+    ENTRADA_DELTA *primerAgregado, *ultimoAgregado;
+
+    long registros, mensajes, bytes;
+} TRANSFERENCIA;
+
+/** Buffer de un mensaje: el largo de 2 bytes limita el mensaje a 65535 bytes **/
+static unsigned char mensaje[65536];
+
+static unsigned int serialDeTexto(const char *texto)
+{
+    unsigned int serial = 0;
+    sscanf(texto,"%*s %*s %u",&serial);
+    return serial;
+}
+
+static int conectarTCP(const char *servidor, const char *puerto)
+{
+    DIRECCION destino;
+    struct timeval espera = {TIMEOUT_TRANSFERENCIA_S, 0};
+    int s;
+
+    if (direccionDesdeTexto(&destino,servidor,atoi(puerto)) < 0)
+    {
+        printf("ERROR: el servidor %s no es una dirección IPv4 ni IPv6\n",servidor);
+        return -1;
+    }
+    if ((s = socket(destino.sa.sa_family,SOCK_STREAM,IPPROTO_TCP)) < 0)
+    {
+        perror("socket error");
+        return -1;
+    }
+    setsockopt(s,SOL_SOCKET,SO_RCVTIMEO,&espera,sizeof(espera));
+    if (connect(s,&destino.sa,direccionLargo(&destino)) < 0)
+    {
+        perror("connect error");
+        close(s);
+        return -1;
+    }
+    return s;
+}
+
+/** Lee exactamente largo bytes; devuelve 0, o -1 si la conexión se cerró o venció la espera **/
+static int leerCompleto(int s, unsigned char *destino, int largo)
+{
+    int leidos = 0, n;
+    while (leidos < largo)
+    {
+        if ((n = recv(s,destino + leidos,largo - leidos,0)) <= 0)
+            return -1;
+        leidos += n;
+    }
+    return 0;
+}
+
+/**
+ * Envía la consulta AXFR o IXFR con su prefijo de largo. La IXFR lleva en la sección
+ * Authority el SOA de la copia local, del que el servidor sólo mira el serial.
+ **/
+static int enviarConsulta(int s, const char *zona, int qtype, unsigned int serial, unsigned short id)
+{
+    unsigned char consulta[2 + 12 + 256 + 4 + 2 + 10 + 22];
+    char host[256];
+    int largo;
+    CABECERA_DNS cabecera = {0};
+
+    memset(consulta,0,sizeof(consulta));
+    cabecera.id = id;
+    cabecera.qdcount = 1;
+    cabecera.nscount = (qtype == T_IXFR) ? 1 : 0;
+    cabeceraEscribir(&cabecera,consulta + 2);
+    snprintf(host,sizeof(host) - 1,"%s",zona);
+    if (strlen(host) > 1 && host[strlen(host)-1] == '.')
+        host[strlen(host)-1] = '\0';
+    cambiarAlFormatoNombreDNS(consulta + 14,host);
+    largo = 14 + strlen((char*)consulta + 14) + 1;
+    escribir16(consulta + largo,qtype);
+    escribir16(consulta + largo + 2,1);
+    largo += TAM_PREGUNTA;
+    if (qtype == T_IXFR)
+    {
+        /** MNAME y RNAME raíz, y los 5 campos de 32 bits **/
+        struct R_DATA campos = {T_SOA, 1, 0, 22};
+        consulta[largo++] = 0xc0;           /** puntero al nombre de la pregunta **/
+        consulta[largo++] = 12;
+        camposRREscribir(&campos,consulta + largo);
+        largo += TAM_R_DATA + 2;
+        escribir32(consulta + largo,serial);
+        largo += 20;
+    }
+    escribir16(consulta,largo - 2);
+    return send(s,consulta,largo,0) == largo ? 0 : -1;
+}
+
+/** Escribe el RR como una línea de archivo de zona **/
+static void escribirRegistro(FILE *salida, struct RESOURCE_RECORD *rr)
+{
+    char textoTipo[LARGO_TEXTO_TIPO];
+    fprintf(salida,"%s.\t%u\tIN\t%s\t%s\n",rr->name[0] ? (char*)rr->name : "",rr->resource.ttl,
+            mapearTipo(rr->resource.type,textoTipo),rr->texto);
+}
+
+/** Clave de comparación de un registro: nombre en minúsculas y sin punto, tipo y rdata (sin TTL) **/
+static char *claveRegistro(const char *nombre, const char *tipo, const char *texto)
+{
+    int largoNombre = strlen(nombre), i;
+    if (largoNombre > 0 && nombre[largoNombre-1] == '.')
+        largoNombre--;
+    char *clave = (char*)malloc(largoNombre + strlen(tipo) + strlen(texto) + 3);
+    for (i = 0; i < largoNombre; i++)
+        clave[i] = tolower((unsigned char)nombre[i]);
+    sprintf(clave + largoNombre,"\t%s\t%s",tipo,texto);
+    return clave;
+}
+
+static unsigned int hashClave(const char *clave)
+{
+    unsigned int h = 5381;
+    while (*clave)
+        h = h * 33 + (unsigned char)*clave++;
+    return h % CUBETAS_DELTA;
+}
+
+static ENTRADA_DELTA *buscarDelta(ENTRADA_DELTA **cubetas, const char *clave)
+{
+    ENTRADA_DELTA *e;
+    for (e = cubetas[hashClave(clave)]; e != NULL; e = e->siguiente)
+        if (e->vigente && strcmp(e->clave,clave) == 0)
+            return e;
+    return NULL;
+}
+
+static ENTRADA_DELTA *insertarDelta(ENTRADA_DELTA **cubetas, char *clave, char *linea)
+{
+    ENTRADA_DELTA *e = (ENTRADA_DELTA*)calloc(1,sizeof(ENTRADA_DELTA));
+    unsigned int h = hashClave(clave);
+    e->clave = clave;
+    e->linea = linea;
+    e->vigente = 1;
+    e->siguiente = cubetas[h];
+    cubetas[h] = e;
+    return e;
+}
+
+static void liberarDeltas(ENTRADA_DELTA **cubetas)
+{
+    int i;
+    for (i = 0; i < CUBETAS_DELTA; i++)
+        while (cubetas[i] != NULL)
+        {
+            ENTRADA_DELTA *e = cubetas[i];
+            cubetas[i] = e->siguiente;
+            free(e->clave);
+            free(e->linea);
+            free(e);
+        }
+}
+
+/** Eliminación de la IXFR: si el registro lo había agregado una secuencia anterior, se anulan ambos **/
+static void registrarBorrado(TRANSFERENCIA *t, struct RESOURCE_RECORD *rr)
+{
+    char textoTipo[LARGO_TEXTO_TIPO];
+    char *clave = claveRegistro((char*)rr->name,mapearTipo(rr->resource.type,textoTipo),rr->texto);
+    ENTRADA_DELTA *agregado = buscarDelta(t->agregados,clave);
+    if (agregado != NULL)
+    {
+        agregado->vigente = 0;
+        free(clave);
+    }
+    else if (buscarDelta(t->borrados,clave) == NULL)
+        insertarDelta(t->borrados,clave,NULL);
+    else
+        free(clave);
+}
+
+/** La línea de archivo de zona del RR, en memoria **/
+static char *lineaRegistro(struct RESOURCE_RECORD *rr)
+{
+    char *linea;
+    size_t largo;
+    FILE *f = open_memstream(&linea,&largo);
+    escribirRegistro(f,rr);
+    fclose(f);
+    return linea;
+}
+
+static void registrarAgregado(TRANSFERENCIA *t, struct RESOURCE_RECORD *rr)
+{
+    char textoTipo[LARGO_TEXTO_TIPO];
+    char *clave = claveRegistro((char*)rr->name,mapearTipo(rr->resource.type,textoTipo),rr->texto);
+    ENTRADA_DELTA *e = insertarDelta(t->agregados,clave,lineaRegistro(rr));
+    if (t->ultimoAgregado != NULL)
+        t->ultimoAgregado->orden = e;
+    else
+        t->primerAgregado = e;
+    t->ultimoAgregado = e;
+}
+
+/**
+ * Procesa un RR de la respuesta según el estado (rr NULL indica el fin de un mensaje).
+ * Devuelve 1 cuando la transferencia terminó, 0 para seguir, -1 si la respuesta no es válida.
+ **/
+static int procesarRegistro(TRANSFERENCIA *t, struct RESOURCE_RECORD *rr)
+{
+    if (rr == NULL)
+    {
+        /** IXFR contestada con un único SOA (RFC 1995 4): si el serial es el nuestro la copia está al
+            día; si es más nuevo, el servidor no guarda los cambios desde el nuestro y hay que pedir AXFR.
+            Una respuesta de verdad nunca corta el primer mensaje después del primer SOA. **/
+        if (t->qtype == T_IXFR && t->estado == ESPERANDO_SEGUNDO && t->mensajes == 1)
+        {
+            if (t->serialNuevo == t->serialLocal)
+                t->alDia = 1;
+            else
+                t->sinDeltas = 1;
+            t->estado = TERMINADA;
+        }
+        return t->estado == TERMINADA;
+    }
+
+    int esSOA = rr->resource.type == T_SOA;
+    unsigned int serial = esSOA ? serialDeTexto(rr->texto) : 0;
+    t->registros++;
+    switch (t->estado)
+    {
+    case ESPERANDO_SOA:
+        if (!esSOA)
+        {
+            printf("ERROR: la transferencia no comienza con el SOA de la zona\n");
+            return -1;
+        }
+        t->serialNuevo = serial;
+        t->soaNuevo = lineaRegistro(rr);
+        t->estado = ESPERANDO_SEGUNDO;
+        return 0;
+    case ESPERANDO_SEGUNDO:
+        if (t->qtype == T_IXFR && esSOA && serial != t->serialNuevo)
+        {
+            t->incremental = 1;
+            t->estado = IXFR_BORRANDO;
+            registrarBorrado(t,rr);
+            return 0;
+        }
+        /** formato AXFR: escribo el SOA que quedó pendiente y este registro **/
+        fprintf(t->salida,"$ORIGIN .\n%s",t->soaNuevo);
+        if (esSOA)     /** zona vacía: sólo los dos SOA **/
+        {
+            t->estado = TERMINADA;
+            return 1;
+        }
+        t->estado = FORMATO_AXFR;
+        escribirRegistro(t->salida,rr);
+        return 0;
+    case FORMATO_AXFR:
+        if (esSOA)     /** el SOA final cierra la transferencia y no se repite en la salida **/
+        {
+            t->estado = TERMINADA;
+            return 1;
+        }
+        escribirRegistro(t->salida,rr);
+        return 0;
+    case IXFR_BORRANDO:
+        if (esSOA)
+        {
+            t->estado = IXFR_AGREGANDO;
+            registrarAgregado(t,rr);
+        }
+        else
+            registrarBorrado(t,rr);
+        return 0;
+    case IXFR_AGREGANDO:
+        if (esSOA && serial == t->serialNuevo)
+        {
+            t->estado = TERMINADA;
+            return 1;
+        }
+        if (esSOA)
+        {
+            t->estado = IXFR_BORRANDO;
+            registrarBorrado(t,rr);
+        }
+        else
+            registrarAgregado(t,rr);
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * Lee los mensajes de la conexión y pasa cada RR de la sección Answer por procesarRegistro,
+ * liberándolo enseguida. Devuelve 0 si la transferencia terminó, -1 si no.
+ **/
+static int recibirTransferencia(int s, unsigned short id, TRANSFERENCIA *t)
+{
+    unsigned char prefijo[2];
+    int resultado = 0;
+    CABECERA_DNS cabecera;
+    while (resultado == 0)
+    {
+        if (leerCompleto(s,prefijo,2) < 0)
+        {
+            printf("ERROR: la conexión se cerró antes del fin de la transferencia\n");
+            return -1;
+        }
+        int largo = leer16(prefijo);
+        if (largo < TAM_CABECERA || leerCompleto(s,mensaje,largo) < 0)
+        {
+            printf("ERROR: mensaje incompleto en la transferencia\n");
+            return -1;
+        }
+        t->mensajes++;
+        t->bytes += largo + 2;
+        cabeceraLeer(mensaje,&cabecera);
+        if (cabecera.id != id)
+        {
+            printf("ERROR: la respuesta no corresponde a la consulta\n");
+            return -1;
+        }
+        if (cabecera.rcode != 0)
+        {
+            printf("ERROR: el servidor rechazó la transferencia (%s)\n",mapearRcode(cabecera.rcode));
+            return -1;
+        }
+
+        /** salteo la sección Question (si viene: es opcional después del primer mensaje) **/
+        unsigned char *reader = mensaje + TAM_CABECERA, *fin = mensaje + largo;
+        int preguntas = cabecera.qdcount, respuestas = cabecera.ancount, i;
+        for (i = 0; i < preguntas && reader < fin; i++)
+        {
+            while (reader < fin && *reader != 0 && (*reader & 0xc0) != 0xc0)
+                reader += *reader + 1;
+            reader += (reader < fin && *reader != 0) ? 2 + 4 : 1 + 4;
+        }
+
+        for (i = 0; i < respuestas && resultado == 0; i++)
+        {
+            struct RESOURCE_RECORD rr;
+            int leidos = 0;
+            reader = leerSeccion(reader,mensaje,largo,1,&rr,1,&leidos);
+            if (leidos == 0)
+            {
+                printf("ERROR: registro truncado en la transferencia\n");
+                return -1;
+            }
+            resultado = procesarRegistro(t,&rr);
+            liberarRegistros(&rr,1);
+        }
+        if (resultado == 0)
+            resultado = procesarRegistro(t,NULL);
+    }
+    return resultado < 0 ? -1 : 0;
+}
+
+static void imprimirResumen(TRANSFERENCIA *t, const char *tipo, const char *zona, long long comienzo, FILE *f)
+{
+    double segundos = (trazaMicrosegundos() - comienzo) / 1000000.0;
+    fprintf(f,";; %s de %s: %ld registros en %ld mensajes (%ld bytes) en %.2f s\n",tipo,zona,
+            t->registros,t->mensajes,t->bytes,segundos);
+}
+
+/** Prepara el estado y envía la consulta; devuelve el socket o -1 **/
+static int comenzarTransferencia(TRANSFERENCIA *t, const char *zona, const char *servidor, const char *puerto,
+                                 int qtype, unsigned int serial, unsigned short *id)
+{
+    int s;
+    memset(t,0,sizeof(*t));
+    t->qtype = qtype;
+    t->serialLocal = serial;
+    if ((s = conectarTCP(servidor,puerto)) < 0)
+        return -1;
+    *id = aleatorioId();
+    if (enviarConsulta(s,zona,qtype,serial,*id) < 0)
+    {
+        perror("send error");
+        close(s);
+        return -1;
+    }
+    return s;
+}
+
+int transferenciaAXFR(const char *zona, const char *servidor, const char *puerto, const char *salida)
+{
+    static TRANSFERENCIA t;
+    unsigned short id;
+    long long comienzo = trazaMicrosegundos();
+    int s = comenzarTransferencia(&t,zona,servidor,puerto,T_AXFR,0,&id), resultado;
+    if (s < 0)
+        return -1;
+
+    if (salida == NULL || strcmp(salida,"-") == 0)
+        t.salida = stdout;
+    else if ((t.salida = fopen(salida,"w")) == NULL)
+    {
+        printf("ERROR: no se pudo abrir el archivo de salida %s\n",salida);
+        close(s);
+        return -1;
+    }
+    setvbuf(t.salida,NULL,_IOFBF,1 << 20);
+
+    resultado = recibirTransferencia(s,id,&t);
+    close(s);
+    free(t.soaNuevo);
+    if (t.salida != stdout)
+        fclose(t.salida);
+    else
+        fflush(stdout);
+    if (resultado == 0)
+        imprimirResumen(&t,"AXFR",zona,comienzo,t.salida == stdout ? stderr : stdout);
+    return resultado;
+}
+
+/**
+ * Escribe la copia local actualizada: las líneas de la copia que no fueron eliminadas, con
+ * los SOA agregados antes del primer registro y el resto de los agregados al final.
+ **/
+static int aplicarDeltas(TRANSFERENCIA *t, FILE *local, FILE *nueva)
+{
+    char *linea = NULL;
+    size_t capacidad = 0;
+    int registrosVistos = 0, soa;
+    ENTRADA_DELTA *e;
+    if (local == NULL)
+        fprintf(nueva,"$ORIGIN .\n");
+    /** línea completa, sin importar el largo: un TXT o un RRSIG largo no se puede partir **/
+    while (local != NULL && getline(&linea,&capacidad,local) != -1)
+    {
+        char nombre[256], tipo[32];
+        int ttl, desplazamiento = 0;
+        if (linea[0] == '$' || linea[0] == ';' || linea[0] == '\n'
+                || sscanf(linea,"%255s %d IN %31s %n",nombre,&ttl,tipo,&desplazamiento) < 3 || desplazamiento == 0)
+        {
+            fputs(linea,nueva);
+            continue;
+        }
+        if (!registrosVistos++)
+            for (e = t->primerAgregado; e != NULL; e = e->orden)
+                if (e->vigente && strstr(e->clave,"\tSOA\t") != NULL)
+                    fputs(e->linea,nueva);
+        linea[strcspn(linea,"\n")] = '\0';
+        char *clave = claveRegistro(nombre,tipo,linea + desplazamiento);
+        if (buscarDelta(t->borrados,clave) == NULL)
+            fprintf(nueva,"%s\n",linea);
+        free(clave);
+    }
+    for (soa = registrosVistos ? 0 : 1; soa >= 0; soa--)
+        for (e = t->primerAgregado; e != NULL; e = e->orden)
+            if (e->vigente && (strstr(e->clave,"\tSOA\t") != NULL) == soa)
+                fputs(e->linea,nueva);
+    free(linea);
+    return 0;
+}
+
+int transferenciaIXFR(const char *zona, const char *servidor, const char *puerto, const char *archivoLocal)
+{
+    static TRANSFERENCIA t;
+    char temporal[4096], *linea = NULL;
+    size_t capacidad = 0;
+    unsigned int serial = 0;
+    unsigned short id;
+    long long comienzo = trazaMicrosegundos();
+    FILE *local = fopen(archivoLocal,"r");
+
+    /** el serial de la copia es el del primer SOA del archivo **/
+    while (local != NULL && getline(&linea,&capacidad,local) != -1)
+    {
+        char tipo[32];
+        int desplazamiento = 0;
+        if (linea[0] != '$' && linea[0] != ';' && sscanf(linea,"%*s %*d IN %31s %n",tipo,&desplazamiento) == 1
+                && desplazamiento > 0 && strcmp(tipo,"SOA") == 0)
+        {
+            serial = serialDeTexto(linea + desplazamiento);
+            break;
+        }
+    }
+    free(linea);
+
+    int s = comenzarTransferencia(&t,zona,servidor,puerto,T_IXFR,serial,&id), resultado;
+    if (s < 0)
+    {
+        if (local != NULL)
+            fclose(local);
+        return -1;
+    }
+    snprintf(temporal,sizeof(temporal),"%s.tmp",archivoLocal);
+    if ((t.salida = fopen(temporal,"w")) == NULL)
+    {
+        printf("ERROR: no se pudo crear el archivo temporal %s\n",temporal);
+        close(s);
+        if (local != NULL)
+            fclose(local);
+        return -1;
+    }
+    setvbuf(t.salida,NULL,_IOFBF,1 << 20);
+
+    resultado = recibirTransferencia(s,id,&t);
+    close(s);
+    if (resultado == 0 && t.alDia)
+    {
+        printf(";; la copia local de %s ya tiene el serial %u\n",zona,serial);
+        fclose(t.salida);
+        remove(temporal);
+    }
+    else if (resultado == 0 && t.sinDeltas)
+    {
+        printf(";; el servidor no tiene los cambios de %s desde el serial %u: se pide la zona completa (AXFR)\n",
+               zona,serial);
+        fclose(t.salida);
+        if ((resultado = transferenciaAXFR(zona,servidor,puerto,temporal)) == 0 && rename(temporal,archivoLocal) < 0)
+        {
+            perror("rename error");
+            resultado = -1;
+        }
+        if (resultado < 0)
+            remove(temporal);
+        else
+            printf(";; copia local de %s actualizada del serial %u al %u\n",zona,serial,t.serialNuevo);
+    }
+    else if (resultado == 0)
+    {
+        if (t.incremental)
+        {
+            if (local != NULL)
+                rewind(local);
+            aplicarDeltas(&t,local,t.salida);
+        }
+        fclose(t.salida);
+        if (rename(temporal,archivoLocal) < 0)
+        {
+            perror("rename error");
+            resultado = -1;
+        }
+        else
+            printf(";; copia local de %s actualizada del serial %u al %u\n",zona,serial,t.serialNuevo);
+    }
+    else
+    {
+        fclose(t.salida);
+        remove(temporal);
+    }
+    if (local != NULL)
+        fclose(local);
+    free(t.soaNuevo);
+    liberarDeltas(t.agregados);
+    liberarDeltas(t.borrados);
+    if (resultado == 0)
+        imprimirResumen(&t,"IXFR",zona,comienzo,stdout);
+    return resultado;
+}
@@ -0,0 +1,36 @@
+#ifndef TRANSFERENCIA_H_INCLUDED
+#define TRANSFERENCIA_H_INCLUDED
+
+/**
+ * Transferencias de zona sobre TCP (parámetros -axfr e -ixfr=).
+ * La respuesta llega como una secuencia de mensajes DNS, cada uno precedido por su largo en
+ * 2 bytes (RFC 1035 4.2.2, RFC 5936). Los mensajes se leen de a uno en un único buffer y los
+ * registros se procesan a medida que se decodifican, así que la memoria usada no depende del
+ * tamaño de la zona.
+ *
+ * Los registros se escriben en formato de archivo de zona (RFC 1035 5), una línea por RR:
+ *      nombre.<TAB>ttl<TAB>IN<TAB>TIPO<TAB>rdata
+ * precedidas por "$ORIGIN ." para que los nombres del rdata (que se imprimen sin el punto
+ * final) se interpreten como absolutos. Ese archivo es la copia local que actualiza -ixfr=.
+ **/
+
+/** Espera máxima por cada lectura del socket TCP **/
+#define TIMEOUT_TRANSFERENCIA_S 15
+
+/**
+ * AXFR: transfiere la zona completa y la escribe en salida (NULL o "-" = salida estándar).
+ * Devuelve 0 si la transferencia terminó bien, -1 si no.
+ **/
+int transferenciaAXFR(const char *zona, const char *servidor, const char *puerto, const char *salida);
+
+/**
+ * IXFR (RFC 1995): toma el serial del SOA de la copia local (0 si el archivo no existe), pide
+ * los cambios desde ese serial y los aplica sobre el archivo. Si el servidor contesta con la
+ * zona completa, la copia se reemplaza; si contesta sólo con un SOA más nuevo (no guarda los
+ * cambios desde nuestro serial), se pide AXFR por otra conexión. Sólo las diferencias se guardan en memoria: la copia
+ * local se recorre línea por línea hacia un archivo temporal que luego la reemplaza.
+ * Devuelve 0 si la copia quedó actualizada, -1 si no.
+ **/
+int transferenciaIXFR(const char *zona, const char *servidor, const char *puerto, const char *archivoLocal);
+
+#endif // TRANSFERENCIA_H_INCLUDED
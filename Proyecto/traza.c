@@ -0,0 +1,170 @@
+#include<stdio.h>
+#include<string.h>
+#include<stdlib.h>
+#include<time.h>
+
+#include "traza.h"
+
+FILE *salidaTraza = NULL;
+
+static int numeroConsulta = 0;   // última consulta numerada; las resoluciones pueden venir de varios hilos
+static long long comienzoTraza;  // los eventos sin consulta miden desde que se activó la traza
+
+int trazaActivar(const char *archivo)
+{
+    comienzoTraza = trazaMicrosegundos();
+    if (archivo == NULL || strcmp(archivo,"-") == 0)
+    {
+        salidaTraza = stderr;
+        return 0;
+    }
+    if ((salidaTraza = fopen(archivo,"a")) == NULL)
+    {
+        printf("Falló abriendo el archivo de traza %s\n",archivo);
+        return -1;
+    }
+    return 0;
+}
+
+long long trazaMicrosegundos()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+const char *mapearRcode(int rcode)
+{
+    switch(rcode)
+    {
+        case 0:
+            return "NOERROR";
+        case 1:
+            return "FORMERR";
+        case 2:
+            return "SERVFAIL";
+        case 3:
+            return "NXDOMAIN";
+        case 4:
+            return "NOTIMP";
+        case 5:
+            return "REFUSED";
+    }
+    return "RCODE?";
+}
+
+/** Escribe una cadena JSON escapando comillas, barras y caracteres de control **/
+static void escribirCadena(const char *s)
+{
+    fputc('"',salidaTraza);
+    for (; s != NULL && *s; s++)
+    {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\')
+        {
+            fputc('\\',salidaTraza);
+            fputc(c,salidaTraza);
+        }
+        else if (c < 0x20)
+            fprintf(salidaTraza,"\\u%04x",c);
+        else
+            fputc(c,salidaTraza);
+    }
+    fputc('"',salidaTraza);
+}
+
+/** Campos comunes a todos los eventos; bloquea la salida hasta terminarEvento **/
+static void comenzarEvento(const TRAZA_CONSULTA *t, const char *evento)
+{
+    flockfile(salidaTraza);
+    fprintf(salidaTraza,"{\"ev\":\"%s\",\"id\":%d,\"t_us\":%lld",evento,t != NULL ? t->numero : 0,
+            trazaMicrosegundos() - (t != NULL ? t->comienzo : comienzoTraza));
+}
+
+static void terminarEvento()
+{
+    fprintf(salidaTraza,"}\n");
+    funlockfile(salidaTraza);
+}
+
+void trazaComenzarConsulta(TRAZA_CONSULTA *t, const char *qname, const char *qtype)
+{
+    if (salidaTraza == NULL)
+        return;
+    t->numero = __atomic_add_fetch(&numeroConsulta,1,__ATOMIC_RELAXED);
+    t->pasos = 0;
+    t->aciertosCache = 0;
+    t->comienzo = trazaMicrosegundos();
+    snprintf(t->nombre,sizeof(t->nombre),"%s",qname);
+    snprintf(t->tipo,sizeof(t->tipo),"%s",qtype);
+
+    comenzarEvento(t,"start");
+    fprintf(salidaTraza,",\"qname\":");
+    escribirCadena(qname);
+    fprintf(salidaTraza,",\"qtype\":\"%s\"",qtype);
+    terminarEvento();
+}
+
+void trazaPaso(TRAZA_CONSULTA *t, const char *servidor, const char *puerto, const char *qname, const char *qtype,
+               long long rtt_us, int bytes, int rcode, const char *resultado, const char *zona)
+{
+    if (salidaTraza == NULL)
+        return;
+    t->pasos++;
+    comenzarEvento(t,"hop");
+    fprintf(salidaTraza,",\"n\":%d,\"server\":",t->pasos);
+    escribirCadena(servidor);
+    fprintf(salidaTraza,",\"port\":%d,\"qname\":",atoi(puerto));
+    escribirCadena(qname);
+    fprintf(salidaTraza,",\"qtype\":\"%s\",\"rtt_us\":%lld,\"size\":%d,\"rcode\":\"%s\",\"outcome\":\"%s\"",
+            qtype,rtt_us,bytes,mapearRcode(rcode),resultado);
+    if (zona != NULL)
+    {
+        fprintf(salidaTraza,",\"zone\":");
+        escribirCadena(zona);
+    }
+    terminarEvento();
+}
+
+void trazaCache(TRAZA_CONSULTA *t, const char *qname, const char *qtype, const char *zona, const char *servidor)
+{
+    if (salidaTraza == NULL)
+        return;
+    t->aciertosCache++;
+    comenzarEvento(t,"cache");
+    fprintf(salidaTraza,",\"qname\":");
+    escribirCadena(qname);
+    fprintf(salidaTraza,",\"qtype\":\"%s\"",qtype);
+    if (zona != NULL)
+    {
+        fprintf(salidaTraza,",\"zone\":");
+        escribirCadena(zona);
+    }
+    fprintf(salidaTraza,",\"server\":");
+    escribirCadena(servidor);
+    terminarEvento();
+}
+
+void trazaFinConsulta(TRAZA_CONSULTA *t, const char *resultado)
+{
+    if (salidaTraza == NULL)
+        return;
+    comenzarEvento(t,"done");
+    fprintf(salidaTraza,",\"qname\":");
+    escribirCadena(t->nombre);
+    fprintf(salidaTraza,",\"qtype\":\"%s\",\"hops\":%d,\"cache_hits\":%d,\"outcome\":\"%s\"",
+            t->tipo,t->pasos,t->aciertosCache,resultado);
+    terminarEvento();
+    fflush(salidaTraza);
+}
+
+void trazaRitmo(const char *servidor, int puerto, double qps, int errores, int resultados)
+{
+    if (salidaTraza == NULL)
+        return;
+    comenzarEvento(NULL,"backoff");
+    fprintf(salidaTraza,",\"server\":");
+    escribirCadena(servidor);
+    fprintf(salidaTraza,",\"port\":%d,\"qps\":%.1f,\"errors\":%d,\"window\":%d",puerto,qps,errores,resultados);
+    terminarEvento();
+}
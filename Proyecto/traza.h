@@ -0,0 +1,54 @@
+#ifndef TRAZA_H_INCLUDED
+#define TRAZA_H_INCLUDED
+
+#include <stdio.h>
+
+/**
+ * Traza estructurada de la resolución (opcional, parámetro -traza).
+ * Cada evento se emite como una línea JSON compacta (JSON Lines), pensada para
+ * ser procesada por otras herramientas y no para ser leída por humanos.
+ * Eventos:
+ *  "start": comienzo de una consulta (qname, qtype).
+ *  "hop":   un paquete enviado a un servidor y su respuesta (rtt, tamaño, rcode, resultado).
+ *  "cache": un paso que se evitó porque se contestó sin salir a la red: la cache de delegaciones o
+ *           de respuestas, una zona de -zona= o las negativas de -nsec ("server" dice cuál).
+ *  "done":  fin de la consulta, con el tiempo total y la cantidad de pasos.
+ *  "backoff": el ritmo de envío (ritmo.h) bajó la tasa de un servidor por errores o timeouts.
+ *
+ * Cada resolución lleva su propio TRAZA_CONSULTA (el lote iterativo tiene muchas en vuelo, y el
+ * priming de la raíz corre en otro hilo), y cada evento sale entero con la salida bloqueada, así
+ * que las líneas de consultas distintas no se mezclan. Los eventos sin consulta ("backoff") van
+ * con id 0.
+ **/
+
+/** Archivo donde se escribe la traza, NULL si está desactivada **/
+extern FILE *salidaTraza;
+
+/** Estado de una consulta trazada **/
+typedef struct
+{
+    int numero;                     // identificador de la consulta dentro del proceso
+    int pasos;                      // paquetes enviados en esta consulta
+    int aciertosCache;              // pasos evitados gracias a una cache
+    long long comienzo;             // instante de comienzo de la consulta (us)
+    char nombre[256];
+    char tipo[16];
+} TRAZA_CONSULTA;
+
+/** Activa la traza sobre el archivo indicado ("-" o NULL = stderr) **/
+int trazaActivar(const char *archivo);
+
+/** Reloj monotónico en microsegundos, para medir RTTs **/
+long long trazaMicrosegundos();
+
+void trazaComenzarConsulta(TRAZA_CONSULTA *t, const char *qname, const char *qtype);
+void trazaPaso(TRAZA_CONSULTA *t, const char *servidor, const char *puerto, const char *qname, const char *qtype,
+               long long rtt_us, int bytes, int rcode, const char *resultado, const char *zona);
+void trazaCache(TRAZA_CONSULTA *t, const char *qname, const char *qtype, const char *zona, const char *servidor);
+void trazaFinConsulta(TRAZA_CONSULTA *t, const char *resultado);
+void trazaRitmo(const char *servidor, int puerto, double qps, int errores, int resultados);
+
+/** Texto del RCODE (RFC 1035 4.1.1 y RFC 6895) **/
+const char *mapearRcode(int rcode);
+
+#endif // TRAZA_H_INCLUDED
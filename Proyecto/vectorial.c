@@ -0,0 +1,327 @@
+#include<stdio.h>
+#include<string.h>
+#include<stdint.h>
+
+#include "vectorial.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define VECTORIAL_X86 1
+#include <immintrin.h>
+#endif
+
+/** ------------------------------------------------------------------------------------
+ * Versiones escalares: son la referencia y cubren los restos que no llenan un registro
+ ** ------------------------------------------------------------------------------------ **/
+
+static unsigned int tablaCRC[256];
+
+static void minusculasEscalar(unsigned char *datos, int largo)
+{
+    int i;
+    for (i = 0; i < largo; i++)
+        if (datos[i] >= 'A' && datos[i] <= 'Z')
+            datos[i] += 'a' - 'A';
+}
+
+static int igualesEscalar(const unsigned char *a, const unsigned char *b, int largo)
+{
+    int i;
+    for (i = 0; i < largo; i++)
+    {
+        unsigned char x = a[i], y = b[i];
+        if (x >= 'A' && x <= 'Z')
+            x += 'a' - 'A';
+        if (y >= 'A' && y <= 'Z')
+            y += 'a' - 'A';
+        if (x != y)
+            return 0;
+    }
+    return 1;
+}
+
+static int buscarEscalar(const unsigned char *datos, int largo, unsigned char byte)
+{
+    const unsigned char *p = memchr(datos,byte,largo);
+    return p != NULL ? p - datos : largo;
+}
+
+static int esCaracterHost(unsigned char c)
+{
+    return ((c | 0x20) >= 'a' && (c | 0x20) <= 'z') || (c >= '0' && c <= '9') || c == '-';
+}
+
+static int caracteresHostEscalar(const unsigned char *datos, int largo)
+{
+    int i;
+    for (i = 0; i < largo; i++)
+        if (!esCaracterHost(datos[i]))
+            return i;
+    return largo;
+}
+
+static unsigned int crcEscalar(unsigned int crc, const unsigned char *datos, int largo)
+{
+    int i;
+    for (i = 0; i < largo; i++)
+        crc = tablaCRC[(crc ^ datos[i]) & 0xff] ^ (crc >> 8);
+    return crc;
+}
+
+static unsigned int hashEscalar(const unsigned char *datos, int largo)
+{
+    return ~crcEscalar(0xFFFFFFFF,datos,largo);
+}
+
+#ifdef VECTORIAL_X86
+
+/** ------------------------------------------------------------------------------------
+ * SSE2 (siempre presente en x86-64): 16 bytes por vuelta
+ ** ------------------------------------------------------------------------------------ **/
+
+/** 0xFF en cada byte que es una letra mayúscula. Los bytes >= 0x80 son negativos y no pasan 'A'-1 **/
+static inline __m128i mayusculas16(__m128i v)
+{
+    return _mm_and_si128(_mm_cmpgt_epi8(v,_mm_set1_epi8('A' - 1)),_mm_cmplt_epi8(v,_mm_set1_epi8('Z' + 1)));
+}
+
+static void minusculasSSE2(unsigned char *datos, int largo)
+{
+    int i;
+    for (i = 0; i + 16 <= largo; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)(datos + i));
+        v = _mm_or_si128(v,_mm_and_si128(mayusculas16(v),_mm_set1_epi8(0x20)));
+        _mm_storeu_si128((__m128i*)(datos + i),v);
+    }
+    minusculasEscalar(datos + i,largo - i);
+}
+
+static int igualesSSE2(const unsigned char *a, const unsigned char *b, int largo)
+{
+    int i;
+    for (i = 0; i + 16 <= largo; i += 16)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i*)(a + i)), y = _mm_loadu_si128((const __m128i*)(b + i));
+        x = _mm_or_si128(x,_mm_and_si128(mayusculas16(x),_mm_set1_epi8(0x20)));
+        y = _mm_or_si128(y,_mm_and_si128(mayusculas16(y),_mm_set1_epi8(0x20)));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(x,y)) != 0xFFFF)
+            return 0;
+    }
+    return igualesEscalar(a + i,b + i,largo - i);
+}
+
+static int buscarSSE2(const unsigned char *datos, int largo, unsigned char byte)
+{
+    __m128i buscado = _mm_set1_epi8((char)byte);
+    int i;
+    for (i = 0; i + 16 <= largo; i += 16)
+    {
+        int mascara = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(datos + i)),buscado));
+        if (mascara != 0)
+            return i + __builtin_ctz(mascara);
+    }
+    return i + buscarEscalar(datos + i,largo - i,byte);
+}
+
+/** 0xFF en cada byte que es letra, dígito o guión **/
+static inline __m128i caracteresHost16(__m128i v)
+{
+    __m128i minuscula = _mm_or_si128(v,_mm_set1_epi8(0x20));
+    __m128i letra = _mm_and_si128(_mm_cmpgt_epi8(minuscula,_mm_set1_epi8('a' - 1)),_mm_cmplt_epi8(minuscula,_mm_set1_epi8('z' + 1)));
+    __m128i digito = _mm_and_si128(_mm_cmpgt_epi8(v,_mm_set1_epi8('0' - 1)),_mm_cmplt_epi8(v,_mm_set1_epi8('9' + 1)));
+    return _mm_or_si128(_mm_or_si128(letra,digito),_mm_cmpeq_epi8(v,_mm_set1_epi8('-')));
+}
+
+static int caracteresHostSSE2(const unsigned char *datos, int largo)
+{
+    int i;
+    for (i = 0; i + 16 <= largo; i += 16)
+    {
+        int mascara = _mm_movemask_epi8(caracteresHost16(_mm_loadu_si128((const __m128i*)(datos + i))));
+        if (mascara != 0xFFFF)
+            return i + __builtin_ctz(~mascara);
+    }
+    return i + caracteresHostEscalar(datos + i,largo - i);
+}
+
+/** ------------------------------------------------------------------------------------
+ * AVX2: 32 bytes por vuelta; lo que sobra pasa a SSE2
+ ** ------------------------------------------------------------------------------------ **/
+
+__attribute__((target("avx2")))
+static inline __m256i mayusculas32(__m256i v)
+{
+    return _mm256_and_si256(_mm256_cmpgt_epi8(v,_mm256_set1_epi8('A' - 1)),_mm256_cmpgt_epi8(_mm256_set1_epi8('Z' + 1),v));
+}
+
+__attribute__((target("avx2")))
+static void minusculasAVX2(unsigned char *datos, int largo)
+{
+    int i;
+    for (i = 0; i + 32 <= largo; i += 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(datos + i));
+        v = _mm256_or_si256(v,_mm256_and_si256(mayusculas32(v),_mm256_set1_epi8(0x20)));
+        _mm256_storeu_si256((__m256i*)(datos + i),v);
+    }
+    minusculasSSE2(datos + i,largo - i);
+}
+
+__attribute__((target("avx2")))
+static int igualesAVX2(const unsigned char *a, const unsigned char *b, int largo)
+{
+    int i;
+    for (i = 0; i + 32 <= largo; i += 32)
+    {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(a + i)), y = _mm256_loadu_si256((const __m256i*)(b + i));
+        x = _mm256_or_si256(x,_mm256_and_si256(mayusculas32(x),_mm256_set1_epi8(0x20)));
+        y = _mm256_or_si256(y,_mm256_and_si256(mayusculas32(y),_mm256_set1_epi8(0x20)));
+        if ((unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x,y)) != 0xFFFFFFFFu)
+            return 0;
+    }
+    return igualesSSE2(a + i,b + i,largo - i);
+}
+
+__attribute__((target("avx2")))
+static int buscarAVX2(const unsigned char *datos, int largo, unsigned char byte)
+{
+    __m256i buscado = _mm256_set1_epi8((char)byte);
+    int i;
+    for (i = 0; i + 32 <= largo; i += 32)
+    {
+        unsigned int mascara = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(datos + i)),buscado));
+        if (mascara != 0)
+            return i + __builtin_ctz(mascara);
+    }
+    return i + buscarSSE2(datos + i,largo - i,byte);
+}
+
+__attribute__((target("avx2")))
+static int caracteresHostAVX2(const unsigned char *datos, int largo)
+{
+    int i;
+    for (i = 0; i + 32 <= largo; i += 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(datos + i));
+        __m256i minuscula = _mm256_or_si256(v,_mm256_set1_epi8(0x20));
+        __m256i letra = _mm256_and_si256(_mm256_cmpgt_epi8(minuscula,_mm256_set1_epi8('a' - 1)),_mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1),minuscula));
+        __m256i digito = _mm256_and_si256(_mm256_cmpgt_epi8(v,_mm256_set1_epi8('0' - 1)),_mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1),v));
+        __m256i valido = _mm256_or_si256(_mm256_or_si256(letra,digito),_mm256_cmpeq_epi8(v,_mm256_set1_epi8('-')));
+        unsigned int mascara = _mm256_movemask_epi8(valido);
+        if (mascara != 0xFFFFFFFFu)
+            return i + __builtin_ctz(~mascara);
+    }
+    return i + caracteresHostSSE2(datos + i,largo - i);
+}
+
+/** ------------------------------------------------------------------------------------
+ * CRC32C por hardware (SSE4.2): 8 bytes por instrucción, mismo polinomio que la tabla
+ ** ------------------------------------------------------------------------------------ **/
+
+__attribute__((target("sse4.2")))
+static unsigned int hashSSE42(const unsigned char *datos, int largo)
+{
+    unsigned int crc = 0xFFFFFFFF;
+    int i = 0;
+#ifdef __x86_64__
+    unsigned long long crc64 = crc;
+    for (; i + 8 <= largo; i += 8)
+    {
+        unsigned long long palabra;
+        memcpy(&palabra,datos + i,8);
+        crc64 = _mm_crc32_u64(crc64,palabra);
+    }
+    crc = (unsigned int)crc64;
+#endif
+    for (; i + 4 <= largo; i += 4)
+    {
+        unsigned int palabra;
+        memcpy(&palabra,datos + i,4);
+        crc = _mm_crc32_u32(crc,palabra);
+    }
+    for (; i < largo; i++)
+        crc = _mm_crc32_u8(crc,datos[i]);
+    return ~crc;
+}
+
+#endif // VECTORIAL_X86
+
+/** ------------------------------------------------------------------------------------
+ * Selección en tiempo de ejecución
+ ** ------------------------------------------------------------------------------------ **/
+
+static void (*minusculas)(unsigned char*, int) = minusculasEscalar;
+static int (*iguales)(const unsigned char*, const unsigned char*, int) = igualesEscalar;
+static int (*buscar)(const unsigned char*, int, unsigned char) = buscarEscalar;
+static int (*caracteresHost)(const unsigned char*, int) = caracteresHostEscalar;
+static unsigned int (*hash)(const unsigned char*, int) = hashEscalar;
+static const char *nivel = "escalar";
+
+/** Corre antes de main: así los punteros no cambian mientras otros hilos los usan **/
+__attribute__((constructor))
+static void elegirVersiones()
+{
+    unsigned int i, j;
+    /** tabla del CRC32C reflejado (polinomio 0x1EDC6F41 invertido) **/
+    for (i = 0; i < 256; i++)
+    {
+        unsigned int crc = i;
+        for (j = 0; j < 8; j++)
+            crc = (crc >> 1) ^ ((crc & 1) ? 0x82F63B78 : 0);
+        tablaCRC[i] = crc;
+    }
+#ifdef VECTORIAL_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2"))
+    {
+        minusculas = minusculasSSE2;
+        iguales = igualesSSE2;
+        buscar = buscarSSE2;
+        caracteresHost = caracteresHostSSE2;
+        nivel = "sse2";
+    }
+    if (__builtin_cpu_supports("sse4.2"))
+    {
+        hash = hashSSE42;
+        nivel = "sse4.2";
+    }
+    if (__builtin_cpu_supports("avx2"))
+    {
+        minusculas = minusculasAVX2;
+        iguales = igualesAVX2;
+        buscar = buscarAVX2;
+        caracteresHost = caracteresHostAVX2;
+        nivel = "avx2";
+    }
+#endif
+}
+
+void vectorialMinusculas(unsigned char *datos, int largo)
+{
+    minusculas(datos,largo);
+}
+
+int vectorialIgualesSinMayusculas(const unsigned char *a, const unsigned char *b, int largo)
+{
+    return iguales(a,b,largo);
+}
+
+int vectorialBuscarByte(const unsigned char *datos, int largo, unsigned char byte)
+{
+    return buscar(datos,largo,byte);
+}
+
+int vectorialCaracteresHost(const unsigned char *datos, int largo)
+{
+    return caracteresHost(datos,largo);
+}
+
+unsigned int vectorialHash(const unsigned char *datos, int largo)
+{
+    return hash(datos,largo);
+}
+
+const char *vectorialNivel()
+{
+    return nivel;
+}
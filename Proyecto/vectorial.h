@@ -0,0 +1,30 @@
+#ifndef VECTORIAL_H_INCLUDED
+#define VECTORIAL_H_INCLUDED
+
+/**
+ * Rutinas por byte del camino caliente (nombres de dominio en el servidor y en los modos masivos)
+ * en versiones vectoriales: SSE2, AVX2 y CRC32 de SSE4.2, con una versión escalar equivalente.
+ * La versión se elige una sola vez al arrancar según lo que soporte el procesador, así que el
+ * mismo ejecutable corre en cualquier x86-64 (y, sólo con las escalares, en otras arquitecturas).
+ * Todas las versiones dan exactamente el mismo resultado.
+ **/
+
+/** Pasa a minúsculas las letras ASCII (el resto de los bytes no cambia) **/
+void vectorialMinusculas(unsigned char *datos, int largo);
+
+/** Compara sin distinguir mayúsculas ASCII; 1 si son iguales **/
+int vectorialIgualesSinMayusculas(const unsigned char *a, const unsigned char *b, int largo);
+
+/** Posición de la primera aparición de byte, o largo si no está **/
+int vectorialBuscarByte(const unsigned char *datos, int largo, unsigned char byte);
+
+/** Posición del primer byte que no es letra, dígito ni guión (RFC 1123), o largo si son todos válidos **/
+int vectorialCaracteresHost(const unsigned char *datos, int largo);
+
+/** CRC32C (Castagnoli) de los datos, usado como hash de nombres **/
+unsigned int vectorialHash(const unsigned char *datos, int largo);
+
+/** Nombre del conjunto de instrucciones elegido ("avx2", "sse4.2", "sse2" o "escalar") **/
+const char *vectorialNivel();
+
+#endif // VECTORIAL_H_INCLUDED
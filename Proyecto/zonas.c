@@ -0,0 +1,676 @@
+#define _GNU_SOURCE
+#include<stdio.h>
+#include<string.h>
+#include<stdlib.h>
+#include<ctype.h>
+#include<sys/socket.h>
+#include<arpa/inet.h>
+#include<netinet/in.h>
+#include<unistd.h>
+
+#include "dns.h"
+#include "tipos_rr.h"
+#include "nombres.h"
+#include "vectorial.h"
+#include "zonas.h"
+#include "direcciones.h"
+
+#define MAX_CAMPOS 512
+#define MAX_LINEA_LOGICA 65536
+#define LOTE_SERVIDOR 64
+#define MAX_RESPUESTA_UDP 512
+
+/** RRs de un mismo nombre y tipo, codificados como van en la respuesta (dueño = 0xC00C) **/
+typedef struct CONJUNTO_RR
+{
+    unsigned short tipo;
+    unsigned short cantidad;
+    unsigned char *wire;
+    int largo;
+    int capacidad;
+    struct CONJUNTO_RR *siguiente;
+} CONJUNTO_RR;
+
+typedef struct NODO_NOMBRE
+{
+    unsigned char *nombre;          // formato DNS, en minúsculas
+    int largoNombre;
+    unsigned int hash;
+    CONJUNTO_RR *conjuntos;         // NULL en los nombres intermedios sin registros
+    struct NODO_NOMBRE *siguiente;
+} NODO_NOMBRE;
+
+typedef struct
+{
+    unsigned char nombre[256];
+    int largo;
+    NODO_NOMBRE *apex;
+} ZONA;
+
+static NODO_NOMBRE **tabla;
+static unsigned int cubetas, nodos;
+static ZONA *zonas;
+static int cantidadZonas;
+
+int zonasCargadas()
+{
+    return cantidadZonas;
+}
+
+static NODO_NOMBRE *buscarNodo(const unsigned char *nombre, int largo)
+{
+    NODO_NOMBRE *n;
+    unsigned int h;
+    if (cubetas == 0)
+        return NULL;
+    h = hashNombreDNS(nombre,largo);
+    for (n = tabla[h % cubetas]; n != NULL; n = n->siguiente)
+        if (n->hash == h && n->largoNombre == largo && memcmp(n->nombre,nombre,largo) == 0)
+            return n;
+    return NULL;
+}
+
+/** Duplica las cubetas cuando hay más nombres que cubetas **/
+static void crecerTabla()
+{
+    unsigned int nuevas = cubetas ? cubetas * 2 : 1024, i;
+    NODO_NOMBRE **nueva = (NODO_NOMBRE**)calloc(nuevas,sizeof(NODO_NOMBRE*));
+    for (i = 0; i < cubetas; i++)
+        while (tabla[i] != NULL)
+        {
+            NODO_NOMBRE *n = tabla[i];
+            tabla[i] = n->siguiente;
+            n->siguiente = nueva[n->hash % nuevas];
+            nueva[n->hash % nuevas] = n;
+        }
+    free(tabla);
+    tabla = nueva;
+    cubetas = nuevas;
+}
+
+/** Busca el nombre o lo crea, junto con los nombres intermedios que falten hacia la raíz **/
+static NODO_NOMBRE *obtenerNodo(const unsigned char *nombre, int largo)
+{
+    NODO_NOMBRE *n = buscarNodo(nombre,largo);
+    if (n != NULL)
+        return n;
+    if (nodos >= cubetas)
+        crecerTabla();
+    n = (NODO_NOMBRE*)calloc(1,sizeof(NODO_NOMBRE));
+    n->nombre = (unsigned char*)malloc(largo);
+    memcpy(n->nombre,nombre,largo);
+    n->largoNombre = largo;
+    n->hash = hashNombreDNS(nombre,largo);
+    n->siguiente = tabla[n->hash % cubetas];
+    tabla[n->hash % cubetas] = n;
+    nodos++;
+    if (nombre[0] != 0)
+        obtenerNodo(nombre + nombre[0] + 1,largo - nombre[0] - 1);
+    return n;
+}
+
+static CONJUNTO_RR *buscarConjunto(NODO_NOMBRE *n, int tipo)
+{
+    CONJUNTO_RR *c;
+    for (c = n->conjuntos; c != NULL; c = c->siguiente)
+        if (c->tipo == tipo)
+            return c;
+    return NULL;
+}
+
+/** Agrega el RR a su RRset; los duplicados se ignoran (un RRset es un conjunto, RFC 2181 5) **/
+static void agregarRegistro(const unsigned char *dueno, int largoDueno, int tipo, unsigned int ttl,
+                            const unsigned char *rdata, int rdlength)
+{
+    NODO_NOMBRE *n = obtenerNodo(dueno,largoDueno);
+    CONJUNTO_RR *c = buscarConjunto(n,tipo);
+    int pos;
+    if (c == NULL)
+    {
+        c = (CONJUNTO_RR*)calloc(1,sizeof(CONJUNTO_RR));
+        c->tipo = tipo;
+        c->siguiente = n->conjuntos;
+        n->conjuntos = c;
+    }
+    for (pos = 0; pos < c->largo; pos += 12 + ((c->wire[pos+10] << 8) | c->wire[pos+11]))
+        if (((c->wire[pos+10] << 8) | c->wire[pos+11]) == rdlength && memcmp(c->wire + pos + 12,rdata,rdlength) == 0)
+            return;
+
+    if (c->largo + 12 + rdlength > c->capacidad)
+    {
+        c->capacidad = (c->largo + 12 + rdlength) * 2;
+        c->wire = (unsigned char*)realloc(c->wire,c->capacidad);
+    }
+    unsigned char *p = c->wire + c->largo;
+    struct R_DATA campos = {tipo, 1, ttl, rdlength};    /** clase IN **/
+    p[0] = 0xc0;                    /** puntero al nombre de la pregunta **/
+    p[1] = 12;
+    camposRREscribir(&campos,p + 2);
+    memcpy(p + 12,rdata,rdlength);
+    c->largo += 12 + rdlength;
+    c->cantidad++;
+
+    /** el SOA marca el apex de una zona **/
+    if (tipo == T_SOA)
+    {
+        int i;
+        for (i = 0; i < cantidadZonas; i++)
+            if (zonas[i].apex == n)
+                return;
+        zonas = (ZONA*)realloc(zonas,(cantidadZonas + 1) * sizeof(ZONA));
+        memcpy(zonas[cantidadZonas].nombre,dueno,largoDueno);
+        zonas[cantidadZonas].largo = largoDueno;
+        zonas[cantidadZonas].apex = n;
+        cantidadZonas++;
+    }
+}
+
+/**
+ * Agrega una línea física a la línea lógica: quita los comentarios y los paréntesis (que sólo
+ * sirven para continuar el registro en la línea siguiente) respetando las comillas.
+ * Devuelve la profundidad de paréntesis que queda abierta.
+ **/
+static int agregarLineaFisica(char *logica, int *largo, const char *linea, int profundidad)
+{
+    int comillas = 0;
+    for (; *linea && *linea != '\n' && *largo < MAX_LINEA_LOGICA - 2; linea++)
+    {
+        if (*linea == '\\' && linea[1] && linea[1] != '\n')
+        {
+            logica[(*largo)++] = *linea++;
+            logica[(*largo)++] = *linea;
+            continue;
+        }
+        if (*linea == '"')
+            comillas = !comillas;
+        else if (!comillas && *linea == ';')
+            break;
+        else if (!comillas && (*linea == '(' || *linea == ')'))
+        {
+            profundidad += (*linea == '(') ? 1 : -1;
+            logica[(*largo)++] = ' ';
+            continue;
+        }
+        logica[(*largo)++] = *linea;
+    }
+    logica[(*largo)++] = ' ';
+    logica[*largo] = '\0';
+    return profundidad;
+}
+
+/** Separa la línea lógica en campos, en el lugar; a los campos entre comillas se les quitan las comillas **/
+static int separarCampos(char *logica, char *campos[], int max)
+{
+    int cantidad = 0;
+    char *p = logica;
+    while (*p && cantidad < max)
+    {
+        while (*p == ' ' || *p == '\t' || *p == '\r')
+            p++;
+        if (*p == '\0')
+            break;
+        if (*p == '"')
+        {
+            campos[cantidad++] = ++p;
+            while (*p && *p != '"')
+                p += (*p == '\\' && p[1]) ? 2 : 1;
+        }
+        else
+        {
+            campos[cantidad++] = p;
+            while (*p && *p != ' ' && *p != '\t' && *p != '\r')
+                p += (*p == '\\' && p[1]) ? 2 : 1;
+        }
+        if (*p)
+            *p++ = '\0';
+    }
+    return cantidad;
+}
+
+/**
+ * Como check-names de BIND: los dueños de A y AAAA y los destinos de NS y MX deberían ser nombres
+ * de host (RFC 1123). Sólo se avisa; el registro se carga igual.
+ **/
+static void revisarNombreHost(const char *archivo, int linea, int tipo, const unsigned char *dueno, int largoDueno,
+                             const unsigned char *rdata, int rdlength)
+{
+    NOMBRE_DNS nombre;
+    char texto[256];
+    int valido = 1;
+    if (tipo == T_A || tipo == T_AAAA)
+        valido = nombreDesdeWire(dueno,largoDueno,&nombre) < 0 || nombreEsHostname(&nombre);
+    else if (tipo == T_NS)
+        valido = nombreDesdeWire(rdata,rdlength,&nombre) < 0 || nombreEsHostname(&nombre);
+    else if (tipo == T_MX && rdlength > 2)
+        valido = nombreDesdeWire(rdata + 2,rdlength - 2,&nombre) < 0 || nombreEsHostname(&nombre);
+    if (!valido)
+        printf("%s:%d: advertencia: %s no es un nombre de host válido\n",archivo,linea,nombreATexto(&nombre,texto));
+}
+
+int zonaCargarArchivo(const char *archivo)
+{
+    char textoTipo[LARGO_TEXTO_TIPO];
+    static char logica[MAX_LINEA_LOGICA];
+    static unsigned char rdata[65536];
+    char linea[4096], *campos[MAX_CAMPOS];
+    unsigned char origen[256] = {0}, dueno[256];
+    int largoDueno = 0, numeroLinea = 0, comienzo = 0, profundidad = 0, largoLogica = 0;
+    int cargados = 0, errores = 0, blancoInicial = 0;
+    unsigned int ttlOmision = 3600;     /** el de $TTL, para los registros que no traen el suyo (RFC 2308 4) **/
+    FILE *f = fopen(archivo,"r");
+    if (f == NULL)
+    {
+        printf("ERROR: no se pudo abrir el archivo de zona %s\n",archivo);
+        return -1;
+    }
+
+    while (fgets(linea,sizeof(linea),f) != NULL)
+    {
+        numeroLinea++;
+        if (profundidad == 0)
+        {
+            comienzo = numeroLinea;
+            largoLogica = 0;
+            blancoInicial = (linea[0] == ' ' || linea[0] == '\t');
+        }
+        profundidad = agregarLineaFisica(logica,&largoLogica,linea,profundidad);
+        if (profundidad > 0)
+            continue;
+
+        int cantidad = separarCampos(logica,campos,MAX_CAMPOS), i = 0;
+        if (cantidad == 0)
+            continue;
+
+        /** directivas **/
+        if (campos[0][0] == '$')
+        {
+            if (strcasecmp(campos[0],"$ORIGIN") == 0 && cantidad == 2 && nombreDesdeTexto(campos[1],origen,dueno) > 0)
+            {
+                memcpy(origen,dueno,largoNombreDNS(dueno));
+                nombrePasarAMinusculas(origen,largoNombreDNS(origen));
+            }
+            else if (strcasecmp(campos[0],"$TTL") == 0 && cantidad == 2 && leerTiempo(campos[1],&ttlOmision) == 0)
+                ;
+            else
+            {
+                printf("%s:%d: directiva no soportada o no válida: %s\n",archivo,comienzo,campos[0]);
+                errores++;
+            }
+            continue;
+        }
+
+        /** dueño: si la línea empieza con un blanco, es el del registro anterior **/
+        if (!blancoInicial)
+        {
+            if ((largoDueno = nombreDesdeTexto(campos[i++],origen,dueno)) < 0)
+            {
+                printf("%s:%d: nombre no válido: %s\n",archivo,comienzo,campos[0]);
+                errores++;
+                continue;
+            }
+            nombrePasarAMinusculas(dueno,largoDueno);
+        }
+        else if (largoDueno == 0)
+        {
+            printf("%s:%d: registro sin dueño\n",archivo,comienzo);
+            errores++;
+            continue;
+        }
+
+        /** TTL y clase, en cualquier orden; el TTL vale sólo para este registro **/
+        unsigned int ttl = ttlOmision;
+        int claseIN = 1, tipo;
+        while (i < cantidad)
+        {
+            unsigned int valor;
+            if (isdigit((unsigned char)campos[i][0]) && leerTiempo(campos[i],&valor) == 0)
+                ttl = valor;
+            else if (strcasecmp(campos[i],"IN") == 0)
+                ;
+            else if (strcasecmp(campos[i],"CH") == 0 || strcasecmp(campos[i],"HS") == 0 || strcasecmp(campos[i],"CS") == 0)
+                claseIN = 0;
+            else
+                break;
+            i++;
+        }
+        if (!claseIN)
+            continue;
+        if (i >= cantidad || (tipo = tipoDesdeNombre(campos[i])) == 0)
+        {
+            printf("%s:%d: tipo desconocido: %s\n",archivo,comienzo,i < cantidad ? campos[i] : "");
+            errores++;
+            continue;
+        }
+
+        int rdlength = codificarRDATA(tipo,campos + i + 1,cantidad - i - 1,origen,rdata,sizeof(rdata));
+        if (rdlength < 0)
+        {
+            printf("%s:%d: RDATA no válido para %s\n",archivo,comienzo,mapearTipo(tipo,textoTipo));
+            errores++;
+            continue;
+        }
+        revisarNombreHost(archivo,comienzo,tipo,dueno,largoDueno,rdata,rdlength);
+        agregarRegistro(dueno,largoDueno,tipo,ttl,rdata,rdlength);
+        cargados++;
+    }
+    fclose(f);
+    if (errores > 0)
+        printf(";; %s: %d líneas con errores se ignoraron\n",archivo,errores);
+    return cargados;
+}
+
+/** ------------------------------------------------------------------------------------
+    Respuestas
+    ------------------------------------------------------------------------------------ **/
+
+/**
+ * Copia el RRset a la respuesta. Sin dueño, el RRset se copia tal cual (dueño = nombre de la
+ * pregunta); con dueño, cada RR se copia detrás del nombre completo. Devuelve -1 si no entra.
+ **/
+static int copiarConjunto(unsigned char *respuesta, int *pos, int max, CONJUNTO_RR *c,
+                          const unsigned char *dueno, int largoDueno)
+{
+    int p;
+    if (dueno == NULL)
+    {
+        if (*pos + c->largo > max)
+            return -1;
+        memcpy(respuesta + *pos,c->wire,c->largo);
+        *pos += c->largo;
+        return 0;
+    }
+    if (*pos + c->largo + c->cantidad * (largoDueno - 2) > max)
+        return -1;
+    for (p = 0; p < c->largo; )
+    {
+        int largoRR = 12 + ((c->wire[p+10] << 8) | c->wire[p+11]);
+        memcpy(respuesta + *pos,dueno,largoDueno);
+        memcpy(respuesta + *pos + largoDueno,c->wire + p + 2,largoRR - 2);
+        *pos += largoDueno + largoRR - 2;
+        p += largoRR;
+    }
+    return 0;
+}
+
+/** Las direcciones (A y AAAA) de los servidores de un RRset NS, si están en los datos cargados **/
+static int agregarPegamento(unsigned char *respuesta, int *pos, int max, CONJUNTO_RR *ns, int *adicionales)
+{
+    int p;
+    for (p = 0; p < ns->largo; p += 12 + ((ns->wire[p+10] << 8) | ns->wire[p+11]))
+    {
+        unsigned char servidor[256];
+        int largo = largoNombreDNS(ns->wire + p + 12), tipos[2] = {T_A, T_AAAA}, t;
+        memcpy(servidor,ns->wire + p + 12,largo);
+        nombrePasarAMinusculas(servidor,largo);
+        NODO_NOMBRE *n = buscarNodo(servidor,largo);
+        for (t = 0; n != NULL && t < 2; t++)
+        {
+            CONJUNTO_RR *c = buscarConjunto(n,tipos[t]);
+            if (c == NULL)
+                continue;
+            if (copiarConjunto(respuesta,pos,max,c,servidor,largo) < 0)
+                return -1;
+            *adicionales += c->cantidad;
+        }
+    }
+    return 0;
+}
+
+/** Largo del header más la pregunta, o -1 si la sección Question no es válida **/
+static int largoPregunta(const unsigned char *consulta, int largo)
+{
+    int pos = TAM_CABECERA;
+    if (largo < TAM_CABECERA || leer16(consulta + 4) != 1)
+        return -1;
+    while (pos < largo && consulta[pos] != 0)
+    {
+        if (consulta[pos] > 63)
+            return -1;
+        pos += consulta[pos] + 1;
+    }
+    pos += 1 + 4;
+    return (pos <= largo && pos - 12 - 4 <= 255) ? pos : -1;
+}
+
+/** Respuesta vacía con el rcode indicado (REFUSED, FORMERR...), repitiendo la pregunta si es válida **/
+static int responderError(const unsigned char *consulta, int largo, unsigned char *respuesta, int rcode)
+{
+    int pregunta = largoPregunta(consulta,largo);
+    CABECERA_DNS pedido, cabecera = {0};
+    if (largo < TAM_CABECERA)
+        return -1;
+    cabeceraLeer(consulta,&pedido);
+    memmove(respuesta,consulta,pregunta > 0 ? pregunta : TAM_CABECERA);
+    /** QR, mismo opcode y RD **/
+    cabecera.id = pedido.id;
+    cabecera.qr = 1;
+    cabecera.opcode = pedido.opcode;
+    cabecera.rd = pedido.rd;
+    cabecera.rcode = rcode;
+    cabecera.qdcount = pregunta > 0;
+    cabeceraEscribir(&cabecera,respuesta);
+    return pregunta > 0 ? pregunta : TAM_CABECERA;
+}
+
+/** Contadores y banderas de la respuesta que se está armando **/
+typedef struct
+{
+    int rcode;
+    int autoritativa;
+    int respuestas, autoridad, adicionales;
+} SECCIONES;
+
+/**
+ * Agrega a la respuesta (desde pos) las secciones Answer, Authority y Additional para qname.
+ * etiquetas tiene los desplazamientos de cada sufijo de qname, hasta el apex de la zona
+ * (el último). Devuelve -1 si la respuesta no entra en max bytes.
+ **/
+static int armarSecciones(const unsigned char *qname, int largoQname, int qtype, ZONA *zona, const int *etiquetas,
+                          int cantidadEtiquetas, unsigned char *respuesta, int *pos, int max, SECCIONES *s)
+{
+    CONJUNTO_RR *c;
+    NODO_NOMBRE *n;
+    int i, alias;
+
+    /** delegación: un NS por debajo del apex, del corte más alto al más bajo **/
+    for (i = cantidadEtiquetas - 2; i >= 0; i--)
+    {
+        n = buscarNodo(qname + etiquetas[i],largoQname - etiquetas[i]);
+        if (n != NULL && (c = buscarConjunto(n,T_NS)) != NULL)
+        {
+            s->autoritativa = 0;
+            if (copiarConjunto(respuesta,pos,max,c,qname + etiquetas[i],largoQname - etiquetas[i]) < 0)
+                return -1;
+            s->autoridad = c->cantidad;
+            return agregarPegamento(respuesta,pos,max,c,&s->adicionales);
+        }
+    }
+
+    /** el nombre y, si es un alias, la cadena de alias dentro de los datos cargados **/
+    if ((n = buscarNodo(qname,largoQname)) == NULL)
+        s->rcode = 3;
+    for (alias = 0; n != NULL && alias <= MAX_CNAME; alias++)
+    {
+        const unsigned char *dueno = (alias == 0) ? NULL : n->nombre;
+        if (qtype == 255)
+        {
+            for (c = n->conjuntos; c != NULL; c = c->siguiente)
+            {
+                if (copiarConjunto(respuesta,pos,max,c,dueno,n->largoNombre) < 0)
+                    return -1;
+                s->respuestas += c->cantidad;
+            }
+            break;
+        }
+        if ((c = buscarConjunto(n,qtype)) != NULL)
+        {
+            if (copiarConjunto(respuesta,pos,max,c,dueno,n->largoNombre) < 0)
+                return -1;
+            s->respuestas += c->cantidad;
+            break;
+        }
+        if (qtype == T_CNAME || (c = buscarConjunto(n,T_CNAME)) == NULL)
+            break;
+        if (copiarConjunto(respuesta,pos,max,c,dueno,n->largoNombre) < 0)
+            return -1;
+        s->respuestas += c->cantidad;
+
+        unsigned char destino[256];
+        int largoDestino = largoNombreDNS(c->wire + 12);
+        memcpy(destino,c->wire + 12,largoDestino);
+        nombrePasarAMinusculas(destino,largoDestino);
+        n = buscarNodo(destino,largoDestino);
+    }
+
+    /** NXDOMAIN o NODATA: el SOA de la zona en la sección Authority (RFC 2308) **/
+    if (s->respuestas == 0 && (c = buscarConjunto(zona->apex,T_SOA)) != NULL)
+    {
+        if (copiarConjunto(respuesta,pos,max,c,zona->nombre,zona->largo) < 0)
+            return -1;
+        s->autoridad = c->cantidad;
+    }
+    return 0;
+}
+
+int zonaResponder(const unsigned char *consulta, int largo, unsigned char *respuesta, int max)
+{
+    unsigned char qname[256];
+    int pregunta, largoQname, qtype, qclass, zona = -1, etiquetas[128], cantidadEtiquetas = 0, pos, i;
+    SECCIONES s = {0, 1, 0, 0, 0};
+    CABECERA_DNS pedido, cabecera = {0};
+
+    if (cantidadZonas == 0)
+        return 0;
+    if ((pregunta = largoPregunta(consulta,largo)) < 0)
+        return -1;
+    cabeceraLeer(consulta,&pedido);
+    if (pedido.qr || pedido.opcode != 0)     /** sólo consultas estándar **/
+        return 0;
+    largoQname = pregunta - TAM_CABECERA - TAM_PREGUNTA;
+    memcpy(qname,consulta + TAM_CABECERA,largoQname);
+    nombrePasarAMinusculas(qname,largoQname);
+    qtype = leer16(consulta + pregunta - 4);
+    qclass = leer16(consulta + pregunta - 2);
+    if (qclass != 1 && qclass != 255)
+        return 0;
+
+    /** la zona más específica que contiene al nombre: pruebo los sufijos de más largo a más corto **/
+    for (i = 0; zona < 0; i += qname[i] + 1)
+    {
+        int z;
+        etiquetas[cantidadEtiquetas++] = i;
+        for (z = 0; z < cantidadZonas; z++)
+            if (zonas[z].largo == largoQname - i && memcmp(zonas[z].nombre,qname + i,zonas[z].largo) == 0)
+                zona = z;
+        if (qname[i] == 0)
+            break;
+    }
+    if (zona < 0)
+        return 0;
+
+    memmove(respuesta,consulta,pregunta);
+    pos = pregunta;
+    if (armarSecciones(qname,largoQname,qtype,&zonas[zona],etiquetas,cantidadEtiquetas,respuesta,&pos,max,&s) < 0)
+    {
+        /** no entra: sólo la pregunta, con TC para que el cliente reintente por TCP **/
+        pos = pregunta;
+        s.rcode = s.respuestas = s.autoridad = s.adicionales = 0;
+        cabecera.tc = 1;
+    }
+    cabecera.id = pedido.id;
+    cabecera.qr = 1;
+    cabecera.aa = s.autoritativa != 0;
+    cabecera.rd = pedido.rd;
+    cabecera.rcode = s.rcode;
+    cabecera.qdcount = 1;
+    cabecera.ancount = s.respuestas;
+    cabecera.nscount = s.autoridad;
+    cabecera.arcount = s.adicionales;
+    cabeceraEscribir(&cabecera,respuesta);
+    return pos;
+}
+
+int zonaServir(const char *direccion)
+{
+    static unsigned char consultas[LOTE_SERVIDOR][MAX_RESPUESTA_UDP];
+    static unsigned char respuestas[LOTE_SERVIDOR][MAX_RESPUESTA_UDP];
+    struct mmsghdr recibidos[LOTE_SERVIDOR], enviados[LOTE_SERVIDOR];
+    struct iovec vectoresRecibidos[LOTE_SERVIDOR], vectoresEnviados[LOTE_SERVIDOR];
+    DIRECCION origenes[LOTE_SERVIDOR], local;
+    char ip[INET6_ADDRSTRLEN] = "0.0.0.0";
+    const char *puerto = direccion, *cierre, *dosPuntos = strrchr(direccion,':');
+    int s, i, n;
+
+    /** "puerto", "ip:puerto" o, para IPv6, "[ip]:puerto" (como @servidor) **/
+    if (direccion[0] == '[' && (cierre = strchr(direccion,']')) != NULL && cierre[1] == ':')
+    {
+        snprintf(ip,sizeof(ip),"%.*s",(int)(cierre - direccion - 1),direccion + 1);
+        puerto = cierre + 2;
+    }
+    else if (dosPuntos != NULL)
+    {
+        snprintf(ip,sizeof(ip),"%.*s",(int)(dosPuntos - direccion),direccion);
+        puerto = dosPuntos + 1;
+    }
+    if (direccionDesdeTexto(&local,ip,atoi(puerto)) < 0)
+    {
+        printf("ERROR: dirección no válida para el servidor: %s\n",ip);
+        return -1;
+    }
+    if ((s = socket(local.sa.sa_family,SOCK_DGRAM,IPPROTO_UDP)) < 0 || bind(s,&local.sa,direccionLargo(&local)) < 0)
+    {
+        perror("bind error");
+        return -1;
+    }
+    printf(";; sirviendo %d zonas (%u nombres) en %s%s%s:%s, rutinas de nombres: %s\n",cantidadZonas,nodos,
+           local.sa.sa_family == AF_INET6 ? "[" : "",ip,local.sa.sa_family == AF_INET6 ? "]" : "",puerto,vectorialNivel());
+    fflush(stdout);
+
+    while (1)
+    {
+        for (i = 0; i < LOTE_SERVIDOR; i++)
+        {
+            vectoresRecibidos[i].iov_base = consultas[i];
+            vectoresRecibidos[i].iov_len = MAX_RESPUESTA_UDP;
+            memset(&recibidos[i].msg_hdr,0,sizeof(recibidos[i].msg_hdr));
+            recibidos[i].msg_hdr.msg_iov = &vectoresRecibidos[i];
+            recibidos[i].msg_hdr.msg_iovlen = 1;
+            recibidos[i].msg_hdr.msg_name = &origenes[i];
+            recibidos[i].msg_hdr.msg_namelen = sizeof(origenes[i]);
+        }
+        /** espera la primera consulta y toma todas las que ya estén en la cola **/
+        if ((n = recvmmsg(s,recibidos,LOTE_SERVIDOR,MSG_WAITFORONE,NULL)) <= 0)
+            continue;
+
+        int aEnviar = 0;
+        for (i = 0; i < n; i++)
+        {
+            CABECERA_DNS pedido;
+            /** a una respuesta (QR) o a algo más corto que una cabecera no se contesta nada: si se contestara
+                con REFUSED, un paquete con el origen falsificado haría que dos servidores se respondan sin fin **/
+            if ((int)recibidos[i].msg_len < TAM_CABECERA)
+                continue;
+            cabeceraLeer(consultas[i],&pedido);
+            if (pedido.qr)
+                continue;
+            int largo = zonaResponder(consultas[i],recibidos[i].msg_len,respuestas[aEnviar],MAX_RESPUESTA_UDP);
+            if (largo == 0)
+                largo = responderError(consultas[i],recibidos[i].msg_len,respuestas[aEnviar],5);   /** REFUSED **/
+            else if (largo < 0)
+                largo = responderError(consultas[i],recibidos[i].msg_len,respuestas[aEnviar],1);   /** FORMERR **/
+            if (largo <= 0)
+                continue;
+            vectoresEnviados[aEnviar].iov_base = respuestas[aEnviar];
+            vectoresEnviados[aEnviar].iov_len = largo;
+            memset(&enviados[aEnviar].msg_hdr,0,sizeof(enviados[aEnviar].msg_hdr));
+            enviados[aEnviar].msg_hdr.msg_iov = &vectoresEnviados[aEnviar];
+            enviados[aEnviar].msg_hdr.msg_iovlen = 1;
+            enviados[aEnviar].msg_hdr.msg_name = &origenes[i];
+            enviados[aEnviar].msg_hdr.msg_namelen = recibidos[i].msg_hdr.msg_namelen;
+            aEnviar++;
+        }
+        if (aEnviar > 0)
+            sendmmsg(s,enviados,aEnviar,0);
+    }
+    return 0;
+}
@@ -0,0 +1,38 @@
+#ifndef ZONAS_H_INCLUDED
+#define ZONAS_H_INCLUDED
+
+/**
+ * Datos autoritativos cargados desde archivos de zona (parámetro -zona=).
+ * Los archivos siguen el formato de RFC 1035 5 ($ORIGIN, $TTL, "@", nombres relativos, dueño
+ * omitido, paréntesis y comentarios), incluidos los generados por -axfr.
+ *
+ * Índice: una tabla hash por nombre (en formato DNS y en minúsculas). Cada nombre guarda sus
+ * RRsets ya codificados tal como van en la respuesta, con el dueño comprimido como un puntero
+ * al nombre de la pregunta (0xC00C): responder es una búsqueda en la tabla y un memcpy por
+ * RRset. Los nombres intermedios sin registros (empty non-terminals) también están en la
+ * tabla, para contestar NODATA en lugar de NXDOMAIN.
+ **/
+
+/** Carga un archivo de zona; devuelve la cantidad de registros cargados, o -1 si no se pudo abrir **/
+int zonaCargarArchivo(const char *archivo);
+
+/** Cantidad de zonas cargadas (una por cada SOA) **/
+int zonasCargadas();
+
+/**
+ * Contesta una consulta con los datos cargados, como lo haría el servidor autoritativo de la
+ * zona (respuesta, alias, delegación, NODATA o NXDOMAIN). respuesta puede ser el mismo buffer
+ * que consulta. Si la respuesta no entra en max bytes se devuelve truncada (bit TC).
+ * Devuelve el largo de la respuesta, 0 si el nombre no pertenece a ninguna zona cargada (o la
+ * consulta no es una consulta estándar de clase IN), o -1 si la consulta está mal formada.
+ **/
+int zonaResponder(const unsigned char *consulta, int largo, unsigned char *respuesta, int max);
+
+/**
+ * Modo servidor (parámetro -servir): contesta por UDP en direccion ("[ip:]puerto"; una IPv6 va
+ * entre corchetes, "[::1]:5353") las consultas de las zonas cargadas, y con REFUSED las demás.
+ * No retorna salvo por un error.
+ **/
+int zonaServir(const char *direccion);
+
+#endif // ZONAS_H_INCLUDED